@@ -15,6 +15,7 @@
 #include <Timer.hh>
 
 #include <gh.hh>
+#include <tracing.hh>
 
 #include <carpet.hh>
 #include <PreSync.hh>
@@ -120,14 +121,17 @@ int CallFunction(void *function,           ///< the function to call
             BEGIN_REFLEVEL_LOOP(cctkGH) {
               if(do_psync)
                 PreSyncGroups(attribute, cctkGH, pre_groups);
-              BEGIN_LOCAL_MAP_LOOP(cctkGH, CCTK_GF) {
-                BEGIN_LOCAL_COMPONENT_LOOP(cctkGH, CCTK_GF) {
-                  CallScheduledFunction("Meta time local mode", function,
-                                        attribute, data, user_timer);
+              {
+                local_mode_restriction const restriction(attribute);
+                BEGIN_LOCAL_MAP_LOOP(cctkGH, CCTK_GF) {
+                  BEGIN_LOCAL_COMPONENT_LOOP(cctkGH, CCTK_GF) {
+                    CallScheduledFunction("Meta time local mode", function,
+                                          attribute, data, user_timer);
+                  }
+                  END_LOCAL_COMPONENT_LOOP;
                 }
-                END_LOCAL_COMPONENT_LOOP;
+                END_LOCAL_MAP_LOOP;
               }
-              END_LOCAL_MAP_LOOP;
               if (not sync_groups.empty()) {
                 SyncGroupsInScheduleBlock(attribute, cctkGH, sync_groups,
                                           sync_timer);
@@ -239,14 +243,17 @@ int CallFunction(void *function,           ///< the function to call
           BEGIN_REFLEVEL_LOOP(cctkGH) {
             if(do_psync)
               PreSyncGroups(attribute, cctkGH, pre_groups);
-            BEGIN_LOCAL_MAP_LOOP(cctkGH, CCTK_GF) {
-              BEGIN_LOCAL_COMPONENT_LOOP(cctkGH, CCTK_GF) {
-                CallScheduledFunction("Global time local mode", function,
-                                      attribute, data, user_timer);
+            {
+              local_mode_restriction const restriction(attribute);
+              BEGIN_LOCAL_MAP_LOOP(cctkGH, CCTK_GF) {
+                BEGIN_LOCAL_COMPONENT_LOOP(cctkGH, CCTK_GF) {
+                  CallScheduledFunction("Global time local mode", function,
+                                        attribute, data, user_timer);
+                }
+                END_LOCAL_COMPONENT_LOOP;
               }
-              END_LOCAL_COMPONENT_LOOP;
+              END_LOCAL_MAP_LOOP;
             }
-            END_LOCAL_MAP_LOOP;
             if (not sync_groups.empty()) {
               SyncGroupsInScheduleBlock(attribute, cctkGH, sync_groups,
                                         sync_timer);
@@ -316,14 +323,17 @@ int CallFunction(void *function,           ///< the function to call
       PreSyncGroups(attribute, cctkGH, pre_groups);
 
     if (attribute->loop_local) {
-      BEGIN_LOCAL_MAP_LOOP(cctkGH, CCTK_GF) {
-        BEGIN_LOCAL_COMPONENT_LOOP(cctkGH, CCTK_GF) {
-          CallScheduledFunction("Level time local mode", function, attribute,
-                                data, user_timer);
+      {
+        local_mode_restriction const restriction(attribute);
+        BEGIN_LOCAL_MAP_LOOP(cctkGH, CCTK_GF) {
+          BEGIN_LOCAL_COMPONENT_LOOP(cctkGH, CCTK_GF) {
+            CallScheduledFunction("Level time local mode", function, attribute,
+                                  data, user_timer);
+          }
+          END_LOCAL_COMPONENT_LOOP;
         }
-        END_LOCAL_COMPONENT_LOOP;
+        END_LOCAL_MAP_LOOP;
       }
-      END_LOCAL_MAP_LOOP;
     } else if (attribute->loop_singlemap) {
       BEGIN_MAP_LOOP(cctkGH, CCTK_GF) {
         CallScheduledFunction("Level time singlemap mode", function, attribute,
@@ -344,14 +354,17 @@ int CallFunction(void *function,           ///< the function to call
       PreSyncGroups(attribute, cctkGH, pre_groups);
 
     if (attribute->loop_local) {
-      BEGIN_LOCAL_MAP_LOOP(cctkGH, CCTK_GF) {
-        BEGIN_LOCAL_COMPONENT_LOOP(cctkGH, CCTK_GF) {
-          CallScheduledFunction("Singlemap time local mode", function,
-                                attribute, data, user_timer);
+      {
+        local_mode_restriction const restriction(attribute);
+        BEGIN_LOCAL_MAP_LOOP(cctkGH, CCTK_GF) {
+          BEGIN_LOCAL_COMPONENT_LOOP(cctkGH, CCTK_GF) {
+            CallScheduledFunction("Singlemap time local mode", function,
+                                  attribute, data, user_timer);
+          }
+          END_LOCAL_COMPONENT_LOOP;
         }
-        END_LOCAL_COMPONENT_LOOP;
+        END_LOCAL_MAP_LOOP;
       }
-      END_LOCAL_MAP_LOOP;
     } else {
       BEGIN_MAP_LOOP(cctkGH, CCTK_GF) {
         CallScheduledFunction("Singlemap mode", function, attribute, data,
@@ -368,14 +381,17 @@ int CallFunction(void *function,           ///< the function to call
     if(do_psync)
       PreSyncGroups(attribute, cctkGH, pre_groups);
 
-    BEGIN_LOCAL_MAP_LOOP(cctkGH, CCTK_GF) {
-      BEGIN_LOCAL_COMPONENT_LOOP(cctkGH, CCTK_GF) {
-        CallScheduledFunction("Local mode", function, attribute, data,
-                              user_timer);
+    {
+      local_mode_restriction const restriction(attribute);
+      BEGIN_LOCAL_MAP_LOOP(cctkGH, CCTK_GF) {
+        BEGIN_LOCAL_COMPONENT_LOOP(cctkGH, CCTK_GF) {
+          CallScheduledFunction("Local mode", function, attribute, data,
+                                user_timer);
+        }
+        END_LOCAL_COMPONENT_LOOP;
       }
-      END_LOCAL_COMPONENT_LOOP;
+      END_LOCAL_MAP_LOOP;
     }
-    END_LOCAL_MAP_LOOP;
     if (not sync_groups.empty()) {
       SyncGroupsInScheduleBlock(attribute, cctkGH, sync_groups, sync_timer);
     }
@@ -430,6 +446,15 @@ void CallScheduledFunction(char const *restrict const time_and_mode,
     Requirements::BeforeRoutine(attribute, cctkGH->cctk_iteration, reflevel,
                                 map, timelevel, timelevel_offset);
 #endif
+    // Tracing may be switched on by this very function, so remember
+    // whether the begin event was recorded
+    char const *const trace_name =
+        tracing::enabled()
+            ? tracing::intern(string(attribute->thorn) + "::" +
+                              attribute->routine)
+            : NULL;
+    if (trace_name)
+      tracing::begin(trace_name, tracing::cat_function, reflevel);
     timer.start();
     if (CCTK_IsFunctionAliased("Accelerator_PreCallFunction")) {
       Timers::Timer pre_timer("PreCall");
@@ -446,6 +471,8 @@ void CallScheduledFunction(char const *restrict const time_and_mode,
       post_timer.stop();
     }
     timer.stop();
+    if (trace_name)
+      tracing::end(trace_name, tracing::cat_function, reflevel);
     CheckFence(cctkGH, attribute);
 #ifdef REQUIREMENTS_HH
     Requirements::AfterRoutine(attribute, cctkGH->cctk_iteration, reflevel, map,
@@ -35,6 +35,15 @@ void CarpetParamCheck(CCTK_ARGUMENTS) {
                    "max_refinement_levels=1.");
   }
 
+  if (not restrict_unused_points and max_refinement_levels > 1 and
+      CCTK_IsThornActive("CarpetEvolutionMask")) {
+    CCTK_WARN(CCTK_WARN_ALERT,
+              "CarpetLib::restrict_unused_points=no leaves stale values in "
+              "the coarse grid points under the finer levels. "
+              "CarpetEvolutionMask and output of the coarse levels will see "
+              "these values instead of the restricted ones.");
+  }
+
   if (max_refinement_levels > 1) {
 
     // InitBase
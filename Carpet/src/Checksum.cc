@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <vector>
 
 #include <cctk.h>
@@ -20,7 +22,7 @@ using namespace std;
 // Checksum information
 struct ckdesc {
   bool valid;
-  unsigned long sum;
+  unsigned long long sum;
 };
 
 // Helper class
@@ -31,24 +33,149 @@ struct ckdesc4 {
 // Checksum information
 vector<vector<vector<ckdesc4> > > checksums; // [rl][ml][group]
 
-// Calculate the internet checksum (see RFC 1071)
-static unsigned short internet_checksum(void const *restrict const addr,
-                                        size_t const len) {
-  unsigned long chk = 0;
-#pragma omp parallel for reduction(+ : chk)
-  for (ptrdiff_t i = 0; i < (ptrdiff_t)len; i += 2) {
-    unsigned long const lb = ((unsigned char const *)addr)[i];
-    unsigned long const ub = ((unsigned char const *)addr)[i + 1];
-    chk += lb + (ub << 8);
+// A block of memory whose checksum is to be calculated
+struct checksum_job {
+  void const *addr;
+  size_t len;
+  unsigned long long *result;
+};
+
+namespace {
+
+// The primes of xxHash64
+unsigned long long const prime1 = 0x9e3779b185ebca87ULL;
+unsigned long long const prime2 = 0xc2b2ae3d27d4eb4fULL;
+unsigned long long const prime3 = 0x165667b19e3779f9ULL;
+unsigned long long const prime4 = 0x85ebca77c2b2ae63ULL;
+unsigned long long const prime5 = 0x27d4eb2f165667c5ULL;
+
+inline unsigned long long rotl(unsigned long long const x, int const r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline unsigned long long hash_round(unsigned long long acc,
+                                     unsigned long long const word) {
+  acc += word * prime2;
+  acc = rotl(acc, 31);
+  acc *= prime1;
+  return acc;
+}
+
+inline unsigned long long hash_merge(unsigned long long acc,
+                                     unsigned long long const val) {
+  acc ^= hash_round(0, val);
+  return acc * prime1 + prime4;
+}
+
+inline unsigned long long load64(unsigned char const *const addr) {
+  unsigned long long word;
+  memcpy(&word, addr, sizeof word);
+  return word;
+}
+
+inline unsigned long long load32(unsigned char const *const addr) {
+  unsigned int word;
+  memcpy(&word, addr, sizeof word);
+  return word;
+}
+
+} // namespace
+
+// Hash one block of memory (xxHash64). The four independent
+// accumulators process 32 bytes per iteration and keep the
+// multipliers busy, unlike a hash with a single dependency chain.
+static unsigned long long block_checksum(unsigned char const *const addr,
+                                         size_t const len) {
+  unsigned char const *p = addr;
+  unsigned char const *const pend = addr + len;
+  unsigned long long h;
+  if (len >= 32) {
+    unsigned long long v1 = prime1 + prime2;
+    unsigned long long v2 = prime2;
+    unsigned long long v3 = 0;
+    unsigned long long v4 = -prime1;
+    for (; p + 32 <= pend; p += 32) {
+      v1 = hash_round(v1, load64(p));
+      v2 = hash_round(v2, load64(p + 8));
+      v3 = hash_round(v3, load64(p + 16));
+      v4 = hash_round(v4, load64(p + 24));
+    }
+    h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    h = hash_merge(h, v1);
+    h = hash_merge(h, v2);
+    h = hash_merge(h, v3);
+    h = hash_merge(h, v4);
+  } else {
+    h = prime5;
   }
-  if (len % 1) {
-    unsigned long const lb = ((unsigned char const *)addr)[len - 1];
-    chk += lb;
+  h += len;
+  for (; p + 8 <= pend; p += 8) {
+    h ^= hash_round(0, load64(p));
+    h = rotl(h, 27) * prime1 + prime4;
   }
-  while (chk >> 16) {
-    chk = (chk & 0xffffUL) + (chk >> 16);
+  if (p + 4 <= pend) {
+    h ^= load32(p) * prime1;
+    h = rotl(h, 23) * prime2 + prime3;
+    p += 4;
   }
-  return ~chk;
+  for (; p < pend; ++p) {
+    h ^= *p * prime5;
+    h = rotl(h, 11) * prime1;
+  }
+  h ^= h >> 33;
+  h *= prime2;
+  h ^= h >> 29;
+  h *= prime3;
+  h ^= h >> 32;
+  return h;
+}
+
+// Mix the bits of a hash value (the finaliser of MurmurHash3)
+static unsigned long long mix_checksum(unsigned long long chk) {
+  chk ^= chk >> 33;
+  chk *= 0xff51afd7ed558ccdULL;
+  chk ^= chk >> 33;
+  chk *= 0xc4ceb9fe1a85ec53ULL;
+  chk ^= chk >> 33;
+  return chk;
+}
+
+// Calculate the checksums of several blocks of memory. Each block is
+// split into fixed-size pieces which are hashed independently, and
+// the piece hashes are combined in order. The pieces of all blocks
+// are distributed over the OpenMP threads together, so that many
+// small components are handled as efficiently as a few large ones.
+static void DataChecksums(vector<checksum_job> const &jobs) {
+  size_t const blocksize = 64 * 1024;
+  vector<ptrdiff_t> offsets(jobs.size() + 1); // first piece of each job
+  offsets[0] = 0;
+  for (size_t j = 0; j < jobs.size(); ++j) {
+    offsets[j + 1] = offsets[j] + (jobs[j].len + blocksize - 1) / blocksize;
+  }
+  ptrdiff_t const npieces = offsets.back();
+  vector<unsigned long long> chks(npieces);
+#pragma omp parallel for schedule(dynamic, 16)
+  for (ptrdiff_t b = 0; b < npieces; ++b) {
+    size_t const j =
+        upper_bound(offsets.begin(), offsets.end(), b) - offsets.begin() - 1;
+    size_t const offset = (b - offsets[j]) * blocksize;
+    chks[b] = block_checksum((unsigned char const *)jobs[j].addr + offset,
+                             min(blocksize, jobs[j].len - offset));
+  }
+  for (size_t j = 0; j < jobs.size(); ++j) {
+    unsigned long long chk = mix_checksum(jobs[j].len);
+    for (ptrdiff_t b = offsets[j]; b < offsets[j + 1]; ++b) {
+      chk = mix_checksum(chk ^ chks[b]);
+    }
+    *jobs[j].result = chk;
+  }
+}
+
+unsigned long long DataChecksum(void const *const addr, size_t const len) {
+  unsigned long long chk;
+  checksum_job const job = {addr, len, &chk};
+  DataChecksums(vector<checksum_job>(1, job));
+  return chk;
 }
 
 // The parameter where specifies which time levels should be
@@ -65,6 +192,10 @@ void CalculateChecksums(const cGH *cgh, const checktimes where) {
 
   Checkpoint("CalculateChecksums");
 
+  // The checksums are calculated after all time levels have been
+  // collected
+  vector<checksum_job> jobs;
+
   checksums.resize(maxreflevels);
   checksums.at(reflevel).resize(mglevels);
   checksums.at(reflevel).at(mglevel).resize(CCTK_NumGroups());
@@ -135,25 +266,17 @@ void CalculateChecksums(const cGH *cgh, const checktimes where) {
                 for (int tl = min_tl; tl <= max_tl; ++tl) {
 
                   const int n = n0 + var;
-                  const void *data = cgh->data[n][tl];
-                  unsigned long const chk = internet_checksum(data, np * sz);
-
-                  checksums.at(reflevel)
-                      .at(mglevel)
-                      .at(group)
-                      .a.at(map)
-                      .at(local_component)
-                      .at(var)
-                      .at(tl)
-                      .sum = chk;
-                  checksums.at(reflevel)
-                      .at(mglevel)
-                      .at(group)
-                      .a.at(map)
-                      .at(local_component)
-                      .at(var)
-                      .at(tl)
-                      .valid = true;
+                  ckdesc &ck = checksums.at(reflevel)
+                                   .at(mglevel)
+                                   .at(group)
+                                   .a.at(map)
+                                   .at(local_component)
+                                   .at(var)
+                                   .at(tl);
+                  checksum_job const job = {cgh->data[n][tl],
+                                            size_t(np) * sz, &ck.sum};
+                  jobs.push_back(job);
+                  ck.valid = true;
 
                 } // for tl
               }   // for var
@@ -166,6 +289,8 @@ void CalculateChecksums(const cGH *cgh, const checktimes where) {
     }   // if storage
   }     // for group
 
+  DataChecksums(jobs);
+
   timer.stop();
 }
 
@@ -175,8 +300,20 @@ void CheckChecksums(const cGH *cgh, const checktimes where) {
   if (!checksum_timelevels)
     return;
 
+  Timers::Timer timer("CheckChecksums");
+  timer.start();
+
   Checkpoint("CheckChecksums");
 
+  // The checksums are calculated and compared after all time levels
+  // have been collected
+  struct check_t {
+    int varindex, tl, component;
+    unsigned long long expected;
+  };
+  vector<check_t> checks;
+  vector<checksum_job> jobs;
+
   assert((int)checksums.size() == maxreflevels);
   assert((int)checksums.at(reflevel).size() == mglevels);
   assert((int)checksums.at(reflevel).at(mglevel).size() == CCTK_NumGroups());
@@ -249,38 +386,20 @@ void CheckChecksums(const cGH *cgh, const checktimes where) {
                            .at(var)
                            .size() == num_tl);
                 for (int tl = min_tl; tl <= max_tl; ++tl) {
-                  if (checksums.at(reflevel)
-                          .at(mglevel)
-                          .at(group)
-                          .a.at(map)
-                          .at(local_component)
-                          .at(var)
-                          .at(tl)
-                          .valid) {
-
+                  const ckdesc &ck = checksums.at(reflevel)
+                                         .at(mglevel)
+                                         .at(group)
+                                         .a.at(map)
+                                         .at(local_component)
+                                         .at(var)
+                                         .at(tl);
+                  if (ck.valid) {
                     const int n = n0 + var;
-                    const void *data = cgh->data[n][tl];
-                    unsigned long const chk = internet_checksum(data, np * sz);
-                    const bool unexpected_change = chk !=
-                                                   checksums.at(reflevel)
-                                                       .at(mglevel)
-                                                       .at(group)
-                                                       .a.at(map)
-                                                       .at(local_component)
-                                                       .at(var)
-                                                       .at(tl)
-                                                       .sum;
-
-                    if (unexpected_change) {
-                      char *fullname = CCTK_FullName(n);
-                      CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
-                                 "Timelevel %d, component %d, refinement level "
-                                 "%d of the variable \"%s\" has changed "
-                                 "unexpectedly",
-                                 tl, component, reflevel, fullname);
-                      free(fullname);
-                    }
-
+                    check_t const check = {n, tl, component, ck.sum};
+                    checks.push_back(check);
+                    checksum_job const job = {cgh->data[n][tl],
+                                              size_t(np) * sz, NULL};
+                    jobs.push_back(job);
                   } // if valid
                 }   // for tl
               }     // for var
@@ -292,6 +411,25 @@ void CheckChecksums(const cGH *cgh, const checktimes where) {
       } // if grouptype fits
     }   // if storage
   }     // for group
+
+  vector<unsigned long long> chks(jobs.size());
+  for (size_t j = 0; j < jobs.size(); ++j)
+    jobs[j].result = &chks[j];
+  DataChecksums(jobs);
+
+  for (size_t j = 0; j < checks.size(); ++j) {
+    const bool unexpected_change = chks[j] != checks[j].expected;
+    if (unexpected_change) {
+      char *fullname = CCTK_FullName(checks[j].varindex);
+      CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
+                 "Timelevel %d, component %d, refinement level %d of the "
+                 "variable \"%s\" has changed unexpectedly",
+                 checks[j].tl, checks[j].component, reflevel, fullname);
+      free(fullname);
+    }
+  }
+
+  timer.stop();
 }
 
 } // namespace Carpet
@@ -3,6 +3,7 @@
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <list>
 #include <vector>
 
 #include <cctk.h>
@@ -25,6 +26,32 @@ using namespace std;
 static void ProlongateGroupBoundaries(const cGH *cctkGH,
                                       const vector<int> &groups);
 
+typedef list<sync_extension_t> sync_extension_list;
+static sync_extension_list sync_extensions;
+
+static bool same_extension(sync_extension_t const &a,
+                           sync_extension_t const &b) {
+  return a.prepare == b.prepare and a.transfer == b.transfer and
+         a.finish == b.finish;
+}
+
+void RegisterSyncExtension(sync_extension_t const &extension) {
+  assert(extension.transfer);
+  UnRegisterSyncExtension(extension);
+  sync_extensions.push_back(extension);
+}
+
+void UnRegisterSyncExtension(sync_extension_t const &extension) {
+  assert(extension.transfer);
+  for (sync_extension_list::iterator ei = sync_extensions.begin();
+       ei != sync_extensions.end();) {
+    if (same_extension(*ei, extension))
+      ei = sync_extensions.erase(ei);
+    else
+      ++ei;
+  }
+}
+
 // Carpet's overload function for CCTK_SyncGroupsByDirI()
 // which synchronises a set of groups given by their indices.
 // Synchronisation of individual directions is not (yet?) implemented.
@@ -168,7 +195,8 @@ int SyncProlongateGroups(const cGH *cctkGH, const vector<int> &groups,
 #endif
 
     // synchronise ghostzones
-    if (sync_during_time_integration or local_do_prolongate) {
+    bool const do_sync = sync_during_time_integration or local_do_prolongate;
+    if (do_sync) {
       if (sync_barriers) {
         static Timers::Timer barrier_timer("PreSyncBarrier");
         barrier_timer.start();
@@ -194,6 +222,13 @@ int SyncProlongateGroups(const cGH *cctkGH, const vector<int> &groups,
         ApplyPhysicalBCsForGroupI(cctkGH,group);
       }
     }
+    if (do_sync) {
+      for (sync_extension_list::const_iterator ei = sync_extensions.begin();
+           ei != sync_extensions.end(); ++ei) {
+        if (ei->finish)
+          ei->finish(cctkGH, goodgroups);
+      }
+    }
   }
 
   return retval;
@@ -357,6 +392,12 @@ void SyncGroups(const cGH *cctkGH, const vector<int> &groups) {
     }
   }
 
+  for (sync_extension_list::const_iterator ei = sync_extensions.begin();
+       ei != sync_extensions.end(); ++ei) {
+    if (ei->prepare)
+      ei->prepare(cctkGH, groups);
+  }
+
   vector<Timers::Timer *>::iterator ti = timers.begin();
   (*ti)->start();
   for (comm_state state; not state.done(); state.step()) {
@@ -377,6 +418,10 @@ void SyncGroups(const cGH *cctkGH, const vector<int> &groups) {
           array.data.AT(v)->sync_all(state, tl, rl, ml);
         }
       }
+      for (sync_extension_list::const_iterator ei = sync_extensions.begin();
+           ei != sync_extensions.end(); ++ei) {
+        ei->transfer(cctkGH, state, g, tl, rl, ml);
+      }
     }
     (*ti)->stop();
     ++ti;
@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 
 #include <cctk.h>
 #include <cctk_Parameters.h>
@@ -10,7 +12,7 @@
 #include <Timer.hh>
 
 #include <defs.hh>
-#include <typeprops.hh>
+#include <dh.hh>
 #include "PreSync.hh"
 
 #include <carpet.hh>
@@ -19,6 +21,153 @@ namespace Carpet {
 
 using namespace std;
 
+namespace {
+
+// A region of a component in which poison is set or looked for
+struct poison_region_t {
+  char const *name;
+  vector<ibbox> boxes; // in the index space of the component's data
+};
+
+// Convert a bbox of the grid hierarchy into the index space of the
+// data of a component
+ibbox data_bbox(ibbox const &box, ibbox const &exterior) {
+  ivect const str = exterior.stride();
+  return ibbox((box.lower() - exterior.lower()) / str,
+               (box.upper() - exterior.lower()) / str, ivect(1));
+}
+
+void add_region(vector<poison_region_t> &regions, char const *const name,
+                ibset const &set, ibbox const &exterior) {
+  poison_region_t region;
+  region.name = name;
+  vector<ibbox> boxes;
+  set.serialise(boxes);
+  for (size_t b = 0; b < boxes.size(); ++b)
+    region.boxes.push_back(data_bbox(boxes[b], exterior));
+  regions.push_back(region);
+}
+
+// Determine the regions of the current local component. The ghost
+// zones and outer boundary (filled by synchronisation, prolongation,
+// and boundary conditions) come first, then the buffer zones (filled
+// by prolongation), then the remaining interior (filled by the
+// evolution). The interior is omitted if only_boundaries is set.
+// Grid arrays consist of a single region.
+vector<poison_region_t> component_regions(int const group, ivect const &lsh,
+                                          bool const only_boundaries) {
+  vector<poison_region_t> regions;
+  if (CCTK_GroupTypeI(group) != CCTK_GF) {
+    poison_region_t region;
+    region.name = "array";
+    region.boxes.push_back(ibbox(ivect(0), lsh - 1, ivect(1)));
+    regions.push_back(region);
+    return regions;
+  }
+
+  dh const &dd = *arrdata.AT(group).AT(map).dd;
+  dh::light_dboxes const &light_box =
+      dd.light_boxes.AT(mglevel).AT(reflevel).AT(component);
+  dh::local_dboxes const &local_box =
+      dd.local_boxes.AT(mglevel).AT(reflevel).AT(local_component);
+  ibbox const &exterior = light_box.exterior;
+  assert(all(exterior.shape() / exterior.stride() == lsh));
+
+  add_region(regions, "ghost zones and outer boundary",
+             ibset(exterior) - light_box.owned, exterior);
+  add_region(regions, "buffer zones", local_box.buffers, exterior);
+  if (not only_boundaries) {
+    add_region(regions, "interior", ibset(light_box.owned) - local_box.buffers,
+               exterior);
+  }
+  return regions;
+}
+
+// Set all points of a box to the poison value
+void poison_box(void *const data, ivect const &ash, int const sz,
+                ibbox const &box, int const poison_value) {
+  ivect const lo = box.lower();
+  ivect const len = box.shape();
+  if (any(len <= 0))
+    return;
+#pragma omp parallel for collapse(2)
+  for (int k = lo[2]; k < lo[2] + len[2]; ++k) {
+    for (int j = lo[1]; j < lo[1] + len[1]; ++j) {
+      ptrdiff_t const idx = lo[0] + ash[0] * (j + ptrdiff_t(ash[1]) * k);
+      memset(static_cast<char *>(data) + idx * sz, poison_value,
+             size_t(len[0]) * sz);
+    }
+  }
+}
+
+// Count the poisoned elements in a row of n elements, each consisting
+// of words machine words. An element is poisoned if all its bytes
+// have the poison value.
+template <typename W>
+int count_poison_row(unsigned char const *const row, int const n,
+                     int const words, W const pattern) {
+  int count = 0;
+  for (int i = 0; i < n; ++i) {
+    bool poisoned = true;
+    for (int w = 0; w < words; ++w) {
+      W word;
+      memcpy(&word, row + (ptrdiff_t(i) * words + w) * sizeof word,
+             sizeof word);
+      poisoned &= word == pattern;
+    }
+    count += poisoned;
+  }
+  return count;
+}
+
+int count_poison_row(unsigned char const *const row, int const n,
+                     int const sz, int const poison_value) {
+  if (sz % sizeof(unsigned long long) == 0) {
+    unsigned long long pattern;
+    memset(&pattern, poison_value, sizeof pattern);
+    return count_poison_row(row, n, sz / sizeof pattern, pattern);
+  } else if (sz % sizeof(unsigned int) == 0) {
+    unsigned int pattern;
+    memset(&pattern, poison_value, sizeof pattern);
+    return count_poison_row(row, n, sz / sizeof pattern, pattern);
+  } else if (sz % sizeof(unsigned short) == 0) {
+    unsigned short pattern;
+    memset(&pattern, poison_value, sizeof pattern);
+    return count_poison_row(row, n, sz / sizeof pattern, pattern);
+  } else {
+    unsigned char const pattern = poison_value;
+    return count_poison_row(row, n, sz, pattern);
+  }
+}
+
+// Count the poisoned elements in each row of a box. Only the rows
+// that contain poison need to be examined point by point.
+int count_poison_box(void const *const data, ivect const &ash, int const sz,
+                     ibbox const &box, int const poison_value,
+                     vector<int> &rowcounts) {
+  ivect const lo = box.lower();
+  ivect const len = box.shape();
+  rowcounts.assign(len[1] * len[2], 0);
+  if (any(len <= 0))
+    return 0;
+  int count = 0;
+#pragma omp parallel for collapse(2) reduction(+ : count)
+  for (int k = 0; k < len[2]; ++k) {
+    for (int j = 0; j < len[1]; ++j) {
+      ptrdiff_t const idx =
+          lo[0] + ash[0] * (lo[1] + j + ptrdiff_t(ash[1]) * (lo[2] + k));
+      int const rowcount = count_poison_row(
+          static_cast<unsigned char const *>(data) + idx * sz, len[0], sz,
+          poison_value);
+      rowcounts[j + len[1] * k] = rowcount;
+      count += rowcount;
+    }
+  }
+  return count;
+}
+
+} // namespace
+
 // The parameter where specifies which time levels should be
 // poisoned.  what specifies what kind of grid variables should be
 // poisoned.
@@ -112,19 +261,37 @@ void PoisonGroup(cGH const *const cctkGH, int const group,
     BEGIN_LOCAL_MAP_LOOP(cctkGH, grouptype) {
       BEGIN_LOCAL_COMPONENT_LOOP(cctkGH, grouptype) {
 
-        ivect size(1);
+        ivect size(1), lsize(1);
         int const gpdim = groupdata.AT(group).info.dim;
         for (int d = 0; d < gpdim; ++d) {
           size[d] = groupdata.AT(group).info.ash[d];
+          lsize[d] = groupdata.AT(group).info.lsh[d];
         }
         int const np = prod(size);
 
-        for (int var = 0; var < nvar; ++var) {
-          int const n = n0 + var;
-          for (int tl = min_tl; tl <= max_tl; ++tl) {
-            memset(cctkGH->data[n][tl], poison_value, size_t(np) * sz);
-          } // for tl
-        }   // for var
+        if (poison_only_boundaries and grouptype == CCTK_GF) {
+          // Poison only the points which are not evolved
+          vector<poison_region_t> const regions =
+              component_regions(group, lsize, true);
+          for (int var = 0; var < nvar; ++var) {
+            int const n = n0 + var;
+            for (int tl = min_tl; tl <= max_tl; ++tl) {
+              for (size_t r = 0; r < regions.size(); ++r) {
+                for (size_t b = 0; b < regions[r].boxes.size(); ++b) {
+                  poison_box(cctkGH->data[n][tl], size, sz,
+                             regions[r].boxes[b], poison_value);
+                }
+              }
+            } // for tl
+          }   // for var
+        } else {
+          for (int var = 0; var < nvar; ++var) {
+            int const n = n0 + var;
+            for (int tl = min_tl; tl <= max_tl; ++tl) {
+              memset(cctkGH->data[n][tl], poison_value, size_t(np) * sz);
+            } // for tl
+          }   // for var
+        }
       }
       END_LOCAL_COMPONENT_LOOP;
     }
@@ -160,7 +327,8 @@ void PoisonCheck(cGH const *const cctkGH, checktimes const where) {
       int const grouptype = CCTK_GroupTypeI(group);
       int const n0 = CCTK_FirstVarIndexI(group);
       assert(n0 >= 0);
-      int const tp = CCTK_VarTypeI(n0);
+      int const sz = CCTK_VarTypeSize(CCTK_VarTypeI(n0));
+      assert(sz > 0);
       int const gpdim = groupdata.AT(group).info.dim;
 
       int const table = CCTK_GroupTagsTableI(group);
@@ -199,7 +367,12 @@ void PoisonCheck(cGH const *const cctkGH, checktimes const where) {
             size[d] = groupdata.AT(group).info.lsh[d];
             asize[d] = groupdata.AT(group).info.ash[d];
           }
-          int const np = prod(size);
+          vector<poison_region_t> const regions =
+              component_regions(group, size, poison_only_boundaries);
+          int np = 0;
+          for (size_t r = 0; r < regions.size(); ++r)
+            for (size_t b = 0; b < regions[r].boxes.size(); ++b)
+              np += regions[r].boxes[b].size();
 
           for (int var = 0; var < nvar; ++var) {
             int const n = n0 + var;
@@ -208,61 +381,79 @@ void PoisonCheck(cGH const *const cctkGH, checktimes const where) {
 
               const void *const data = cctkGH->data[n][tl];
               int numpoison = 0;
-              for (int k = 0; k < size[2]; ++k) {
-                for (int j = 0; j < size[1]; ++j) {
-                  for (int i = 0; i < size[0]; ++i) {
-                    int const idx = i + asize[0] * (j + asize[1] * k);
-                    bool poisoned = false;
-                    switch (specific_cactus_type(tp)) {
-// cast to (void *) below to avoid warning about CCTK_COMPLEX being a
-// non-trivial type. C++11 guarantees that std::complex<double> has the same
-// memory layout as C99's complex type, which is (likely) a trivial type in
-// memory.
-#define TYPECASE(N, T)                                                         \
-  case N: {                                                                    \
-    T worm;                                                                    \
-    memset(static_cast<void *>(&worm), poison_value, sizeof worm);             \
-    const T &val = ((const T *)data)[idx];                                     \
-    poisoned = memcmp(&worm, &val, sizeof worm) == 0;                          \
-    break;                                                                     \
-  }
-#include "typecase.hh"
-#undef TYPECASE
-                    default:
-                      UnsupportedVarType(n);
-                    }
-                    if (poisoned) {
-                      ++numpoison;
-                      if (max_poison_locations == -1 or
-                          numpoison <= max_poison_locations) {
-                        char *fullname = CCTK_FullName(n);
-                        CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
-                                   "At iteration %d: timelevel %d, component "
-                                   "%d, map %d, refinement level %d of the "
-                                   "variable \"%s\" contains poison at "
-                                   "[%d,%d,%d]",
-                                   cctkGH->cctk_iteration, tl, component, map,
-                                   reflevel, fullname, i, j, k);
-                        free(fullname);
-                      }
-                    } // if poisoned
-                  }   // for i
-                }     // for j
-              }       // for k
-              if (max_poison_locations != -1 and
-                  numpoison > max_poison_locations) {
+              // The first region containing poison, and the extent of
+              // the poison there
+              int first_region = -1;
+              ibbox first_extent;
+              vector<int> rowcounts;
+              for (size_t r = 0; r < regions.size(); ++r) {
+                for (size_t b = 0; b < regions[r].boxes.size(); ++b) {
+                  ibbox const &box = regions[r].boxes[b];
+                  if (count_poison_box(data, asize, sz, box, poison_value,
+                                       rowcounts) == 0)
+                    continue;
+
+                  // Examine the rows containing poison
+                  ivect const lo = box.lower();
+                  ivect const len = box.shape();
+                  for (int k = lo[2]; k < lo[2] + len[2]; ++k) {
+                    for (int j = lo[1]; j < lo[1] + len[1]; ++j) {
+                      if (rowcounts[j - lo[1] + len[1] * (k - lo[2])] == 0)
+                        continue;
+                      for (int i = lo[0]; i < lo[0] + len[0]; ++i) {
+                        ptrdiff_t const idx =
+                            i + asize[0] * (j + ptrdiff_t(asize[1]) * k);
+                        if (count_poison_row(
+                                static_cast<unsigned char const *>(data) +
+                                    idx * sz,
+                                1, sz, poison_value) == 0)
+                          continue;
+                        ++numpoison;
+                        ivect const ipos(i, j, k);
+                        if (first_region == -1) {
+                          first_region = r;
+                          first_extent = ibbox(ipos, ipos, ivect(1));
+                        } else if (first_region == int(r)) {
+                          first_extent = first_extent.expanded_containing(
+                              ibbox(ipos, ipos, ivect(1)));
+                        }
+                        if (max_poison_locations == -1 or
+                            numpoison <= max_poison_locations) {
+                          char *fullname = CCTK_FullName(n);
+                          CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
+                                     "At iteration %d: timelevel %d, "
+                                     "component %d, map %d, refinement level "
+                                     "%d of the variable \"%s\" contains "
+                                     "poison at [%d,%d,%d]",
+                                     cctkGH->cctk_iteration, tl, component,
+                                     map, reflevel, fullname, i, j, k);
+                          free(fullname);
+                        }
+                      } // for i
+                    }   // for j
+                  }     // for k
+                }       // for b
+              }         // for r
+
+              if (numpoison > 0) {
                 char *fullname = CCTK_FullName(n);
+                ivect const flo = first_extent.lower();
+                ivect const fhi = first_extent.upper();
                 CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
                            "At iteration %d: timelevel %d, component %d, map "
                            "%d, refinement level %d of the variable \"%s\" "
-                           "contains poison at %d of %d locations; not all "
-                           "locations were printed",
+                           "contains poison at %d of %d checked locations%s; "
+                           "the first poisoned region is the %s, with poison "
+                           "in [%d,%d,%d]:[%d,%d,%d]",
                            cctkGH->cctk_iteration, tl, component, map, reflevel,
-                           fullname, numpoison, np);
+                           fullname, numpoison, np,
+                           max_poison_locations != -1 and
+                                   numpoison > max_poison_locations
+                               ? " (not all locations were printed)"
+                               : "",
+                           regions.AT(first_region).name, flo[0], flo[1],
+                           flo[2], fhi[0], fhi[1], fhi[2]);
                 free(fullname);
-              } else if (numpoison > 0) {
-                CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
-                           "Found poison at %d of %d locations", numpoison, np);
               }
 
             } // for tl
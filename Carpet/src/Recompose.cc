@@ -35,6 +35,7 @@
 #include <defs.hh>
 #include <dh.hh>
 #include <gh.hh>
+#include <mem.hh>
 #include <region.hh>
 #include <vect.hh>
 
@@ -143,6 +144,7 @@ bool Regrid(cGH const *const cctkGH, bool const force_recompose,
   char const *const where = "Regrid";
   static Timers::Timer timer(where);
   timer.start();
+  memphase const phase(gmem::phase_regrid);
 
   Checkpoint("Regridding level %d...", reflevel);
 
@@ -363,6 +365,7 @@ bool Recompose(cGH const *const cctkGH, int const rl, bool const do_init) {
   char const *const where = "Recompose";
   static Timers::Timer timer(where);
   timer.start();
+  memphase const phase(gmem::phase_regrid);
 
   bool did_recompose = false;
 
@@ -389,6 +392,7 @@ void RegridFree(cGH const *const cctkGH, bool const do_init) {
   char const *const where = "RegridFree";
   static Timers::Timer timer(where);
   timer.start();
+  memphase const phase(gmem::phase_regrid);
 
   Checkpoint("Freeing after regridding level %d...", reflevel);
 
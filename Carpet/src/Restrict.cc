@@ -73,7 +73,10 @@ void Restrict(const cGH *cctkGH) {
 static void RestrictGroups(const cGH *cctkGH, const vector<int> &groups) {
   DECLARE_CCTK_PARAMETERS;
 
-  // TODO: Transmit only the regions that are actually needed
+  // TODO: Transmit only the regions that are actually needed. The
+  // restriction itself skips the unused region when
+  // CarpetLib::restrict_unused_points is false, but the accelerator
+  // is still told about the whole levels.
   if (CCTK_IsFunctionAliased("Accelerator_RequireValidData")) {
     vector<CCTK_INT> vis, rls, tls;
     for (int group = 0; group < (int)groups.size(); ++group) {
@@ -170,7 +173,8 @@ static void RestrictGroups(const cGH *cctkGH, const vector<int> &groups) {
   ++ti;
   assert(ti == timers.end());
 
-  // TODO: Transmit only the regions that are actually needed
+  // TODO: Transmit only the regions that are actually written (see
+  // above)
   if (CCTK_IsFunctionAliased("Accelerator_NotifyDataModified")) {
     vector<CCTK_INT> vis, rls, tls;
     for (int group = 0; group < (int)groups.size(); ++group) {
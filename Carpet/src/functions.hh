@@ -15,6 +15,7 @@
 #endif
 
 #include <bbox.hh>
+#include <commstate.hh>
 #include <dh.hh>
 #include <gh.hh>
 #include <vect.hh>
@@ -50,6 +51,30 @@ int QueryDriverBCForVarI(const cGH *cgh, const int varindex);
 
 void Restrict(const cGH *cgh);
 
+// Calculate a 64-bit hash of a block of memory, e.g. to detect
+// whether grid function data have changed. The result does not depend
+// on the number of OpenMP threads.
+unsigned long long DataChecksum(void const *addr, size_t len);
+
+// Additional transfers that are executed in the same communication
+// round as the ghost zone synchronisation of a set of groups.
+// "prepare" is called once on all processes before the communication
+// starts, and may communicate. "transfer" is called for every
+// communication state and every synchronised group, with the same
+// time level, refinement level, and multigrid level that are used
+// for the synchronisation itself. "finish" is called after the
+// groups have been synchronised and their physical boundary
+// conditions (if any) have been applied. "prepare" and "finish" may
+// be NULL.
+struct sync_extension_t {
+  void (*prepare)(cGH const *cctkGH, vector<int> const &groups);
+  void (*transfer)(cGH const *cctkGH, comm_state &state, int group, int tl,
+                   int rl, int ml);
+  void (*finish)(cGH const *cctkGH, vector<int> const &groups);
+};
+void RegisterSyncExtension(sync_extension_t const &extension);
+void UnRegisterSyncExtension(sync_extension_t const &extension);
+
 // Multi-Model
 void SplitUniverse(MPI_Comm const world, string const model, MPI_Comm &comm,
                    bool verbose);
@@ -5,6 +5,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <functional>
+#include <map>
+#include <vector>
 
 #include <cctk.h>
 #include <cctk_Parameters.h>
@@ -550,6 +552,215 @@ void leave_singlemap_mode(cGH *const cctkGH) {
   assert(is_level_mode());
 }
 
+// Data pointer tables for local mode
+
+// Entering local mode sets the data pointers of all grid functions.
+// Instead of looking up the storage of each variable every time, the
+// pointers for a local component are collected once into a table,
+// which is discarded when the storage of any grid function changes
+// (allocated, freed, cycled, or regridded).
+
+namespace {
+
+// Layout of the grid function groups in the tables
+struct local_mode_group_t {
+  int group;
+  int firstvar, numvars, maxtimelevels;
+  size_t offset; // offset of the first pointer in a table
+};
+vector<local_mode_group_t> local_mode_groups;
+vector<int> local_mode_group_index; // [group]; -1 if not a grid function
+vector<int> local_mode_all_groups;  // indices into local_mode_groups
+size_t local_mode_table_size = 0;
+
+struct local_mode_key_t {
+  int m, rl, lc, ml, tl; // tl is -1 if all time levels are accessible
+  bool operator<(local_mode_key_t const &other) const {
+    if (m != other.m)
+      return m < other.m;
+    if (rl != other.rl)
+      return rl < other.rl;
+    if (lc != other.lc)
+      return lc < other.lc;
+    if (ml != other.ml)
+      return ml < other.ml;
+    return tl < other.tl;
+  }
+};
+std::map<local_mode_key_t, vector<void *> > local_mode_tables;
+size_t local_mode_tables_generation = size_t(-1);
+
+// Groups whose data pointers are set when entering local mode
+vector<int> const *local_mode_restricted_groups = NULL;
+// Groups whose data pointers are currently set
+vector<int> const *local_mode_current_groups = NULL;
+
+void setup_local_mode_groups() {
+  if (not local_mode_group_index.empty())
+    return;
+
+  local_mode_group_index.resize(CCTK_NumGroups(), -1);
+  for (int group = 0; group < CCTK_NumGroups(); ++group) {
+    if (CCTK_GroupTypeI(group) == CCTK_GF) {
+      local_mode_group_t g;
+      g.group = group;
+      g.numvars = CCTK_NumVarsInGroupI(group);
+      assert(g.numvars >= 0);
+      g.firstvar = g.numvars > 0 ? CCTK_FirstVarIndexI(group) : -1;
+      g.maxtimelevels = 0;
+      g.offset = 0;
+      local_mode_group_index.AT(group) = local_mode_groups.size();
+      local_mode_all_groups.push_back(local_mode_groups.size());
+      local_mode_groups.push_back(g);
+    }
+  }
+}
+
+// The maximum number of time levels can be increased at run time
+void update_local_mode_layout() {
+  size_t offset = 0;
+  for (size_t i = 0; i < local_mode_groups.size(); ++i) {
+    local_mode_group_t &g = local_mode_groups[i];
+    g.maxtimelevels = groupdata.AT(g.group).info.maxtimelevels;
+    assert(g.maxtimelevels >= 0);
+    g.offset = offset;
+    offset += g.numvars * g.maxtimelevels;
+  }
+  local_mode_table_size = offset;
+}
+
+// Return the data pointers of all grid functions for the current
+// local component
+vector<void *> const &get_local_mode_table() {
+  DECLARE_CCTK_PARAMETERS;
+
+  if (local_mode_tables_generation != ggf::storage_generation) {
+    local_mode_tables.clear();
+    update_local_mode_layout();
+    local_mode_tables_generation = ggf::storage_generation;
+  }
+
+  local_mode_key_t key;
+  key.m = map;
+  key.rl = reflevel;
+  key.lc = local_component;
+  key.ml = mglevel;
+  key.tl = do_allow_past_timelevels ? -1 : timelevel;
+  auto const iter = local_mode_tables.find(key);
+  if (iter != local_mode_tables.end())
+    return iter->second;
+
+  vector<void *> &ptrs = local_mode_tables[key];
+  ptrs.resize(local_mode_table_size, NULL);
+  for (size_t i = 0; i < local_mode_groups.size(); ++i) {
+    local_mode_group_t const &g = local_mode_groups[i];
+    // TODO: Modify flesh so the max_tl can be updated
+    const int active_tl =
+        groupdata.AT(g.group).activetimelevels.AT(mglevel).AT(reflevel);
+    assert(active_tl >= 0);
+    int available_tl;
+    int tl_offset;
+    if (active_tl == 0) {
+      // group has no storage
+      available_tl = active_tl;
+      tl_offset = 0;
+    } else if (do_allow_past_timelevels) {
+      // regular case; all timelevels are accessible
+      available_tl = active_tl;
+      tl_offset = 0;
+    } else {
+      // only one timelevel is accessible
+      available_tl = 1;
+      if (timelevel < active_tl) {
+        // timelevel "timelevel" exists
+        tl_offset = timelevel;
+      } else {
+        // timelevel "timelevel" does not exist
+        tl_offset = active_tl - 1;
+      }
+    }
+
+    assert(g.group < (int)arrdata.size());
+    for (int var = 0; var < g.numvars; ++var) {
+      ggf *const ff = arrdata.AT(g.group).AT(map).data.AT(var);
+      for (int tl = 0; tl < min(available_tl, g.maxtimelevels); ++tl) {
+        if (ff) {
+          gdata *const data = ff->data_pointer(tl_offset + tl, reflevel,
+                                               local_component, mglevel);
+          assert(data);
+          ptrs[g.offset + var * g.maxtimelevels + tl] = data->storage();
+        }
+      }
+    }
+  }
+  return ptrs;
+}
+
+// Find the grid function groups accessed by a scheduled function;
+// return NULL if this is not known
+vector<int> const *
+get_local_mode_function_groups(cFunctionData const *const attribute) {
+  static std::map<cFunctionData const *, vector<int> > function_groups;
+  static std::map<cFunctionData const *, bool> function_known;
+
+  auto const iter = function_known.find(attribute);
+  if (iter != function_known.end()) {
+    return iter->second ? &function_groups[attribute] : NULL;
+  }
+
+  // Functions without clauses may access any variable
+  bool known = attribute->n_ReadsClauses + attribute->n_WritesClauses > 0;
+  vector<bool> accessed(local_mode_groups.size(), false);
+  for (int n = 0; known and n < attribute->n_ReadsClauses +
+                                     attribute->n_WritesClauses;
+       ++n) {
+    char const *const clause =
+        n < attribute->n_ReadsClauses
+            ? attribute->ReadsClauses[n]
+            : attribute->WritesClauses[n - attribute->n_ReadsClauses];
+    // Remove trailing "(...)" modifier, if any
+    string const name(clause, strcspn(clause, "("));
+    int group = CCTK_GroupIndex(name.c_str());
+    if (group < 0) {
+      int const vi = CCTK_VarIndex(name.c_str());
+      group = vi >= 0 ? CCTK_GroupIndexFromVarI(vi) : -1;
+    }
+    if (group < 0) {
+      known = false;
+    } else if (local_mode_group_index.AT(group) >= 0) {
+      accessed.AT(local_mode_group_index.AT(group)) = true;
+    }
+  }
+
+  function_known[attribute] = known;
+  if (not known)
+    return NULL;
+  vector<int> &groups = function_groups[attribute];
+  for (size_t i = 0; i < accessed.size(); ++i) {
+    if (accessed[i])
+      groups.push_back(i);
+  }
+  return &groups;
+}
+
+} // namespace
+
+local_mode_restriction::local_mode_restriction(
+    cFunctionData const *const attribute)
+    : old_groups(local_mode_restricted_groups) {
+  DECLARE_CCTK_PARAMETERS;
+  if (restrict_local_mode_to_clauses) {
+    setup_local_mode_groups();
+    vector<int> const *const groups = get_local_mode_function_groups(attribute);
+    if (groups)
+      local_mode_restricted_groups = groups;
+  }
+}
+
+local_mode_restriction::~local_mode_restriction() {
+  local_mode_restricted_groups = old_groups;
+}
+
 // Set local mode
 
 void enter_local_mode(cGH *const cctkGH, int const c, int const lc,
@@ -633,81 +844,42 @@ void enter_local_mode(cGH *const cctkGH, int const c, int const lc,
       assert(cctkGH->cctk_to[d] <= cctkGH->cctk_lsh[d]);
     }
 
-    for (int group = 0; group < CCTK_NumGroups(); ++group) {
-      if (CCTK_GroupTypeI(group) == CCTK_GF) {
-
-        cGroupDynamicData &info = groupdata.AT(group).info;
+    setup_local_mode_groups();
+    for (size_t i = 0; i < local_mode_groups.size(); ++i) {
+      cGroupDynamicData &info = groupdata.AT(local_mode_groups[i].group).info;
 
-        ivect_ref(info.lbnd) = ivect_ref(cctkGH->cctk_lbnd);
-        ivect_ref(info.ubnd) = ivect_ref(cctkGH->cctk_ubnd);
-        ivect_ref(info.lsh) = ivect_ref(cctkGH->cctk_lsh);
+      ivect_ref(info.lbnd) = ivect_ref(cctkGH->cctk_lbnd);
+      ivect_ref(info.ubnd) = ivect_ref(cctkGH->cctk_ubnd);
+      ivect_ref(info.lsh) = ivect_ref(cctkGH->cctk_lsh);
 #ifdef CCTK_HAVE_CGH_TILE
-        ivect_ref(info.tile_min) = ivect_ref(cctkGH->cctk_tile_min);
-        ivect_ref(info.tile_max) = ivect_ref(cctkGH->cctk_tile_max);
+      ivect_ref(info.tile_min) = ivect_ref(cctkGH->cctk_tile_min);
+      ivect_ref(info.tile_max) = ivect_ref(cctkGH->cctk_tile_max);
 #endif
-        ivect_ref(info.ash) = ivect_ref(cctkGH->cctk_ash);
-        info.alignment = cctkGH->cctk_alignment;
-        info.alignment_offset = cctkGH->cctk_alignment_offset;
-
-        for (int d = 0; d < dim; ++d) {
-          const_cast<int *>(info.bbox)[2 * d] = cctkGH->cctk_bbox[2 * d];
-          const_cast<int *>(info.bbox)[2 * d + 1] =
-              cctkGH->cctk_bbox[2 * d + 1];
-        }
+      ivect_ref(info.ash) = ivect_ref(cctkGH->cctk_ash);
+      info.alignment = cctkGH->cctk_alignment;
+      info.alignment_offset = cctkGH->cctk_alignment_offset;
 
-        if (local_component != -1) {
-          const int numvars = CCTK_NumVarsInGroupI(group);
-          if (numvars > 0) {
-            const int firstvar = CCTK_FirstVarIndexI(group);
-            assert(firstvar >= 0);
-            // TODO: Modify flesh so the max_tl can be updated
-            const int active_tl =
-                groupdata.AT(group).activetimelevels.AT(mglevel).AT(reflevel);
-            assert(active_tl >= 0);
-            int available_tl;
-            int tl_offset;
-            if (active_tl == 0) {
-              // group has no storage
-              available_tl = active_tl;
-              tl_offset = 0;
-            } else if (do_allow_past_timelevels) {
-              // regular case; all timelevels are accessible
-              available_tl = active_tl;
-              tl_offset = 0;
-            } else {
-              // only one timelevel is accessible
-              available_tl = 1;
-              if (timelevel < active_tl) {
-                // timelevel "timelevel" exists
-                tl_offset = timelevel;
-              } else {
-                // timelevel "timelevel" does not exist
-                tl_offset = active_tl - 1;
-              }
-            }
-
-            // assert (vhh.AT(map)->is_local(reflevel,component));
-
-            assert(group < (int)arrdata.size());
-            for (int var = 0; var < numvars; ++var) {
-              assert(firstvar + var < CCTK_NumVars());
-              ggf *const ff = arrdata.AT(group).AT(map).data.AT(var);
-              for (int tl = 0; tl < info.maxtimelevels; ++tl) {
-                if (ff and tl < available_tl) {
-                  gdata *const data = ff->data_pointer(
-                      tl_offset + tl, reflevel, local_component, mglevel);
-                  assert(data);
-                  cctkGH->data[firstvar + var][tl] = data->storage();
-                } else {
-                  cctkGH->data[firstvar + var][tl] = NULL;
-                }
-              }
-            }
-          }
+      for (int d = 0; d < dim; ++d) {
+        const_cast<int *>(info.bbox)[2 * d] = cctkGH->cctk_bbox[2 * d];
+        const_cast<int *>(info.bbox)[2 * d + 1] = cctkGH->cctk_bbox[2 * d + 1];
+      }
+    } // for i
+
+    if (local_component != -1) {
+      // Set the data pointers from the table
+      vector<void *> const &ptrs = get_local_mode_table();
+      vector<int> const &groups = local_mode_restricted_groups
+                                      ? *local_mode_restricted_groups
+                                      : local_mode_all_groups;
+      for (size_t i = 0; i < groups.size(); ++i) {
+        local_mode_group_t const &g = local_mode_groups.AT(groups[i]);
+        for (int var = 0; var < g.numvars; ++var) {
+          void *const *const src = &ptrs[g.offset + var * g.maxtimelevels];
+          copy(src, src + g.maxtimelevels, cctkGH->data[g.firstvar + var]);
         }
-
-      } // if grouptype
-    }   // for group
+      }
+      local_mode_current_groups = &groups;
+    }
 
   } // if mc_grouptype
 
@@ -762,49 +934,39 @@ void leave_local_mode(cGH *const cctkGH) {
       cctkGH->cctk_bbox[2 * d + 1] = deadbeef;
     }
 
-    for (int group = 0; group < CCTK_NumGroups(); ++group) {
-      if (CCTK_GroupTypeI(group) == CCTK_GF) {
-
-        cGroupDynamicData &info = groupdata.AT(group).info;
+    for (size_t i = 0; i < local_mode_groups.size(); ++i) {
+      cGroupDynamicData &info = groupdata.AT(local_mode_groups[i].group).info;
 
-        ivect_ref(info.lbnd) = ivect_ref(cctkGH->cctk_lbnd);
-        ivect_ref(info.ubnd) = ivect_ref(cctkGH->cctk_ubnd);
-        ivect_ref(info.lsh) = ivect_ref(cctkGH->cctk_lsh);
+      ivect_ref(info.lbnd) = ivect_ref(cctkGH->cctk_lbnd);
+      ivect_ref(info.ubnd) = ivect_ref(cctkGH->cctk_ubnd);
+      ivect_ref(info.lsh) = ivect_ref(cctkGH->cctk_lsh);
 #ifdef CCTK_HAVE_CGH_TILE
-        ivect_ref(info.tile_min) = ivect_ref(cctkGH->cctk_tile_min);
-        ivect_ref(info.tile_max) = ivect_ref(cctkGH->cctk_tile_max);
+      ivect_ref(info.tile_min) = ivect_ref(cctkGH->cctk_tile_min);
+      ivect_ref(info.tile_max) = ivect_ref(cctkGH->cctk_tile_max);
 #endif
-        ivect_ref(info.ash) = ivect_ref(cctkGH->cctk_ash);
-        info.alignment = cctkGH->cctk_alignment;
-        info.alignment_offset = cctkGH->cctk_alignment_offset;
-
-        for (int d = 0; d < dim; ++d) {
-          const_cast<int *>(info.bbox)[2 * d] = cctkGH->cctk_bbox[2 * d];
-          const_cast<int *>(info.bbox)[2 * d + 1] =
-              cctkGH->cctk_bbox[2 * d + 1];
-        }
+      ivect_ref(info.ash) = ivect_ref(cctkGH->cctk_ash);
+      info.alignment = cctkGH->cctk_alignment;
+      info.alignment_offset = cctkGH->cctk_alignment_offset;
 
-        if (local_component != -1) {
-          const int numvars = CCTK_NumVarsInGroupI(group);
-          if (numvars > 0) {
-            const int firstvar = CCTK_FirstVarIndexI(group);
-            assert(firstvar >= 0);
-            const int active_tl =
-                groupdata.AT(group).activetimelevels.AT(mglevel).AT(reflevel);
-            assert(active_tl >= 0);
-
-            assert(group < (int)arrdata.size());
-            for (int var = 0; var < numvars; ++var) {
-              assert(firstvar + var < CCTK_NumVars());
-              for (int tl = 0; tl < active_tl; ++tl) {
-                cctkGH->data[firstvar + var][tl] = NULL;
-              }
-            }
-          }
+      for (int d = 0; d < dim; ++d) {
+        const_cast<int *>(info.bbox)[2 * d] = cctkGH->cctk_bbox[2 * d];
+        const_cast<int *>(info.bbox)[2 * d + 1] = cctkGH->cctk_bbox[2 * d + 1];
+      }
+    } // for i
+
+    if (local_component != -1) {
+      // Unset the data pointers that were set
+      assert(local_mode_current_groups);
+      vector<int> const &groups = *local_mode_current_groups;
+      for (size_t i = 0; i < groups.size(); ++i) {
+        local_mode_group_t const &g = local_mode_groups.AT(groups[i]);
+        for (int var = 0; var < g.numvars; ++var) {
+          void **const dst = cctkGH->data[g.firstvar + var];
+          fill(dst, dst + g.maxtimelevels, (void *)NULL);
         }
-
-      } // if grouptype
-    }   // for group
+      }
+      local_mode_current_groups = NULL;
+    }
 
   } // if mc_grouptype
 
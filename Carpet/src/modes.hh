@@ -1,7 +1,10 @@
 #ifndef MODES_HH
 #define MODES_HH
 
+#include <vector>
+
 #include <cctk.h>
+#include <cctk_Schedule.h>
 
 namespace Carpet {
 
@@ -41,6 +44,18 @@ void leave_singlemap_mode(cGH *cctkGH);
 void enter_local_mode(cGH *cctkGH, int c, int lc, int grouptype);
 void leave_local_mode(cGH *cctkGH);
 
+// While an object of this class exists, entering local mode sets
+// only the data pointers of those grid functions that the scheduled
+// function accesses according to its READS and WRITES clauses (if
+// restrict_local_mode_to_clauses is set)
+class local_mode_restriction {
+  vector<int> const *old_groups;
+
+public:
+  local_mode_restriction(cFunctionData const *attribute);
+  ~local_mode_restriction();
+};
+
 // Mode iterators
 
 class mglevel_iterator {
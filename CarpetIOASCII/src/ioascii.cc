@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <fstream>
 #include <iomanip>
+#include <limits>
 #include <map>
 #include <ostream>
 #include <sstream>
@@ -30,6 +31,7 @@
 #include "typeprops.hh"
 
 #include "ioascii.hh"
+#include "ioascii_binary.h"
 
 // That's a hack
 namespace Carpet {
@@ -56,6 +58,133 @@ const int ioproc = 0;
 // Global configuration parameters
 bool stop_on_parse_errors = false;
 
+// Which file formats to write (binary output is only available for
+// 1D and 2D output)
+static bool WantTextOutput(const int outdim) {
+  DECLARE_CCTK_PARAMETERS;
+  return outdim == 0 or outdim == 3 or
+         not CCTK_EQUALS(output_format, "binary");
+}
+
+static bool WantBinaryOutput(const int outdim) {
+  DECLARE_CCTK_PARAMETERS;
+  return (outdim == 1 or outdim == 2) and
+         not CCTK_EQUALS(output_format, "text");
+}
+
+// A binary output file and its index. Records are collected in a
+// buffer and written when the buffer is flushed.
+struct BinaryFile {
+  fstream file, index;
+  vector<char> buf;
+  vector<ioascii_binary_index_entry_t> entries; // offsets relative to buf
+  CCTK_REAL bytes_written;
+
+  BinaryFile() : bytes_written(0) {}
+
+  bool is_open() const { return file.is_open(); }
+
+  void open(const string &filename, const bool truncate, const int outdim) {
+    const ios::openmode mode =
+        ios::out | ios::binary | (truncate ? ios::trunc : ios::app);
+    const string indexname = filename + ".idx";
+    file.open(filename.c_str(), mode);
+    index.open(indexname.c_str(), mode);
+    if (not file.good() or not index.good()) {
+      CCTK_VERROR("Could not open binary output file '%s'", filename.c_str());
+    }
+    write_file_header(file, IOASCII_BINARY_MAGIC, outdim);
+    write_file_header(index, IOASCII_BINARY_INDEX_MAGIC, outdim);
+  }
+
+  // Append a text record
+  void text(const string &str) {
+    if (str.empty())
+      return;
+    const size_t pos = append_record(IOASCII_BINARY_RECORD_TEXT, str.size());
+    memcpy(&buf[pos], str.data(), str.size());
+  }
+
+  // Append a data record and return the offset of its columns in the
+  // buffer
+  size_t data(const ioascii_binary_data_header_t &header,
+              const size_t columns_size) {
+    const size_t record_offset = buf.size();
+    const size_t pos = append_record(IOASCII_BINARY_RECORD_DATA,
+                                     sizeof header + columns_size);
+    memcpy(&buf[pos], &header, sizeof header);
+    ioascii_binary_index_entry_t entry;
+    entry.offset = record_offset;
+    entry.length = buf.size() - record_offset;
+    entry.iteration = header.iteration;
+    entry.tl = header.tl;
+    entry.rl = header.rl;
+    entry.c = header.c;
+    entry.ml = header.ml;
+    entry.m = header.m;
+    entries.push_back(entry);
+    return pos + sizeof header;
+  }
+
+  void flush() {
+    if (buf.empty())
+      return;
+    file.seekp(0, ios::end);
+    const int64_t base = file.tellp();
+    for (size_t n = 0; n < entries.size(); ++n) {
+      entries.at(n).offset += base;
+    }
+    file.write(&buf[0], buf.size());
+    if (not entries.empty()) {
+      index.write(reinterpret_cast<const char *>(&entries[0]),
+                  entries.size() * sizeof entries[0]);
+    }
+    assert(file.good() and index.good());
+    bytes_written += buf.size() + entries.size() * sizeof entries[0];
+    buf.clear();
+    entries.clear();
+  }
+
+  void close() {
+    flush();
+    file.close();
+    index.close();
+    assert(file.good() and index.good());
+  }
+
+private:
+  // Write a file header if the file is empty
+  static void write_file_header(fstream &os, const char *const magic,
+                                const int outdim) {
+    os.seekp(0, ios::end);
+    if (os.tellp() > 0)
+      return;
+    ioascii_binary_file_header_t header;
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, magic, sizeof header.magic);
+    header.version = IOASCII_BINARY_VERSION;
+    header.byte_order = IOASCII_BINARY_BYTE_ORDER;
+    header.outdim = outdim;
+    os.write(reinterpret_cast<const char *>(&header), sizeof header);
+  }
+
+  // Append a record header and reserve (padded) space for the
+  // payload; return the offset of the payload in the buffer
+  size_t append_record(const int type, const size_t length) {
+    ioascii_binary_record_header_t header;
+    memset(&header, 0, sizeof header);
+    header.type = type;
+    header.length = length;
+    const size_t padded =
+        (length + IOASCII_BINARY_ALIGNMENT - 1) / IOASCII_BINARY_ALIGNMENT *
+        IOASCII_BINARY_ALIGNMENT;
+    const size_t pos = buf.size();
+    buf.resize(pos + sizeof header + padded, 0);
+    memcpy(&buf[pos], &header, sizeof header);
+    return pos + sizeof header;
+  }
+};
+
 int CarpetIOASCIIStartup() {
   IOASCII<0>::Startup();
   IOASCII<1>::Startup();
@@ -505,8 +634,9 @@ void IOASCII<outdim>::OutputDirection(const cGH *const cctkGH, const int vindex,
   for (int m = m_min; m < m_max; ++m) {
 
     fstream file;
+    BinaryFile binfile;
     OpenFile(cctkGH, m, vindex, alias, basefilename, dirs, is_new_file,
-             truncate_file, file);
+             truncate_file, file, binfile);
 
     // Find the output offset
     const ivect offset = groupdata.grouptype == CCTK_GF
@@ -634,7 +764,7 @@ void IOASCII<outdim>::OutputDirection(const cGH *const cctkGH, const int vindex,
             }
           }
 
-          if (dist::rank() == ioproc) {
+          if (dist::rank() == ioproc and file.is_open()) {
             ostringstream buf;
             buf << setprecision(out_precision);
             WriteASCII(buf, tmpdatas, ext, vindex, cctkGH->cctk_iteration,
@@ -642,6 +772,11 @@ void IOASCII<outdim>::OutputDirection(const cGH *const cctkGH, const int vindex,
                        coord_upper, tmpcoords);
             file << buf.str();
           }
+          if (dist::rank() == ioproc and binfile.is_open()) {
+            WriteBinary(binfile, tmpdatas, ext, vindex, cctkGH->cctk_iteration,
+                        offset1, dirs, rl, ml, m, c, tl, coord_time,
+                        coord_lower, coord_upper, tmpcoords);
+          }
 
           if (proc != ioproc) {
             for (size_t n = 0; n < tmpdatas.size(); ++n) {
@@ -655,10 +790,20 @@ void IOASCII<outdim>::OutputDirection(const cGH *const cctkGH, const int vindex,
           // Append EOL after every component
           if (dist::rank() == ioproc) {
             if (separate_components) {
+              if (file.is_open()) {
+                assert(file.good());
+                file << eol;
+              }
+              if (binfile.is_open()) {
+                binfile.text(eol);
+              }
+            }
+            if (file.is_open()) {
               assert(file.good());
-              file << eol;
             }
-            assert(file.good());
+            if (binfile.is_open()) {
+              binfile.flush();
+            }
           }
 
         } // for tl
@@ -668,13 +813,20 @@ void IOASCII<outdim>::OutputDirection(const cGH *const cctkGH, const int vindex,
     // Append EOL after every complete set of components
     if (dist::rank() == ioproc) {
       if (separate_grids and not compact_format) {
+        if (file.is_open()) {
+          assert(file.good());
+          file << eol;
+        }
+        if (binfile.is_open()) {
+          binfile.text(eol);
+        }
+      }
+      if (file.is_open()) {
         assert(file.good());
-        file << eol;
       }
-      assert(file.good());
     }
 
-    CloseFile(cctkGH, file);
+    CloseFile(cctkGH, file, binfile);
 
   } // for m
 }
@@ -739,7 +891,7 @@ void IOASCII<outdim>::OpenFile(const cGH *const cctkGH, const int m,
                                const string basefilename,
                                const vect<int, outdim> &dirs,
                                const bool is_new_file, const bool truncate_file,
-                               fstream &file) {
+                               fstream &file, BinaryFile &binfile) {
   DECLARE_CCTK_PARAMETERS;
 
   BeginTimingIO(cctkGH);
@@ -779,19 +931,27 @@ void IOASCII<outdim>::OpenFile(const cGH *const cctkGH, const int m,
     const char *const filename = filenamestr.c_str();
 
     // Open the file
-    file.open(filename, ios::out | (truncate_file ? ios::trunc : ios::app));
-    if (not file.good()) {
-      char *const fullname = CCTK_FullName(vindex);
-      CCTK_VERROR("Could not open output file '%s' for variable '%s'", filename,
-                  fullname);
-      free(fullname);
+    if (WantTextOutput(outdim)) {
+      file.open(filename, ios::out | (truncate_file ? ios::trunc : ios::app));
+      if (not file.good()) {
+        char *const fullname = CCTK_FullName(vindex);
+        CCTK_VERROR("Could not open output file '%s' for variable '%s'",
+                    filename, fullname);
+        free(fullname);
+      }
+      io_files += 1;
+      io_bytes_begin = file.tellg();
+    }
+    if (WantBinaryOutput(outdim)) {
+      binfile.open(filenamestr + ".bin", truncate_file, outdim);
+      io_files += 2;
     }
-    io_files += 1;
-    io_bytes_begin = file.tellg();
 
     // If this is the first time, then write a nice header
     if (is_new_file) {
 
+      ostringstream header;
+
       bool want_labels = false;
       bool want_date = false;
       bool want_parfilename = false;
@@ -813,8 +973,8 @@ void IOASCII<outdim>::OpenFile(const cGH *const cctkGH, const int m,
         CCTK_ERROR("internal error");
       }
 
-      file << "# " << outdim << "D ASCII output created by CarpetIOASCII"
-           << eol;
+      header << "# " << outdim << "D ASCII output created by CarpetIOASCII"
+             << eol;
 
       if (want_date) {
         char run_host[1000];
@@ -827,72 +987,90 @@ void IOASCII<outdim>::OpenFile(const cGH *const cctkGH, const int m,
         Util_CurrentDate(sizeof run_date, run_date);
         char run_time[1000];
         Util_CurrentTime(sizeof run_time, run_time);
-        file << "# created on " << run_host << " by " << run_user << " on "
-             << run_date << " at " << run_time << eol;
-        assert(file.good());
+        header << "# created on " << run_host << " by " << run_user << " on "
+               << run_date << " at " << run_time << eol;
+        assert(header.good());
       }
 
       if (want_parfilename) {
         char parameter_filename[10000];
         CCTK_ParameterFilename(sizeof parameter_filename, parameter_filename);
-        file << "# parameter filename: \"" << parameter_filename << "\"" << eol;
+        header << "# parameter filename: \"" << parameter_filename << "\""
+               << eol;
       }
 
       if (want_other) {
         if (CCTK_IsFunctionAliased("UniqueBuildID")) {
           const char *const build_id = (const char *)UniqueBuildID(cctkGH);
-          file << "# Build ID: " << build_id << eol;
+          header << "# Build ID: " << build_id << eol;
         }
         if (CCTK_IsFunctionAliased("UniqueSimulationID")) {
           const char *const job_id = (const char *)UniqueSimulationID(cctkGH);
-          file << "# Simulation ID: " << job_id << eol;
+          header << "# Simulation ID: " << job_id << eol;
         }
         if (CCTK_IsFunctionAliased("UniqueRunID")) {
           const char *const job_id = (const char *)UniqueRunID(cctkGH);
-          file << "# Run ID: " << job_id << eol;
+          header << "# Run ID: " << job_id << eol;
         }
       }
 
-      file << "#" << eol;
+      header << "#" << eol;
 
       if (want_labels) {
         if (one_file_per_group) {
           char *const groupname = CCTK_GroupNameFromVarI(vindex);
-          file << "# " << groupname;
+          header << "# " << groupname;
           free(groupname);
         } else {
           const char *const varname = CCTK_VarName(vindex);
-          file << "# " << varname;
+          header << "# " << varname;
         }
         for (int d = 0; d < outdim; ++d) {
-          file << " "
-               << "xyzd"[dirs[d]];
+          header << " "
+                 << "xyzd"[dirs[d]];
         }
-        file << " (" << alias << ")" << eol;
-        file << "#" << eol;
+        header << " (" << alias << ")" << eol;
+        header << "#" << eol;
+      }
+
+      if (file.is_open()) {
+        file << header.str();
+      }
+      if (binfile.is_open()) {
+        binfile.text(header.str());
       }
 
     } // if is_new_file
 
-    file << setprecision(out_precision);
-    assert(file.good());
+    if (file.is_open()) {
+      file << setprecision(out_precision);
+      assert(file.good());
+    }
 
   } // if on the I/O processor
 }
 
 template <int outdim>
-void IOASCII<outdim>::CloseFile(const cGH *const cctkGH, fstream &file) {
+void IOASCII<outdim>::CloseFile(const cGH *const cctkGH, fstream &file,
+                                BinaryFile &binfile) {
   DECLARE_CCTK_PARAMETERS;
 
   if (dist::rank() == ioproc) {
-    io_bytes_end = file.tellg();
-    file.close();
-    assert(file.good());
+    if (file.is_open()) {
+      io_bytes_end = file.tellg();
+      file.close();
+      assert(file.good());
+    }
+    if (binfile.is_open()) {
+      binfile.close();
+    }
   }
 
   assert(not file.is_open());
+  assert(not binfile.is_open());
 
-  CCTK_REAL const io_bytes = io_bytes_end - io_bytes_begin;
+  CCTK_REAL const io_bytes =
+      io_bytes_end - io_bytes_begin + binfile.bytes_written;
   EndTimingIO(cctkGH, io_files, io_bytes, false);
 }
 
@@ -1211,20 +1389,14 @@ CCTK_REAL nicelooking(const CCTK_REAL val, const CCTK_REAL base) {
   return floor(val / base + 0.5) * base;
 }
 
-// Output
-template <int outdim>
-void WriteASCII(ostream &os, vector<gdata *> const &gfdatas,
-                const bbox<int, dim> &gfext, const int vi, const int time,
-                const vect<int, dim> &org, const vect<int, outdim> &dirs,
-                const int rl, const int ml, const int m, const int c,
-                const int tl, const CCTK_REAL coord_time,
-                const vect<CCTK_REAL, dim> &coord_lower,
-                const vect<CCTK_REAL, dim> &coord_upper,
-                vector<gdata *> const &gfcoords) {
+// Write the comments describing a component
+static void WriteASCIIComments(ostream &os, const int vi, const int time,
+                               const int rl, const int ml, const int m,
+                               const int c, const int tl,
+                               const CCTK_REAL coord_time,
+                               vector<bool> &did_output_format) {
   DECLARE_CCTK_PARAMETERS;
 
-  assert(outdim <= dim);
-
   const int vartype = CCTK_VarTypeI(vi);
   const int grouptype = CCTK_GroupTypeFromVarI(vi);
   const int groupdim = CCTK_GroupDimFromVarI(vi);
@@ -1242,7 +1414,6 @@ void WriteASCII(ostream &os, vector<gdata *> const &gfdatas,
       os << "# refinement level " << rl << "   multigrid level " << ml
          << "   map " << m << "   component " << c << eol;
     }
-    static vector<bool> did_output_format;
     if (did_output_format.empty()) {
       did_output_format.resize(CCTK_NumVars());
     }
@@ -1290,6 +1461,118 @@ void WriteASCII(ostream &os, vector<gdata *> const &gfdatas,
     }
 
   } // if out_fileinfo
+}
+
+// Write the points on the diagonal
+static void WriteASCIIDiagonal(ostream &os, vector<gdata *> const &gfdatas,
+                               const bbox<int, dim> &gfext, const int vi,
+                               const int time, const int rl, const int ml,
+                               const int m, const int c, const int tl,
+                               const CCTK_REAL coord_time,
+                               const vect<CCTK_REAL, dim> &coord_lower,
+                               const vect<CCTK_REAL, dim> &coord_upper) {
+  DECLARE_CCTK_PARAMETERS;
+
+  const int vartype = CCTK_VarTypeI(vi);
+
+  const ivect lo = gfext.lower();
+  const ivect up = gfext.upper();
+  const ivect str = gfext.stride();
+  const ibbox ext(lo, up, str);
+
+  gh const &hh = *vhh.at(m);
+  ibbox const &base = hh.baseextents.at(mglevel).at(reflevel);
+
+  assert(base.stride()[0] == base.stride()[1] and
+         base.stride()[0] == base.stride()[2]);
+
+  // output the data on the diagonal
+  for (int i = maxval(base.lower()); i <= minval(base.upper());
+       i += base.stride()[0]) {
+
+    ivect const pos = ivect(i, i, i);
+
+    // check if the point in question is in our gf's extent
+    if (gfext.contains(pos)) {
+      os << time;
+      if (not compact_format) {
+        // Don't output the grid structure in compact format (it
+        // is still output in the comments above every component)
+        os << "\t" << tl << " " << rl << " " << c << " " << ml;
+      }
+      for (int d = 0; d < dim; ++d) {
+        os << (d == 0 ? "\t" : " ") << pos[d];
+      }
+      os << "\t" << coord_time;
+      for (int d = 0; d < dim; ++d) {
+        os << (d == 0 ? "\t" : " ");
+        assert(gfext.upper()[d] - gfext.lower()[d] >= 0);
+        if (gfext.upper()[d] - gfext.lower()[d] == 0) {
+          os << coord_lower[d];
+        } else {
+          CCTK_REAL const dx = ((coord_upper[d] - coord_lower[d]) /
+                                (gfext.upper()[d] - gfext.lower()[d]));
+          os << (nicelooking(coord_lower[d] +
+                                 (pos[d] - gfext.lower()[d]) * dx,
+                             dx * 1.0e-8));
+        }
+      }
+      for (size_t n = 0; n < gfdatas.size(); ++n) {
+        const gdata *gfdata = gfdatas.at(n);
+        os << (n == 0 ? "\t" : " ");
+        switch (specific_cactus_type(vartype)) {
+#define TYPECASE(N, T)                                                         \
+case N:                                                                      \
+  os << (*(const CarpetLib::data<T> *)gfdata)[pos];                          \
+  break;
+#include "typecase.hh"
+#undef TYPECASE
+        default:
+          UnsupportedVarType(vi);
+        }
+      } // for n
+      os << eol;
+
+    } else {
+
+      if (not compact_format) {
+        os << "#" << eol;
+      }
+
+    } // if not ext contains org
+
+  } // end for loop
+
+  if (not compact_format or maxval(base.lower()) > minval(base.upper())) {
+    // In the compact format, don't separate outputs that consist
+    // of a single lines only
+    os << eol;
+  }
+
+  assert(os.good());
+}
+
+// Output
+template <int outdim>
+void WriteASCII(ostream &os, vector<gdata *> const &gfdatas,
+                const bbox<int, dim> &gfext, const int vi, const int time,
+                const vect<int, dim> &org, const vect<int, outdim> &dirs,
+                const int rl, const int ml, const int m, const int c,
+                const int tl, const CCTK_REAL coord_time,
+                const vect<CCTK_REAL, dim> &coord_lower,
+                const vect<CCTK_REAL, dim> &coord_upper,
+                vector<gdata *> const &gfcoords) {
+  DECLARE_CCTK_PARAMETERS;
+
+  assert(outdim <= dim);
+
+  const int vartype = CCTK_VarTypeI(vi);
+  const int grouptype = CCTK_GroupTypeFromVarI(vi);
+  const int groupdim = CCTK_GroupDimFromVarI(vi);
+
+  static vector<bool> did_output_format;
+  WriteASCIIComments(os, vi, time, rl, ml, m, c, tl, coord_time,
+                     did_output_format);
 
   // boolean that says if we are doing 1D-diagonal output
   // This is not beautiful, but works for the moment
@@ -1412,83 +1695,213 @@ void WriteASCII(ostream &os, vector<gdata *> const &gfdatas,
 
   } else { // taking care of the diagonal
 
-    const ivect lo = gfext.lower();
-    const ivect up = gfext.upper();
-    const ivect str = gfext.stride();
-    const ibbox ext(lo, up, str);
+    WriteASCIIDiagonal(os, gfdatas, gfext, vi, time, rl, ml, m, c, tl,
+                       coord_time, coord_lower, coord_upper);
 
-    gh const &hh = *vhh.at(m);
-    ibbox const &base = hh.baseextents.at(mglevel).at(reflevel);
-
-    assert(base.stride()[0] == base.stride()[1] and
-           base.stride()[0] == base.stride()[2]);
+  } // if diagonal_output
+}
 
-    // output the data on the diagonal
-    for (int i = maxval(base.lower()); i <= minval(base.upper());
-         i += base.stride()[0]) {
+// Store the values of a variable at the given points as a binary
+// column
+template <typename T>
+static void StoreBinaryColumn(char *const column, const gdata *const gfdata,
+                              const vector<ivect> &points, const int kind) {
+  const CarpetLib::data<T> &gf = *(const CarpetLib::data<T> *)gfdata;
+  if (kind == IOASCII_BINARY_KIND_REAL) {
+    for (size_t i = 0; i < points.size(); ++i) {
+      const double value = gf[points[i]];
+      memcpy(column + i * sizeof value, &value, sizeof value);
+    }
+  } else {
+    for (size_t i = 0; i < points.size(); ++i) {
+      const int64_t value = gf[points[i]];
+      memcpy(column + i * sizeof value, &value, sizeof value);
+    }
+  }
+}
 
-      ivect const pos = ivect(i, i, i);
+// Store the real and imaginary parts of a complex variable as two
+// consecutive binary columns
+template <typename T>
+static void StoreBinaryComplexColumns(char *const columns,
+                                      const gdata *const gfdata,
+                                      const vector<ivect> &points) {
+  const CarpetLib::data<T> &gf = *(const CarpetLib::data<T> *)gfdata;
+  const size_t npoints = points.size();
+  for (size_t i = 0; i < npoints; ++i) {
+    const double re = real(gf[points[i]]);
+    const double im = imag(gf[points[i]]);
+    memcpy(columns + i * sizeof re, &re, sizeof re);
+    memcpy(columns + (npoints + i) * sizeof im, &im, sizeof im);
+  }
+}
 
-      // check if the point in question is in our gf's extent
-      if (gfext.contains(pos)) {
-        os << time;
-        if (not compact_format) {
-          // Don't output the grid structure in compact format (it
-          // is still output in the comments above every component)
-          os << "\t" << tl << " " << rl << " " << c << " " << ml;
-        }
-        for (int d = 0; d < dim; ++d) {
-          os << (d == 0 ? "\t" : " ") << pos[d];
-        }
-        os << "\t" << coord_time;
-        for (int d = 0; d < dim; ++d) {
-          os << (d == 0 ? "\t" : " ");
-          assert(gfext.upper()[d] - gfext.lower()[d] >= 0);
-          if (gfext.upper()[d] - gfext.lower()[d] == 0) {
-            os << coord_lower[d];
-          } else {
-            CCTK_REAL const dx = ((coord_upper[d] - coord_lower[d]) /
-                                  (gfext.upper()[d] - gfext.lower()[d]));
-            os << (nicelooking(coord_lower[d] +
-                                   (pos[d] - gfext.lower()[d]) * dx,
-                               dx * 1.0e-8));
-          }
-        }
-        for (size_t n = 0; n < gfdatas.size(); ++n) {
-          const gdata *gfdata = gfdatas.at(n);
-          os << (n == 0 ? "\t" : " ");
-          switch (specific_cactus_type(vartype)) {
-#define TYPECASE(N, T)                                                         \
-  case N:                                                                      \
-    os << (*(const CarpetLib::data<T> *)gfdata)[pos];                          \
-    break;
-#include "typecase.hh"
-#undef TYPECASE
-          default:
-            UnsupportedVarType(vi);
-          }
-        } // for n
-        os << eol;
+// Binary output. The data are written in the same order as by
+// WriteASCII, so that the utility carpetbin2ascii can reproduce the
+// text output exactly.
+template <int outdim>
+void WriteBinary(BinaryFile &file, vector<gdata *> const &gfdatas,
+                 const bbox<int, dim> &gfext, const int vi, const int time,
+                 const vect<int, dim> &org, const vect<int, outdim> &dirs,
+                 const int rl, const int ml, const int m, const int c,
+                 const int tl, const CCTK_REAL coord_time,
+                 const vect<CCTK_REAL, dim> &coord_lower,
+                 const vect<CCTK_REAL, dim> &coord_upper,
+                 vector<gdata *> const &gfcoords) {
+  DECLARE_CCTK_PARAMETERS;
 
-      } else {
+  assert(outdim <= dim);
 
-        if (not compact_format) {
-          os << "#" << eol;
-        }
+  const int vartype = CCTK_VarTypeI(vi);
+  const int grouptype = CCTK_GroupTypeFromVarI(vi);
+  const int groupdim = CCTK_GroupDimFromVarI(vi);
 
-      } // if not ext contains org
+  // Comments are stored as text
+  static vector<bool> did_output_format;
+  {
+    ostringstream os;
+    os << setprecision(out_precision);
+    WriteASCIIComments(os, vi, time, rl, ml, m, c, tl, coord_time,
+                       did_output_format);
+    file.text(os.str());
+  }
 
-    } // end for loop
+  // Diagonal output is rare and small; store it as text as well
+  bool const diagonal_output = outdim == 1 and dirs[0] == 3;
+  if (diagonal_output) {
+    ostringstream os;
+    os << setprecision(out_precision);
+    WriteASCIIDiagonal(os, gfdatas, gfext, vi, time, rl, ml, m, c, tl,
+                       coord_time, coord_lower, coord_upper);
+    file.text(os.str());
+    return;
+  }
 
-    if (not compact_format or maxval(base.lower()) > minval(base.upper())) {
-      // In the compact format, don't separate outputs that consist
-      // of a single lines only
-      os << eol;
+  const vect<int, outdim> lo = gfext.lower()[dirs];
+  const vect<int, outdim> up = gfext.upper()[dirs];
+  const vect<int, outdim> str = gfext.stride()[dirs];
+  const bbox<int, outdim> ext(lo, up, str);
+
+  // check whether the output origin is contained in the extent of
+  // the data that should be output
+  ivect org1(org);
+  for (int d = 0; d < outdim; ++d)
+    org1[dirs[d]] = ext.lower()[d];
+  if (not gfext.contains(org1)) {
+    if (not compact_format) {
+      file.text(string("#") + eol);
     }
+    return;
+  }
 
-    assert(os.good());
+  // Collect the points in output order
+  vector<ivect> points;
+  points.reserve(ext.size());
+  typename bbox<int, outdim>::iterator it = ext.begin();
+  do {
+    ivect index(org);
+    for (int d = 0; d < outdim; ++d)
+      index[dirs[d]] = (*it)[d];
+    points.push_back(index);
+    ++it;
+  } while (it != ext.end());
 
-  } // if diagonal_output
+  int kind = -1, ncomps = -1;
+  switch (specific_cactus_type(vartype)) {
+#define CARPET_NO_COMPLEX
+#define TYPECASE(N, T)                                                         \
+  case N:                                                                      \
+    kind = numeric_limits<T>::is_integer                                       \
+               ? (sizeof(T) == 1 ? IOASCII_BINARY_KIND_CHAR                    \
+                                 : IOASCII_BINARY_KIND_INT)                    \
+               : IOASCII_BINARY_KIND_REAL;                                     \
+    ncomps = 1;                                                                \
+    break;
+#include "typecase.hh"
+#undef TYPECASE
+#undef CARPET_NO_COMPLEX
+#define CARPET_COMPLEX
+#define TYPECASE(N, T)                                                         \
+  case N:                                                                      \
+    kind = IOASCII_BINARY_KIND_REAL;                                           \
+    ncomps = 2;                                                                \
+    break;
+#include "typecase.hh"
+#undef TYPECASE
+#undef CARPET_COMPLEX
+  default:
+    UnsupportedVarType(vi);
+  }
+
+  const bool have_coords = not gfcoords.empty();
+  const int nvars = gfdatas.size();
+
+  ioascii_binary_data_header_t header;
+  memset(&header, 0, sizeof header);
+  header.iteration = time;
+  header.tl = tl;
+  header.rl = rl;
+  header.c = c;
+  header.ml = ml;
+  header.m = m;
+  header.grouptype = grouptype;
+  header.groupdim = groupdim;
+  header.outdim = outdim;
+  for (int d = 0; d < dim; ++d) {
+    header.dirs[d] = d < outdim ? dirs[d] : -1;
+    header.org[d] = org[d];
+    header.lower[d] = gfext.lower()[d];
+    header.upper[d] = gfext.upper()[d];
+    header.stride[d] = gfext.stride()[d];
+    header.coord_lower[d] = coord_lower[d];
+    header.coord_upper[d] = coord_upper[d];
+  }
+  header.precision = out_precision;
+  header.compact_format = compact_format;
+  header.output_all_timelevels = output_all_timelevels;
+  header.have_coords = have_coords;
+  header.nvars = nvars;
+  header.ncomps = ncomps;
+  header.kind = kind;
+  header.npoints = points.size();
+  header.coord_time = coord_time;
+
+  // All values are stored with 8 bytes
+  const size_t column_size = points.size() * sizeof(double);
+  const size_t ncolumns = (have_coords ? dim : 0) + nvars * ncomps;
+  size_t pos = file.data(header, ncolumns * column_size);
+
+  if (have_coords) {
+    for (int d = 0; d < dim; ++d) {
+      StoreBinaryColumn<CCTK_REAL>(&file.buf[pos], gfcoords.at(d), points,
+                                   IOASCII_BINARY_KIND_REAL);
+      pos += column_size;
+    }
+  }
+  for (int n = 0; n < nvars; ++n) {
+    const gdata *const gfdata = gfdatas.at(n);
+    switch (specific_cactus_type(vartype)) {
+#define CARPET_NO_COMPLEX
+#define TYPECASE(N, T)                                                         \
+  case N:                                                                      \
+    StoreBinaryColumn<T>(&file.buf[pos], gfdata, points, kind);                \
+    break;
+#include "typecase.hh"
+#undef TYPECASE
+#undef CARPET_NO_COMPLEX
+#define CARPET_COMPLEX
+#define TYPECASE(N, T)                                                         \
+  case N:                                                                      \
+    StoreBinaryComplexColumns<T>(&file.buf[pos], gfdata, points);              \
+    break;
+#include "typecase.hh"
+#undef TYPECASE
+#undef CARPET_COMPLEX
+    default:
+      UnsupportedVarType(vi);
+    }
+    pos += ncomps * column_size;
+  }
 }
 
 // Explicit instantiation for all output dimensions
@@ -16,6 +16,8 @@ int CarpetIOASCIIStartup(void);
 void CarpetIOASCIIInit(CCTK_ARGUMENTS);
 }
 
+struct BinaryFile;
+
 // routines which are independent of the output dimension
 static ibbox GetOutputBBox(const cGH *cctkGH, int group, int rl, int m, int c,
                            const ibbox &ext);
@@ -71,9 +73,10 @@ template <int outdim> struct IOASCII {
 
   static void OpenFile(const cGH *cctkGH, int m, int vindex, string alias,
                        string basefilename, const vect<int, outdim> &dirs,
-                       bool is_new_file, bool truncate_file, fstream &file);
+                       bool is_new_file, bool truncate_file, fstream &file,
+                       BinaryFile &binfile);
 
-  static void CloseFile(const cGH *cctkGH, fstream &file);
+  static void CloseFile(const cGH *cctkGH, fstream &file, BinaryFile &binfile);
 
   static ivect GetOutputOffset(const cGH *cctkGH, int m,
                                const vect<int, outdim> &dirs);
@@ -90,6 +93,16 @@ void WriteASCII(ostream &os, vector<gdata *> const &gfdatas,
                 const vect<CCTK_REAL, dim> &coord_upper,
                 vector<gdata *> const &gfcoords);
 
+template <int outdim>
+void WriteBinary(BinaryFile &file, vector<gdata *> const &gfdatas,
+                 const bbox<int, dim> &gfext, const int vi, const int time,
+                 const vect<int, dim> &org, const vect<int, outdim> &dirs,
+                 const int rl, const int ml, const int m, const int c,
+                 const int tl, const CCTK_REAL coord_time,
+                 const vect<CCTK_REAL, dim> &coord_lower,
+                 const vect<CCTK_REAL, dim> &coord_upper,
+                 vector<gdata *> const &gfcoords);
+
 } // namespace CarpetIOASCII
 
 #endif // ! defined CARPETIOASCII_HH
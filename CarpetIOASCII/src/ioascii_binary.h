@@ -0,0 +1,84 @@
+#ifndef IOASCII_BINARY_H
+#define IOASCII_BINARY_H
+
+/* Binary file format for CarpetIOASCII 1D and 2D output.
+ *
+ * This header is shared between the thorn (C++) and the
+ * carpetbin2ascii utility (C), and must therefore remain valid C.
+ *
+ * A binary output file consists of a file header followed by a
+ * sequence of records. Each record starts with a record header and is
+ * padded to a multiple of 8 bytes, so that all data can be accessed
+ * directly after mapping the file into memory. There are two kinds
+ * of records:
+ *
+ * - Text records contain comments and separators verbatim as they
+ *   would appear in the text output.
+ *
+ * - Data records contain one component of one variable (or group)
+ *   for one iteration, refinement level, and time level. They consist
+ *   of a data header, followed by the coordinate columns (if grid
+ *   function coordinates are used), followed by the data columns.
+ *   Each column contains npoints values, stored in the order in
+ *   which the text output lists the points. Integer values are
+ *   stored as int64_t, real values as double.
+ *
+ * Data are stored in the native byte order of the machine writing
+ * the file; the byte order marker in the file header identifies it.
+ *
+ * An accompanying index file (with suffix ".idx") contains a file
+ * header followed by one index entry per data record, allowing tools
+ * to locate data without scanning the whole file. */
+
+#include <stdint.h>
+
+#define IOASCII_BINARY_MAGIC "CIOASCB1"
+#define IOASCII_BINARY_INDEX_MAGIC "CIOASCI1"
+#define IOASCII_BINARY_VERSION 1
+#define IOASCII_BINARY_BYTE_ORDER 0x01020304
+
+#define IOASCII_BINARY_ALIGNMENT 8
+
+/* Record types */
+#define IOASCII_BINARY_RECORD_TEXT 1
+#define IOASCII_BINARY_RECORD_DATA 2
+
+/* Value kinds */
+#define IOASCII_BINARY_KIND_INT 0  /* int64_t, formatted as integer */
+#define IOASCII_BINARY_KIND_REAL 1 /* double, formatted as real */
+#define IOASCII_BINARY_KIND_CHAR 2 /* int64_t, formatted as character */
+
+typedef struct {
+  char magic[8];
+  int32_t version;
+  int32_t byte_order;
+  int32_t outdim;
+  int32_t reserved;
+} ioascii_binary_file_header_t;
+
+typedef struct {
+  int32_t type;
+  int32_t reserved;
+  int64_t length; /* payload length in bytes, without padding */
+} ioascii_binary_record_header_t;
+
+typedef struct {
+  int32_t iteration, tl, rl, c, ml, m;
+  int32_t grouptype, groupdim;
+  int32_t outdim, dirs[3];
+  int32_t org[3];                      /* output origin */
+  int32_t lower[3], upper[3], stride[3]; /* extent of the component */
+  int32_t precision, compact_format, output_all_timelevels, have_coords;
+  int32_t nvars, ncomps, kind, reserved;
+  int64_t npoints;
+  double coord_time;
+  double coord_lower[3], coord_upper[3];
+} ioascii_binary_data_header_t;
+
+typedef struct {
+  int64_t offset; /* offset of the record header in the data file */
+  int64_t length; /* length of the record including its header */
+  int32_t iteration, tl, rl, c, ml, m;
+} ioascii_binary_index_entry_t;
+
+#endif /* #ifndef IOASCII_BINARY_H */
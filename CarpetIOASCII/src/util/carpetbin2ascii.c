@@ -0,0 +1,230 @@
+
+/*******************************************************************
+ * Program: carpetbin2ascii
+ * Description: Converts from Carpet binary 1D/2D output to the
+ *              Carpet ASCII file format
+ *
+ * Reads a file written by CarpetIOASCII with output_format =
+ * "binary" or "both" and writes the equivalent text output, either
+ * to stdout or to a file. The result is identical to the file that
+ * CarpetIOASCII would have written with output_format = "text".
+ *
+ * Usage: carpetbin2ascii <infile.bin> [outfile]
+ *******************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../ioascii_binary.h"
+
+/*******************************************************************
+ * Function: nicelooking
+ * Round a coordinate as CarpetIOASCII does
+ *******************************************************************/
+static double nicelooking(double val, double base) {
+  return floor(val / base + 0.5) * base;
+}
+
+/*******************************************************************
+ * Function: read_padded
+ * Read a record payload and skip its padding
+ *******************************************************************/
+static int read_padded(FILE *infile, void *buf, int64_t length) {
+  const int64_t padded = (length + IOASCII_BINARY_ALIGNMENT - 1) /
+                         IOASCII_BINARY_ALIGNMENT * IOASCII_BINARY_ALIGNMENT;
+  if (fread(buf, 1, length, infile) != (size_t)length)
+    return 0;
+  if (padded > length && fseek(infile, padded - length, SEEK_CUR) != 0)
+    return 0;
+  return 1;
+}
+
+/*******************************************************************
+ * Function: write_value
+ * Write one value of a data column
+ *******************************************************************/
+static void write_value(FILE *outfile, const char *column, int64_t i, int kind,
+                        int precision) {
+  if (kind == IOASCII_BINARY_KIND_REAL) {
+    double value;
+    memcpy(&value, column + i * sizeof value, sizeof value);
+    fprintf(outfile, "%.*g", precision, value);
+  } else {
+    int64_t value;
+    memcpy(&value, column + i * sizeof value, sizeof value);
+    if (kind == IOASCII_BINARY_KIND_CHAR) {
+      fputc((int)(char)value, outfile);
+    } else {
+      fprintf(outfile, "%lld", (long long)value);
+    }
+  }
+}
+
+/*******************************************************************
+ * Function: write_data
+ * Write the points of one data record in text form
+ *******************************************************************/
+static void write_data(FILE *outfile, const ioascii_binary_data_header_t *hdr,
+                       const char *columns) {
+  const int64_t npoints = hdr->npoints;
+  const size_t column_size = npoints * sizeof(double);
+  const int compact = hdr->compact_format;
+  const int prec = hdr->precision;
+  int64_t count[3];
+  int index[3];
+  int64_t i;
+  int d, n;
+
+  for (d = 0; d < hdr->outdim; ++d) {
+    const int dir = hdr->dirs[d];
+    count[d] = (hdr->upper[dir] - hdr->lower[dir]) / hdr->stride[dir] + 1;
+  }
+
+  for (i = 0; i < npoints; ++i) {
+    int64_t rest = i;
+    int64_t block = 1;
+
+    for (d = 0; d < 3; ++d)
+      index[d] = hdr->org[d];
+    for (d = 0; d < hdr->outdim; ++d) {
+      const int dir = hdr->dirs[d];
+      index[dir] = hdr->lower[dir] + (int)(rest % count[d]) * hdr->stride[dir];
+      rest /= count[d];
+    }
+
+    fprintf(outfile, "%d", hdr->iteration);
+    if (!compact || hdr->output_all_timelevels)
+      fprintf(outfile, "\t%d", hdr->tl);
+    if (!compact)
+      fprintf(outfile, "\t%d %d %d", hdr->rl, hdr->c, hdr->ml);
+    {
+      const int ndims =
+          !compact ? 3 : (hdr->groupdim < 3 ? hdr->groupdim : 3);
+      for (d = 0; d < ndims; ++d)
+        fprintf(outfile, "%s%d", d == 0 ? "\t" : " ", index[d]);
+    }
+    fprintf(outfile, "\t%.*g", prec, hdr->coord_time);
+    if (!compact || hdr->grouptype == 1 /* CCTK_GF */) {
+      for (d = 0; d < 3; ++d) {
+        fputs(d == 0 ? "\t" : " ", outfile);
+        if (hdr->have_coords) {
+          write_value(outfile, columns + d * column_size, i,
+                      IOASCII_BINARY_KIND_REAL, prec);
+        } else if (hdr->upper[d] == hdr->lower[d]) {
+          fprintf(outfile, "%.*g", prec, hdr->coord_lower[d]);
+        } else {
+          const double dx = (hdr->coord_upper[d] - hdr->coord_lower[d]) /
+                            (hdr->upper[d] - hdr->lower[d]);
+          fprintf(outfile, "%.*g", prec,
+                  nicelooking(hdr->coord_lower[d] +
+                                  (index[d] - hdr->lower[d]) * dx,
+                              dx * 1.0e-8));
+        }
+      }
+    }
+    for (n = 0; n < hdr->nvars; ++n) {
+      const char *const column =
+          columns +
+          ((hdr->have_coords ? 3 : 0) + n * hdr->ncomps) * column_size;
+      fputs(n == 0 ? "\t" : " ", outfile);
+      write_value(outfile, column, i, hdr->kind, prec);
+      if (hdr->ncomps == 2) {
+        fputs(" ", outfile);
+        write_value(outfile, column + column_size, i, hdr->kind, prec);
+      }
+    }
+    fputs("\n", outfile);
+
+    /* separate rows and planes as the text output does */
+    for (d = 0; d < hdr->outdim; ++d) {
+      block *= count[d];
+      if ((i + 1) % block != 0)
+        break;
+      if (!compact || count[d] > 1)
+        fputs("\n", outfile);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  FILE *infile, *outfile;
+  ioascii_binary_file_header_t file_header;
+  ioascii_binary_record_header_t record;
+  char *buf = NULL;
+  int64_t bufsize = 0;
+
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "Usage: %s <infile.bin> [outfile]\n", argv[0]);
+    return 1;
+  }
+
+  infile = fopen(argv[1], "rb");
+  if (!infile) {
+    fprintf(stderr, "Could not open input file '%s'\n", argv[1]);
+    return 1;
+  }
+  if (argc == 3) {
+    outfile = fopen(argv[2], "w");
+    if (!outfile) {
+      fprintf(stderr, "Could not open output file '%s'\n", argv[2]);
+      return 1;
+    }
+  } else {
+    outfile = stdout;
+  }
+
+  if (fread(&file_header, sizeof file_header, 1, infile) != 1 ||
+      memcmp(file_header.magic, IOASCII_BINARY_MAGIC,
+             sizeof file_header.magic) != 0) {
+    fprintf(stderr, "'%s' is not a CarpetIOASCII binary file\n", argv[1]);
+    return 1;
+  }
+  if (file_header.byte_order != IOASCII_BINARY_BYTE_ORDER) {
+    fprintf(stderr, "'%s' was written with a different byte order\n",
+            argv[1]);
+    return 1;
+  }
+  if (file_header.version != IOASCII_BINARY_VERSION) {
+    fprintf(stderr, "'%s' has unsupported version %d\n", argv[1],
+            (int)file_header.version);
+    return 1;
+  }
+
+  while (fread(&record, sizeof record, 1, infile) == 1) {
+    if (record.length > bufsize) {
+      bufsize = record.length;
+      buf = realloc(buf, bufsize);
+      if (!buf) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+      }
+    }
+    if (!read_padded(infile, buf, record.length)) {
+      fprintf(stderr, "'%s' is truncated\n", argv[1]);
+      return 1;
+    }
+    switch (record.type) {
+    case IOASCII_BINARY_RECORD_TEXT:
+      fwrite(buf, 1, record.length, outfile);
+      break;
+    case IOASCII_BINARY_RECORD_DATA: {
+      ioascii_binary_data_header_t hdr;
+      memcpy(&hdr, buf, sizeof hdr);
+      write_data(outfile, &hdr, buf + sizeof hdr);
+      break;
+    }
+    default:
+      fprintf(stderr, "'%s' contains an unknown record type %d\n", argv[1],
+              (int)record.type);
+      return 1;
+    }
+  }
+
+  free(buf);
+  fclose(infile);
+  if (outfile != stdout)
+    fclose(outfile);
+  return 0;
+}
@@ -245,57 +245,85 @@ int OutputVarAs(cGH const *const cctkGH, const char *const varname,
     // myioproc to myioproc+ioproc_every-1 (inclusive). Within each
     // group, at most one process can perform I/O.
 
-    // If I am not the first process in my I/O group, wait for a
-    // token from my predecessor
-    if (myproc > myioproc) {
-      MPI_Recv(NULL, 0, MPI_INT, myproc - 1, 0, dist::comm(),
-               MPI_STATUS_IGNORE);
-    }
-
-    // Open file
     static bool first_time = true;
 
-    // The file name doesn't matter since we currently write
-    // everything into a single file
-    int const vindex = CCTK_VarIndex(varname);
-    assert(vindex >= 0);
-    string const basename = generate_basename(cctkGH, vindex);
-    int const ioproc = myioproc / ioproc_every;
-    string const name =
-        create_filename(cctkGH, basename, cctkGH->cctk_iteration, ioproc,
-                        io_dir_output, first_time);
-
-    indent_t indent;
-    cout << indent << "I/O process=" << ioproc << "\n";
-
-    enter_keep_file_open();
-    bool const truncate_file =
-        first_time and IO_TruncateOutputFiles(cctkGH) and myproc == myioproc;
-    if (open_file < 0) {
-      // Reuse file hid if file is already open
-      hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
-      H5Pset_fclose_degree(fapl, H5F_CLOSE_STRONG);
-      open_file = truncate_file ? H5Fcreate(name.c_str(), H5F_ACC_TRUNC,
-                                            H5P_DEFAULT, fapl)
-                                : H5Fopen(name.c_str(), H5F_ACC_RDWR, fapl);
-      assert(open_file >= 0);
-      H5Pclose(fapl);
-    }
-    first_time = false;
+    if (use_async_output()) {
+
+      // Stage the data and send them to our I/O process, which
+      // writes them in the background while the simulation
+      // continues
+      int const vindex = CCTK_VarIndex(varname);
+      assert(vindex >= 0);
+      string const basename = generate_basename(cctkGH, vindex);
+      int const ioproc = myioproc / ioproc_every;
+      string const name =
+          create_filename(cctkGH, basename, cctkGH->cctk_iteration, ioproc,
+                          io_dir_output, first_time);
+      bool const truncate_file =
+          first_time and IO_TruncateOutputFiles(cctkGH);
+      first_time = false;
+
+      vector<bool> output_var(CCTK_NumVars());
+      output_var.at(vindex) = true;
+      stage_output(cctkGH, output_var, false, true);
+      flush_staged_fragments(cctkGH, name, truncate_file, myioproc,
+                             ioproc_every);
+
+    } else {
+
+      // Ensure that no output is being written in the background
+      wait_for_async_output();
 
-    vector<bool> output_var(CCTK_NumVars());
-    output_var.at(vindex) = true;
-    // NOTE: We should output metadata at most once per iteration,
-    // probably only once per restart (per file)
-    output(cctkGH, open_file, output_var, false, true);
+      // If I am not the first process in my I/O group, wait for a
+      // token from my predecessor
+      if (myproc > myioproc) {
+        MPI_Recv(NULL, 0, MPI_INT, myproc - 1, 0, dist::comm(),
+                 MPI_STATUS_IGNORE);
+      }
 
-    // Close file
-    leave_keep_file_open();
+      // Open file
+      // The file name doesn't matter since we currently write
+      // everything into a single file
+      int const vindex = CCTK_VarIndex(varname);
+      assert(vindex >= 0);
+      string const basename = generate_basename(cctkGH, vindex);
+      int const ioproc = myioproc / ioproc_every;
+      string const name =
+          create_filename(cctkGH, basename, cctkGH->cctk_iteration, ioproc,
+                          io_dir_output, first_time);
+
+      indent_t indent;
+      cout << indent << "I/O process=" << ioproc << "\n";
+
+      enter_keep_file_open();
+      bool const truncate_file =
+          first_time and IO_TruncateOutputFiles(cctkGH) and myproc == myioproc;
+      if (open_file < 0) {
+        // Reuse file hid if file is already open
+        hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+        H5Pset_fclose_degree(fapl, H5F_CLOSE_STRONG);
+        open_file = truncate_file ? H5Fcreate(name.c_str(), H5F_ACC_TRUNC,
+                                              H5P_DEFAULT, fapl)
+                                  : H5Fopen(name.c_str(), H5F_ACC_RDWR, fapl);
+        assert(open_file >= 0);
+        H5Pclose(fapl);
+      }
+      first_time = false;
 
-    // If I am not the last process in my I/O group, send a token to
-    // my successor
-    if (myproc < min(myioproc + ioproc_every, nprocs) - 1) {
-      MPI_Send(NULL, 0, MPI_INT, myproc + 1, 0, dist::comm());
+      vector<bool> output_var(CCTK_NumVars());
+      output_var.at(vindex) = true;
+      // NOTE: We should output metadata at most once per iteration,
+      // probably only once per restart (per file)
+      output(cctkGH, open_file, output_var, false, true);
+
+      // Close file
+      leave_keep_file_open();
+
+      // If I am not the last process in my I/O group, send a token to
+      // my successor
+      if (myproc < min(myioproc + ioproc_every, nprocs) - 1) {
+        MPI_Send(NULL, 0, MPI_INT, myproc + 1, 0, dist::comm());
+      }
     }
   }
   END_GLOBAL_MODE;
@@ -313,6 +341,9 @@ void Checkpoint(cGH const *const cctkGH, int const called_from) {
   CCTK_VInfo(CCTK_THORNSTRING, "F5::Checkpoint: iteration=%d",
              cctkGH->cctk_iteration);
 
+  // Ensure that no output is being written in the background
+  wait_for_async_output();
+
 #if 0
     // generate filenames for both the temporary and real checkpoint
     // files
@@ -427,6 +458,12 @@ void CarpetIOF5_TerminationCheckpoint(CCTK_ARGUMENTS) {
   }
 }
 
+// Scheduled shutdown routine
+void CarpetIOF5_Shutdown(CCTK_ARGUMENTS) {
+  // Wait until all output has been written
+  shutdown_async_output();
+}
+
 // Recovery information
 static int recovery_iteration = -1;
 
@@ -446,6 +483,9 @@ int Input(cGH *const cctkGH, char const *const basefilename,
       return 0; // no error
   }
 
+  // Ensure that no output is being written in the background
+  wait_for_async_output();
+
   BEGIN_GLOBAL_MODE(cctkGH) {
     DECLARE_CCTK_ARGUMENTS;
 
@@ -25,6 +25,7 @@
 #include <carpet.hh>
 
 #include "distribute.hh"
+#include "staging.hh"
 
 // This requires defining a boolean local variable "error_flag",
 // initialised to false
@@ -39,8 +40,7 @@ static T failwarn(bool &error_flag, T const expr, int const line,
                   char const *const msg) {
   static_assert(T(-1) < T(0), "Type T must be signed");
   if (expr < 0) {
-    CCTK_VWarn(CCTK_WARN_ALERT, line, file, thorn,
-               "Expression \"%s\" return %d", msg, (int)expr);
+    CarpetIOF5::report_failure(line, file, thorn, msg, (int)expr);
     error_flag = true;
   }
   return expr;
@@ -52,8 +52,7 @@ static T failwarn0(bool &error_flag, T const expr, int const line,
                    char const *const msg) {
   static_assert(T(-1) > T(0), "Type T must be unsigned");
   if (expr == 0) {
-    CCTK_VWarn(CCTK_WARN_ALERT, line, file, thorn,
-               "Expression \"%s\" return %d", msg, (int)expr);
+    CarpetIOF5::report_failure(line, file, thorn, msg, (int)expr);
     error_flag = true;
   }
   return expr;
@@ -210,6 +209,7 @@ void interpret_fieldname(cGH const *const cctkGH, string fieldname, int &vi);
 // Write/read Cactus metadata to a particular location in an HDF5
 // file
 void write_metadata(cGH const *const cctkGH, hid_t const group);
+void write_metadata(metadata_t const &metadata, hid_t const group);
 void read_metadata(cGH const *const cctkGH, hid_t const group);
 
 // Handle Carpet's grid structure (this should move to Carpet and/or
@@ -220,6 +220,9 @@ void deserialise_grid_structure(cGH const *const cctkGH, string const buf);
 void output(cGH const *const cctkGH, hid_t const file,
             vector<bool> const &output_var, bool const output_past_timelevels,
             bool const output_metadata);
+void stage_output(cGH const *const cctkGH, vector<bool> const &output_var,
+                  bool const output_past_timelevels,
+                  bool const output_metadata);
 
 void input(cGH const *const cctkGH, hid_t const file,
            vector<bool> const &input_var, bool const input_past_timelevels,
@@ -229,6 +232,7 @@ void input(cGH const *const cctkGH, hid_t const file,
 extern "C" {
 int CarpetIOF5_Startup();
 int CarpetIOF5_RecoverParameters();
+void CarpetIOF5_Shutdown(CCTK_ARGUMENTS);
 void CarpetIOF5_Init(CCTK_ARGUMENTS);
 void CarpetIOF5_InitialDataCheckpoint(CCTK_ARGUMENTS);
 void CarpetIOF5_EvolutionCheckpoint(CCTK_ARGUMENTS);
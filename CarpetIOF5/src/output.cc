@@ -27,14 +27,378 @@
 #include <vect.hh>
 
 #include <carpet.hh>
+#include <quantize.hh>
 
 #include "iof5.hh"
+#include "staging.hh"
 
 namespace CarpetIOF5 {
 
 using namespace std;
 using namespace Carpet;
 
+// Create (or open) the topologies for a refinement level
+struct topology_paths_t {
+  F5Path *path;
+  F5Path *coordpath;
+  bool close_coordpath;
+};
+
+static topology_paths_t create_topology(hid_t const file,
+                                        topology_t const &topo,
+                                        bool &error_flag) {
+  topology_paths_t paths;
+  paths.path = NULL;
+  paths.coordpath = NULL;
+  paths.close_coordpath = true;
+
+  double time = topo.time;
+  hvect const reffact = v2h(topo.reffact);
+  if (topo.is_gf) {
+    if (topo.indexdepth == 0) {
+      paths.path = F5Rcreate_coordinate_topology(
+          file, &time, topo.gridname.c_str(), topo.chartname.c_str(),
+          topo.topologyname.c_str(), 0, topo.dim, topo.dim, &reffact[0]);
+    } else {
+      char vertextopologyname[1000];
+      TopologyName(vertextopologyname, sizeof vertextopologyname, &reffact[0],
+                   0, dim);
+      paths.coordpath = F5Rcreate_coordinate_topology(
+          file, &time, topo.gridname.c_str(), topo.chartname.c_str(),
+          vertextopologyname, 0, topo.dim, topo.dim, &reffact[0]);
+      paths.path = F5Rcreate_coordinate_topology(
+          file, &time, topo.gridname.c_str(),
+          /*topo.chartname.c_str(),*/
+          vertextopologyname, topo.topologyname.c_str(), topo.indexdepth,
+          topo.dim, topo.dim, &reffact[0]);
+      // TODO: how should these two topologies be linked?
+      // assert(mi.dim == 3);
+      // assert(all(reffact == 1));
+      // path =
+      //   F5Rcreate_hexaedrons_as_vertices_topology(file, &cctk_time,
+      //                                             gridname.c_str());
+    }
+  } else {
+    paths.path = F5Rcreate_coordinate_topology(
+        file, &time, topo.gridname.c_str(), topo.chartname.c_str(),
+        topo.topologyname.c_str(), 0, topo.dim, topo.dim, &reffact[0]);
+  }
+  if (!paths.coordpath) {
+    paths.coordpath = paths.path;
+    paths.close_coordpath = false;
+  }
+  assert(paths.coordpath);
+  assert(paths.path);
+
+  // TODO: Attach the number of I/O processes to the topology. WB
+  // sent email with suggestions.
+
+  // Define default topology (once per grid)
+  if (topo.link_default_topology) {
+    // TODO: Check that this happens at least once
+    FAILWARN(F5Rlink_default_vertex_topology(paths.path, &reffact[0]));
+  }
+
+  // Define iteration
+  if (topo.set_timestep) {
+    FAILWARN(F5Rset_timestep(paths.path, topo.iteration));
+  }
+
+  return paths;
+}
+
+static void close_topology(topology_paths_t const &paths) {
+  if (paths.close_coordpath)
+    F5close(paths.coordpath);
+  F5close(paths.path);
+}
+
+// Attach Cactus/Carpet metadata to a grid
+static void attach_metadata(F5Path *const path, string const &gridname,
+                            cGH const *const cctkGH,
+                            metadata_t const *const metadata) {
+  // hid_t const metadata_group = path->Grid_hid;
+  ostringstream pathname;
+  pathname << FIBER_CONTENT_GRIDS << "/" << gridname;
+  hid_t group;
+  group =
+      H5Gopen(path->ContentsGroup_hid, pathname.str().c_str(), H5P_DEFAULT);
+  if (group < 0) {
+    group = H5Gcreate(path->ContentsGroup_hid, pathname.str().c_str(),
+                      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  }
+  assert(group >= 0);
+  if (metadata) {
+    write_metadata(*metadata, group);
+  } else {
+    write_metadata(cctkGH, group);
+  }
+  herr_t const herr = H5Gclose(group);
+  assert(not herr);
+}
+
+// Define the geometry of a map
+static void write_map_geometry(F5Path *const path, int const mdim,
+                               ivect const &gsh, rvect const &lower,
+                               rvect const &upper, rvect const &delta,
+                               bool &error_flag) {
+  F5_vec3_double_t const vlower = v2d(lower);
+  F5_vec3_double_t const vupper = v2d(upper);
+  F5_vec3_double_t const vdelta = v2d(delta);
+  static vector<ChartDomain_IDs *> charts;
+  if (charts.size() < dim + 1) {
+    charts.resize(dim + 1, NULL);
+    charts.at(3) = F5B_standard_cartesian_chart3D();
+  }
+  if (not charts.at(mdim)) {
+    assert(mdim != 0);
+    char const *coordnames[] = {"x", "y", "z"};
+    ostringstream chartnamebuf;
+    chartnamebuf << "Cartesian " << mdim << "D";
+    charts.at(mdim) = F5B_new_global_float_chart(
+        coordnames, mdim, chartnamebuf.str().c_str(), F5_FORTRAN_ORDER);
+    assert(charts.at(mdim));
+  }
+  // hid_t const type = charts.at(mdim)->DoublePrecision.Point_hid_t;
+  hid_t const type = path->myChart->DoublePrecision.Point_hid_t;
+  assert(type);
+  FAILWARN(F5Fwrite_linear(path, FIBER_HDF5_POSITIONS_STRING, mdim,
+                           &v2h(gsh)[0], type, &vlower, &vdelta));
+  // TODO: path and chart don't match
+  FAILWARN(F5Fset_range(path, &vlower, &vupper));
+}
+
+// Determine the HDF5 datatype for a field
+static hid_t field_type(int const tensortype, int const vartype,
+                        bool const write_positions) {
+  hid_t type = -1;
+  switch (tensortype) {
+
+  case tt_scalar:
+    // Scalar field
+    assert(not write_positions);
+    switch (vartype) {
+    case CCTK_VARIABLE_INT:
+      switch (sizeof(CCTK_INT)) {
+      case 1:
+        type = H5T_NATIVE_INT8;
+        break;
+      case 2:
+        type = H5T_NATIVE_INT16;
+        break;
+      case 4:
+        type = H5T_NATIVE_INT32;
+        break;
+      case 8:
+        type = H5T_NATIVE_INT64;
+        break;
+      // case 16: type = H5T_NATIVE_INT128; break;
+      default:
+        CCTK_ERROR("Unsupported CCTK_INT type");
+      }
+      break;
+    case CCTK_VARIABLE_REAL:
+      switch (sizeof(CCTK_REAL)) {
+      case 4:
+        type = H5T_NATIVE_FLOAT;
+        break;
+      case 8:
+        type = H5T_NATIVE_DOUBLE;
+        break;
+      case 16:
+        type = H5T_NATIVE_LDOUBLE;
+        break; // ???
+      default:
+        CCTK_ERROR("Unsupported CCTK_REAL type");
+      }
+      break;
+    default:
+      CCTK_ERROR("Unsupported type");
+    }
+    break;
+
+  case tt_vector:
+    // Vector field, or positions
+    switch (vartype) {
+    case CCTK_VARIABLE_REAL:
+      type = write_positions ? F5T_COORD3_DOUBLE : F5T_VEC3_DOUBLE;
+      break;
+    default:
+      assert(0);
+    }
+    break;
+
+  case tt_symtensor:
+    // Symmetric tensor field
+    assert(not write_positions);
+    switch (vartype) {
+    case CCTK_VARIABLE_REAL:
+      type = F5T_METRIC33_DOUBLE;
+      break;
+    default:
+      assert(0);
+    }
+    break;
+
+  case tt_tensor:
+    // Non-symmetric tensor field
+    assert(not write_positions);
+    switch (vartype) {
+    case CCTK_VARIABLE_REAL:
+      type = F5T_BIVEC3_DOUBLE;
+      break;
+    default:
+      assert(0);
+    }
+    break;
+
+  default:
+    assert(0);
+  }
+  return type;
+}
+
+// Check whether the positions of a fragment have already been
+// written
+static bool have_positions(F5Path *const path, string const &name,
+                           string const &fragmentname) {
+  htri_t const exists =
+      H5Lexists(path->Representation_hid, name.c_str(), H5P_DEFAULT);
+  assert(exists >= 0);
+  if (not exists)
+    return false;
+  string const fragmentpath = name + "/" + fragmentname;
+  htri_t const exists2 =
+      H5Lexists(path->Representation_hid, fragmentpath.c_str(), H5P_DEFAULT);
+  assert(exists2 >= 0);
+  return exists2;
+}
+
+// Write a field (a set of contiguous arrays, one per tensor
+// component) into a fragment
+static void write_field(F5Path *const path, string const &name,
+                        string const &fragmentname, int const fdim,
+                        ivect const &gsh, ivect const &ilen, ivect const &ioff,
+                        ivect const &lghosts, ivect const &ughosts,
+                        hid_t const type, int const num_comps,
+                        void const *const *const data, bool const is_multipatch,
+                        bool const full_coverage,
+                        write_options_t const &options, bool &error_flag) {
+  // Dataset properties
+  hid_t const prop = H5Pcreate(H5P_DATASET_CREATE);
+  assert(prop >= 0);
+  // Use chunked I/O if requested or needed
+  bool const set_chunks = options.use_chunks or
+                          options.compression_level >= 0 or
+                          options.use_checksums;
+  if (set_chunks) {
+    assert(fdim > 0);
+    int const chunksize = options.max_chunksize / H5Tget_size(type);
+    assert(chunksize > 0);
+    int cs = 1, csd = 1;
+    while (csd < chunksize) {
+      cs <<= 1;
+      csd <<= fdim;
+      assert(fdim > 0);
+    }
+    ivect chunkshape(cs);
+    chunkshape[fdim - 1] = cs / (csd / chunksize);
+    chunkshape = max(chunkshape, 1);
+    chunkshape = min(chunkshape, ilen);
+    FAILWARN(H5Pset_chunk(prop, fdim, &v2h(chunkshape).reverse()[dim - fdim]));
+  }
+  // Enable compression if requested
+  if (options.compression_level >= 0) {
+    assert(set_chunks);
+    FAILWARN(H5Pset_shuffle(prop));
+    FAILWARN(H5Pset_deflate(prop, options.compression_level));
+  }
+  // Enable checksums if requested
+  if (options.use_checksums) {
+    assert(set_chunks);
+    FAILWARN(H5Pset_fletcher32(prop));
+  }
+
+  if (num_comps == 1 and not options.separate_single_component_tensors) {
+    // Write single-component tensors into non-separated fractions
+    // for convenience (could also use a separated compound
+    // instead)
+    // TODO: Extend F5 API to allow writing non-fragmented datasets
+    // TODO: Extend F5 API to accept hyperslab descriptors
+    FAILWARN(F5Fwrite_fraction(
+        path, name.c_str(), fdim, is_multipatch ? NULL : &v2h(gsh)[0],
+        &v2h(ilen)[0], type, type, data[0], &v2h(ioff)[0], &v2h(lghosts)[0],
+        &v2h(ughosts)[0], fragmentname.c_str(), prop));
+  } else {
+    // F5ls does not seem to support what F5 generates in this
+    // case. It seems that F5 does not generate a separated object
+    // (it does not generate a group for all datasets), but
+    // declares that it does create one (it calls it
+    // FragmentedSeparatedCompound). F5ls then gets confused
+    // because it cannot open this group. (output_hyperslab warns
+    // about this.)
+    // TODO: Extend F5 API to accept hyperslab descriptors
+    FAILWARN(F5FSwrite_fraction(
+        path, name.c_str(), fdim, is_multipatch ? NULL : &v2h(gsh)[0],
+        &v2h(ilen)[0], type, type, const_cast<void const **>(data),
+        &v2h(ioff)[0], &v2h(lghosts)[0], &v2h(ughosts)[0],
+        fragmentname.c_str(), prop, full_coverage));
+  }
+
+  FAILWARN(H5Pclose(prop));
+}
+
+// Write a staged fragment
+void write_fragment(hid_t const file, fragment_t const &fragment,
+                    metadata_t const *const metadata,
+                    write_options_t const &options, bool &error_flag) {
+  topology_t const &topo = fragment.topology;
+  topology_paths_t const paths = create_topology(file, topo, error_flag);
+
+  if (topo.attach_metadata and metadata)
+    attach_metadata(paths.path, topo.gridname, NULL, metadata);
+
+  switch (fragment.kind) {
+
+  case fragment_t::kind_map:
+    write_map_geometry(paths.path, fragment.dim, fragment.gsh, fragment.lower,
+                       fragment.upper, fragment.delta, error_flag);
+    break;
+
+  case fragment_t::kind_component:
+    FAILWARN(F5Fwrite_linear_fraction(
+        paths.path, FIBER_HDF5_POSITIONS_STRING, fragment.dim,
+        &v2h(fragment.gsh)[0], &v2h(fragment.ilen)[0], F5T_COORD3_DOUBLE,
+        &fragment.clower, &fragment.delta, &v2h(fragment.ioff)[0],
+        fragment.fragmentname.c_str()));
+    break;
+
+  case fragment_t::kind_field: {
+    if (fragment.write_positions and
+        have_positions(paths.path, fragment.fieldname, fragment.fragmentname))
+      break;
+    hid_t const type = field_type(fragment.tensortype, fragment.vartype,
+                                  fragment.write_positions);
+    ptrdiff_t const compsize = fragment.data.size() / fragment.num_comps;
+    assert(ptrdiff_t(fragment.data.size()) == fragment.num_comps * compsize);
+    vector<void const *> data(fragment.num_comps);
+    for (int d = 0; d < fragment.num_comps; ++d)
+      data.at(d) = &fragment.data.at(d * compsize);
+    write_field(paths.path, fragment.fieldname, fragment.fragmentname,
+                fragment.dim, fragment.gsh, fragment.ilen, fragment.ioff,
+                fragment.lghosts, fragment.ughosts, type, fragment.num_comps,
+                &data.front(), fragment.is_multipatch, fragment.full_coverage,
+                options, error_flag);
+    break;
+  }
+
+  default:
+    assert(0);
+  }
+
+  close_topology(paths);
+}
+
 class output_iterator_t {
   // Can't be cGH const, since the mode loops change its entries
   cGH *const cctkGH;
@@ -43,6 +407,9 @@ class output_iterator_t {
   bool const output_past_timelevels;
   bool const output_metadata;
   bool const is_multipatch;
+  bool const staging; // stage fragments instead of writing them
+
+  topology_t topology; // the current topology
 
   int group_type;       // CCTK_GF or CCTK_ARRAY
   int group_index;      // if group_type != CCTK_GF; else -1
@@ -164,12 +531,13 @@ class output_iterator_t {
 public:
   output_iterator_t(cGH *const cctkGH_, vector<bool> const &output_var_,
                     bool const output_past_timelevels_,
-                    bool const output_metadata_)
+                    bool const output_metadata_, bool const staging_)
       : cctkGH(cctkGH_), output_var(output_var_),
         output_past_timelevels(output_past_timelevels_),
         output_metadata(output_metadata_),
         is_multipatch(
-            CCTK_IsFunctionAliased("MultiPatch_GetSystemSpecification")) {}
+            CCTK_IsFunctionAliased("MultiPatch_GetSystemSpecification")),
+        staging(staging_) {}
 
   void iterate(hid_t const file) {
     // Iterate over the variables in groups, first all grid
@@ -366,88 +734,43 @@ private:
 
     // Define grid hierarchy
     map_indices_t const mi(cctkGH, group_index);
-    F5Path *path = NULL;
-    F5Path *coordpath = NULL;
-    bool close_coordpath = true;
-    if (group_type == CCTK_GF) {
-      int const indexdepth = vhh.at(0)->refcent == vertex_centered ? 0 : 1;
-      if (indexdepth == 0) {
-        path = F5Rcreate_coordinate_topology(
-            file, &cctk_time, gridname.c_str(), chartname.c_str(),
-            topologyname.c_str(), 0, mi.dim, mi.dim, &v2h(reffact)[0]);
-      } else {
-        char vertextopologyname[1000];
-        TopologyName(vertextopologyname, sizeof vertextopologyname,
-                     &v2h(reffact)[0], 0, dim);
-        coordpath = F5Rcreate_coordinate_topology(
-            file, &cctk_time, gridname.c_str(), chartname.c_str(),
-            vertextopologyname, 0, mi.dim, mi.dim, &v2h(reffact)[0]);
-        path = F5Rcreate_coordinate_topology(file, &cctk_time, gridname.c_str(),
-                                             /*chartname.c_str(),*/
-                                             vertextopologyname,
-                                             topologyname.c_str(), indexdepth,
-                                             mi.dim, mi.dim, &v2h(reffact)[0]);
-        // TODO: how should these two topologies be linked?
-        // assert(mi.dim == 3);
-        // assert(all(reffact == 1));
-        // path =
-        //   F5Rcreate_hexaedrons_as_vertices_topology(file, &cctk_time,
-        //                                             gridname.c_str());
-      }
-    } else {
-      path = F5Rcreate_coordinate_topology(
-          file, &cctk_time, gridname.c_str(), chartname.c_str(),
-          topologyname.c_str(), 0, mi.dim, mi.dim, &v2h(reffact)[0]);
-    }
-    if (!coordpath) {
-      coordpath = path;
-      close_coordpath = false;
-    }
-    assert(coordpath);
-    assert(path);
-
-    // TODO: Attach the number of I/O processes to the topology. WB
-    // sent email with suggestions.
-
-    // Define default topology (once per grid)
-    if (group_type == CCTK_GF and reflevel == 0 and timelevel == 0 and
-        all(slice_ipos < 0)) {
-      // TODO: Check that this happens at least once
-      FAILWARN(F5Rlink_default_vertex_topology(path, &v2h(reffact)[0]));
+    topology.gridname = gridname;
+    topology.chartname = chartname;
+    topology.topologyname = topologyname;
+    topology.time = cctk_time;
+    topology.iteration = cctk_iteration;
+    topology.reffact = reffact;
+    topology.is_gf = group_type == CCTK_GF;
+    topology.indexdepth =
+        group_type == CCTK_GF and vhh.at(0)->refcent != vertex_centered ? 1
+                                                                         : 0;
+    topology.dim = mi.dim;
+    topology.link_default_topology = group_type == CCTK_GF and
+                                     reflevel == 0 and timelevel == 0 and
+                                     all(slice_ipos < 0);
+    topology.set_timestep = reflevel == 0 and timelevel == 0;
+    // Attach Cactus/Carpet metadata (only once per output)
+    topology.attach_metadata = output_metadata and group_type == CCTK_GF and
+                               reflevel == 0 and timelevel == 0;
+
+    if (staging) {
+      // The topology is created when the staged fragments are
+      // written
+      BEGIN_LOCAL_MAP_LOOP(cctkGH, group_type) { output_map(NULL); }
+      END_LOCAL_MAP_LOOP;
+      return;
     }
 
-    // Define iteration
-    if (reflevel == 0 and timelevel == 0) {
-      FAILWARN(F5Rset_timestep(path, cctk_iteration));
-    }
+    topology_paths_t const paths = create_topology(file, topology, error_flag);
 
-    // Attach Cactus/Carpet metadata (only once per output)
-    if (output_metadata) {
-      if (group_type == CCTK_GF and reflevel == 0 and timelevel == 0) {
-        // hid_t const metadata_group = path->Grid_hid;
-        ostringstream pathname;
-        pathname << FIBER_CONTENT_GRIDS << "/" << gridname;
-        hid_t group;
-        group = H5Gopen(path->ContentsGroup_hid, pathname.str().c_str(),
-                        H5P_DEFAULT);
-        if (group < 0) {
-          group = H5Gcreate(path->ContentsGroup_hid, pathname.str().c_str(),
-                            H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        }
-        assert(group >= 0);
-        write_metadata(cctkGH, group);
-        herr_t const herr = H5Gclose(group);
-        assert(not herr);
-      }
-    }
+    if (topology.attach_metadata)
+      attach_metadata(paths.path, gridname, cctkGH, NULL);
 
-    BEGIN_LOCAL_MAP_LOOP(cctkGH, group_type) { output_map(path); }
+    BEGIN_LOCAL_MAP_LOOP(cctkGH, group_type) { output_map(paths.path); }
     END_LOCAL_MAP_LOOP;
 
     // Close topologies
-    if (close_coordpath)
-      F5close(coordpath);
-    F5close(path);
+    close_topology(paths);
   }
 
   void output_map(F5Path *const path) {
@@ -462,30 +785,20 @@ private:
     if (group_type != CCTK_GF or not is_multipatch) {
       // Define level geometry
       map_indices_t const mi(cctkGH, group_index);
-      F5_vec3_double_t const vlower = v2d(mi.lower);
-      F5_vec3_double_t const vupper = v2d(mi.upper);
-      F5_vec3_double_t const vdelta = v2d(mi.delta);
-      static vector<ChartDomain_IDs *> charts;
-      if (charts.size() < dim + 1) {
-        charts.resize(dim + 1, NULL);
-        charts.at(3) = F5B_standard_cartesian_chart3D();
-      }
-      if (not charts.at(mi.dim)) {
-        assert(mi.dim != 0);
-        char const *coordnames[] = {"x", "y", "z"};
-        ostringstream chartnamebuf;
-        chartnamebuf << "Cartesian " << mi.dim << "D";
-        charts.at(mi.dim) = F5B_new_global_float_chart(
-            coordnames, mi.dim, chartnamebuf.str().c_str(), F5_FORTRAN_ORDER);
-        assert(charts.at(mi.dim));
+      if (staging) {
+        fragment_t fragment;
+        fragment.kind = fragment_t::kind_map;
+        fragment.topology = topology;
+        fragment.dim = mi.dim;
+        fragment.gsh = mi.gsh;
+        fragment.lower = mi.lower;
+        fragment.upper = mi.upper;
+        fragment.delta = mi.delta;
+        stage_fragment(fragment);
+      } else {
+        write_map_geometry(path, mi.dim, mi.gsh, mi.lower, mi.upper, mi.delta,
+                           error_flag);
       }
-      // hid_t const type = charts.at(mi.dim)->DoublePrecision.Point_hid_t;
-      hid_t const type = path->myChart->DoublePrecision.Point_hid_t;
-      assert(type);
-      FAILWARN(F5Fwrite_linear(path, FIBER_HDF5_POSITIONS_STRING, mi.dim,
-                               &v2h(mi.gsh)[0], type, &vlower, &vdelta));
-      // TODO: path and chart don't match
-      FAILWARN(F5Fset_range(path, &vlower, &vupper));
     }
 
     BEGIN_LOCAL_COMPONENT_LOOP(cctkGH, group_type) { output_component(path); }
@@ -513,10 +826,24 @@ private:
         // box was already defined above, but it provides the
         // individual components' bounding boxes.)
         component_indices_t const ci(cctkGH, group_index, slice_ipos);
-        FAILWARN(F5Fwrite_linear_fraction(
-            path, FIBER_HDF5_POSITIONS_STRING, ci.dim, &v2h(ci.gsh)[0],
-            &v2h(ci.ilen)[0], F5T_COORD3_DOUBLE, &ci.clower, &ci.delta,
-            &v2h(ci.ioff)[0], fragmentname.c_str()));
+        if (staging) {
+          fragment_t fragment;
+          fragment.kind = fragment_t::kind_component;
+          fragment.topology = topology;
+          fragment.dim = ci.dim;
+          fragment.gsh = ci.gsh;
+          fragment.delta = ci.delta;
+          fragment.fragmentname = fragmentname;
+          fragment.ioff = ci.ioff;
+          fragment.ilen = ci.ilen;
+          fragment.clower = ci.clower;
+          stage_fragment(fragment);
+        } else {
+          FAILWARN(F5Fwrite_linear_fraction(
+              path, FIBER_HDF5_POSITIONS_STRING, ci.dim, &v2h(ci.gsh)[0],
+              &v2h(ci.ilen)[0], F5T_COORD3_DOUBLE, &ci.clower, &ci.delta,
+              &v2h(ci.ioff)[0], fragmentname.c_str()));
+        }
       } else {
         // Output coordinates
         output_variable(path, CCTK_VarIndex("grid::x"), true);
@@ -636,133 +963,50 @@ private:
       return;
     }
 
-    hid_t type = -1;
     int num_comps = 0;
     string name;
 
     switch (tensortype) {
-
-    case tt_scalar: {
-      // Scalar field
-      assert(not write_positions);
-      switch (groupdata.vartype) {
-      case CCTK_VARIABLE_INT:
-        switch (sizeof(CCTK_INT)) {
-        case 1:
-          type = H5T_NATIVE_INT8;
-          break;
-        case 2:
-          type = H5T_NATIVE_INT16;
-          break;
-        case 4:
-          type = H5T_NATIVE_INT32;
-          break;
-        case 8:
-          type = H5T_NATIVE_INT64;
-          break;
-        // case 16: type = H5T_NATIVE_INT128; break;
-        default:
-          CCTK_ERROR("Unsupported CCTK_INT type");
-        }
-        break;
-      case CCTK_VARIABLE_REAL:
-        switch (sizeof(CCTK_REAL)) {
-        case 4:
-          type = H5T_NATIVE_FLOAT;
-          break;
-        case 8:
-          type = H5T_NATIVE_DOUBLE;
-          break;
-        case 16:
-          type = H5T_NATIVE_LDOUBLE;
-          break; // ???
-        default:
-          CCTK_ERROR("Unsupported CCTK_REAL type");
-        }
-        break;
-      default:
-        CCTK_ERROR("Unsupported type");
-      }
+    case tt_scalar:
       num_comps = 1;
       name = generate_fieldname(cctkGH, var, tensortype);
       break;
-    }
-
-    case tt_vector: {
-      // Vector field, or positions
-      switch (groupdata.vartype) {
-      case CCTK_VARIABLE_REAL:
-        type = write_positions ? F5T_COORD3_DOUBLE : F5T_VEC3_DOUBLE;
-        break;
-      default:
-        assert(0);
-      }
+    case tt_vector:
       num_comps = dim;
       // TODO: use generate_positionsname
       name = write_positions ? FIBER_HDF5_POSITIONS_STRING
                              : generate_fieldname(cctkGH, var, tensortype);
-      if (write_positions) {
-        htri_t const exists =
-            H5Lexists(path->Representation_hid, name.c_str(), H5P_DEFAULT);
-        assert(exists >= 0);
-        if (exists) {
-          string const fragmentpath = name + "/" + fragmentname;
-          htri_t const exists2 = H5Lexists(path->Representation_hid,
-                                           fragmentpath.c_str(), H5P_DEFAULT);
-          assert(exists2 >= 0);
-          if (exists2) {
-            // Write positions only once
-            indent_t indent2;
-            cout << indent2 << "skipping output since the positions have "
-                               "already been output\n";
-            return;
-          }
-        }
-      }
       break;
-    }
-
-    case tt_symtensor: {
-      // Symmetric tensor field
-      assert(not write_positions);
-      switch (groupdata.vartype) {
-      case CCTK_VARIABLE_REAL:
-        type = F5T_METRIC33_DOUBLE;
-        break;
-      default:
-        assert(0);
-      }
+    case tt_symtensor:
       num_comps = dim * (dim + 1) / 2;
       name = generate_fieldname(cctkGH, var, tensortype);
       break;
-    }
-
-    case tt_tensor: {
-      // Non-symmetric tensor field
-      assert(not write_positions);
-      switch (groupdata.vartype) {
-      case CCTK_VARIABLE_REAL:
-        type = F5T_BIVEC3_DOUBLE;
-        break;
-      default:
-        assert(0);
-      }
+    case tt_tensor:
       num_comps = dim * dim;
       name = generate_fieldname(cctkGH, var, tensortype);
       break;
-    }
-
     default:
       assert(0);
     }
 
+    if (write_positions and not staging and
+        have_positions(path, name, fragmentname)) {
+      // Write positions only once
+      indent_t indent2;
+      cout << indent2 << "skipping output since the positions have "
+                         "already been output\n";
+      return;
+    }
+
     cout << indent << "fieldname=" << name << "\n";
 
-    output_hyperslab(path, var, type, num_comps, name);
+    output_hyperslab(path, var, tensortype, write_positions, num_comps, name);
   }
 
-  void output_hyperslab(F5Path *const path, int const var, hid_t const type,
-                        int const num_comps, string const name) {
+  void output_hyperslab(F5Path *const path, int const var,
+                        tensortype_t const tensortype,
+                        bool const write_positions, int const num_comps,
+                        string const name) {
     DECLARE_CCTK_ARGUMENTS;
     DECLARE_CCTK_PARAMETERS;
     indent_t indent;
@@ -770,14 +1014,17 @@ private:
 
     cout << indent << "hyperslab=" << (slice_ipos < ivect(0)) << "\n";
 
+    int const vartype = CCTK_VarTypeI(var);
+    hid_t const type = field_type(tensortype, vartype, write_positions);
+
     // Write data
     assert(type >= 0);       // HDF5 datatype
     assert(num_comps > 0);   // field components
     assert(name.size() > 0); // field name
 
     // Ensure that the data types match
-    int const vartype = CCTK_VarTypeI(var);
-    assert(num_comps * CCTK_VarTypeSize(vartype) == (int)H5Tget_size(type));
+    int const vartypesize = CCTK_VarTypeSize(vartype);
+    assert(num_comps * vartypesize == (int)H5Tget_size(type));
 
     component_indices_t const ci(cctkGH, group_index, slice_ipos);
     // Do not output empty datasets, or slices that do not intersect
@@ -787,7 +1034,22 @@ private:
 
     int const will_cover_complete_domain =
         (group_type != CCTK_GF or not is_multipatch) and reflevel == 0;
+    int const full_coverage = will_cover_complete_domain and
+                              not fragment_contiguous_components and
+                              all(slice_ipos < 0);
+    if (num_comps == 1 and separate_single_component_tensors and
+        not full_coverage) {
+      CCTK_WARN(CCTK_WARN_ALERT,
+                "Outputting scalars in a fragmented, separated way. "
+                "This does not seem to be supported by F5ls "
+                "(or is implemented wrong in the F5 library).");
+    }
 
+    // Copy the data into a contiguous buffer. When staging, this
+    // buffer is kept until the data have been written, so that the
+    // simulation can continue to modify the grid functions.
+    ptrdiff_t const npoints = prod(ci.ilen);
+    vector<char> buffer(num_comps * npoints * vartypesize);
     void const *data[num_comps];
     switch (vartype) {
 
@@ -796,7 +1058,7 @@ private:
         CCTK_INT const *const varptr =
             (CCTK_INT const *)CCTK_VarDataPtrI(cctkGH, timelevel, var + d);
         assert(varptr);
-        CCTK_INT *const rdata = new CCTK_INT[prod(ci.ilen)];
+        CCTK_INT *const rdata = (CCTK_INT *)&buffer[d * npoints * vartypesize];
         for (int k = 0; k < ci.ilen[2]; ++k) {
           for (int j = 0; j < ci.ilen[1]; ++j) {
             for (int i = 0; i < ci.ilen[0]; ++i) {
@@ -818,7 +1080,8 @@ private:
         CCTK_REAL const *const varptr =
             (CCTK_REAL const *)CCTK_VarDataPtrI(cctkGH, timelevel, var + d);
         assert(varptr);
-        CCTK_REAL *const rdata = new CCTK_REAL[prod(ci.ilen)];
+        CCTK_REAL *const rdata =
+            (CCTK_REAL *)&buffer[d * npoints * vartypesize];
         for (int k = 0; k < ci.ilen[2]; ++k) {
           for (int j = 0; j < ci.ilen[1]; ++j) {
             for (int i = 0; i < ci.ilen[0]; ++i) {
@@ -839,116 +1102,107 @@ private:
       assert(0);
     }
 
-    // Dataset properties
-    hid_t const prop = H5Pcreate(H5P_DATASET_CREATE);
-    assert(prop >= 0);
-    // Use chunked I/O if requested or needed
-    bool const set_chunks =
-        use_chunks or compression_level >= 0 or use_checksums;
-    if (set_chunks) {
-      assert(ci.dim > 0);
-      int const chunksize = max_chunksize / H5Tget_size(type);
-      assert(chunksize > 0);
-      int cs = 1, csd = 1;
-      while (csd < chunksize) {
-        cs <<= 1;
-        csd <<= ci.dim;
-        assert(ci.dim > 0);
-      }
-      ivect chunkshape(cs);
-      chunkshape[ci.dim - 1] = cs / (csd / chunksize);
-      chunkshape = max(chunkshape, 1);
-      chunkshape = min(chunkshape, ci.ilen);
-      FAILWARN(
-          H5Pset_chunk(prop, ci.dim, &v2h(chunkshape).reverse()[dim - ci.dim]));
-    }
-    // Enable compression if requested
-    if (compression_level >= 0) {
-      assert(set_chunks);
-      indent_t indent2;
-      cout << indent2 << "using chunk size " << ci.ilen << " "
-           << "(" << prod(ci.ilen) << ")\n";
-      FAILWARN(H5Pset_shuffle(prop));
-      FAILWARN(H5Pset_deflate(prop, compression_level));
-    }
-    // Enable checksums if requested
-    if (use_checksums) {
-      assert(set_chunks);
-      FAILWARN(H5Pset_fletcher32(prop));
-    }
-
-    if (num_comps == 1 and not separate_single_component_tensors) {
-      // Write single-component tensors into non-separated fractions
-      // for convenience (could also use a separated compound
-      // instead)
-      // TODO: Extend F5 API to allow writing non-fragmented datasets
-      // TODO: Extend F5 API to accept hyperslab descriptors
-      FAILWARN(F5Fwrite_fraction(
-          path, name.c_str(), ci.dim, is_multipatch ? NULL : &v2h(ci.gsh)[0],
-          &v2h(ci.ilen)[0], type, type, data[0], &v2h(ci.ioff)[0],
-          &v2h(ci.lghosts)[0], &v2h(ci.ughosts)[0], fragmentname.c_str(),
-          prop));
-    } else {
-      int const full_coverage = will_cover_complete_domain and
-                                not fragment_contiguous_components and
-                                all(slice_ipos < 0);
-      // F5ls does not seem to support what F5 generates in this
-      // case. It seems that F5 does not generate a separated object
-      // (it does not generate a group for all datasets), but
-      // declares that it does create one (it calls it
-      // FragmentedSeparatedCompound). F5ls then gets confused
-      // because it cannot open this group.
-      if (not full_coverage and num_comps == 1) {
-        CCTK_WARN(CCTK_WARN_ALERT,
-                  "Outputting scalars in a fragmented, separated way. "
-                  "This does not seem to be supported by F5ls "
-                  "(or is implemented wrong in the F5 library).");
-      }
-      // TODO: Extend F5 API to accept hyperslab descriptors
-      FAILWARN(F5FSwrite_fraction(
-          path, name.c_str(), ci.dim, is_multipatch ? NULL : &v2h(ci.gsh)[0],
-          &v2h(ci.ilen)[0], type, type, data, &v2h(ci.ioff)[0],
-          &v2h(ci.lghosts)[0], &v2h(ci.ughosts)[0], fragmentname.c_str(), prop,
-          full_coverage));
+    // Round the data to the requested tolerances, so that they
+    // compress better (only past timelevels are output for
+    // checkpoints, which must not be lossy); level 0 stores the data
+    // uncompressed, so that rounding would lose accuracy for nothing
+    double abs_tol, rel_tol;
+    if (compression_level > 0 and not output_past_timelevels and
+        CarpetLib::lookup_tolerances(compression_tolerances, var, abs_tol,
+                                     rel_tol)) {
+      CarpetLib::quantize(vartype, &buffer.front(), num_comps * npoints,
+                          abs_tol, rel_tol);
     }
 
-    for (int d = 0; d < num_comps; ++d) {
-      if (data[d]) {
-        switch (vartype) {
-        case CCTK_VARIABLE_INT:
-          delete[](CCTK_INT const *) data[d];
-          break;
-        case CCTK_VARIABLE_REAL:
-          delete[](CCTK_REAL const *) data[d];
-          break;
-        default:
-          assert(0);
-        }
-      }
-      data[d] = NULL;
+    if (staging) {
+      fragment_t fragment;
+      fragment.kind = fragment_t::kind_field;
+      fragment.topology = topology;
+      fragment.dim = ci.dim;
+      fragment.gsh = ci.gsh;
+      fragment.fragmentname = fragmentname;
+      fragment.ioff = ci.ioff;
+      fragment.ilen = ci.ilen;
+      fragment.lghosts = ci.lghosts;
+      fragment.ughosts = ci.ughosts;
+      fragment.fieldname = name;
+      fragment.tensortype = tensortype;
+      fragment.vartype = vartype;
+      fragment.num_comps = num_comps;
+      fragment.write_positions = write_positions;
+      fragment.is_multipatch = is_multipatch;
+      fragment.full_coverage = full_coverage;
+      swap(fragment.data, buffer);
+      stage_fragment(fragment);
+      return;
     }
 
-    FAILWARN(H5Pclose(prop));
+    write_options_t options;
+    options.capture();
+    write_field(path, name, fragmentname, ci.dim, ci.gsh, ci.ilen, ci.ioff,
+                ci.lghosts, ci.ughosts, type, num_comps, data, is_multipatch,
+                full_coverage, options, error_flag);
   }
 
 }; // class output_iterator_t
 
-void write_metadata(cGH const *const cctkGH, hid_t const file) {
-  DECLARE_CCTK_PARAMETERS;
+metadata_t::metadata_t(cGH const *const cctkGH) {
+  // Unique identifiers
+  if (CCTK_IsFunctionAliased("UniqueConfigID")) {
+    config_id = (char const *)UniqueConfigID(cctkGH);
+  }
+  if (CCTK_IsFunctionAliased("UniqueBuildID")) {
+    build_id = (char const *)UniqueBuildID(cctkGH);
+  }
+  if (CCTK_IsFunctionAliased("UniqueSimulationID")) {
+    simulation_id = (char const *)UniqueSimulationID(cctkGH);
+  }
+  if (CCTK_IsFunctionAliased("UniqueRunID")) {
+    run_id = (char const *)UniqueRunID(cctkGH);
+  }
+
+  // Parameters
+  int const get_all = 1;
+  char *const all_parameters = IOUtil_GetAllParameters(cctkGH, get_all);
+  assert(all_parameters);
+  parameters = all_parameters;
+  free(all_parameters);
+
+  // Grid structure
+  grid_structure = serialise_grid_structure(cctkGH);
+}
 
+static bool have_metadata(hid_t const file) {
+  htri_t const exists = H5Lexists(file, metadata_group, H5P_DEFAULT);
+  assert(exists >= 0);
+  return exists;
+}
+
+void write_metadata(cGH const *const cctkGH, hid_t const file) {
   assert(cctkGH);
   assert(file >= 0);
 
+  // Create metadata only once
+  // TODO: instead, overwrite the metadata
+  if (have_metadata(file))
+    return;
+
+  write_metadata(metadata_t(cctkGH), file);
+}
+
+void write_metadata(metadata_t const &metadata, hid_t const file) {
+  assert(file >= 0);
+
   herr_t herr;
 
   // Create metadata only once
   // TODO: instead, overwrite the metadata
-  htri_t const exists = H5Lexists(file, metadata_group, H5P_DEFAULT);
-  assert(exists >= 0);
-  if (exists)
+  if (have_metadata(file))
     return;
 
-  CCTK_INFO("Writing simulation metadata...");
+  // (This may be called from a background thread, so we don't use
+  // CCTK_INFO)
+  cout << "Writing simulation metadata...\n";
 
   // Create a group to hold all metadata
   hid_t const group =
@@ -959,18 +1213,17 @@ void write_metadata(cGH const *const cctkGH, hid_t const file) {
   WriteAttribute(group, "Cactus version", CCTK_FullVersion());
 
   // Unique identifiers
-  if (CCTK_IsFunctionAliased("UniqueConfigID")) {
-    WriteAttribute(group, "config id", (char const *)UniqueConfigID(cctkGH));
+  if (not metadata.config_id.empty()) {
+    WriteAttribute(group, "config id", metadata.config_id);
   }
-  if (CCTK_IsFunctionAliased("UniqueBuildID")) {
-    WriteAttribute(group, "build id", (char const *)UniqueBuildID(cctkGH));
+  if (not metadata.build_id.empty()) {
+    WriteAttribute(group, "build id", metadata.build_id);
   }
-  if (CCTK_IsFunctionAliased("UniqueSimulationID")) {
-    WriteAttribute(group, "simulation id",
-                   (char const *)UniqueSimulationID(cctkGH));
+  if (not metadata.simulation_id.empty()) {
+    WriteAttribute(group, "simulation id", metadata.simulation_id);
   }
-  if (CCTK_IsFunctionAliased("UniqueRunID")) {
-    WriteAttribute(group, "run id", (char const *)UniqueRunID(cctkGH));
+  if (not metadata.run_id.empty()) {
+    WriteAttribute(group, "run id", metadata.run_id);
   }
 
 // Don't write this attribute; the number of files may change
@@ -984,15 +1237,10 @@ void write_metadata(cGH const *const cctkGH, hid_t const file) {
 
   // Write parameters into a separate dataset (they may be too large
   // for an attribute)
-  int const get_all = 1;
-  char *const parameters = IOUtil_GetAllParameters(cctkGH, get_all);
-  assert(parameters);
-  WriteLargeAttribute(group, all_parameters, parameters);
-  free(parameters);
+  WriteLargeAttribute(group, all_parameters, metadata.parameters.c_str());
 
   // Grid structure
-  string const gs = serialise_grid_structure(cctkGH);
-  WriteLargeAttribute(group, grid_structure, gs.c_str());
+  WriteLargeAttribute(group, grid_structure, metadata.grid_structure.c_str());
 
   herr = H5Gclose(group);
   assert(not herr);
@@ -1002,8 +1250,16 @@ void output(cGH const *const cctkGH, hid_t const file,
             vector<bool> const &output_var, bool const output_past_timelevels,
             bool const output_metadata) {
   output_iterator_t iterator(const_cast<cGH *>(cctkGH), output_var,
-                             output_past_timelevels, output_metadata);
+                             output_past_timelevels, output_metadata, false);
   iterator.iterate(file);
 }
 
+void stage_output(cGH const *const cctkGH, vector<bool> const &output_var,
+                  bool const output_past_timelevels,
+                  bool const output_metadata) {
+  output_iterator_t iterator(const_cast<cGH *>(cctkGH), output_var,
+                             output_past_timelevels, output_metadata, true);
+  iterator.iterate(H5I_INVALID_HID);
+}
+
 } // end namespace CarpetIOF5
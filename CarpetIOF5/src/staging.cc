@@ -0,0 +1,506 @@
+#include "staging.hh"
+
+#include <cctk.h>
+#include <cctk_Parameters.h>
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <hdf5.h>
+
+#include <Timer.hh>
+
+#include <carpet.hh>
+
+namespace CarpetIOF5 {
+
+using namespace std;
+
+/*** Serialisation **********************************************************/
+
+namespace {
+
+template <typename T> void put(vector<char> &buf, T const &x) {
+  char const *const p = reinterpret_cast<char const *>(&x);
+  buf.insert(buf.end(), p, p + sizeof x);
+}
+
+void put(vector<char> &buf, string const &x) {
+  put(buf, x.size());
+  buf.insert(buf.end(), x.begin(), x.end());
+}
+
+void put(vector<char> &buf, vector<char> const &x) {
+  put(buf, x.size());
+  buf.insert(buf.end(), x.begin(), x.end());
+}
+
+template <typename T> void get(char const *&buf, T &x) {
+  memcpy(static_cast<void *>(&x), buf, sizeof x);
+  buf += sizeof x;
+}
+
+void get(char const *&buf, string &x) {
+  size_t size;
+  get(buf, size);
+  x.assign(buf, size);
+  buf += size;
+}
+
+void get(char const *&buf, vector<char> &x) {
+  size_t size;
+  get(buf, size);
+  x.assign(buf, buf + size);
+  buf += size;
+}
+
+void put(vector<char> &buf, topology_t const &x) {
+  put(buf, x.gridname);
+  put(buf, x.chartname);
+  put(buf, x.topologyname);
+  put(buf, x.time);
+  put(buf, x.iteration);
+  put(buf, x.reffact);
+  put(buf, x.is_gf);
+  put(buf, x.indexdepth);
+  put(buf, x.dim);
+  put(buf, x.link_default_topology);
+  put(buf, x.set_timestep);
+  put(buf, x.attach_metadata);
+}
+
+void get(char const *&buf, topology_t &x) {
+  get(buf, x.gridname);
+  get(buf, x.chartname);
+  get(buf, x.topologyname);
+  get(buf, x.time);
+  get(buf, x.iteration);
+  get(buf, x.reffact);
+  get(buf, x.is_gf);
+  get(buf, x.indexdepth);
+  get(buf, x.dim);
+  get(buf, x.link_default_topology);
+  get(buf, x.set_timestep);
+  get(buf, x.attach_metadata);
+}
+
+} // namespace
+
+void fragment_t::serialise(vector<char> &buf) const {
+  put(buf, kind);
+  put(buf, topology);
+  put(buf, dim);
+  put(buf, gsh);
+  put(buf, lower);
+  put(buf, upper);
+  put(buf, delta);
+  put(buf, fragmentname);
+  put(buf, ioff);
+  put(buf, ilen);
+  put(buf, lghosts);
+  put(buf, ughosts);
+  put(buf, clower);
+  put(buf, fieldname);
+  put(buf, tensortype);
+  put(buf, vartype);
+  put(buf, num_comps);
+  put(buf, write_positions);
+  put(buf, is_multipatch);
+  put(buf, full_coverage);
+  put(buf, data);
+}
+
+void fragment_t::deserialise(char const *&buf) {
+  get(buf, kind);
+  get(buf, topology);
+  get(buf, dim);
+  get(buf, gsh);
+  get(buf, lower);
+  get(buf, upper);
+  get(buf, delta);
+  get(buf, fragmentname);
+  get(buf, ioff);
+  get(buf, ilen);
+  get(buf, lghosts);
+  get(buf, ughosts);
+  get(buf, clower);
+  get(buf, fieldname);
+  get(buf, tensortype);
+  get(buf, vartype);
+  get(buf, num_comps);
+  get(buf, write_positions);
+  get(buf, is_multipatch);
+  get(buf, full_coverage);
+  get(buf, data);
+}
+
+size_t batch_t::memory() const {
+  size_t mem = sizeof *this + metadata.parameters.size() +
+               metadata.grid_structure.size();
+  for (vector<fragment_t>::const_iterator fi = fragments.begin();
+       fi != fragments.end(); ++fi) {
+    mem += fi->memory();
+  }
+  return mem;
+}
+
+void write_options_t::capture() {
+  DECLARE_CCTK_PARAMETERS;
+  this->use_chunks = use_chunks;
+  this->max_chunksize = max_chunksize;
+  this->compression_level = compression_level;
+  this->use_checksums = use_checksums;
+  this->separate_single_component_tensors = separate_single_component_tensors;
+}
+
+/*** Background writer ******************************************************/
+
+namespace {
+
+// Failures recorded by the current thread instead of being reported
+// (set only in the background writer thread)
+thread_local vector<string> *recorded_failures = NULL;
+
+// Write batches into files in a background thread. Only one writer
+// exists per process; it is only active on I/O processes.
+class writer_t {
+  thread worker;
+  mutex mtx;
+  condition_variable cond;
+
+  deque<batch_t *> queue;
+  size_t queued_bytes;
+  bool busy;
+  bool stopping;
+  int num_errors;
+  vector<string> failures;
+
+  // The currently open file; it is kept open while consecutive
+  // batches write into the same file
+  string open_filename;
+  hid_t open_file;
+
+  void run();
+  void write_batch(batch_t const &batch);
+  void close_file();
+
+public:
+  writer_t();
+  ~writer_t();
+
+  void submit(batch_t *batch, size_t max_bytes);
+  void wait();
+  int errors(vector<string> &messages);
+};
+
+writer_t::writer_t()
+    : queued_bytes(0), busy(false), stopping(false), num_errors(0),
+      open_file(H5I_INVALID_HID) {
+  worker = thread(&writer_t::run, this);
+}
+
+writer_t::~writer_t() {
+  {
+    unique_lock<mutex> lock(mtx);
+    stopping = true;
+  }
+  cond.notify_all();
+  worker.join();
+  assert(queue.empty());
+  assert(open_file < 0);
+}
+
+void writer_t::submit(batch_t *const batch, size_t const max_bytes) {
+  size_t const bytes = batch->memory();
+  unique_lock<mutex> lock(mtx);
+  // Bound the amount of staged data; wait until enough has been
+  // written. We always accept at least one batch.
+  while (not queue.empty() and queued_bytes + bytes > max_bytes) {
+    cond.wait(lock);
+  }
+  queue.push_back(batch);
+  queued_bytes += bytes;
+  cond.notify_all();
+}
+
+void writer_t::wait() {
+  unique_lock<mutex> lock(mtx);
+  while (not queue.empty() or busy) {
+    cond.wait(lock);
+  }
+}
+
+int writer_t::errors(vector<string> &messages) {
+  unique_lock<mutex> lock(mtx);
+  int const nerrors = num_errors;
+  num_errors = 0;
+  messages.clear();
+  swap(messages, failures);
+  return nerrors;
+}
+
+void writer_t::run() {
+  vector<string> thread_failures;
+  recorded_failures = &thread_failures;
+
+  unique_lock<mutex> lock(mtx);
+  for (;;) {
+    while (queue.empty() and not stopping) {
+      cond.wait(lock);
+    }
+    if (queue.empty()) {
+      assert(stopping);
+      break;
+    }
+
+    batch_t *const batch = queue.front();
+    queue.pop_front();
+    size_t const bytes = batch->memory();
+    busy = true;
+    lock.unlock();
+
+    write_batch(*batch);
+    delete batch;
+
+    lock.lock();
+    queued_bytes -= bytes;
+    // Close the file when there is nothing more to do, so that
+    // complete files are visible to readers
+    if (queue.empty()) {
+      lock.unlock();
+      close_file();
+      lock.lock();
+    }
+    failures.insert(failures.end(), thread_failures.begin(),
+                    thread_failures.end());
+    thread_failures.clear();
+    busy = false;
+    cond.notify_all();
+  }
+}
+
+void writer_t::write_batch(batch_t const &batch) {
+  bool error_flag = false;
+
+  if (open_file >= 0 and open_filename != batch.filename)
+    close_file();
+
+  if (open_file < 0) {
+    hid_t const fapl = H5Pcreate(H5P_FILE_ACCESS);
+    H5Pset_fclose_degree(fapl, H5F_CLOSE_STRONG);
+    open_file =
+        batch.truncate
+            ? H5Fcreate(batch.filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT,
+                        fapl)
+            : H5Fopen(batch.filename.c_str(), H5F_ACC_RDWR, fapl);
+    H5Pclose(fapl);
+    if (open_file < 0) {
+      unique_lock<mutex> lock(mtx);
+      ++num_errors;
+      return;
+    }
+    open_filename = batch.filename;
+  }
+
+  metadata_t const *const metadata =
+      batch.have_metadata ? &batch.metadata : NULL;
+  for (vector<fragment_t>::const_iterator fi = batch.fragments.begin();
+       fi != batch.fragments.end(); ++fi) {
+    write_fragment(open_file, *fi, metadata, batch.options, error_flag);
+  }
+
+  if (error_flag) {
+    unique_lock<mutex> lock(mtx);
+    ++num_errors;
+  }
+}
+
+void writer_t::close_file() {
+  if (open_file < 0)
+    return;
+  herr_t const herr = H5Fclose(open_file);
+  if (herr < 0) {
+    unique_lock<mutex> lock(mtx);
+    ++num_errors;
+  }
+  open_file = H5I_INVALID_HID;
+  open_filename.clear();
+  H5garbage_collect();
+}
+
+writer_t *writer = NULL;
+
+// Fragments staged by this process since the last flush
+vector<fragment_t> staged_fragments;
+
+int const tag_staged = 1;
+
+void report_errors() {
+  if (not writer)
+    return;
+  vector<string> messages;
+  int const nerrors = writer->errors(messages);
+  for (size_t n = 0; n < messages.size(); ++n) {
+    CCTK_WARN(CCTK_WARN_ALERT, messages[n].c_str());
+  }
+  if (nerrors > 0) {
+    CCTK_VWarn(CCTK_WARN_ALERT, __LINE__, __FILE__, CCTK_THORNSTRING,
+               "%d errors occurred while writing output asynchronously",
+               nerrors);
+  }
+}
+
+} // namespace
+
+/*** Interface **************************************************************/
+
+void report_failure(int const line, char const *const file,
+                    char const *const thorn, char const *const msg,
+                    int const value) {
+  if (recorded_failures) {
+    ostringstream buf;
+    buf << "Expression \"" << msg << "\" return " << value << " (" << file
+        << ":" << line << ", in background writer thread)";
+    recorded_failures->push_back(buf.str());
+    return;
+  }
+  CCTK_VWarn(CCTK_WARN_ALERT, line, file, thorn, "Expression \"%s\" return %d",
+             msg, value);
+}
+
+bool use_async_output() {
+  DECLARE_CCTK_PARAMETERS;
+  if (not async_output)
+    return false;
+#ifdef H5_HAVE_THREADSAFE
+  return true;
+#else
+  static bool did_warn = false;
+  if (not did_warn) {
+    CCTK_WARN(CCTK_WARN_ALERT,
+              "Asynchronous output requested, but the HDF5 library was not "
+              "built thread-safe. Writing output synchronously instead.");
+    did_warn = true;
+  }
+  return false;
+#endif
+}
+
+void stage_fragment(fragment_t &fragment) {
+  staged_fragments.push_back(fragment_t());
+  // Avoid copying the data
+  swap(staged_fragments.back(), fragment);
+}
+
+void flush_staged_fragments(cGH const *const cctkGH, string const filename,
+                            bool const truncate, int const myioproc,
+                            int const ioproc_every) {
+  DECLARE_CCTK_PARAMETERS;
+
+  static Timers::Timer timer("F5::flush_staged_fragments");
+  timer.start();
+
+  report_errors();
+
+  int const myproc = CCTK_MyProc(cctkGH);
+  int const nprocs = CCTK_nProcs(cctkGH);
+
+  if (myproc != myioproc) {
+
+    // Send all staged fragments to our I/O process
+    vector<char> buf;
+    for (vector<fragment_t>::const_iterator fi = staged_fragments.begin();
+         fi != staged_fragments.end(); ++fi) {
+      fi->serialise(buf);
+    }
+    assert(buf.size() <= INT_MAX);
+    int const nfragments = staged_fragments.size();
+    int const size = buf.size();
+    int sizes[2] = {nfragments, size};
+    MPI_Send(sizes, 2, MPI_INT, myioproc, tag_staged, dist::comm());
+    if (size > 0) {
+      MPI_Send(buf.data(), size, MPI_CHAR, myioproc, tag_staged,
+               dist::comm());
+    }
+    staged_fragments.clear();
+
+  } else {
+
+    // Collect the fragments of all processes in our I/O group
+    batch_t *const batch = new batch_t;
+    batch->filename = filename;
+    batch->truncate = truncate;
+    swap(batch->fragments, staged_fragments);
+    for (int p = myproc + 1; p < min(myioproc + ioproc_every, nprocs); ++p) {
+      int sizes[2];
+      MPI_Recv(sizes, 2, MPI_INT, p, tag_staged, dist::comm(),
+               MPI_STATUS_IGNORE);
+      int const nfragments = sizes[0];
+      int const size = sizes[1];
+      vector<char> buf(size);
+      if (size > 0) {
+        MPI_Recv(buf.data(), size, MPI_CHAR, p, tag_staged, dist::comm(),
+                 MPI_STATUS_IGNORE);
+      }
+      char const *ptr = buf.data();
+      size_t const nold = batch->fragments.size();
+      batch->fragments.resize(nold + nfragments);
+      for (int n = 0; n < nfragments; ++n) {
+        batch->fragments.at(nold + n).deserialise(ptr);
+      }
+      assert(ptr == buf.data() + size);
+    }
+
+    // Metadata are gathered once per iteration
+    static int metadata_iteration = -1;
+    static metadata_t metadata;
+    if (metadata_iteration != cctkGH->cctk_iteration) {
+      metadata = metadata_t(cctkGH);
+      metadata_iteration = cctkGH->cctk_iteration;
+    }
+    batch->have_metadata = true;
+    batch->metadata = metadata;
+    batch->options.capture();
+
+    if (not writer)
+      writer = new writer_t;
+    size_t const max_bytes =
+        max_staging_buffer_size > 0
+            ? size_t(max_staging_buffer_size) * 1024 * 1024
+            : SIZE_MAX;
+    writer->submit(batch, max_bytes);
+  }
+
+  timer.stop();
+}
+
+void wait_for_async_output() {
+  if (not writer)
+    return;
+  static Timers::Timer timer("F5::wait_for_async_output");
+  timer.start();
+  writer->wait();
+  report_errors();
+  timer.stop();
+}
+
+void shutdown_async_output() {
+  if (not writer)
+    return;
+  wait_for_async_output();
+  delete writer;
+  writer = NULL;
+}
+
+} // namespace CarpetIOF5
@@ -0,0 +1,119 @@
+#ifndef STAGING_HH
+#define STAGING_HH
+
+#include <cctk.h>
+
+#include <defs.hh>
+#include <vect.hh>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <hdf5.h>
+
+namespace CarpetIOF5 {
+
+using namespace std;
+
+// Cactus/Carpet metadata, gathered in advance so that it can be
+// written at a later time
+struct metadata_t {
+  string config_id, build_id, simulation_id, run_id;
+  string parameters;
+  string grid_structure;
+
+  metadata_t() {}
+  metadata_t(cGH const *const cctkGH);
+};
+
+// Parameters that determine how fields are written. They are captured
+// on the main thread, so that the background writer does not read
+// steerable parameters.
+struct write_options_t {
+  int use_chunks, max_chunksize, compression_level, use_checksums;
+  int separate_single_component_tensors;
+
+  // Capture the current parameter values
+  void capture();
+};
+
+// Description of a topology (a refinement level and time level) in
+// an F5 file
+struct topology_t {
+  string gridname, chartname, topologyname;
+  CCTK_REAL time;
+  int iteration;
+  ivect reffact;
+  int is_gf;      // whether this is a grid function
+  int indexdepth; // 0 for vertex, 1 for cell centring
+  int dim;
+  int link_default_topology, set_timestep, attach_metadata;
+};
+
+// A staged piece of output, containing all information necessary to
+// write it to a file without referring to the grid hierarchy
+struct fragment_t {
+  enum kind_t { kind_map, kind_component, kind_field };
+  int kind;
+
+  topology_t topology;
+
+  // Map and component geometry
+  int dim;
+  ivect gsh;
+  rvect lower, upper, delta;
+  string fragmentname;
+  ivect ioff, ilen, lghosts, ughosts;
+  rvect clower;
+
+  // Field
+  string fieldname;
+  int tensortype, vartype, num_comps;
+  int write_positions, is_multipatch, full_coverage;
+  vector<char> data; // [num_comps][ilen]
+
+  size_t memory() const { return sizeof *this + data.size(); }
+  void serialise(vector<char> &buf) const;
+  void deserialise(char const *&buf);
+};
+
+// A set of fragments that are written into the same file
+struct batch_t {
+  string filename;
+  bool truncate;
+  bool have_metadata;
+  metadata_t metadata;
+  write_options_t options;
+  vector<fragment_t> fragments;
+
+  batch_t() : truncate(false), have_metadata(false) {}
+  size_t memory() const;
+};
+
+// Write a staged fragment into a file (defined in output.cc)
+void write_fragment(hid_t const file, fragment_t const &fragment,
+                    metadata_t const *const metadata,
+                    write_options_t const &options, bool &error_flag);
+
+// Report a failed expression (used by FAILWARN). In the background
+// writer thread, which must not call CCTK_VWarn, the warning is
+// recorded instead, and is reported later by the main thread.
+void report_failure(int const line, char const *const file,
+                    char const *const thorn, char const *const msg,
+                    int const value);
+
+// Asynchronous output: Fragments are staged (copied) by all
+// processes, sent to their I/O process, and written to disk there by
+// a background thread
+bool use_async_output();
+void stage_fragment(fragment_t &fragment);
+void flush_staged_fragments(cGH const *const cctkGH, string const filename,
+                            bool const truncate, int const myioproc,
+                            int const ioproc_every);
+void wait_for_async_output();
+void shutdown_async_output();
+
+} // namespace CarpetIOF5
+
+#endif // #ifndef STAGING_HH
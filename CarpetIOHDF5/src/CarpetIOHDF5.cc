@@ -24,6 +24,9 @@
 
 #include "defs.hh"
 #include "gh.hh"
+#include "mem.hh"
+#include "mpi_string.hh"
+#include "tracing.hh"
 
 namespace CarpetIOHDF5 {
 
@@ -46,9 +49,15 @@ static int OutputVarAs(const cGH *const cctkGH, const char *const varname,
                        const char *const alias);
 static int TimeToOutput(const cGH *const cctkGH, const int vindex);
 static int TriggerOutput(const cGH *const cctkGH, const int vindex);
+static void DeferOutput(const cGH *const cctkGH, const int vindex);
+static bool HaveDeferredOutput();
+static int FlushDeferredOutput(const cGH *const cctkGH);
 
 // general checkpoint routine
 static void Checkpoint(const cGH *const cctkGH, int called_from);
+static int WriteCheckpointIndex(hid_t const file,
+                                const vector<string> &entries,
+                                bool const parallel_io);
 
 // callback for I/O parameter parsing routine
 static void GetVarIndex(int vindex, const char *optstring, void *arg);
@@ -120,6 +129,9 @@ void CarpetIOHDF5_EvolutionCheckpoint(CCTK_ARGUMENTS) {
   DECLARE_CCTK_ARGUMENTS_CarpetIOHDF5_EvolutionCheckpoint;
   DECLARE_CCTK_PARAMETERS;
 
+  // commit a previous asynchronous checkpoint once it has been drained
+  FinishCheckpointDrain(cctkGH, false);
+
   CCTK_INT const iteration = cctk_iteration;
   CCTK_REAL const walltime = CCTK_RunTime() / 3600.0;
 
@@ -184,6 +196,21 @@ void CarpetIOHDF5_TerminationCheckpoint(CCTK_ARGUMENTS) {
       }
     }
   }
+
+  // do not terminate before the last checkpoint has been committed
+  FinishCheckpointDrain(cctkGH, true);
+}
+
+void CarpetIOHDF5_FlushOutput(CCTK_ARGUMENTS) {
+  DECLARE_CCTK_ARGUMENTS_CarpetIOHDF5_FlushOutput;
+
+  // Write deferred output requests (see out_batch_levels) whose
+  // iteration did not reach the finest level
+  if (HaveDeferredOutput()) {
+    memphase const phase(gmem::phase_output);
+    FlushDeferredOutput(cctkGH);
+  }
+  assert(not HaveDeferredOutput());
 }
 
 CCTK_INT CarpetIOHDF5_SetCheckpointGroups(CCTK_INT const *const groups,
@@ -206,6 +233,8 @@ CCTK_INT CarpetIOHDF5_SetCheckpointGroups(CCTK_INT const *const groups,
 
 vector<bool> groups_to_checkpoint;
 
+string checkpoint_index_entries;
+
 hid_t CCTKtoHDF5_Datatype(const cGH *const cctkGH, int cctk_type,
                           bool single_precision) {
   hid_t retval;
@@ -707,6 +736,8 @@ static void CheckSteerableParameters(const cGH *const cctkGH,
 }
 
 static int OutputGH(const cGH *const cctkGH) {
+  DECLARE_CCTK_PARAMETERS;
+
   static Timers::Timer timer("OutputGH");
   timer.start();
 
@@ -714,13 +745,34 @@ static int OutputGH(const cGH *const cctkGH) {
       (CarpetIOHDF5GH *)CCTK_GHExtension(cctkGH, CCTK_THORNSTRING);
   CheckSteerableParameters(cctkGH, myGH);
 
+  // Determine what is output first, so that the output phase (which
+  // samples the metadata) is entered at most once
+  vector<int> trigger_vars;
   if (strcmp(myGH->out_vars, "")) {
     for (int vindex = CCTK_NumVars() - 1; vindex >= 0; vindex--) {
       if (TimeToOutput(cctkGH, vindex)) {
-        TriggerOutput(cctkGH, vindex);
+        if (out_batch_levels and CCTK_GroupTypeFromVarI(vindex) == CCTK_GF) {
+          DeferOutput(cctkGH, vindex);
+        } else {
+          trigger_vars.push_back(vindex);
+        }
       }
     }
   }
+
+  // The finest level is the last level that is output in an
+  // iteration
+  bool const flush = do_late_global_mode and HaveDeferredOutput();
+
+  if (not trigger_vars.empty() or flush) {
+    memphase const phase(gmem::phase_output);
+    for (size_t i = 0; i < trigger_vars.size(); ++i) {
+      TriggerOutput(cctkGH, trigger_vars[i]);
+    }
+    if (flush) {
+      FlushDeferredOutput(cctkGH);
+    }
+  }
   timer.stop();
 
   return (0);
@@ -808,11 +860,10 @@ static int TimeToOutput(const cGH *const cctkGH, const int vindex) {
   return output_this_iteration ? 1 : 0;
 }
 
-static int TriggerOutput(const cGH *const cctkGH, const int vindex) {
+// The name under which a variable is output
+static string OutputAlias(const int vindex) {
   DECLARE_CCTK_PARAMETERS;
-  int retval;
 
-  char *const fullname = CCTK_FullName(vindex);
   if (one_file_per_group) {
     const int gindex = CCTK_GroupIndexFromVarI(vindex);
     char *const groupname_c = CCTK_GroupName(gindex);
@@ -823,11 +874,15 @@ static int TriggerOutput(const cGH *const cctkGH, const int vindex) {
     size_t const oldseppos = groupname.find(oldsep);
     assert(oldseppos != string::npos);
     groupname.replace(oldseppos, oldsep.size(), out_group_separator);
-    retval = OutputVarAs(cctkGH, fullname, groupname.c_str());
+    return groupname;
   } else {
-    const char *varname = CCTK_VarName(vindex);
-    retval = OutputVarAs(cctkGH, fullname, varname);
+    return CCTK_VarName(vindex);
   }
+}
+
+static int TriggerOutput(const cGH *const cctkGH, const int vindex) {
+  char *const fullname = CCTK_FullName(vindex);
+  int const retval = OutputVarAs(cctkGH, fullname, OutputAlias(vindex).c_str());
   free(fullname);
 
   return (retval);
@@ -846,58 +901,31 @@ static void GetVarIndex(int vindex, const char *optstring, void *arg) {
   *((int *)arg) = vindex;
 }
 
-static int OutputVarAs(const cGH *const cctkGH, const char *const fullname,
-                       const char *const alias) {
-  DECLARE_CCTK_ARGUMENTS;
+// Files into which output has been written, and the iteration at
+// which each variable was last output into them [ml][rl][var]
+typedef std::map<string, vector<vector<vector<int> > > > filelist;
+static filelist created_files;
+
+// Determine the name of the output file of a variable, and which
+// processes write into it
+static void OutputFilenames(const cGH *const cctkGH, const char *const alias,
+                            const ioRequest *const request,
+                            const cGroup &groupdata, string &filename,
+                            string &index_filename, int &ioproc,
+                            int &nioprocs) {
   DECLARE_CCTK_PARAMETERS;
 
-  int error_count = 0;
-  int vindex = -1;
-
-  if (CCTK_TraverseString(fullname, GetVarIndex, &vindex, CCTK_VAR) < 0) {
-    CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
-               "error while parsing variable name '%s' (alias name '%s')",
-               fullname, alias);
-    return (-1);
-  }
-
-  if (vindex < 0) {
-    return (-1);
-  }
-
-  const int group = CCTK_GroupIndexFromVarI(vindex);
-  assert(group >= 0);
-  cGroup groupdata;
-  CCTK_GroupData(group, &groupdata);
-  if (groupdata.grouptype == CCTK_SCALAR or groupdata.grouptype == CCTK_ARRAY) {
-    assert(do_global_mode);
-  }
-
-  // get the default I/O request for this variable
   const CarpetIOHDF5GH *myGH =
       (CarpetIOHDF5GH *)CCTK_GHExtension(cctkGH, CCTK_THORNSTRING);
-  ioRequest *request = myGH->requests[vindex];
-  if (not request) {
-#ifdef IOUTIL_PARSER_HAS_OUT_DT
-    request = IOUtil_DefaultIORequest(cctkGH, vindex, 1, -1.0);
-#else
-    request = IOUtil_DefaultIORequest(cctkGH, vindex, 1);
-#endif
-  }
-
-  // Get grid hierarchy extentsion from IOUtil
-  const ioGH *const iogh = (const ioGH *)CCTK_GHExtension(cctkGH, "IO");
-  assert(iogh);
 
-  // Invent a file name
-  int ioproc = 0, nioprocs = 1;
-  string filename;
-  filename.append(myGH->out_dir);
+  ioproc = 0;
+  nioprocs = 1;
+  filename = myGH->out_dir;
   filename.append(alias);
   if (out_timesteps_per_file > 0) {
     // Round down to nearest multiple of out_timesteps_per_file
-    int const iter =
-        cctk_iteration / out_timesteps_per_file * out_timesteps_per_file;
+    int const iter = cctkGH->cctk_iteration / out_timesteps_per_file *
+                     out_timesteps_per_file;
     char buffer[32];
     snprintf(buffer, sizeof(buffer), ".iter_%d", iter);
     filename.append(buffer);
@@ -911,18 +939,26 @@ static int OutputVarAs(const cGH *const cctkGH, const char *const fullname,
     filename.append(buffer);
   }
 
-  string base_filename(filename);
+  string const base_filename(filename);
   filename.append(out_extension);
 
-  string index_filename(base_filename + ".idx" + out_extension);
+  index_filename = base_filename + ".idx" + out_extension;
+}
+
+// Check whether a variable still needs to be output on a given level
+// at this iteration, and mark it as output. is_new_file is set if the
+// file has not yet been created.
+static bool MarkOutput(const cGH *const cctkGH, const char *const fullname,
+                       int const vindex, int const ml, int const rl,
+                       const string &filename, bool &is_new_file,
+                       filelist::iterator &thisfile) {
+  DECLARE_CCTK_PARAMETERS;
 
-  const char *const c_filename = filename.c_str();
+  int const cctk_iteration = cctkGH->cctk_iteration;
 
   // check if the file has been created already
-  typedef std::map<string, vector<vector<vector<int> > > > filelist;
-  static filelist created_files;
-  filelist::iterator thisfile = created_files.find(filename);
-  bool is_new_file = thisfile == created_files.end();
+  thisfile = created_files.find(filename);
+  is_new_file = thisfile == created_files.end();
   if (is_new_file) {
     int const numvars = CCTK_NumVars();
     vector<vector<vector<int> > > last_outputs; // [ml][rl][var]
@@ -938,11 +974,12 @@ static int OutputVarAs(const cGH *const cctkGH, const char *const fullname,
     assert(thisfile != created_files.end());
   }
 
+  const int group = CCTK_GroupIndexFromVarI(vindex);
   const int firstvar = one_file_per_group ? CCTK_FirstVarIndexI(group) : vindex;
   const int numvars = one_file_per_group ? CCTK_NumVarsInGroupI(group) : 1;
 
   // check if this variable has been output already during this iteration
-  int &last_output = thisfile->second.at(mglevel).at(reflevel).at(vindex);
+  int &last_output = thisfile->second.at(ml).at(rl).at(vindex);
   if (last_output == cctk_iteration) {
     // Has already been output during this iteration
     if (not one_file_per_group or vindex == firstvar + numvars - 1) {
@@ -954,7 +991,7 @@ static int OutputVarAs(const cGH *const cctkGH, const char *const fullname,
                  varname);
       free(varname);
     }
-    return (0);
+    return false;
   }
   assert(last_output < cctk_iteration);
   last_output = cctk_iteration;
@@ -964,17 +1001,27 @@ static int OutputVarAs(const cGH *const cctkGH, const char *const fullname,
     CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
                "Cannot output variable '%s' because it has no storage",
                fullname);
-    return (0);
+    return false;
   }
 
-  // Open the output file if this is a designated I/O processor
-  hid_t file = -1;
-  hid_t index_file = -1;
-  CCTK_REAL io_files = 0;
-  CCTK_REAL io_bytes = 0;
-  BeginTimingIO(cctkGH);
+  return true;
+}
+
+// Open (or create) the output file if this is a designated I/O
+// processor
+static int OpenOutputFile(const cGH *const cctkGH, const string &filename,
+                          const string &index_filename, bool is_new_file,
+                          int const ioproc, int const nioprocs,
+                          int const firstvar, int const numvars, hid_t &file,
+                          hid_t &index_file, CCTK_REAL &io_files) {
+  DECLARE_CCTK_PARAMETERS;
+
+  int error_count = 0;
+  file = -1;
+  index_file = -1;
   if (dist::rank() == ioproc) {
 
+    const char *const c_filename = filename.c_str();
     if (is_new_file and not IO_TruncateOutputFiles(cctkGH)) {
       H5E_BEGIN_TRY { is_new_file = H5Fis_hdf5(c_filename) <= 0; }
       H5E_END_TRY;
@@ -1012,6 +1059,22 @@ static int OutputVarAs(const cGH *const cctkGH, const char *const fullname,
     io_files += 1;
   }
 
+  return error_count;
+}
+
+// Write the variables of an output file on the current level
+static int WriteOutputVars(const cGH *const cctkGH, const char *const fullname,
+                           int const firstvar, int const numvars,
+                           const cGroup &groupdata, hid_t const file,
+                           hid_t const index_file, CCTK_REAL &io_bytes,
+                           filelist::iterator const thisfile) {
+  DECLARE_CCTK_PARAMETERS;
+
+  const CarpetIOHDF5GH *myGH =
+      (CarpetIOHDF5GH *)CCTK_GHExtension(cctkGH, CCTK_THORNSTRING);
+
+  int error_count = 0;
+
   if (CCTK_Equals(verbose, "full")) {
     CCTK_VInfo(CCTK_THORNSTRING,
                "Writing variable '%s' on mglevel %d reflevel %d", fullname,
@@ -1049,13 +1112,19 @@ static int OutputVarAs(const cGH *const cctkGH, const char *const fullname,
       IOUtil_FreeIORequest(&r);
 
     // mark this variable to have been output at this iteration
-    thisfile->second.at(mglevel).at(reflevel).at(var) = cctk_iteration;
+    thisfile->second.at(mglevel).at(reflevel).at(var) = cctkGH->cctk_iteration;
   }
 
-  // free I/O request structure
-  if (request != myGH->requests[vindex]) {
-    IOUtil_FreeIORequest(&request);
-  }
+  return error_count;
+}
+
+// Close the output file, and collect I/O statistics
+static int CloseOutputFile(const cGH *const cctkGH, hid_t const file,
+                           hid_t const index_file, CCTK_REAL io_files,
+                           CCTK_REAL io_bytes) {
+  DECLARE_CCTK_PARAMETERS;
+
+  int error_count = 0;
 
   // Close the file
   if (file >= 0) {
@@ -1075,6 +1144,88 @@ static int OutputVarAs(const cGH *const cctkGH, const char *const fullname,
   }
   EndTimingIO(cctkGH, io_files, io_bytes, true);
 
+  return error_count;
+}
+
+static int OutputVarAs(const cGH *const cctkGH, const char *const fullname,
+                       const char *const alias) {
+  DECLARE_CCTK_PARAMETERS;
+
+  tracing::region const trace(
+      tracing::enabled() ? tracing::intern(fullname) : fullname,
+      tracing::cat_io);
+
+  int error_count = 0;
+  int vindex = -1;
+
+  if (CCTK_TraverseString(fullname, GetVarIndex, &vindex, CCTK_VAR) < 0) {
+    CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
+               "error while parsing variable name '%s' (alias name '%s')",
+               fullname, alias);
+    return (-1);
+  }
+
+  if (vindex < 0) {
+    return (-1);
+  }
+
+  const int group = CCTK_GroupIndexFromVarI(vindex);
+  assert(group >= 0);
+  cGroup groupdata;
+  CCTK_GroupData(group, &groupdata);
+  if (groupdata.grouptype == CCTK_SCALAR or groupdata.grouptype == CCTK_ARRAY) {
+    assert(do_global_mode);
+  }
+
+  // get the default I/O request for this variable
+  const CarpetIOHDF5GH *myGH =
+      (CarpetIOHDF5GH *)CCTK_GHExtension(cctkGH, CCTK_THORNSTRING);
+  ioRequest *request = myGH->requests[vindex];
+  if (not request) {
+#ifdef IOUTIL_PARSER_HAS_OUT_DT
+    request = IOUtil_DefaultIORequest(cctkGH, vindex, 1, -1.0);
+#else
+    request = IOUtil_DefaultIORequest(cctkGH, vindex, 1);
+#endif
+  }
+
+  // Get grid hierarchy extentsion from IOUtil
+  const ioGH *const iogh = (const ioGH *)CCTK_GHExtension(cctkGH, "IO");
+  assert(iogh);
+
+  // Invent a file name
+  int ioproc, nioprocs;
+  string filename, index_filename;
+  OutputFilenames(cctkGH, alias, request, groupdata, filename, index_filename,
+                  ioproc, nioprocs);
+
+  // free I/O request structure
+  if (request != myGH->requests[vindex]) {
+    IOUtil_FreeIORequest(&request);
+  }
+
+  const int firstvar = one_file_per_group ? CCTK_FirstVarIndexI(group) : vindex;
+  const int numvars = one_file_per_group ? CCTK_NumVarsInGroupI(group) : 1;
+
+  bool is_new_file;
+  filelist::iterator thisfile;
+  if (not MarkOutput(cctkGH, fullname, vindex, mglevel, reflevel, filename,
+                     is_new_file, thisfile)) {
+    return (0);
+  }
+
+  hid_t file, index_file;
+  CCTK_REAL io_files = 0;
+  CCTK_REAL io_bytes = 0;
+  BeginTimingIO(cctkGH);
+  error_count +=
+      OpenOutputFile(cctkGH, filename, index_filename, is_new_file, ioproc,
+                     nioprocs, firstvar, numvars, file, index_file, io_files);
+  error_count += WriteOutputVars(cctkGH, fullname, firstvar, numvars, groupdata,
+                                 file, index_file, io_bytes, thisfile);
+  error_count +=
+      CloseOutputFile(cctkGH, file, index_file, io_files, io_bytes);
+
   if (error_count > 0 and abort_on_io_errors) {
     CCTK_WARN(0, "Aborting simulation due to previous I/O errors");
   }
@@ -1082,9 +1233,240 @@ static int OutputVarAs(const cGH *const cctkGH, const char *const fullname,
   return (0);
 }
 
+// Batched output (see out_batch_levels)
+//
+// Output of grid functions is deferred until the finest level of an
+// iteration has been output. All refinement levels and variables that
+// go into the same file are then written while the file is open, so
+// that each file is opened, and its metadata are read and written,
+// only once per iteration instead of once per variable and level.
+
+namespace {
+
+// An output request that has been deferred
+struct deferred_output_t {
+  int vindex;
+  int ml, rl;
+};
+
+vector<deferred_output_t> deferred_outputs;
+
+// All deferred output requests for one file
+struct output_batch_t {
+  string filename, index_filename;
+  int ioproc, nioprocs;
+  int firstvar, numvars;
+  cGroup groupdata;
+  vector<deferred_output_t> outputs;
+};
+
+} // namespace
+
+static void DeferOutput(const cGH *const cctkGH, const int vindex) {
+  assert(is_level_mode());
+  assert(CCTK_GroupTypeFromVarI(vindex) == CCTK_GF);
+  deferred_output_t output;
+  output.vindex = vindex;
+  output.ml = mglevel;
+  output.rl = reflevel;
+  deferred_outputs.push_back(output);
+}
+
+static bool HaveDeferredOutput() { return not deferred_outputs.empty(); }
+
+static int FlushDeferredOutput(const cGH *const cctkGH) {
+  DECLARE_CCTK_PARAMETERS;
+
+  if (deferred_outputs.empty())
+    return 0;
+
+  static Timers::Timer timer("FlushDeferredOutput");
+  timer.start();
+  tracing::region const trace("CarpetIOHDF5::FlushDeferredOutput",
+                              tracing::cat_io);
+
+  const CarpetIOHDF5GH *myGH =
+      (CarpetIOHDF5GH *)CCTK_GHExtension(cctkGH, CCTK_THORNSTRING);
+
+  // Sort the requests by output file, keeping their order otherwise
+  vector<output_batch_t> batches;
+  std::map<string, size_t> batch_index;
+  for (size_t n = 0; n < deferred_outputs.size(); ++n) {
+    deferred_output_t const &output = deferred_outputs[n];
+    int const group = CCTK_GroupIndexFromVarI(output.vindex);
+    assert(group >= 0);
+    cGroup groupdata;
+    CCTK_GroupData(group, &groupdata);
+
+    ioRequest *request = myGH->requests[output.vindex];
+    if (not request) {
+#ifdef IOUTIL_PARSER_HAS_OUT_DT
+      request = IOUtil_DefaultIORequest(cctkGH, output.vindex, 1, -1.0);
+#else
+      request = IOUtil_DefaultIORequest(cctkGH, output.vindex, 1);
+#endif
+    }
+    output_batch_t batch;
+    OutputFilenames(cctkGH, OutputAlias(output.vindex).c_str(), request,
+                    groupdata, batch.filename, batch.index_filename,
+                    batch.ioproc, batch.nioprocs);
+    if (request != myGH->requests[output.vindex]) {
+      IOUtil_FreeIORequest(&request);
+    }
+
+    std::map<string, size_t>::const_iterator const ibatch =
+        batch_index.find(batch.filename);
+    if (ibatch == batch_index.end()) {
+      batch.firstvar =
+          one_file_per_group ? CCTK_FirstVarIndexI(group) : output.vindex;
+      batch.numvars = one_file_per_group ? CCTK_NumVarsInGroupI(group) : 1;
+      batch.groupdata = groupdata;
+      batch.outputs.push_back(output);
+      batch_index[batch.filename] = batches.size();
+      batches.push_back(batch);
+    } else {
+      output_batch_t &old_batch = batches.AT(ibatch->second);
+      assert(old_batch.ioproc == batch.ioproc);
+      old_batch.outputs.push_back(output);
+    }
+  }
+  deferred_outputs.clear();
+
+  int error_count = 0;
+  for (size_t b = 0; b < batches.size(); ++b) {
+    output_batch_t const &batch = batches[b];
+
+    hid_t file = -1, index_file = -1;
+    CCTK_REAL io_files = 0;
+    CCTK_REAL io_bytes = 0;
+    bool is_open = false;
+    BeginTimingIO(cctkGH);
+
+    for (size_t n = 0; n < batch.outputs.size(); ++n) {
+      deferred_output_t const &output = batch.outputs[n];
+      char *const fullname = CCTK_FullName(output.vindex);
+      bool is_new;
+      filelist::iterator thisfile;
+      if (MarkOutput(cctkGH, fullname, output.vindex, output.ml, output.rl,
+                     batch.filename, is_new, thisfile)) {
+        // The file is opened only once it is known that something is
+        // written
+        if (not is_open) {
+          error_count += OpenOutputFile(
+              cctkGH, batch.filename, batch.index_filename, is_new,
+              batch.ioproc, batch.nioprocs, batch.firstvar, batch.numvars,
+              file, index_file, io_files);
+          is_open = true;
+        }
+        // The requests are flushed from level mode (or from meta mode
+        // at termination), and may belong to any level
+        BEGIN_META_MODE(cctkGH) {
+          ENTER_GLOBAL_MODE(cctkGH, output.ml) {
+            ENTER_LEVEL_MODE(cctkGH, output.rl) {
+              error_count += WriteOutputVars(
+                  cctkGH, fullname, output.vindex, 1, batch.groupdata, file,
+                  index_file, io_bytes, thisfile);
+            }
+            LEAVE_LEVEL_MODE;
+          }
+          LEAVE_GLOBAL_MODE;
+        }
+        END_META_MODE;
+      }
+      free(fullname);
+    }
+
+    if (is_open) {
+      error_count +=
+          CloseOutputFile(cctkGH, file, index_file, io_files, io_bytes);
+    } else {
+      EndTimingIO(cctkGH, 0, 0, true);
+    }
+  }
+
+  if (error_count > 0 and abort_on_io_errors) {
+    CCTK_WARN(0, "Aborting simulation due to previous I/O errors");
+  }
+
+  timer.stop();
+  return 0;
+}
+
+// Write the global checkpoint index into the metadata group. The index
+// is a character array with one line per dataset (see
+// AddCheckpointIndexEntry), where the datasets of each file follow a
+// line "file <n>". The lines are grouped by level, and the attribute
+// "levels" lists the mglevel, reflevel, offset, and length of each
+// group, so that recovery can read the index level by level.
+static int WriteCheckpointIndex(hid_t const file,
+                                const vector<string> &entries,
+                                bool const parallel_io) {
+  int error_count = 0;
+
+  typedef pair<int, int> level_t;
+  std::map<level_t, string> levels;
+  for (size_t p = 0; p < entries.size(); ++p) {
+    std::map<level_t, bool> have_header;
+    istringstream buf(entries.at(p));
+    string line;
+    while (getline(buf, line)) {
+      string varname;
+      level_t level;
+      istringstream entry(line);
+      entry >> varname >> level.first >> level.second;
+      assert(not entry.fail());
+      string &index = levels[level];
+      if (not have_header[level]) {
+        ostringstream header;
+        header << "file " << (parallel_io ? p : 0) << "\n";
+        index += header.str();
+        have_header[level] = true;
+      }
+      index += line + "\n";
+    }
+  }
+
+  string index;
+  vector<hsize_t> extents;
+  for (std::map<level_t, string>::const_iterator level = levels.begin();
+       level != levels.end(); ++level) {
+    extents.push_back(level->first.first);
+    extents.push_back(level->first.second);
+    extents.push_back(index.size());
+    extents.push_back(level->second.size());
+    index += level->second;
+  }
+
+  hid_t group, dataspace, dataset;
+  HDF5_ERROR(group = H5Gopen(file, METADATA_GROUP));
+  hsize_t const size = index.size();
+  HDF5_ERROR(dataspace = H5Screate_simple(1, &size, NULL));
+  HDF5_ERROR(dataset = H5Dcreate(group, CHECKPOINT_INDEX, H5T_NATIVE_CHAR,
+                                 dataspace, H5P_DEFAULT));
+  if (size > 0) {
+    HDF5_ERROR(H5Dwrite(dataset, H5T_NATIVE_CHAR, H5S_ALL, H5S_ALL,
+                        H5P_DEFAULT, index.data()));
+    error_count +=
+        WriteAttribute(dataset, "levels", &extents.front(), extents.size());
+  }
+  HDF5_ERROR(H5Dclose(dataset));
+  HDF5_ERROR(H5Sclose(dataspace));
+  HDF5_ERROR(H5Gclose(group));
+
+  return error_count;
+}
+
 static void Checkpoint(const cGH *const cctkGH, int called_from) {
   int error_count = 0;
   DECLARE_CCTK_PARAMETERS;
+  tracing::region const trace("CarpetIOHDF5::Checkpoint", tracing::cat_io);
+  memphase const phase(gmem::phase_checkpoint);
+
+  // finish writing the previous checkpoint if it is still being drained
+  FinishCheckpointDrain(cctkGH, true);
+  bool const staging = UseCheckpointStaging();
+  bool const staging_in_memory =
+      staging and CCTK_EQUALS(checkpoint_staging, "memory");
 
   /* get the filenames for both the temporary and real checkpoint file */
   int ioproc = 0, nioprocs = 1;
@@ -1104,34 +1486,62 @@ static void Checkpoint(const cGH *const cctkGH, int called_from) {
   char *index_filename = IOUtil_AssembleFilename(
       cctkGH, NULL, "", ".idx.h5", called_from, ioproc, not parallel_io);
 
+  // only checkpoints with one file per process can be incremental
+  BeginIncrementalCheckpoint(parallel_io ? filename : NULL);
+
+  // with staging, the checkpoint file is first written into memory or
+  // into the staging directory
+  string stagedname;
+  vector<char> image;
+
   hid_t file = -1;
   hid_t index_file = -1;
   if (dist::rank() == ioproc) {
+    if (staging and not staging_in_memory) {
+      stagedname = CheckpointStagingName(cctkGH, tempname);
+    }
     if (CCTK_Equals(verbose, "full")) {
       CCTK_VInfo(CCTK_THORNSTRING, "Creating temporary checkpoint file '%s'",
-                 tempname);
+                 staging_in_memory
+                     ? "(in memory)"
+                     : stagedname.empty() ? tempname : stagedname.c_str());
     }
 
     hid_t fapl_id;
     HDF5_ERROR(fapl_id = H5Pcreate(H5P_FILE_ACCESS));
     HDF5_ERROR(H5Pset_fclose_degree(fapl_id, H5F_CLOSE_STRONG));
-    HDF5_ERROR(file = H5Fcreate(tempname, H5F_ACC_TRUNC, H5P_DEFAULT, fapl_id));
+    if (staging_in_memory) {
+      // keep the file in memory only, without backing store
+      HDF5_ERROR(H5Pset_fapl_core(fapl_id, 64 * 1024 * 1024, 0));
+    }
+    HDF5_ERROR(file = H5Fcreate(stagedname.empty() ? tempname
+                                                   : stagedname.c_str(),
+                                H5F_ACC_TRUNC, H5P_DEFAULT, fapl_id));
 
     // write metadata information
     error_count += WriteMetadata(cctkGH, nioprocs, -1, -1, true, file);
 
-    if (output_index) {
+    HDF5_ERROR(H5Pclose(fapl_id));
 
+    if (output_index) {
+      // the index file is small and is not staged; it is written
+      // directly into the checkpoint directory and renamed when the
+      // checkpoint is committed
+      HDF5_ERROR(fapl_id = H5Pcreate(H5P_FILE_ACCESS));
+      HDF5_ERROR(H5Pset_fclose_degree(fapl_id, H5F_CLOSE_STRONG));
       HDF5_ERROR(index_file = H5Fcreate(index_tempname, H5F_ACC_TRUNC,
                                         H5P_DEFAULT, fapl_id));
+      HDF5_ERROR(H5Pclose(fapl_id));
       error_count += WriteMetadata(cctkGH, nioprocs, -1, -1, true, index_file);
     }
-    HDF5_ERROR(H5Pclose(fapl_id));
   }
 
   // remember the current wall time
   CCTK_REAL const walltime = CCTK_RunTime() / 3600.0;
 
+  // start a new global index of the datasets in this checkpoint
+  checkpoint_index_entries.clear();
+
   // now dump the grid variables on all mglevels, reflevels, maps and components
   BEGIN_MGLEVEL_LOOP(cctkGH) {
 
@@ -1263,6 +1673,33 @@ static void Checkpoint(const cGH *const cctkGH, int called_from) {
   }
   END_MGLEVEL_LOOP;
 
+  // Collect the global index of all datasets and store it with the
+  // metadata in the checkpoint file of process 0
+  if (checkpoint_index) {
+    vector<string> const entries =
+        gather_string(dist::comm(), 0, checkpoint_index_entries);
+    if (dist::rank() == 0) {
+      assert(file >= 0);
+      error_count += WriteCheckpointIndex(file, entries, parallel_io);
+    }
+    checkpoint_index_entries.clear();
+  }
+
+#ifdef HAVE_H5FGET_FILE_IMAGE
+  // Copy the in-memory file before closing it
+  if (file >= 0 and staging_in_memory) {
+    HDF5_ERROR(H5Fflush(file, H5F_SCOPE_GLOBAL));
+    ssize_t const size = H5Fget_file_image(file, NULL, 0);
+    if (size < 0 or
+        (image.resize(size),
+         H5Fget_file_image(file, &image[0], image.size()) != size)) {
+      CCTK_WARN(1, "Could not obtain the image of the in-memory checkpoint "
+                   "file");
+      error_count++;
+    }
+  }
+#endif
+
   // Close the file
   if (file >= 0) {
     HDF5_ERROR(H5Fclose(file));
@@ -1277,82 +1714,28 @@ static void Checkpoint(const cGH *const cctkGH, int called_from) {
   MPI_Allreduce(&temp, &error_count, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
 
   if (error_count == 0) {
-    if (file >= 0) {
-      if (rename(tempname, filename)) {
-        CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
-                   "Could not rename temporary checkpoint file '%s' to '%s'",
-                   tempname, filename);
-        error_count = -1;
-      } else if (called_from == CP_EVOLUTION_DATA and checkpoint_keep > 0) {
-        CarpetIOHDF5GH *myGH =
-            (CarpetIOHDF5GH *)CCTK_GHExtension(cctkGH, CCTK_THORNSTRING);
-
-        // should an older checkpoint file be removed ?
-        if (myGH->cp_filename_list[myGH->cp_filename_index]) {
-          // check whether the recovery checkpoint (which can be a list of
-          // several chunked files) or a checkpoint file should be removed
-          if (myGH->recovery_filename_list) {
-            for (int i = 0; i < myGH->recovery_num_filenames; i++) {
-              if (myGH->recovery_filename_list[i]) {
-                // remove possible index file
-                string old_index_filename = myGH->recovery_filename_list[i];
-                size_t const basenamelen =
-                    old_index_filename.rfind(out_extension);
-                if (basenamelen != string::npos) {
-                  old_index_filename.insert(basenamelen, ".idx");
-                  remove(old_index_filename.c_str());
-                }
-
-                remove(myGH->recovery_filename_list[i]);
-                free(myGH->recovery_filename_list[i]);
-              }
-            }
-            free(myGH->recovery_filename_list);
-            myGH->recovery_filename_list = NULL;
-          } else {
-            // remove possible index file
-            string old_index_filename =
-                myGH->cp_filename_list[myGH->cp_filename_index];
-            size_t const basenamelen = old_index_filename.rfind(out_extension);
-            if (basenamelen != string::npos) {
-              old_index_filename.insert(basenamelen, ".idx");
-              remove(old_index_filename.c_str());
-            }
-            remove(myGH->cp_filename_list[myGH->cp_filename_index]);
-            free(myGH->cp_filename_list[myGH->cp_filename_index]);
-          }
-        }
-
-        // add this checkpoint to the checkpoint filename ring buffer
-        myGH->cp_filename_list[myGH->cp_filename_index] = strdup(filename);
-        myGH->cp_filename_index =
-            (myGH->cp_filename_index + 1) % checkpoint_keep;
-
-        // since the 'checkpoint_keep' parameter is steerable,
-        // we may need to resize the ring buffer
-        if (myGH->checkpoint_keep != checkpoint_keep) {
-          char **cp_filename_list =
-              (char **)calloc(checkpoint_keep, sizeof(char *));
-          int min = myGH->checkpoint_keep < checkpoint_keep
-                        ? myGH->checkpoint_keep
-                        : checkpoint_keep;
-          while (min-- > 0) {
-            cp_filename_list[min] = myGH->cp_filename_list[min];
-          }
-          free(myGH->cp_filename_list);
-          myGH->cp_filename_list = cp_filename_list;
-          myGH->checkpoint_keep = checkpoint_keep;
-        }
-      }
-    }
-    if (index_file >= 0) {
-      if (rename(index_tempname, index_filename)) {
-        CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
-                   "Could not rename temporary index file '%s' to '%s'",
-                   index_tempname, index_filename);
-      }
+    if (staging) {
+      // let the simulation continue while the files are written into the
+      // checkpoint directory
+      char *const markername =
+          dist::rank() == 0
+              ? IOUtil_AssembleFilename(cctkGH, NULL, "", ".draining",
+                                        called_from, 0, 1)
+              : NULL;
+      DrainCheckpoint(called_from, file >= 0 ? filename : NULL, tempname,
+                      index_file >= 0 ? index_filename : NULL, index_tempname,
+                      markername, stagedname, image);
+      free(markername);
+    } else {
+      error_count = CommitCheckpoint(cctkGH, called_from,
+                                     file >= 0 ? filename : NULL, tempname,
+                                     index_file >= 0 ? index_filename : NULL,
+                                     index_tempname);
     }
   } else {
+    if (not stagedname.empty()) {
+      remove(stagedname.c_str());
+    }
     CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
                "Failed to create checkpoint at iteration %d",
                cctkGH->cctk_iteration);
@@ -1377,6 +1760,104 @@ static void Checkpoint(const cGH *const cctkGH, int called_from) {
 
 } // Checkpoint
 
+int CommitCheckpoint(const cGH *const cctkGH, int const called_from,
+                     const char *const filename, const char *const tempname,
+                     const char *const index_filename,
+                     const char *const index_tempname) {
+  DECLARE_CCTK_PARAMETERS;
+  int error_count = 0;
+
+  if (filename) {
+    if (rename(tempname, filename)) {
+      CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
+                 "Could not rename temporary checkpoint file '%s' to '%s'",
+                 tempname, filename);
+      error_count = -1;
+    } else {
+      CommitIncrementalCheckpoint(filename);
+    }
+    if (error_count == 0 and called_from == CP_EVOLUTION_DATA and
+        checkpoint_keep > 0) {
+      CarpetIOHDF5GH *myGH =
+          (CarpetIOHDF5GH *)CCTK_GHExtension(cctkGH, CCTK_THORNSTRING);
+
+      // should an older checkpoint file be removed ?
+      if (myGH->cp_filename_list[myGH->cp_filename_index]) {
+        // check whether the recovery checkpoint (which can be a list of
+        // several chunked files) or a checkpoint file should be removed
+        if (myGH->recovery_filename_list) {
+          for (int i = 0; i < myGH->recovery_num_filenames; i++) {
+            if (myGH->recovery_filename_list[i]) {
+              // remove possible index file
+              string old_index_filename = myGH->recovery_filename_list[i];
+              size_t const basenamelen =
+                  old_index_filename.rfind(out_extension);
+              if (basenamelen != string::npos) {
+                old_index_filename.insert(basenamelen, ".idx");
+                remove(old_index_filename.c_str());
+              }
+
+              // (the files of the recovered incremental checkpoint
+              // of this process may link to earlier checkpoint files)
+              if (i % dist::size() == dist::rank()) {
+                RemoveRecoveredCheckpointFile(myGH->recovery_filename_list[i]);
+              } else {
+                remove(myGH->recovery_filename_list[i]);
+              }
+              free(myGH->recovery_filename_list[i]);
+            }
+          }
+          free(myGH->recovery_filename_list);
+          myGH->recovery_filename_list = NULL;
+        } else {
+          // remove possible index file
+          string old_index_filename =
+              myGH->cp_filename_list[myGH->cp_filename_index];
+          size_t const basenamelen = old_index_filename.rfind(out_extension);
+          if (basenamelen != string::npos) {
+            old_index_filename.insert(basenamelen, ".idx");
+            remove(old_index_filename.c_str());
+          }
+          // (later incremental checkpoints may still link to this file)
+          RemoveCheckpointFile(myGH->cp_filename_list[myGH->cp_filename_index]);
+          free(myGH->cp_filename_list[myGH->cp_filename_index]);
+        }
+      }
+
+      // add this checkpoint to the checkpoint filename ring buffer
+      myGH->cp_filename_list[myGH->cp_filename_index] = strdup(filename);
+      myGH->cp_filename_index =
+          (myGH->cp_filename_index + 1) % checkpoint_keep;
+
+      // since the 'checkpoint_keep' parameter is steerable,
+      // we may need to resize the ring buffer
+      if (myGH->checkpoint_keep != checkpoint_keep) {
+        char **cp_filename_list =
+            (char **)calloc(checkpoint_keep, sizeof(char *));
+        int min = myGH->checkpoint_keep < checkpoint_keep
+                      ? myGH->checkpoint_keep
+                      : checkpoint_keep;
+        while (min-- > 0) {
+          cp_filename_list[min] = myGH->cp_filename_list[min];
+        }
+        free(myGH->cp_filename_list);
+        myGH->cp_filename_list = cp_filename_list;
+        myGH->checkpoint_keep = checkpoint_keep;
+      }
+    }
+  }
+  if (index_filename) {
+    if (rename(index_tempname, index_filename)) {
+      CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
+                 "Could not rename temporary index file '%s' to '%s'",
+                 index_tempname, index_filename);
+      error_count = -1;
+    }
+  }
+
+  return error_count;
+} // CommitCheckpoint
+
 int WriteMetadata(const cGH *const cctkGH, int const nioprocs,
                   int const firstvar, int const numvars,
                   bool const called_from_checkpoint, hid_t const file) {
@@ -4,6 +4,7 @@
 #define H5_USE_16_API 1
 #include <hdf5.h>
 
+#include <string>
 #include <vector>
 
 #include "CactusBase/IOUtil/src/ioutil_Utils.h"
@@ -14,6 +15,7 @@
 #define METADATA_GROUP "Parameters and Global Attributes"
 #define ALL_PARAMETERS "All Parameters"
 #define GRID_STRUCTURE "Grid Structure v5"
+#define CHECKPOINT_INDEX "Checkpoint Index v2"
 
 // atomic HDF5 datatypes for the generic CCTK datatypes
 // (the one for CCTK_COMPLEX is created at startup as a compound HDF5 datatype)
@@ -59,6 +61,20 @@
 #define slice_start_size_t hsize_t
 #endif
 
+// H5Fget_file_image() is available since HDF5 1.8.9
+#if (H5_VERS_MAJOR > 1 ||                                                      \
+     (H5_VERS_MAJOR == 1 &&                                                    \
+      (H5_VERS_MINOR > 8 || (H5_VERS_MINOR == 8 && H5_VERS_RELEASE >= 9))))
+#define HAVE_H5FGET_FILE_IMAGE 1
+#endif
+
+// H5Dwrite_chunk() is available since HDF5 1.10.2
+#if (H5_VERS_MAJOR > 1 ||                                                      \
+     (H5_VERS_MAJOR == 1 &&                                                    \
+      (H5_VERS_MINOR > 10 || (H5_VERS_MINOR == 10 && H5_VERS_RELEASE >= 2))))
+#define HAVE_H5DWRITE_CHUNK 1
+#endif
+
 // CarpetIOHDF5 GH extension structure
 typedef struct {
   // default number of times to output
@@ -142,6 +158,56 @@ int WriteAttribute(hid_t const group, char const *const name,
 int WriteLargeAttribute(hid_t const group, char const *const name,
                         char const *const svalue);
 
+// rename the files of a checkpoint from their temporary names and
+// remove old checkpoints (file names are NULL if they do not exist on
+// this process)
+int CommitCheckpoint(const cGH *const cctkGH, int const called_from,
+                     const char *const filename, const char *const tempname,
+                     const char *const index_filename,
+                     const char *const index_tempname);
+
+// asynchronous checkpointing via a staging area, which is drained into
+// the checkpoint directory in the background
+bool UseCheckpointStaging();
+string CheckpointStagingName(const cGH *const cctkGH,
+                             const char *const tempname);
+void DrainCheckpoint(int const called_from, const char *const filename,
+                     const char *const tempname,
+                     const char *const index_filename,
+                     const char *const index_tempname,
+                     const char *const markername, const string &stagedname,
+                     vector<char> &image);
+void FinishCheckpointDrain(const cGH *const cctkGH, bool const wait);
+
+// incremental checkpoints, which link to unchanged datasets in earlier
+// checkpoint files instead of writing them again
+void BeginIncrementalCheckpoint(const char *const filename);
+string IncrementalCheckpointKey(const string &datasetname, const ibbox &bbox,
+                                const string &active);
+bool FindUnchangedDataset(const string &key, unsigned long long const hash,
+                          const string &datasetname, string &target_filename,
+                          string &target_datasetname);
+void CommitIncrementalCheckpoint(const char *const filename);
+void RemoveCheckpointFile(const char *const filename);
+void RemoveRecoveredCheckpointFile(const char *const filename);
+
+// compression of output datasets in parallel, writing the compressed
+// chunks directly; the chunks are rounded to the given tolerances
+// first (see CarpetLib's quantize.hh) if these are nonzero
+bool UseCompressionThreads(hid_t const memdatatype, hid_t const filedatatype);
+void CompressionChunkShape(int const rank, const hsize_t *const shape,
+                           size_t const elemsize, hsize_t *const chunk);
+int WriteCompressedChunks(hid_t const dataset, int const rank,
+                          const hsize_t *const shape,
+                          const hsize_t *const chunk, size_t const elemsize,
+                          const void *const data, int const level,
+                          int const vartype, double const abs_tol,
+                          double const rel_tol);
+// the tolerances to which compressed output (but not checkpoint) data
+// of a variable are rounded; returns false if they are not rounded
+bool OutputRoundingTolerances(int const vindex, int const vartype,
+                              double &abs_tol, double &rel_tol);
+
 // returns an HDF5 datatype corresponding to the given CCTK datatype
 hid_t CCTKtoHDF5_Datatype(const cGH *const cctkGH, int cctk_type,
                           bool single_precision);
@@ -230,6 +296,7 @@ void CarpetIOHDF5_CloseFiles(CCTK_ARGUMENTS);
 void CarpetIOHDF5_InitialDataCheckpoint(CCTK_ARGUMENTS);
 void CarpetIOHDF5_EvolutionCheckpoint(CCTK_ARGUMENTS);
 void CarpetIOHDF5_TerminationCheckpoint(CCTK_ARGUMENTS);
+void CarpetIOHDF5_FlushOutput(CCTK_ARGUMENTS);
 
 CCTK_INT CarpetIOHDF5_SetCheckpointGroups(CCTK_INT const *groups,
                                           CCTK_INT ngroups);
@@ -240,6 +307,11 @@ CCTK_INT CarpetIOHDF5_SetCheckpointGroups(CCTK_INT const *groups,
 // should be checkpointed (default).
 extern vector<bool> groups_to_checkpoint;
 
+// Global index of the datasets written into the current checkpoint
+// by this process, one line per dataset. This is collected while the
+// checkpoint is written and stored with the metadata on process 0.
+extern string checkpoint_index_entries;
+
 } // namespace CarpetIOHDF5
 
 #endif // !defined(CARPETIOHDF5_HH)
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#include <zlib.h>
+
+#include "cctk.h"
+#include "cctk_Parameters.h"
+
+#include "CarpetIOHDF5.hh"
+#include "quantize.hh"
+
+// Parallel compression of output datasets
+//
+// With the HDF5 filter pipeline, datasets are compressed by a single
+// thread inside H5Dwrite, which often takes longer than writing the
+// data. Instead, the dataset can be split into chunks, which are
+// shuffled and deflated in parallel by OpenMP threads exactly as the
+// HDF5 shuffle and deflate filters would do it, and which are then
+// written directly via H5Dwrite_chunk. The resulting files are
+// indistinguishable from files written via the filter pipeline.
+
+namespace CarpetIOHDF5 {
+
+using namespace std;
+using namespace Carpet;
+
+bool UseCompressionThreads(hid_t const memdatatype, hid_t const filedatatype) {
+  DECLARE_CCTK_PARAMETERS;
+
+  if (not CCTK_EQUALS(compression_pipeline, "threads"))
+    return false;
+  // Fletcher32 checksums would have to be computed as well
+  if (use_checksums)
+    return false;
+#ifdef HAVE_H5DWRITE_CHUNK
+  // The data are written as is, without datatype conversion
+  return H5Tequal(memdatatype, filedatatype) > 0;
+#else
+  static bool warned = false;
+  if (not warned) {
+    CCTK_WARN(CCTK_WARN_ALERT,
+              "CarpetIOHDF5::compression_pipeline is set to \"threads\", but "
+              "this requires HDF5 1.10.2 or later; compressing via the HDF5 "
+              "filter pipeline instead");
+    warned = true;
+  }
+  return false;
+#endif
+}
+
+bool OutputRoundingTolerances(int const vindex, int const vartype,
+                              double &abs_tol, double &rel_tol) {
+  DECLARE_CCTK_PARAMETERS;
+
+  if (CarpetLib::can_quantize(vartype) and
+      CarpetLib::lookup_tolerances(compression_tolerances, vindex, abs_tol,
+                                   rel_tol))
+    return true;
+  abs_tol = rel_tol = 0.0;
+  return false;
+}
+
+void CompressionChunkShape(int const rank, const hsize_t *const shape,
+                           size_t const elemsize, hsize_t *const chunk) {
+  DECLARE_CCTK_PARAMETERS;
+
+  // Chunks consist of complete planes along the slowest dimension, so
+  // that each chunk is contiguous in memory
+  assert(rank > 0);
+  hsize_t plane_size = elemsize;
+  for (int d = 1; d < rank; ++d) {
+    chunk[d] = shape[d];
+    plane_size *= shape[d];
+  }
+  chunk[0] = max(hsize_t(1), min(shape[0], hsize_t(compression_chunk_size) /
+                                               plane_size));
+}
+
+int WriteCompressedChunks(hid_t const dataset, int const rank,
+                          const hsize_t *const shape,
+                          const hsize_t *const chunk, size_t const elemsize,
+                          const void *const data, int const level,
+                          int const vartype, double const abs_tol,
+                          double const rel_tol) {
+  int error_count = 0;
+  const bool round = abs_tol > 0.0 or rel_tol > 0.0;
+  assert(not round or CarpetLib::can_quantize(vartype));
+
+#ifdef HAVE_H5DWRITE_CHUNK
+  hsize_t plane_elems = 1;
+  for (int d = 1; d < rank; ++d)
+    plane_elems *= shape[d];
+  const size_t chunk_elems = chunk[0] * plane_elems;
+  const size_t chunk_bytes = chunk_elems * elemsize;
+  const int num_chunks = (shape[0] + chunk[0] - 1) / chunk[0];
+
+  // Compress a limited number of chunks at a time to bound the
+  // memory overhead
+  const int batch_size = 2 * dist::num_threads();
+  vector<vector<Bytef> > compressed(batch_size);
+  vector<uLongf> compressed_size(batch_size);
+  for (int batch = 0; batch < num_chunks; batch += batch_size) {
+    const int nchunks = min(batch_size, num_chunks - batch);
+    int zlib_errors = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+ : zlib_errors)
+    for (int n = 0; n < nchunks; ++n) {
+      const int c = batch + n;
+      const size_t offset = c * chunk_bytes;
+      const size_t total_bytes = shape[0] * plane_elems * elemsize;
+      const size_t bytes = min(chunk_bytes, total_bytes - offset);
+      const char *src = static_cast<const char *>(data) + offset;
+
+      // Round a copy of the chunk (the data themselves must not
+      // change)
+      vector<char> rounded;
+      if (round) {
+        rounded.assign(src, src + bytes);
+        CarpetLib::quantize(vartype, &rounded.front(), bytes / elemsize,
+                            abs_tol, rel_tol);
+        src = &rounded.front();
+      }
+
+      // Shuffle the bytes of the elements (as the HDF5 shuffle filter
+      // does); the last chunk is padded with zeros
+      vector<Bytef> shuffled(chunk_bytes, 0);
+      const size_t elems = bytes / elemsize;
+      for (size_t b = 0; b < elemsize; ++b) {
+        Bytef *const dst = &shuffled[b * chunk_elems];
+        for (size_t i = 0; i < elems; ++i)
+          dst[i] = src[i * elemsize + b];
+      }
+
+      compressed[n].resize(compressBound(chunk_bytes));
+      compressed_size[n] = compressed[n].size();
+      if (compress2(&compressed[n].front(), &compressed_size[n],
+                    &shuffled.front(), chunk_bytes, level) != Z_OK) {
+        ++zlib_errors;
+      }
+    }
+    if (zlib_errors) {
+      CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
+                 "zlib failed to compress %d chunks", zlib_errors);
+      error_count += zlib_errors;
+      continue;
+    }
+
+    for (int n = 0; n < nchunks; ++n) {
+      hsize_t offset[dim];
+      offset[0] = (batch + n) * chunk[0];
+      for (int d = 1; d < rank; ++d)
+        offset[d] = 0;
+      HDF5_ERROR(H5Dwrite_chunk(dataset, H5P_DEFAULT, 0, offset,
+                                compressed_size[n], &compressed[n].front()));
+    }
+  }
+#else
+  assert(0);
+#endif
+
+  return error_count;
+}
+
+} // namespace CarpetIOHDF5
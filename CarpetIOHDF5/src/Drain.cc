@@ -0,0 +1,281 @@
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "cctk.h"
+#include "cctk_Parameters.h"
+
+#include <Timer.hh>
+
+#include "CarpetIOHDF5.hh"
+#include "mem.hh"
+
+// Asynchronous checkpointing
+//
+// Checkpoint files are first written into a staging area, either into
+// memory (via HDF5's core driver) or into a directory on fast,
+// node-local storage. The simulation then continues, while a
+// background thread copies ("drains") the files under their temporary
+// names into the checkpoint directory. Once all processes have
+// finished draining, the files are renamed to their final names and
+// old checkpoints are removed, exactly as for synchronous
+// checkpoints.
+//
+// While a checkpoint is being drained, process 0 keeps a marker file
+// next to the checkpoint files. Recovery refuses to use a checkpoint
+// for which this marker exists, so that an incomplete checkpoint is
+// never used, even if the simulation is interrupted while renaming
+// the files.
+
+namespace CarpetIOHDF5 {
+
+using namespace std;
+using namespace Carpet;
+
+namespace {
+
+// A checkpoint that is being drained
+struct drain_t {
+  int called_from;
+  string filename, tempname;             // empty if this process has no file
+  string index_filename, index_tempname; // empty if there is no index file
+  string markername;                     // only set on process 0
+  string stagedname;                     // staged file (directory staging)
+  vector<char> image;                    // staged file (memory staging)
+  size_t image_bytes;                    // accounted size of the image
+
+  thread worker;
+  mutex mtx;
+  bool done;
+  int errors;
+
+  drain_t() : called_from(-1), image_bytes(0), done(false), errors(0) {}
+};
+
+drain_t *pending = NULL;
+
+// Copy the staged file into the checkpoint directory; this runs in a
+// background thread and must not call Cactus or HDF5
+void drain(drain_t *const d) {
+  int errors = 0;
+
+  if (not d->tempname.empty()) {
+    FILE *const outfile = fopen(d->tempname.c_str(), "wb");
+    if (not outfile) {
+      ++errors;
+    } else {
+      if (d->stagedname.empty()) {
+        if (not d->image.empty() and
+            fwrite(&d->image[0], 1, d->image.size(), outfile) !=
+                d->image.size()) {
+          ++errors;
+        }
+      } else {
+        FILE *const infile = fopen(d->stagedname.c_str(), "rb");
+        if (not infile) {
+          ++errors;
+        } else {
+          vector<char> buffer(16 * 1024 * 1024);
+          size_t count;
+          while ((count = fread(&buffer[0], 1, buffer.size(), infile)) > 0) {
+            if (fwrite(&buffer[0], 1, count, outfile) != count) {
+              ++errors;
+              break;
+            }
+          }
+          if (ferror(infile))
+            ++errors;
+          fclose(infile);
+        }
+      }
+      // Ensure the data are on disk before the file is renamed
+      if (fflush(outfile) or fsync(fileno(outfile)))
+        ++errors;
+      if (fclose(outfile))
+        ++errors;
+    }
+
+    // Free the staging area
+    if (not errors and not d->stagedname.empty())
+      remove(d->stagedname.c_str());
+    vector<char>().swap(d->image);
+  }
+
+  lock_guard<mutex> lock(d->mtx);
+  d->done = true;
+  d->errors = errors;
+}
+
+} // namespace
+
+bool UseCheckpointStaging() {
+  DECLARE_CCTK_PARAMETERS;
+
+  if (CCTK_EQUALS(checkpoint_staging, "none"))
+    return false;
+#ifndef HAVE_H5FGET_FILE_IMAGE
+  if (CCTK_EQUALS(checkpoint_staging, "memory")) {
+    static bool did_warn = false;
+    if (not did_warn) {
+      CCTK_WARN(CCTK_WARN_ALERT,
+                "Staging checkpoints in memory requires HDF5 1.8.9 or "
+                "later. Writing checkpoints synchronously instead.");
+      did_warn = true;
+    }
+    return false;
+  }
+#endif
+  return true;
+}
+
+string CheckpointStagingName(const cGH *const cctkGH,
+                             const char *const tempname) {
+  DECLARE_CCTK_PARAMETERS;
+
+  assert(CCTK_EQUALS(checkpoint_staging, "directory"));
+
+  // Every process stages its files on its own (node-local) storage
+  static string created_dir;
+  if (created_dir != checkpoint_staging_dir) {
+    int const result =
+        IOUtil_CreateDirectory(cctkGH, checkpoint_staging_dir, 1, dist::rank());
+    if (result < 0) {
+      CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
+                 "Problem creating checkpoint staging directory '%s'",
+                 checkpoint_staging_dir);
+    }
+    created_dir = checkpoint_staging_dir;
+  }
+
+  const char *const slash = strrchr(tempname, '/');
+  return string(checkpoint_staging_dir) + "/" + (slash ? slash + 1 : tempname);
+}
+
+void DrainCheckpoint(int const called_from, const char *const filename,
+                     const char *const tempname,
+                     const char *const index_filename,
+                     const char *const index_tempname,
+                     const char *const markername, const string &stagedname,
+                     vector<char> &image) {
+  DECLARE_CCTK_PARAMETERS;
+
+  assert(not pending);
+  pending = new drain_t;
+  pending->called_from = called_from;
+  if (filename) {
+    assert(tempname);
+    pending->filename = filename;
+    pending->tempname = tempname;
+  }
+  if (index_filename) {
+    assert(index_tempname);
+    pending->index_filename = index_filename;
+    pending->index_tempname = index_tempname;
+  }
+  pending->stagedname = stagedname;
+  swap(pending->image, image);
+  pending->image_bytes = pending->image.capacity();
+  gmem::account(gmem::sub_io, pending->image_bytes);
+
+  // Mark the checkpoint as incomplete until it has been drained
+  if (markername) {
+    pending->markername = markername;
+    FILE *const marker = fopen(markername, "w");
+    if (marker) {
+      fprintf(marker, "This checkpoint is still being written.\n");
+      fclose(marker);
+    } else {
+      CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
+                 "Could not create checkpoint marker file '%s'", markername);
+    }
+  }
+
+  if (CCTK_Equals(verbose, "full")) {
+    CCTK_VInfo(CCTK_THORNSTRING, "Draining checkpoint file '%s' in the "
+                                 "background",
+               pending->filename.c_str());
+  }
+
+  pending->worker = thread(drain, pending);
+}
+
+void FinishCheckpointDrain(const cGH *const cctkGH, bool const wait) {
+  DECLARE_CCTK_PARAMETERS;
+
+  // Checkpointing is collective, so that either all or no processes
+  // have a pending drain
+  if (not pending)
+    return;
+
+  if (not wait) {
+    // Finish only if all processes are done
+    int done;
+    {
+      lock_guard<mutex> lock(pending->mtx);
+      done = pending->done;
+    }
+    int all_done;
+    MPI_Allreduce(&done, &all_done, 1, MPI_INT, MPI_MIN, dist::comm());
+    if (not all_done)
+      return;
+  }
+
+  static Timers::Timer timer("FinishCheckpointDrain");
+  timer.start();
+
+  pending->worker.join();
+  // The worker has freed the image
+  gmem::account(gmem::sub_io, -double(pending->image_bytes));
+
+  int error_count = pending->errors;
+  {
+    int const temp = error_count;
+    MPI_Allreduce(const_cast<int *>(&temp), &error_count, 1, MPI_INT, MPI_SUM,
+                  dist::comm());
+  }
+
+  if (error_count == 0) {
+    int const commit_errors = CommitCheckpoint(
+        cctkGH, pending->called_from,
+        pending->filename.empty() ? NULL : pending->filename.c_str(),
+        pending->tempname.c_str(),
+        pending->index_filename.empty() ? NULL
+                                        : pending->index_filename.c_str(),
+        pending->index_tempname.c_str());
+    int const temp = commit_errors != 0;
+    MPI_Allreduce(const_cast<int *>(&temp), &error_count, 1, MPI_INT, MPI_SUM,
+                  dist::comm());
+  } else {
+    CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
+               "Failed to write staged checkpoint files into the checkpoint "
+               "directory");
+  }
+
+  // Remove the marker only if all files have their final names
+  if (error_count == 0 and not pending->markername.empty()) {
+    remove(pending->markername.c_str());
+  }
+
+  if (CCTK_Equals(verbose, "full")) {
+    CCTK_VInfo(CCTK_THORNSTRING, "Finished draining checkpoint file '%s'",
+               pending->filename.c_str());
+  }
+
+  delete pending;
+  pending = NULL;
+
+  timer.stop();
+
+  if (error_count > 0 and abort_on_io_errors) {
+    CCTK_WARN(0, "Aborting simulation due to previous I/O errors");
+  }
+}
+
+} // namespace CarpetIOHDF5
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cctk.h"
+#include "cctk_Parameters.h"
+
+#include "CarpetIOHDF5.hh"
+
+// Incremental checkpoints
+//
+// In an incremental checkpoint, datasets which have not changed since
+// the previous checkpoint are not written again. Instead, the
+// checkpoint file contains an HDF5 external link to the dataset in the
+// earlier checkpoint file which holds the data. Datasets are compared
+// via a hash of their data, and are identified by their variable,
+// time level, refinement level, map, component, and bounding box.
+//
+// Every process keeps track of the datasets in its own checkpoint
+// files. A checkpoint file is removed only when no remaining
+// checkpoint file links to it; its removal is deferred otherwise. A
+// full checkpoint is written every checkpoint_full_every checkpoints,
+// after which all earlier checkpoint files can be removed. When the
+// checkpoint from which a simulation was recovered is removed, the
+// files it links to are removed as well.
+
+namespace CarpetIOHDF5 {
+
+using namespace std;
+
+namespace {
+
+// Where the data of a dataset are stored
+struct dataset_location_t {
+  unsigned long long hash;
+  string filename;    // checkpoint file containing the data
+  string datasetname; // dataset name in this file
+};
+
+// Datasets of the last committed checkpoint
+std::map<string, dataset_location_t> committed_datasets;
+// Datasets of the checkpoint which is currently being written
+std::map<string, dataset_location_t> current_datasets;
+
+// The checkpoint file which is currently being written (its final
+// name), or empty if the current checkpoint is not incremental
+string current_filename;
+// Number of checkpoints since the last full checkpoint
+int checkpoints_since_full = 0;
+
+// Files which are linked to from each existing checkpoint file
+std::map<string, set<string> > checkpoint_references;
+// Checkpoint files whose removal was deferred
+list<string> deferred_removals;
+
+string basename(const string &filename) {
+  size_t const slash = filename.rfind('/');
+  return slash == string::npos ? filename : filename.substr(slash + 1);
+}
+
+string dirname(const string &filename) {
+  size_t const slash = filename.rfind('/');
+  return slash == string::npos ? string() : filename.substr(0, slash + 1);
+}
+
+// Collect the files to which the external links in a group point
+herr_t add_link_target(hid_t const group, const char *const name,
+                       const H5L_info_t *const info, void *const op_data) {
+  set<string> &targets = *static_cast<set<string> *>(op_data);
+  if (info->type != H5L_TYPE_EXTERNAL)
+    return 0;
+  int error_count = 0;
+  vector<char> buf(info->u.val_size);
+  const char *filename, *objname;
+  HDF5_ERROR(H5Lget_val(group, name, &buf.front(), buf.size(), H5P_DEFAULT));
+  HDF5_ERROR(
+      H5Lunpack_elink_val(&buf.front(), buf.size(), NULL, &filename, &objname));
+  if (error_count == 0)
+    targets.insert(filename);
+  return 0;
+}
+
+bool is_referenced(const string &filename) {
+  for (std::map<string, set<string> >::const_iterator i =
+           checkpoint_references.begin();
+       i != checkpoint_references.end(); ++i) {
+    if (i->first != filename and i->second.count(filename))
+      return true;
+  }
+  return false;
+}
+
+} // namespace
+
+// Prepare writing a checkpoint file (filename is NULL if the
+// checkpoint cannot be incremental)
+void BeginIncrementalCheckpoint(const char *const filename) {
+  DECLARE_CCTK_PARAMETERS;
+
+  current_datasets.clear();
+  current_filename.clear();
+  if (not checkpoint_incremental or not filename)
+    return;
+
+  current_filename = filename;
+  if (checkpoints_since_full + 1 >= checkpoint_full_every) {
+    // write a full checkpoint
+    committed_datasets.clear();
+  }
+}
+
+string IncrementalCheckpointKey(const string &datasetname, const ibbox &bbox,
+                                const string &active) {
+  // remove the iteration number from the dataset name
+  string key = datasetname;
+  size_t const pos = key.find(" it=");
+  if (pos != string::npos) {
+    size_t const end = key.find(' ', pos + 1);
+    key.erase(pos, end == string::npos ? string::npos : end - pos);
+  }
+  ostringstream buf;
+  buf << key << " " << bbox << " " << active;
+  return buf.str();
+}
+
+bool FindUnchangedDataset(const string &key, unsigned long long const hash,
+                          const string &datasetname, string &target_filename,
+                          string &target_datasetname) {
+  if (current_filename.empty())
+    return false;
+
+  dataset_location_t location;
+  std::map<string, dataset_location_t>::const_iterator const old =
+      committed_datasets.find(key);
+  bool const unchanged = old != committed_datasets.end() and
+                         old->second.hash == hash and
+                         old->second.filename != current_filename;
+  if (unchanged) {
+    location = old->second;
+    // links are relative to the directory of the linking file
+    target_filename = basename(location.filename);
+    target_datasetname = location.datasetname;
+  } else {
+    location.hash = hash;
+    location.filename = current_filename;
+    location.datasetname = datasetname;
+  }
+  current_datasets[key] = location;
+  return unchanged;
+}
+
+void CommitIncrementalCheckpoint(const char *const filename) {
+  if (current_filename.empty() or current_filename != filename)
+    return;
+
+  set<string> &references = checkpoint_references[current_filename];
+  references.clear();
+  bool full = true;
+  for (std::map<string, dataset_location_t>::const_iterator i =
+           current_datasets.begin();
+       i != current_datasets.end(); ++i) {
+    if (i->second.filename != current_filename) {
+      references.insert(i->second.filename);
+      full = false;
+    }
+  }
+  checkpoints_since_full = full ? 0 : checkpoints_since_full + 1;
+
+  committed_datasets.swap(current_datasets);
+  current_datasets.clear();
+  current_filename.clear();
+}
+
+// Remove a checkpoint file from which this simulation was recovered.
+// The earlier checkpoint files to which it links (directly, or via
+// other earlier files) were written by the previous run and are not
+// known otherwise; they are put under the same rules as the files
+// written by this run, and are removed once no checkpoint links to
+// them any more.
+void RemoveRecoveredCheckpointFile(const char *const filename) {
+  list<string> pending(1, filename);
+  while (not pending.empty()) {
+    string const name = pending.front();
+    pending.pop_front();
+    if (checkpoint_references.count(name))
+      continue;
+    set<string> &references = checkpoint_references[name];
+
+    H5E_BEGIN_TRY { // the file may not exist
+      hid_t const file = H5Fopen(name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+      if (file >= 0) {
+        set<string> targets;
+        hsize_t idx = 0;
+        H5Literate(file, H5_INDEX_NAME, H5_ITER_NATIVE, &idx, add_link_target,
+                   &targets);
+        H5Fclose(file);
+        // links are relative to the directory of the linking file
+        for (set<string>::const_iterator i = targets.begin();
+             i != targets.end(); ++i) {
+          string const target = dirname(name) + *i;
+          references.insert(target);
+          pending.push_back(target);
+          if (find(deferred_removals.begin(), deferred_removals.end(),
+                   target) == deferred_removals.end())
+            deferred_removals.push_back(target);
+        }
+      }
+    }
+    H5E_END_TRY;
+  }
+
+  RemoveCheckpointFile(filename);
+}
+
+void RemoveCheckpointFile(const char *const filename) {
+  deferred_removals.push_back(filename);
+
+  // remove all files which are not referenced any more
+  bool did_remove;
+  do {
+    did_remove = false;
+    for (list<string>::iterator i = deferred_removals.begin();
+         i != deferred_removals.end();) {
+      if (is_referenced(*i)) {
+        ++i;
+      } else {
+        remove(i->c_str());
+        checkpoint_references.erase(*i);
+        i = deferred_removals.erase(i);
+        did_remove = true;
+      }
+    }
+  } while (did_remove);
+}
+
+} // namespace CarpetIOHDF5
@@ -19,6 +19,8 @@
 #include "CarpetIOHDF5.hh"
 
 #include "defs.hh"
+#include "mpi_string.hh"
+#include "tracing.hh"
 
 namespace CarpetIOHDF5 {
 
@@ -78,6 +80,14 @@ typedef struct {
   vector<vector<i2vect> > grid_buffers;          // [map]
   vector<vector<int> > grid_prolongation_orders; // [map]
 
+  // global checkpoint index (if present), listing the patches of each
+  // file that overlap with components of this process on one level
+  string index_filename;
+  bool read_global_index;
+  bool has_global_index;
+  int index_mglevel, index_reflevel;
+  vector<list<patch_t> > global_index; // [nioprocs]
+
 } fileset_t;
 
 // list of checkpoint/filereader files
@@ -91,9 +101,13 @@ static list<fileset_t>::iterator OpenFileSet(const cGH *const cctkGH,
                                              const char *basefilename,
                                              int called_from);
 static void ReadMetadata(fileset_t &fileset, const file_t &file);
+static void ReadCheckpointIndex(fileset_t &fileset,
+                                const std::map<string, unsigned int> &alias);
 static herr_t BrowseDatasets(hid_t group, const char *objectname, void *arg);
-static int ReadVar(const cGH *const cctkGH, file_t &file, CCTK_REAL &io_bytes,
-                   list<patch_t>::const_iterator patch,
+static void GetPatchMapAndComponent(patch_t &patch, const char *objectname);
+static bool PatchOverlapsLocalComponents(const patch_t &patch);
+static int ReadVar(const cGH *const cctkGH, file_t &file, CCTK_REAL &io_files,
+                   CCTK_REAL &io_bytes, list<patch_t>::const_iterator patch,
                    vector<ibset> &bboxes_read, bool in_recovery);
 
 //////////////////////////////////////////////////////////////////////////////
@@ -344,6 +358,7 @@ void CarpetIOHDF5_CloseFiles(CCTK_ARGUMENTS) {
 int Recover(cGH *cctkGH, const char *basefilename, int called_from) {
   int error_count = 0;
   DECLARE_CCTK_PARAMETERS;
+  tracing::region const trace("CarpetIOHDF5::Recover", tracing::cat_io);
 
   assert(called_from == CP_RECOVER_PARAMETERS or
          called_from == CP_RECOVER_DATA or called_from == FILEREADER_DATA);
@@ -543,6 +558,16 @@ int Recover(cGH *cctkGH, const char *basefilename, int called_from) {
   }
 #endif
 
+  // read the global checkpoint index for this level, so that only
+  // those files need to be opened which contain data for this process
+  if (in_recovery and recover_from_checkpoint_index and
+      (not fileset->read_global_index or
+       (fileset->has_global_index and
+        (fileset->index_mglevel != mglevel or
+         fileset->index_reflevel != reflevel)))) {
+    ReadCheckpointIndex(*fileset, alias);
+  }
+
   CarpetIOHDF5GH *myGH =
       (CarpetIOHDF5GH *)CCTK_GHExtension(cctkGH, CCTK_THORNSTRING);
   // allocate list of recovery filenames
@@ -582,7 +607,19 @@ int Recover(cGH *cctkGH, const char *basefilename, int called_from) {
                                   ".h5", called_from, file_idx, 0);
       assert(file.filename);
     }
-    if (file.patches.size() == 0) {
+    if (myGH->recovery_filename_list and not myGH->recovery_filename_list[i]) {
+      myGH->recovery_filename_list[i] = strdup(file.filename);
+    }
+
+    if (fileset->has_global_index) {
+      // use the patches of this file which overlap with components
+      // of this process, and skip the file entirely if there are none
+      // (the file is only opened in ReadVar)
+      file.patches = fileset->global_index.at(file_idx);
+      if (file.patches.empty()) {
+        continue;
+      }
+    } else if (file.patches.size() == 0) {
       // we defer opening the actual data file until we have to
       // and open only the index file if it exists
 
@@ -613,9 +650,6 @@ int Recover(cGH *cctkGH, const char *basefilename, int called_from) {
                             "/", NULL, BrowseDatasets, args));
     }
     assert(file.patches.size() > 0);
-    if (myGH->recovery_filename_list and not myGH->recovery_filename_list[i]) {
-      myGH->recovery_filename_list[i] = strdup(file.filename);
-    }
 
     // some optimisation for the case when all processors recover
     // from a single chunked checkpoint file:
@@ -678,7 +712,7 @@ int Recover(cGH *cctkGH, const char *basefilename, int called_from) {
       // actually read the patch
       if (not read_completely.at(patch->vindex).at(patch->timelevel)) {
         error_count += ReadVar(
-            cctkGH, file, io_bytes, patch,
+            cctkGH, file, io_files, io_bytes, patch,
             bboxes_read.at(patch->vindex).at(patch->timelevel), in_recovery);
 
         // update the read_completely entry
@@ -894,6 +928,25 @@ static list<fileset_t>::iterator OpenFileSet(const cGH *const cctkGH,
   list<string> filenames;
   DECLARE_CCTK_PARAMETERS;
 
+  // refuse to recover from a checkpoint that is still being drained
+  // from the staging area (see checkpoint_staging)
+  if (called_from == CP_RECOVER_PARAMETERS) {
+    char *const markername = IOUtil_AssembleFilename(
+        NULL, basefilename, "", ".draining", called_from, 0, 1);
+    assert(markername);
+    FILE *const marker = fopen(markername, "r");
+    if (marker) {
+      fclose(marker);
+      CCTK_VWarn(CCTK_WARN_ALERT, __LINE__, __FILE__, CCTK_THORNSTRING,
+                 "Checkpoint '%s' is incomplete (marker file '%s' exists); "
+                 "ignoring it",
+                 basefilename, markername);
+      free(markername);
+      return filesets.end();
+    }
+    free(markername);
+  }
+
   // first try to open a chunked file written on this processor
   // (note that dist::rank() cannot be called yet during RECOVER_PARAMETERS)
   fileset.first_ioproc = CCTK_MyProc(cctkGH);
@@ -1043,6 +1096,11 @@ static list<fileset_t>::iterator OpenFileSet(const cGH *const cctkGH,
   fileset.files[fileset.first_ioproc] = file;
   fileset.setname = setname;
   fileset.basefilename = basefilename;
+  fileset.index_filename = file.filename;
+  fileset.read_global_index = false;
+  fileset.has_global_index = false;
+  fileset.index_mglevel = -1;
+  fileset.index_reflevel = -1;
 
   // add the new fileset to the list of sets and return an iterator to it
   filesets.push_front(fileset);
@@ -1230,7 +1288,13 @@ static herr_t BrowseDatasets(hid_t group, const char *objectname, void *args) {
     return (0);
   }
   // we are interested only in datasets
+  // (incremental checkpoints contain external links to datasets in
+  // earlier checkpoint files)
   HDF5_ERROR(H5Gget_objinfo(group, objectname, 0, &object_info));
+  bool const is_link = object_info.type == H5G_UDLINK;
+  if (is_link) {
+    HDF5_ERROR(H5Gget_objinfo(group, objectname, 1, &object_info));
+  }
   if (object_info.type != H5G_DATASET) {
     return (0);
   }
@@ -1273,6 +1337,14 @@ static herr_t BrowseDatasets(hid_t group, const char *objectname, void *args) {
   HDF5_ERROR(attr = H5Aopen_name(dataset, "timestep"));
   HDF5_ERROR(H5Aread(attr, H5T_NATIVE_INT, &patch.timestep));
   HDF5_ERROR(H5Aclose(attr));
+  if (is_link) {
+    // the attributes of a linked dataset describe the checkpoint in
+    // which it was written
+    const char *const iteration_string = strstr(objectname, " it=");
+    if (iteration_string) {
+      sscanf(iteration_string, " it=%d", &patch.timestep);
+    }
+  }
   HDF5_ERROR(attr = H5Aopen_name(dataset, "group_timelevel"));
   HDF5_ERROR(H5Aread(attr, H5T_NATIVE_INT, &patch.timelevel));
   HDF5_ERROR(H5Aclose(attr));
@@ -1306,8 +1378,25 @@ static herr_t BrowseDatasets(hid_t group, const char *objectname, void *args) {
   }
   HDF5_ERROR(H5Dclose(dataset));
 
-  // try to obtain the map and component number from the patch's name
-  // (cleaner way would be to store attributes with the dataset)
+  GetPatchMapAndComponent(patch, objectname);
+
+  // add this patch to our list
+  if (patch.vindex >= 0 and patch.vindex < CCTK_NumVars()) {
+    patch.patchname = objectname;
+    file->patches.push_back(patch);
+  } else {
+    CCTK_VWarn(3, __LINE__, __FILE__, CCTK_THORNSTRING,
+               "Ignoring dataset '%s' (invalid variable name)", objectname);
+  }
+
+  return (0);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Obtains the map and component number of a patch from its name
+// (cleaner way would be to store attributes with the dataset)
+//////////////////////////////////////////////////////////////////////////////
+static void GetPatchMapAndComponent(patch_t &patch, const char *objectname) {
   patch.map = 0;
   const char *map_string = strstr(objectname, " m=");
   if (map_string) {
@@ -1318,24 +1407,232 @@ static herr_t BrowseDatasets(hid_t group, const char *objectname, void *args) {
   if (component_string) {
     sscanf(component_string, " c=%d", &patch.component);
   }
+}
 
-  // add this patch to our list
-  if (patch.vindex >= 0 and patch.vindex < CCTK_NumVars()) {
-    patch.patchname = objectname;
-    file->patches.push_back(patch);
-  } else {
-    CCTK_VWarn(3, __LINE__, __FILE__, CCTK_THORNSTRING,
-               "Ignoring dataset '%s' (invalid variable name)", objectname);
+//////////////////////////////////////////////////////////////////////////////
+// Reads the part of the global index of a checkpoint (written by
+// process 0) that describes the current mglevel and reflevel, and
+// stores the patches of each file that overlap with components of
+// this process
+//////////////////////////////////////////////////////////////////////////////
+static void ReadCheckpointIndex(fileset_t &fileset,
+                                const std::map<string, unsigned int> &alias) {
+  int error_count = 0;
+  DECLARE_CCTK_PARAMETERS;
+
+  fileset.read_global_index = true;
+  fileset.has_global_index = false;
+  fileset.index_mglevel = mglevel;
+  fileset.index_reflevel = reflevel;
+  fileset.global_index.clear();
+
+  // read the index on process 0 only and broadcast it, so that the
+  // file system sees only a single access
+  int found = 0;
+  string index;
+  if (dist::rank() == 0) {
+    const file_t &file = fileset.files.at(fileset.first_ioproc);
+    // the file may have been closed after recovering an earlier level
+    hid_t indexfile = file.file;
+    if (indexfile < 0) {
+      H5E_BEGIN_TRY {
+        indexfile = H5Fopen(fileset.index_filename.c_str(), H5F_ACC_RDONLY,
+                            H5P_DEFAULT);
+      }
+      H5E_END_TRY;
+    }
+    hid_t dataset = -1;
+    if (indexfile >= 0) {
+      H5E_BEGIN_TRY {
+        dataset = H5Dopen(indexfile, METADATA_GROUP "/" CHECKPOINT_INDEX);
+      }
+      H5E_END_TRY;
+    }
+    if (dataset >= 0) {
+      found = 1;
+      // find the extent of the current level in the index
+      hsize_t offset = 0, length = 0;
+      hid_t attr;
+      H5E_BEGIN_TRY { attr = H5Aopen_name(dataset, "levels"); }
+      H5E_END_TRY;
+      if (attr >= 0) {
+        hid_t attrspace;
+        HDF5_ERROR(attrspace = H5Aget_space(attr));
+        vector<hsize_t> extents(H5Sget_simple_extent_npoints(attrspace));
+        HDF5_ERROR(H5Sclose(attrspace));
+        assert(extents.size() % 4 == 0);
+        if (not extents.empty()) {
+          HDF5_ERROR(H5Aread(attr, H5T_NATIVE_HSIZE, &extents.front()));
+        }
+        HDF5_ERROR(H5Aclose(attr));
+        for (size_t i = 0; i < extents.size(); i += 4) {
+          if (int(extents[i]) == mglevel and int(extents[i + 1]) == reflevel) {
+            offset = extents[i + 2];
+            length = extents[i + 3];
+          }
+        }
+      }
+      if (length > 0) {
+        hid_t filespace, memspace;
+        HDF5_ERROR(filespace = H5Dget_space(dataset));
+        HDF5_ERROR(H5Sselect_hyperslab(filespace, H5S_SELECT_SET, &offset,
+                                       NULL, &length, NULL));
+        HDF5_ERROR(memspace = H5Screate_simple(1, &length, NULL));
+        vector<char> index_buf(length);
+        HDF5_ERROR(H5Dread(dataset, H5T_NATIVE_CHAR, memspace, filespace,
+                           H5P_DEFAULT, &index_buf.front()));
+        HDF5_ERROR(H5Sclose(memspace));
+        HDF5_ERROR(H5Sclose(filespace));
+        index.assign(index_buf.begin(), index_buf.end());
+      }
+      HDF5_ERROR(H5Dclose(dataset));
+    }
+    if (indexfile >= 0 and indexfile != file.file) {
+      HDF5_ERROR(H5Fclose(indexfile));
+    }
   }
+  MPI_Bcast(&found, 1, MPI_INT, 0, dist::comm());
+  if (not found) {
+    return;
+  }
+  index = broadcast_string(dist::comm(), 0, index);
+
+  // parse the index, keeping only those patches which overlap with
+  // components of this process
+  fileset.global_index.resize(fileset.nioprocs);
+  int num_patches = 0, num_local_patches = 0;
+  int file_idx = -1;
+  istringstream buf(index);
+  string line;
+  while (getline(buf, line)) {
+    if (line.compare(0, 5, "file ") == 0) {
+      file_idx = atoi(line.c_str() + 5);
+      if (file_idx < 0 or file_idx >= fileset.nioprocs) {
+        CCTK_VWarn(1, __LINE__, __FILE__, CCTK_THORNSTRING,
+                   "Invalid file number %d in checkpoint index; ignoring the "
+                   "index",
+                   file_idx);
+        fileset.global_index.clear();
+        return;
+      }
+      continue;
+    }
 
-  return (0);
+    patch_t patch;
+    string varname;
+    ivect lower, upper, stride;
+    istringstream entry(line);
+    entry >> varname >> patch.mglevel >> patch.reflevel >> patch.timelevel >>
+        patch.timestep >> patch.rank;
+    for (int d = 0; d < dim; ++d)
+      entry >> lower[d];
+    for (int d = 0; d < dim; ++d)
+      entry >> upper[d];
+    for (int d = 0; d < dim; ++d)
+      entry >> stride[d];
+    entry.get();
+    getline(entry, patch.patchname);
+    if (file_idx < 0 or entry.fail() or patch.rank <= 0 or
+        patch.rank > dim or patch.patchname.empty() or
+        patch.mglevel != mglevel or patch.reflevel != reflevel) {
+      CCTK_WARN(1, "Invalid entry in checkpoint index; ignoring the index");
+      fileset.global_index.clear();
+      return;
+    }
+    ++num_patches;
+
+    string key(varname);
+    transform(key.begin(), key.end(), key.begin(), (int (*)(int))toupper);
+    std::map<string, unsigned int>::const_iterator const a = alias.find(key);
+    patch.vindex =
+        a != alias.end() ? int(a->second) : CCTK_VarIndex(varname.c_str());
+    if (patch.vindex < 0 or patch.vindex >= CCTK_NumVars()) {
+      CCTK_VWarn(3, __LINE__, __FILE__, CCTK_THORNSTRING,
+                 "Ignoring dataset '%s' (invalid variable name)",
+                 patch.patchname.c_str());
+      continue;
+    }
+
+    // convert the bbox to the attributes stored with the dataset
+    patch.ioffset = ((lower % stride) + stride) % stride;
+    patch.iorigin = (lower - patch.ioffset) / stride;
+    if (CCTK_GroupTypeFromVarI(patch.vindex) == CCTK_GF) {
+      patch.ioffsetdenom = stride;
+    } else {
+      patch.ioffset = ivect(0);
+      patch.ioffsetdenom = ivect(1);
+    }
+    ivect const shape = (upper - lower) / stride + 1;
+    patch.shape.resize(patch.rank);
+    for (int d = 0; d < patch.rank; ++d) {
+      patch.shape.at(patch.rank - 1 - d) = shape[d];
+    }
+    GetPatchMapAndComponent(patch, patch.patchname.c_str());
+
+    if (PatchOverlapsLocalComponents(patch)) {
+      fileset.global_index.at(file_idx).push_back(patch);
+      ++num_local_patches;
+    }
+  }
+
+  fileset.has_global_index = true;
+  if (not CCTK_Equals(verbose, "none")) {
+    CCTK_VInfo(CCTK_THORNSTRING,
+               "Using checkpoint index with %d datasets on level %d in %d "
+               "files (%d overlap with this process)",
+               num_patches, reflevel, fileset.nioprocs, num_local_patches);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Checks whether a patch overlaps with any of the components of this
+// process on the current mglevel and reflevel
+//////////////////////////////////////////////////////////////////////////////
+static bool PatchOverlapsLocalComponents(const patch_t &patch) {
+  const int gindex = CCTK_GroupIndexFromVarI(patch.vindex);
+  assert(gindex >= 0);
+  cGroup group;
+  CCTK_GroupData(gindex, &group);
+
+  // DISTRIB=CONSTANT arrays and scalars are read by all processes
+  if (group.disttype == CCTK_DISTRIB_CONSTANT) {
+    return true;
+  }
+  // grid arrays have a single map
+  const int m = group.grouptype == CCTK_GF ? patch.map : 0;
+  if (m < 0 or m >= int(arrdata.at(gindex).size())) {
+    return false;
+  }
+
+  // map patch into simulation grid, as in ReadVar
+  const struct arrdesc &data = arrdata.at(gindex).at(m);
+  const ivect stride = group.grouptype == CCTK_GF
+                           ? data.hh->baseextent(mglevel, reflevel).stride()
+                           : ivect(1);
+  ivect shape(1);
+  for (int i = 0; i < patch.rank; i++) {
+    shape[i] = patch.shape[patch.rank - i - 1];
+  }
+  const ivect lower =
+      patch.iorigin * stride + patch.ioffset * stride / patch.ioffsetdenom;
+  const ivect upper = lower + (shape - 1) * stride;
+  const ibbox filebox(lower, upper, stride);
+
+  for (int lc = 0; lc < data.hh->local_components(reflevel); ++lc) {
+    int const c = data.hh->get_component(reflevel, lc);
+    if (data.dd->light_boxes.at(mglevel).at(reflevel).at(c).exterior.intersects(
+            filebox)) {
+      return true;
+    }
+  }
+  return false;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 // Reads a single grid variable from a checkpoint/data file
 //////////////////////////////////////////////////////////////////////////////
-static int ReadVar(const cGH *const cctkGH, file_t &file, CCTK_REAL &io_bytes,
-                   list<patch_t>::const_iterator patch,
+static int ReadVar(const cGH *const cctkGH, file_t &file, CCTK_REAL &io_files,
+                   CCTK_REAL &io_bytes, list<patch_t>::const_iterator patch,
                    vector<ibset> &bboxes_read, bool in_recovery) {
   int error_count = 0;
   DECLARE_CCTK_PARAMETERS;
@@ -1498,6 +1795,7 @@ static int ReadVar(const cGH *const cctkGH, file_t &file, CCTK_REAL &io_bytes,
         HDF5_ERROR(H5Pset_fclose_degree(fapl_id, H5F_CLOSE_STRONG));
         HDF5_ERROR(file.file = H5Fopen(file.filename, H5F_ACC_RDONLY, fapl_id));
         HDF5_ERROR(H5Pclose(fapl_id));
+        io_files += 1;
         if (CCTK_Equals(verbose, "full")) {
           CCTK_VInfo(CCTK_THORNSTRING, "opening %s file '%s'",
                      in_recovery ? "checkpoint" : "input", file.filename);
@@ -13,6 +13,7 @@
 #include "operators.hh"
 #include "typeprops.hh"
 #include "mpi_string.hh"
+#include "quantize.hh"
 
 namespace CarpetIOHDF5 {
 
@@ -26,6 +27,14 @@ static int AddAttributes(const cGH *const cctkGH, const char *fullname,
                          const char *active, hid_t dataset,
                          bool is_index = false);
 
+// add an entry for a dataset to the global checkpoint index
+static void AddCheckpointIndexEntry(const cGH *const cctkGH,
+                                    const char *fullname, int vdim,
+                                    int refinementlevel,
+                                    const ioRequest *const request,
+                                    const ibbox &bbox,
+                                    const string &datasetname);
+
 int WriteVarUnchunked(const cGH *const cctkGH, hid_t outfile,
                       CCTK_REAL &io_bytes, const ioRequest *const request,
                       bool called_from_checkpoint) {
@@ -105,6 +114,21 @@ int WriteVarUnchunked(const cGH *const cctkGH, hid_t outfile,
       if (num_elems == 0)
         continue;
 
+      // round the data to the requested tolerances if they are
+      // compressed, so that they compress better (never for
+      // checkpoints)
+      const int compression_lvl = request->compression_level >= 0
+                                      ? request->compression_level
+                                      : compression_level;
+      const bool compress =
+          compression_lvl and num_elems * H5Tget_size(filedatatype) >
+                                  hsize_t(minimum_size_for_compression);
+      double abs_tol, rel_tol;
+      const bool round =
+          compress and not called_from_checkpoint and
+          OutputRoundingTolerances(request->vindex, group.vartype, abs_tol,
+                                   rel_tol);
+
       // create the dataset on the I/O processor
       // skip DISTRIB=CONSTANT components from processors other than 0
       hid_t memfile = -1, memdataset = -1;
@@ -147,11 +171,7 @@ int WriteVarUnchunked(const cGH *const cctkGH, hid_t outfile,
         // enable compression if requested
         hid_t plist_dataset;
         HDF5_ERROR(plist_dataset = H5Pcreate(H5P_DATASET_CREATE));
-        const int compression_lvl = request->compression_level >= 0
-                                        ? request->compression_level
-                                        : compression_level;
-        const hsize_t size = num_elems * H5Tget_size(filedatatype);
-        if (compression_lvl and size > hsize_t(minimum_size_for_compression)) {
+        if (compress) {
           HDF5_ERROR(H5Pset_chunk(plist_dataset, group.dim, shape));
           HDF5_ERROR(H5Pset_shuffle(plist_dataset));
           HDF5_ERROR(H5Pset_deflate(plist_dataset, compression_lvl));
@@ -245,6 +265,13 @@ int WriteVarUnchunked(const cGH *const cctkGH, hid_t outfile,
                          fullname, request->timelevel, bbox_id);
             }
           } else {
+            // the processor component is a temporary copy, which can
+            // be rounded in place
+            if (round) {
+              CarpetLib::quantize(group.vartype, processor_component->storage(),
+                                  overlap.size(), abs_tol, rel_tol);
+            }
+
             hsize_t overlapshape[dim];
 
             // before HDF5-1.6.4 the H5Sselect_hyperslab() function expected
@@ -499,12 +526,24 @@ int WriteVarChunkedSequential(const cGH *const cctkGH, hid_t outfile,
                                           ? request->compression_level
                                           : compression_level;
           const hsize_t size = num_elems * H5Tget_size(filedatatype);
-          if (compression_lvl and
-              size > hsize_t(minimum_size_for_compression)) {
+          const bool compress =
+              compression_lvl and size > hsize_t(minimum_size_for_compression);
+          if (compress) {
             HDF5_ERROR(H5Pset_chunk(plist, group.dim, shape));
             HDF5_ERROR(H5Pset_shuffle(plist));
             HDF5_ERROR(H5Pset_deflate(plist, compression_lvl));
           }
+          // round the data to the requested tolerances, so that they
+          // compress better (never for checkpoints); the processor
+          // component is a temporary copy, which can be rounded in
+          // place
+          double abs_tol, rel_tol;
+          if (compress and not called_from_checkpoint and
+              OutputRoundingTolerances(request->vindex, group.vartype,
+                                       abs_tol, rel_tol)) {
+            CarpetLib::quantize(group.vartype, processor_component->storage(),
+                                bbox.size(), abs_tol, rel_tol);
+          }
           // enable checksums if requested
           if (use_checksums) {
             HDF5_ERROR(H5Pset_chunk(plist, group.dim, shape));
@@ -532,6 +571,11 @@ int WriteVarChunkedSequential(const cGH *const cctkGH, hid_t outfile,
           error_count +=
               AddAttributes(cctkGH, fullname, group.dim, refinementlevel,
                             request, bbox, active.c_str(), dataset);
+          if (called_from_checkpoint and checkpoint_index) {
+            AddCheckpointIndexEntry(cctkGH, fullname, group.dim,
+                                    refinementlevel, request, bbox,
+                                    datasetname.str());
+          }
           HDF5_ERROR(H5Dclose(dataset));
 
           if (indexfile != -1) {
@@ -715,6 +759,44 @@ int WriteVarChunkedParallel(const cGH *const cctkGH, hid_t outfile,
         num_elems *= hyperslab_count[group.dim - 1 - d];
       }
 
+      // In an incremental checkpoint, link to the dataset in an earlier
+      // checkpoint file if the data have not changed since then
+      if (called_from_checkpoint and checkpoint_incremental) {
+        hsize_t num_padded_elems = 1;
+        for (int d = 0; d < group.dim; ++d)
+          num_padded_elems *= shape[d];
+        unsigned long long const hash = Carpet::DataChecksum(
+            data, num_padded_elems * H5Tget_size(memdatatype));
+        string target_filename, target_datasetname;
+        if (FindUnchangedDataset(
+                IncrementalCheckpointKey(datasetname.str(), bbox, active), hash,
+                datasetname.str(), target_filename, target_datasetname)) {
+          HDF5_ERROR(H5Lcreate_external(
+              target_filename.c_str(), target_datasetname.c_str(), outfile,
+              datasetname.str().c_str(), H5P_DEFAULT, H5P_DEFAULT));
+          if (indexfile != -1) {
+            hid_t dataspace, index_dataset;
+            HDF5_ERROR(dataspace = H5Screate_simple(group.dim, shape, NULL));
+            HDF5_ERROR(index_dataset =
+                           H5Dcreate(indexfile, datasetname.str().c_str(),
+                                     filedatatype, dataspace, H5P_DEFAULT));
+            HDF5_ERROR(H5Sclose(dataspace));
+            error_count += AddAttributes(cctkGH, fullname, group.dim,
+                                         refinementlevel, request, bbox,
+                                         active.c_str(), index_dataset, true);
+            HDF5_ERROR(H5Dclose(index_dataset));
+          }
+          if (checkpoint_index) {
+            AddCheckpointIndexEntry(cctkGH, fullname, group.dim,
+                                    refinementlevel, request, bbox,
+                                    datasetname.str());
+          }
+          if (data != mydata)
+            free(data);
+          continue;
+        }
+      }
+
       // Write the component as an individual dataset
       hid_t plist, dataspace, dataset, index_dataset = -1;
       HDF5_ERROR(plist = H5Pcreate(H5P_DATASET_CREATE));
@@ -723,11 +805,45 @@ int WriteVarChunkedParallel(const cGH *const cctkGH, hid_t outfile,
                                       ? request->compression_level
                                       : compression_level;
       const hsize_t size = num_elems * H5Tget_size(filedatatype);
-      if (compression_lvl and size > hsize_t(minimum_size_for_compression)) {
+      const bool compress =
+          compression_lvl and size > hsize_t(minimum_size_for_compression);
+      hsize_t chunk[dim];
+      const bool compress_in_threads =
+          compress and UseCompressionThreads(memdatatype, filedatatype);
+      if (compress_in_threads) {
+        CompressionChunkShape(group.dim, shape, H5Tget_size(memdatatype),
+                              chunk);
+        HDF5_ERROR(H5Pset_chunk(plist, group.dim, chunk));
+        HDF5_ERROR(H5Pset_shuffle(plist));
+        HDF5_ERROR(H5Pset_deflate(plist, compression_lvl));
+      } else if (compress) {
         HDF5_ERROR(H5Pset_chunk(plist, group.dim, shape));
         HDF5_ERROR(H5Pset_shuffle(plist));
         HDF5_ERROR(H5Pset_deflate(plist, compression_lvl));
       }
+      // round the data to the requested tolerances, so that they
+      // compress better (never for checkpoints)
+      double abs_tol = 0.0, rel_tol = 0.0;
+      const bool round =
+          compress and not called_from_checkpoint and
+          OutputRoundingTolerances(request->vindex, group.vartype, abs_tol,
+                                   rel_tol);
+      if (not round)
+        abs_tol = rel_tol = 0.0;
+      // the threaded compression rounds each chunk while compressing
+      // it; otherwise round a copy of the whole dataset
+      vector<char> rounded;
+      if (round and not compress_in_threads) {
+        hsize_t num_padded_elems = 1;
+        for (int d = 0; d < group.dim; ++d)
+          num_padded_elems *= shape[d];
+        const char *const begin = static_cast<const char *>(data);
+        rounded.assign(begin,
+                       begin + num_padded_elems * H5Tget_size(memdatatype));
+        CarpetLib::quantize(group.vartype, &rounded.front(), num_padded_elems,
+                            abs_tol, rel_tol);
+      }
+      const void *const outdata = rounded.empty() ? data : &rounded.front();
       // enable checksums if requested
       if (use_checksums) {
         HDF5_ERROR(H5Pset_chunk(plist, group.dim, shape));
@@ -749,10 +865,28 @@ int WriteVarChunkedParallel(const cGH *const cctkGH, hid_t outfile,
           H5Sget_simple_extent_npoints(dataspace) * H5Tget_size(filedatatype);
       HDF5_ERROR(H5Pclose(plist));
       HDF5_ERROR(H5Sclose(dataspace));
-      HDF5_ERROR(
-          H5Dwrite(dataset, memdatatype, H5S_ALL, H5S_ALL, H5P_DEFAULT, data));
+      if (compress_in_threads) {
+        error_count += WriteCompressedChunks(
+            dataset, group.dim, shape, chunk, H5Tget_size(memdatatype),
+            outdata, compression_lvl, group.vartype, abs_tol, rel_tol);
+      } else {
+        HDF5_ERROR(H5Dwrite(dataset, memdatatype, H5S_ALL, H5S_ALL,
+                            H5P_DEFAULT, outdata));
+      }
       error_count += AddAttributes(cctkGH, fullname, group.dim, refinementlevel,
                                    request, bbox, active.c_str(), dataset);
+      if (round) {
+        if (abs_tol > 0.0)
+          error_count += WriteAttribute(dataset, "lossy_absolute_tolerance",
+                                        abs_tol);
+        if (rel_tol > 0.0)
+          error_count += WriteAttribute(dataset, "lossy_relative_tolerance",
+                                        rel_tol);
+      }
+      if (called_from_checkpoint and checkpoint_index) {
+        AddCheckpointIndexEntry(cctkGH, fullname, group.dim, refinementlevel,
+                                request, bbox, datasetname.str());
+      }
       HDF5_ERROR(H5Dclose(dataset));
 
       if (indexfile != -1) {
@@ -957,4 +1091,28 @@ static int AddAttributes(const cGH *const cctkGH, const char *fullname,
   return error_count;
 }
 
+// add an entry for a dataset to the global checkpoint index
+//
+// Each entry is a line containing the variable name, mglevel,
+// reflevel, timelevel, iteration, rank, the bbox (lower, upper, and
+// stride), and finally the dataset name.
+static void AddCheckpointIndexEntry(const cGH *const cctkGH,
+                                    const char *fullname, int vdim,
+                                    int refinementlevel,
+                                    const ioRequest *const request,
+                                    const ibbox &bbox,
+                                    const string &datasetname) {
+  ostringstream buf;
+  buf << fullname << " " << mglevel << " " << refinementlevel << " "
+      << request->timelevel << " " << cctkGH->cctk_iteration << " " << vdim;
+  for (int d = 0; d < dim; ++d)
+    buf << " " << bbox.lower()[d];
+  for (int d = 0; d < dim; ++d)
+    buf << " " << bbox.upper()[d];
+  for (int d = 0; d < dim; ++d)
+    buf << " " << bbox.stride()[d];
+  buf << " " << datasetname << "\n";
+  checkpoint_index_entries += buf.str();
+}
+
 } // namespace CarpetIOHDF5
@@ -15,6 +15,7 @@
 
 #include <Timer.hh>
 
+#include "quantize.hh"
 #include "typeprops.hh"
 
 #include "CarpetIOHDF5.hh"
@@ -544,7 +545,7 @@ void IOHDF5<outdim>::OutputDirection(const cGH *const cctkGH, const int vindex,
     const dh *const dd = arrdata.at(group).at(m).dd;
 
     // get the active (non-buffered) region stored during regrid
-    const ibset &allactive = dd->level_boxes.AT(ml).AT(rl).active;
+    const ibset &allactive = dd->global_level_boxes(ml, rl).active;
 
     // Traverse all components on this multigrid level, refinement
     // level, and map
@@ -1385,7 +1386,9 @@ int IOHDF5<outdim>::WriteHDF5(const cGH *cctkGH, hid_t &file, hid_t &indexfile,
       slice_count[dim - 1 - d] = slice_upper[d] - slice_lower[d] + 1;
     }
     const hsize_t size = num_elems * H5Tget_size(slice_type);
-    if (compression_level and size > hsize_t(minimum_size_for_compression)) {
+    const bool compress =
+        compression_level and size > hsize_t(minimum_size_for_compression);
+    if (compress) {
       HDF5_ERROR(H5Pset_shuffle(plist));
       HDF5_ERROR(H5Pset_deflate(plist, compression_level));
     }
@@ -1440,7 +1443,7 @@ int IOHDF5<outdim>::WriteHDF5(const cGH *cctkGH, hid_t &file, hid_t &indexfile,
       }
       const ibbox outputslab(lo, up, str);
       // Intersect active region with this hyperslab
-      const ibset &active0 = vdd.at(m)->level_boxes.at(ml).at(rl).active;
+      const ibset &active0 = vdd.at(m)->global_level_boxes(ml, rl).active;
       const ibset active1 = active0 & outputslab;
       // Reduce dimensionality of active region
       bboxset<int, outdim> active2;
@@ -1508,8 +1511,37 @@ int IOHDF5<outdim>::WriteHDF5(const cGH *cctkGH, hid_t &file, hid_t &indexfile,
                                              slice_type, slice_space, plist));
       }
 
-      HDF5_ERROR(H5Dwrite(dataset, mem_type, mem_space, H5S_ALL, H5P_DEFAULT,
-                          gfdatas[n]->storage()));
+      // round the slice to the requested tolerances, so that it
+      // compresses better; the data may be the grid function itself, so
+      // that the slice has to be copied first
+      double abs_tol, rel_tol;
+      if (compress and OutputRoundingTolerances(vi + n, groupdata.vartype,
+                                                abs_tol, rel_tol)) {
+        const size_t elemsize = CCTK_VarTypeSize(groupdata.vartype);
+        const char *const src =
+            static_cast<const char *>(gfdatas[n]->storage());
+        vector<char> rounded(num_elems * elemsize);
+        char *dst = &rounded.front();
+        assert(dim == 3);
+        for (hsize_t k = 0; k < slice_count[0]; ++k) {
+          for (hsize_t j = 0; j < slice_count[1]; ++j) {
+            const hsize_t i0 = hsize_t(slice_start[0]) + k;
+            const hsize_t i1 = hsize_t(slice_start[1]) + j;
+            const hsize_t offset =
+                (i0 * mem_shape[1] + i1) * mem_shape[2] + slice_start[2];
+            memcpy(dst, src + offset * elemsize, slice_count[2] * elemsize);
+            dst += slice_count[2] * elemsize;
+          }
+        }
+        assert(dst == &rounded.front() + rounded.size());
+        CarpetLib::quantize(groupdata.vartype, &rounded.front(), num_elems,
+                            abs_tol, rel_tol);
+        HDF5_ERROR(H5Dwrite(dataset, mem_type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+                            &rounded.front()));
+      } else {
+        HDF5_ERROR(H5Dwrite(dataset, mem_type, mem_space, H5S_ALL,
+                            H5P_DEFAULT, gfdatas[n]->storage()));
+      }
       error_count += AddSliceAttributes(
           cctkGH, fullname, rl, ml, m, tl, origin, delta, iorigin, ioffset,
           ioffsetdenom, bbox, nghostzones, active, dataset, slice_shape, false);
@@ -1582,7 +1614,9 @@ int IOHDF5<outdim>::WriteHDF5(const cGH *cctkGH, hid_t &file, hid_t &indexfile,
     assert(offset == npoints);
 
     const hsize_t size = npoints * H5Tget_size(slice_type);
-    if (compression_level and size > hsize_t(minimum_size_for_compression)) {
+    const bool compress =
+        compression_level and size > hsize_t(minimum_size_for_compression);
+    if (compress) {
       HDF5_ERROR(H5Pset_shuffle(plist));
       HDF5_ERROR(H5Pset_deflate(plist, compression_level));
     }
@@ -1619,12 +1653,23 @@ int IOHDF5<outdim>::WriteHDF5(const cGH *cctkGH, hid_t &file, hid_t &indexfile,
         IOUtil_FreeIORequest(&request);
       }
 
+      // round the diagonal (which is a copy) to the requested
+      // tolerances, so that it compresses better
+      char *const diagonal = &buffer.front() +
+                             n * npoints * CCTK_VarTypeSize(groupdata.vartype);
+      double abs_tol, rel_tol;
+      if (compress and OutputRoundingTolerances(vi + n, groupdata.vartype,
+                                                abs_tol, rel_tol)) {
+        CarpetLib::quantize(groupdata.vartype, diagonal, npoints, abs_tol,
+                            rel_tol);
+      }
+
       // write the dataset
       hid_t dataset;
       HDF5_ERROR(dataset = H5Dcreate(file, datasetname.c_str(), slice_type,
                                      slice_space, plist));
       HDF5_ERROR(H5Dwrite(dataset, mem_type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                          &buffer.front() + n * npoints * gfdatas.size()));
+                          diagonal));
       HDF5_ERROR(H5Dclose(dataset));
 
       io_bytes +=
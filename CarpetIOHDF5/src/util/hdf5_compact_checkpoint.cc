@@ -0,0 +1,148 @@
+// Convert an incremental CarpetIOHDF5 checkpoint file into a full
+// checkpoint file. Incremental checkpoint files contain external links
+// to unchanged datasets in earlier checkpoint files; these datasets
+// are copied into the new file, so that the earlier checkpoint files
+// are not needed any more.
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <string>
+
+#define H5_USE_16_API 1
+#include <cctk_Config.h>
+
+#include <hdf5.h>
+
+using namespace std;
+
+// Check a return value
+#define check(_expr)                                                           \
+  do {                                                                         \
+    bool const _val = (_expr);                                                 \
+    assert(_val);                                                              \
+  } while (0)
+
+// A link in the root group of the input file
+struct link_t {
+  string name;
+  bool is_external;
+  string target_file, target_object;
+};
+
+static herr_t add_link(hid_t group, const char *name, H5L_info_t const *info,
+                       void *op_data);
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    cerr << "Usage: " << argv[0] << " <incremental checkpoint file> "
+         << "<output file>" << endl;
+    return 1;
+  }
+  string const input_file_name = argv[1];
+  string const output_file_name = argv[2];
+
+  // External links are relative to the directory of the input file
+  size_t const slash = input_file_name.rfind('/');
+  string const input_dir =
+      slash == string::npos ? "" : input_file_name.substr(0, slash + 1);
+
+  cout << "Opening input file \"" << input_file_name << "\"" << endl;
+  hid_t const input_file =
+      H5Fopen(input_file_name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  if (input_file < 0) {
+    cerr << "Could not open input file \"" << input_file_name << "\"" << endl;
+    return 1;
+  }
+
+  cout << "Creating output file \"" << output_file_name << "\"" << endl;
+  hid_t const output_file = H5Fcreate(output_file_name.c_str(), H5F_ACC_EXCL,
+                                      H5P_DEFAULT, H5P_DEFAULT);
+  if (output_file < 0) {
+    cerr << "Could not create output file \"" << output_file_name << "\""
+         << endl;
+    return 1;
+  }
+
+  list<link_t> links;
+  hsize_t idx = 0;
+  check(not H5Literate(input_file, H5_INDEX_NAME, H5_ITER_NATIVE, &idx,
+                       add_link, &links));
+
+  int num_copied = 0, num_resolved = 0;
+  for (list<link_t>::const_iterator ilink = links.begin();
+       ilink != links.end(); ++ilink) {
+    link_t const &link = *ilink;
+
+    if (not link.is_external) {
+      check(not H5Ocopy(input_file, link.name.c_str(), output_file,
+                        link.name.c_str(), H5P_DEFAULT, H5P_DEFAULT));
+      ++num_copied;
+      continue;
+    }
+
+    string const target_file_name = link.target_file[0] == '/'
+                                        ? link.target_file
+                                        : input_dir + link.target_file;
+    cout << "Resolving \"" << link.name << "\" from \"" << target_file_name
+         << "\"" << endl;
+    hid_t const target_file =
+        H5Fopen(target_file_name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (target_file < 0) {
+      cerr << "Could not open linked file \"" << target_file_name << "\""
+           << endl;
+      return 1;
+    }
+    check(not H5Ocopy(target_file, link.target_object.c_str(), output_file,
+                      link.name.c_str(), H5P_DEFAULT, H5P_DEFAULT));
+    check(not H5Fclose(target_file));
+
+    // The attributes of the copied dataset describe the checkpoint in
+    // which it was written; correct the iteration number
+    int iteration;
+    const char *const iteration_string = strstr(link.name.c_str(), " it=");
+    if (iteration_string and
+        sscanf(iteration_string, " it=%d", &iteration) == 1) {
+      hid_t const dataset = H5Dopen(output_file, link.name.c_str());
+      assert(dataset >= 0);
+      hid_t const attr = H5Aopen_name(dataset, "timestep");
+      if (attr >= 0) {
+        check(not H5Awrite(attr, H5T_NATIVE_INT, &iteration));
+        check(not H5Aclose(attr));
+      }
+      check(not H5Dclose(dataset));
+    }
+    ++num_resolved;
+  }
+
+  check(not H5Fclose(output_file));
+  check(not H5Fclose(input_file));
+
+  cout << "Copied " << num_copied << " objects, resolved " << num_resolved
+       << " external links" << endl;
+  cout << "Done." << endl;
+  return 0;
+}
+
+static herr_t add_link(hid_t const group, const char *const name,
+                       H5L_info_t const *const info, void *const op_data) {
+  list<link_t> &links = *static_cast<list<link_t> *>(op_data);
+  link_t link;
+  link.name = name;
+  link.is_external = info->type == H5L_TYPE_EXTERNAL;
+  if (link.is_external) {
+    char *const buf = static_cast<char *>(malloc(info->u.val_size));
+    check(not H5Lget_val(group, name, buf, info->u.val_size, H5P_DEFAULT));
+    const char *filename, *objname;
+    check(not H5Lunpack_elink_val(buf, info->u.val_size, NULL, &filename,
+                                  &objname));
+    link.target_file = filename;
+    link.target_object = objname;
+    free(buf);
+  }
+  links.push_back(link);
+  return 0;
+}
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <iomanip>
 #include <list>
+#include <map>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -55,12 +56,24 @@ static int TriggerOutput(const cGH *cctkGH, int vindex);
 // Internal functions
 static void CheckSteerableParameters(const cGH *const cctkGH,
                                      bool first_time = false);
+static const char *GetReductions(int vindex);
+static list<info> ParseReductions(const char *out_reductions, bool warn);
+static void PrefetchReductions(const cGH *cctkGH, vector<int> const &vindices);
+static void ReduceVariables(const cGH *cctkGH, const char *out_reductions,
+                            list<info> const &reductions, int firstvar,
+                            int numvars, int vartype, vector<char> &results);
 
 // Definition of static members
 vector<bool> do_truncate;
 vector<bool> reductions_changed;
 vector<int> last_output;
 
+// Results of the reductions for the variables that are output during
+// the current call to OutputGH, evaluated all at once. For each
+// variable, this holds the list of reductions and one value per
+// reduction.
+std::map<int, pair<string, vector<char> > > prefetched_results;
+
 /* CarpetScalar GH extension structure */
 static struct {
   /* list of variables to output */
@@ -134,15 +147,31 @@ void *SetupGH(tFleshConfig *const fc, int const convLevel, cGH *const cctkGH) {
 }
 
 int OutputGH(const cGH *const cctkGH) {
+  DECLARE_CCTK_PARAMETERS;
+
   static Timers::Timer timer("OutputGH");
   timer.start();
   CheckSteerableParameters(cctkGH);
   if (strcmp(IOparameters.out_vars, "")) {
+    // Find all variables that should be output
+    vector<int> vindices;
     for (int vindex = 0; vindex < CCTK_NumVars(); ++vindex) {
       if (TimeToOutput(cctkGH, vindex)) {
-        TriggerOutput(cctkGH, vindex);
+        vindices.push_back(vindex);
+        if (one_file_per_group) {
+          // The whole group is output at once
+          int const gindex = CCTK_GroupIndexFromVarI(vindex);
+          vindex = CCTK_FirstVarIndexI(gindex) + CCTK_NumVarsInGroupI(gindex) -
+                   1;
+        }
       }
     }
+    // Evaluate the reductions for all these variables at once
+    PrefetchReductions(cctkGH, vindices);
+    for (size_t i = 0; i < vindices.size(); ++i) {
+      TriggerOutput(cctkGH, vindices[i]);
+    }
+    prefetched_results.clear();
   }
   timer.stop();
   return 0;
@@ -219,32 +248,7 @@ int OutputVarAs(const cGH *const cctkGH, const char *const varname,
     }
 
     // Find the set of desired reductions
-    list<info> reductions;
-    string const redlist(out_reductions);
-    string::const_iterator p = redlist.begin();
-    while (p != redlist.end()) {
-      while (p != redlist.end() and isspace(*p))
-        ++p;
-      if (p == redlist.end())
-        break;
-      string::const_iterator const start = p;
-      while (p != redlist.end() and not isspace(*p))
-        ++p;
-      string::const_iterator const end = p;
-      string const reduction(start, end);
-      int const handle = CCTK_ReductionHandle(reduction.c_str());
-      if (handle < 0) {
-        CCTK_VWARN(CCTK_WARN_ALERT,
-                   "Reduction operator \"%s\" does not exist (maybe there is "
-                   "no reduction thorn active?)",
-                   reduction.c_str());
-      } else {
-        info i;
-        i.reduction = reduction;
-        i.handle = handle;
-        reductions.push_back(i);
-      }
-    }
+    list<info> const reductions = ParseReductions(out_reductions, true);
 
     // Output in global mode
     BEGIN_GLOBAL_MODE(cctkGH) {
@@ -257,6 +261,14 @@ int OutputVarAs(const cGH *const cctkGH, const char *const varname,
         Driver_RequireValidData(cctkGH, &n, &tl, 1, &where);
       }
 
+      // Evaluate all reductions for all variables at once
+      int const firstvar = one_file_per_group ? CCTK_FirstVarIndexI(group) : n;
+      int const numvars = one_file_per_group ? CCTK_NumVarsInGroupI(group) : 1;
+      int const vartypesize = CCTK_VarTypeSize(vartype);
+      vector<char> results(reductions.size() * numvars * vartypesize);
+      ReduceVariables(cctkGH, out_reductions, reductions, firstvar, numvars,
+                      vartype, results);
+
       // single fstreams object used for all output files.
       // This violates resource-allocation-is-initialization but is required
       // when outputting all reductions into a single file (in which case there
@@ -268,8 +280,9 @@ int OutputVarAs(const cGH *const cctkGH, const char *const varname,
         BeginTimingIO(cctkGH);
       }
 
+      int ired = 0;
       for (list<info>::const_iterator ireduction = reductions.begin();
-           ireduction != reductions.end(); ++ireduction) {
+           ireduction != reductions.end(); ++ireduction, ++ired) {
         string const reduction = ireduction->reduction;
 
         if (not all_reductions_in_one_file) {
@@ -426,28 +439,10 @@ int OutputVarAs(const cGH *const cctkGH, const char *const varname,
           }
         }
 
-        int const handle = ireduction->handle;
-
-        char resultbuf[100]; // assuming no type is larger
-        void *const result = &resultbuf;
-
-        int const firstvar =
-            one_file_per_group ? CCTK_FirstVarIndexI(group) : n;
-        int const numvars =
-            one_file_per_group ? CCTK_NumVarsInGroupI(group) : 1;
-
         for (int n = firstvar; n < firstvar + numvars; ++n) {
 
-          assert(CCTK_VarTypeSize(vartype) <= int(sizeof resultbuf));
-          int const ierr =
-              CCTK_Reduce(cctkGH, 0, handle, 1, vartype, result, 1, n);
-          if (ierr) {
-            char *const fullname = CCTK_FullName(n);
-            CCTK_VWARN(CCTK_WARN_ALERT,
-                       "Error during reduction for variable \"%s\"", fullname);
-            free(fullname);
-            memset(result, 0, sizeof resultbuf);
-          }
+          void const *const result =
+              &results[(ired * numvars + n - firstvar) * vartypesize];
 
           if (CCTK_MyProc(cctkGH) == 0) {
             buf << " ";
@@ -678,11 +673,7 @@ int TriggerOutput(const cGH *const cctkGH, int const vindex) {
 
   assert(vindex >= 0 and vindex < CCTK_NumVars());
 
-  // use individual reductions list for this variable when given
-  // otherwise IOScalar::outScalar_reductions
-  const char *out_reductions = IOparameters.requests[vindex]->reductions;
-  if (not out_reductions)
-    out_reductions = outScalar_reductions;
+  const char *const out_reductions = GetReductions(vindex);
 
   int retval;
 
@@ -719,6 +710,226 @@ int TriggerOutput(const cGH *const cctkGH, int const vindex) {
   return retval;
 }
 
+// Return the list of reductions for a variable
+const char *GetReductions(int const vindex) {
+  DECLARE_CCTK_PARAMETERS;
+
+  // use individual reductions list for this variable when given
+  // otherwise IOScalar::outScalar_reductions
+  const char *out_reductions = IOparameters.requests[vindex]->reductions;
+  if (not out_reductions)
+    out_reductions = outScalar_reductions;
+  return out_reductions;
+}
+
+// Find the set of desired reductions
+list<info> ParseReductions(const char *const out_reductions, bool const warn) {
+  list<info> reductions;
+  string const redlist(out_reductions);
+  string::const_iterator p = redlist.begin();
+  while (p != redlist.end()) {
+    while (p != redlist.end() and isspace(*p))
+      ++p;
+    if (p == redlist.end())
+      break;
+    string::const_iterator const start = p;
+    while (p != redlist.end() and not isspace(*p))
+      ++p;
+    string::const_iterator const end = p;
+    string const reduction(start, end);
+    int const handle = CCTK_ReductionHandle(reduction.c_str());
+    if (handle < 0) {
+      if (warn) {
+        CCTK_VWARN(CCTK_WARN_ALERT,
+                   "Reduction operator \"%s\" does not exist (maybe there is "
+                   "no reduction thorn active?)",
+                   reduction.c_str());
+      }
+    } else {
+      info i;
+      i.reduction = reduction;
+      i.handle = handle;
+      reductions.push_back(i);
+    }
+  }
+  return reductions;
+}
+
+// Evaluate the reductions for all variables that are output at the
+// same time. Variables with the same type, dimension, and list of
+// reductions are reduced together, reading each grid point only once
+// and combining the results across processes with as few collective
+// operations as possible.
+void PrefetchReductions(const cGH *const cctkGH, vector<int> const &vindices) {
+  DECLARE_CCTK_PARAMETERS;
+
+  prefetched_results.clear();
+  if (not CCTK_IsFunctionAliased("ReduceGVsMultiple"))
+    return;
+
+  struct batch_t {
+    string reductions;
+    int vartype, groupdim, is_gf;
+    vector<CCTK_INT> vars;
+  };
+  vector<batch_t> batches;
+  for (size_t i = 0; i < vindices.size(); ++i) {
+    int const vindex = vindices[i];
+    int const group = CCTK_GroupIndexFromVarI(vindex);
+    if (not CCTK_QueryGroupStorageI(cctkGH, group))
+      continue;
+    string const reductions = GetReductions(vindex);
+    int const vartype = CCTK_VarTypeI(vindex);
+    int const groupdim = CCTK_GroupDimI(group);
+    int const is_gf = CCTK_GroupTypeI(group) == CCTK_GF;
+    size_t b;
+    for (b = 0; b < batches.size(); ++b) {
+      if (batches[b].reductions == reductions and
+          batches[b].vartype == vartype and batches[b].groupdim == groupdim and
+          batches[b].is_gf == is_gf)
+        break;
+    }
+    if (b == batches.size()) {
+      batch_t batch;
+      batch.reductions = reductions;
+      batch.vartype = vartype;
+      batch.groupdim = groupdim;
+      batch.is_gf = is_gf;
+      batches.push_back(batch);
+    }
+    int const firstvar =
+        one_file_per_group ? CCTK_FirstVarIndexI(group) : vindex;
+    int const numvars = one_file_per_group ? CCTK_NumVarsInGroupI(group) : 1;
+    for (int n = firstvar; n < firstvar + numvars; ++n) {
+      batches[b].vars.push_back(n);
+    }
+  }
+
+  BEGIN_LEVEL_MODE(cctkGH) {
+    BEGIN_GLOBAL_MODE(cctkGH) {
+      for (size_t b = 0; b < batches.size(); ++b) {
+        batch_t const &batch = batches[b];
+        list<info> const reductions =
+            ParseReductions(batch.reductions.c_str(), false);
+        if (reductions.empty())
+          continue;
+
+        // Synchronize and apply BCs if needed
+        if (not CCTK_EQUALS(presync_mode, "off")) {
+          for (size_t i = 0; i < batch.vars.size(); ++i) {
+            int const n = batch.vars[i];
+            if (QueryDriverBCForVarI(cctkGH, n)) {
+              int const tl = 0;
+              int const where = CCTK_VALID_EVERYWHERE;
+              Driver_RequireValidData(cctkGH, &n, &tl, 1, &where);
+            }
+          }
+        }
+
+        vector<CCTK_INT> handles;
+        for (list<info>::const_iterator ireduction = reductions.begin();
+             ireduction != reductions.end(); ++ireduction) {
+          handles.push_back(ireduction->handle);
+        }
+        int const nreductions = handles.size();
+        int const numvars = batch.vars.size();
+        int const vartypesize = CCTK_VarTypeSize(batch.vartype);
+        vector<char> values(nreductions * numvars * vartypesize);
+        int const ierr = ReduceGVsMultiple(cctkGH, 0, nreductions, &handles[0],
+                                           batch.vartype, &values[0], numvars,
+                                           &batch.vars[0]);
+        // If this fails, OutputVarAs evaluates the reductions itself
+        if (ierr)
+          continue;
+
+        for (int i = 0; i < numvars; ++i) {
+          pair<string, vector<char> > &result =
+              prefetched_results[batch.vars[i]];
+          result.first = batch.reductions;
+          result.second.resize(nreductions * vartypesize);
+          for (int r = 0; r < nreductions; ++r) {
+            memcpy(&result.second[r * vartypesize],
+                   &values[(r * numvars + i) * vartypesize], vartypesize);
+          }
+        }
+      }
+    }
+    END_GLOBAL_MODE;
+  }
+  END_LEVEL_MODE;
+}
+
+// Evaluate all reductions for the variables firstvar ... firstvar +
+// numvars - 1, storing the results as results[reduction][variable]
+void ReduceVariables(const cGH *const cctkGH, const char *const out_reductions,
+                     list<info> const &reductions, int const firstvar,
+                     int const numvars, int const vartype,
+                     vector<char> &results) {
+  int const nreductions = reductions.size();
+  int const vartypesize = CCTK_VarTypeSize(vartype);
+  assert(int(results.size()) == nreductions * numvars * vartypesize);
+  if (nreductions == 0)
+    return;
+
+  // Use the results evaluated in OutputGH, if available
+  bool have_results = true;
+  for (int n = firstvar; n < firstvar + numvars; ++n) {
+    std::map<int, pair<string, vector<char> > >::const_iterator const it =
+        prefetched_results.find(n);
+    if (it == prefetched_results.end() or it->second.first != out_reductions) {
+      have_results = false;
+      break;
+    }
+  }
+  if (have_results) {
+    for (int n = firstvar; n < firstvar + numvars; ++n) {
+      vector<char> const &values = prefetched_results.at(n).second;
+      assert(int(values.size()) == nreductions * vartypesize);
+      for (int r = 0; r < nreductions; ++r) {
+        memcpy(&results[(r * numvars + n - firstvar) * vartypesize],
+               &values[r * vartypesize], vartypesize);
+      }
+    }
+    return;
+  }
+
+  // Evaluate all reductions at once, if the reduction thorn supports
+  // this
+  if (CCTK_IsFunctionAliased("ReduceGVsMultiple")) {
+    vector<CCTK_INT> handles, vars;
+    for (list<info>::const_iterator ireduction = reductions.begin();
+         ireduction != reductions.end(); ++ireduction) {
+      handles.push_back(ireduction->handle);
+    }
+    for (int n = firstvar; n < firstvar + numvars; ++n) {
+      vars.push_back(n);
+    }
+    int const ierr = ReduceGVsMultiple(cctkGH, 0, nreductions, &handles[0],
+                                       vartype, &results[0], numvars, &vars[0]);
+    if (not ierr)
+      return;
+  }
+
+  // Evaluate the reductions one by one
+  int ired = 0;
+  for (list<info>::const_iterator ireduction = reductions.begin();
+       ireduction != reductions.end(); ++ireduction, ++ired) {
+    for (int n = firstvar; n < firstvar + numvars; ++n) {
+      void *const result =
+          &results[(ired * numvars + n - firstvar) * vartypesize];
+      int const ierr = CCTK_Reduce(cctkGH, 0, ireduction->handle, 1, vartype,
+                                   result, 1, n);
+      if (ierr) {
+        char *const fullname = CCTK_FullName(n);
+        CCTK_VWARN(CCTK_WARN_ALERT,
+                   "Error during reduction for variable \"%s\"", fullname);
+        free(fullname);
+        memset(result, 0, vartypesize);
+      }
+    }
+  }
+}
+
 static void CheckSteerableParameters(const cGH *const cctkGH, bool first_time) {
   DECLARE_CCTK_PARAMETERS;
 
@@ -10,6 +10,7 @@
 #include <cstring>
 #include <iostream>
 #include <limits>
+#include <list>
 #include <map>
 #include <vector>
 
@@ -24,6 +25,7 @@
 #include "defs.hh"
 #include "dist.hh"
 #include "ggf.hh"
+#include "mem.hh"
 #include "timestat.hh"
 #include "typeprops.hh"
 #include "vect.hh"
@@ -59,11 +61,146 @@ static inline size_type component_idx_(int const p, int const m, int const rl,
   return global_idx;
 }
 
+// A persistent interpolation plan, describing everything which depends
+// only on the interpolation points and the grid structure: where the
+// points are interpolated, and how the points and the interpolated
+// values are communicated. Repeated interpolations at the same points
+// can re-use the plan, skipping point mapping and coordinate exchange.
+struct interp_plan_t {
+  // Identification
+  unsigned long long hash;
+  int regridding_epoch;
+  int coord_system_handle, coord_group;
+  int minrl, maxrl;
+  int N_dims;
+  bool have_source_map;
+  vector<CCTK_REAL> interp_coords; // [d * N_interp_points + n]
+  vector<CCTK_INT> interp_source_map;
+
+  // Communication
+  vector<int> sendcnt, recvcnt;
+  vector<int> senddispl, recvdispl;
+  vector<int> allhomecnts;     // number of sent points per component
+  vector<int> reverse_indices; // original position of the sent points
+
+  // Local interpolation
+  int N_points_local;
+  vector<int> homecnts; // number of received points per component
+  std::map<size_type, int> homecntsmap;
+  vector<CCTK_REAL> coords_buffer; // received coordinates
+};
+
+// Cached interpolation plans, most recently used first
+static list<interp_plan_t> plan_cache;
+static size_t plan_cache_bytes = 0; // memory accounted for the cache
+
+static size_t memoryof(interp_plan_t const &plan) {
+  using CarpetLib::memoryof;
+  return sizeof plan + memoryof(plan.interp_coords) +
+         memoryof(plan.interp_source_map) + memoryof(plan.sendcnt) +
+         memoryof(plan.recvcnt) + memoryof(plan.senddispl) +
+         memoryof(plan.recvdispl) + memoryof(plan.allhomecnts) +
+         memoryof(plan.reverse_indices) + memoryof(plan.homecnts) +
+         plan.homecntsmap.size() *
+             (sizeof(size_type) + sizeof(int) + 4 * sizeof(void *)) +
+         memoryof(plan.coords_buffer);
+}
+
+static unsigned long long hash_interp_plan(interp_plan_t const &plan) {
+  // FNV-1a, applied to 64-bit words
+  unsigned long long hash = 14695981039346656037ULL;
+  unsigned long long const prime = 1099511628211ULL;
+  long long const header[] = {plan.regridding_epoch,
+                              plan.coord_system_handle,
+                              plan.coord_group,
+                              plan.minrl,
+                              plan.maxrl,
+                              plan.N_dims,
+                              plan.have_source_map,
+                              (long long)plan.interp_source_map.size()};
+  for (size_t i = 0; i < sizeof header / sizeof *header; ++i)
+    hash = (hash ^ (unsigned long long)header[i]) * prime;
+  for (size_t i = 0; i < plan.interp_coords.size(); ++i) {
+    unsigned long long word = 0;
+    memcpy(&word, &plan.interp_coords[i],
+           min(sizeof word, sizeof plan.interp_coords[i]));
+    hash = (hash ^ word) * prime;
+  }
+  for (size_t i = 0; i < plan.interp_source_map.size(); ++i)
+    hash = (hash ^ (unsigned long long)plan.interp_source_map[i]) * prime;
+  return hash;
+}
+
+static bool same_interp_plan(interp_plan_t const &plan1,
+                             interp_plan_t const &plan2) {
+  return plan1.hash == plan2.hash and
+         plan1.regridding_epoch == plan2.regridding_epoch and
+         plan1.coord_system_handle == plan2.coord_system_handle and
+         plan1.coord_group == plan2.coord_group and
+         plan1.minrl == plan2.minrl and plan1.maxrl == plan2.maxrl and
+         plan1.N_dims == plan2.N_dims and
+         plan1.have_source_map == plan2.have_source_map and
+         plan1.interp_coords == plan2.interp_coords and
+         plan1.interp_source_map == plan2.interp_source_map;
+}
+
+// Look up a plan in the cache. This is collective: a plan is used
+// only if all processes find it, since using it skips communication.
+static interp_plan_t *find_interp_plan(interp_plan_t const &key) {
+  list<interp_plan_t>::iterator iplan = plan_cache.begin();
+  while (iplan != plan_cache.end() and not same_interp_plan(*iplan, key))
+    ++iplan;
+  int const found = iplan != plan_cache.end();
+  int all_found;
+  MPI_Allreduce(const_cast<int *>(&found), &all_found, 1, MPI_INT, MPI_MIN,
+                dist::comm());
+  if (not all_found)
+    return NULL;
+  // Move the plan to the front
+  plan_cache.splice(plan_cache.begin(), plan_cache, iplan);
+  return &plan_cache.front();
+}
+
+// Insert a plan into the cache, removing outdated plans
+static interp_plan_t *store_interp_plan(interp_plan_t &plan) {
+  DECLARE_CCTK_PARAMETERS;
+  for (list<interp_plan_t>::iterator iplan = plan_cache.begin();
+       iplan != plan_cache.end();) {
+    if (iplan->regridding_epoch != Carpet::regridding_epoch or
+        same_interp_plan(*iplan, plan)) {
+      iplan = plan_cache.erase(iplan);
+    } else {
+      ++iplan;
+    }
+  }
+  plan_cache.push_front(interp_plan_t());
+  swap(plan_cache.front(), plan);
+  while ((int)plan_cache.size() > max_persistent_plans)
+    plan_cache.pop_back();
+
+  size_t bytes = 0;
+  for (list<interp_plan_t>::const_iterator iplan = plan_cache.begin();
+       iplan != plan_cache.end(); ++iplan)
+    bytes += memoryof(*iplan);
+  gmem::account(gmem::sub_interp, double(bytes) - double(plan_cache_bytes));
+  plan_cache_bytes = bytes;
+
+  return &plan_cache.front();
+}
+
+static void make_interp_plan(
+    cGH const *const cctkGH, int const coord_system_handle,
+    int const coord_group, int const ml, int const minrl, int const maxrl,
+    int const maxncomps, int const N_dims, int const N_interp_points,
+    bool const have_source_map, vector<CCTK_INT> &source_map,
+    void const *const coords_list[], interp_plan_t &plan);
+
 static int extract_parameter_table_options(
     cGH const *const cctkGH, int const param_table_handle,
     int const N_interp_points, int const N_input_arrays,
     int const N_output_arrays, bool &want_global_mode, bool &have_source_map,
-    vector<int> &num_time_derivs, int &prolongation_order_time,
+    bool &want_persistent_plan, vector<int> &num_time_derivs,
+    int &prolongation_order_time,
     CCTK_REAL &current_time, CCTK_REAL &delta_time,
     vector<CCTK_INT> &source_map, vector<CCTK_INT> &operand_indices,
     vector<CCTK_INT> &time_deriv_order);
@@ -265,6 +402,7 @@ extern "C" CCTK_INT Carpet_DriverInterpolate(
   vector<CCTK_INT> operand_indices(N_output_arrays);
   vector<CCTK_INT> time_deriv_order(N_output_arrays);
   bool have_source_map;
+  bool want_persistent_plan;
   vector<int> num_time_derivs;
   CCTK_REAL current_time, delta_time;
   int prolongation_order_time;
@@ -272,9 +410,10 @@ extern "C" CCTK_INT Carpet_DriverInterpolate(
   {
     int const iret = extract_parameter_table_options(
         cctkGH, param_table_handle, N_interp_points, N_input_arrays,
-        N_output_arrays, want_global_mode, have_source_map, num_time_derivs,
-        prolongation_order_time, current_time, delta_time, source_map,
-        operand_indices, time_deriv_order);
+        N_output_arrays, want_global_mode, have_source_map,
+        want_persistent_plan, num_time_derivs, prolongation_order_time,
+        current_time, delta_time, source_map, operand_indices,
+        time_deriv_order);
     if (iret < 0) {
       timer_CDI->stop(0);
       return iret;
@@ -301,6 +440,197 @@ extern "C" CCTK_INT Carpet_DriverInterpolate(
     }
   }
 
+  //////////////////////////////////////////////////////////////////////
+  // Find or create the interpolation plan
+  //////////////////////////////////////////////////////////////////////
+  interp_plan_t newplan;
+  interp_plan_t *plan = NULL;
+  if (want_persistent_plan) {
+    // Identify the plan
+    newplan.regridding_epoch = Carpet::regridding_epoch;
+    newplan.coord_system_handle = coord_system_handle;
+    newplan.coord_group = coord_group;
+    newplan.minrl = minrl;
+    newplan.maxrl = maxrl;
+    newplan.N_dims = N_dims;
+    newplan.have_source_map = have_source_map;
+    newplan.interp_coords.resize(N_dims * N_interp_points);
+    for (int d = 0; d < N_dims; ++d) {
+      if (N_interp_points > 0) {
+        memcpy(&newplan.interp_coords.AT(d * N_interp_points), coords_list[d],
+               N_interp_points * sizeof(CCTK_REAL));
+      }
+    }
+    newplan.interp_source_map = source_map;
+    newplan.hash = hash_interp_plan(newplan);
+    plan = find_interp_plan(newplan);
+  }
+  if (not plan) {
+    make_interp_plan(cctkGH, coord_system_handle, coord_group, ml, minrl, maxrl,
+                     maxncomps, N_dims, N_interp_points, have_source_map,
+                     source_map, coords_list, newplan);
+    plan = want_persistent_plan ? store_interp_plan(newplan) : &newplan;
+  }
+
+  vector<int> &sendcnt = plan->sendcnt;
+  vector<int> &recvcnt = plan->recvcnt;
+  vector<int> &senddispl = plan->senddispl;
+  vector<int> &recvdispl = plan->recvdispl;
+  int const N_points_local = plan->N_points_local;
+  vector<int> const &allhomecnts = plan->allhomecnts;
+  vector<int> const &homecnts = plan->homecnts;
+  std::map<size_type, int> const &homecntsmap = plan->homecntsmap;
+  vector<CCTK_REAL> &coords_buffer = plan->coords_buffer;
+  vector<int> const &reverse_indices = plan->reverse_indices;
+
+  //////////////////////////////////////////////////////////////////////
+  // Do the local interpolation on individual components
+  //////////////////////////////////////////////////////////////////////
+  const int vtype = output_array_type_codes[0];
+  const int vtypesize = CCTK_VarTypeSize(vtype);
+  assert(vtypesize > 0);
+  vector<char> outputs_buffer(N_points_local * N_output_arrays * vtypesize);
+  vector<char *> outputs(homecnts.size(), &outputs_buffer.front());
+  vector<CCTK_REAL *> coords(homecnts.size(), &coords_buffer.front());
+  vector<CCTK_INT> status_and_retval_buffer(2 * dist::size(), 0);
+  CCTK_INT *per_proc_statuses = &status_and_retval_buffer.front();
+  CCTK_INT *per_proc_retvals = per_proc_statuses + dist::size();
+
+  // Set up the per-component coordinates and output arrays as offsets
+  // into the single communication buffers
+  {
+    int offset = 0;
+    for (size_t c = 0; c < homecnts.size(); c++) {
+      coords[c] += N_dims * offset;
+      outputs[c] += N_output_arrays * offset * vtypesize;
+      offset += homecnts[c];
+    }
+    assert(offset == N_points_local);
+  }
+
+  interpolate_components(
+      cctkGH, coord_system_handle, coord_group, minrl, maxrl, maxncomps,
+      want_global_mode, prolongation_order_time, N_dims, homecnts, homecntsmap,
+      recvcnt, coords, outputs, per_proc_statuses, per_proc_retvals,
+      operand_indices, time_deriv_order, num_time_derivs, local_interp_handle,
+      param_table_handle, current_time, delta_time, N_input_arrays,
+      N_output_arrays, output_array_type_codes, input_array_variable_indices);
+
+  // Free some memory
+  coords.clear();
+
+  //////////////////////////////////////////////////////////////////////
+  // Communicate interpolation results
+  //////////////////////////////////////////////////////////////////////
+
+  {
+    vector<char> tmp(N_interp_points * N_output_arrays * vtypesize);
+
+    MPI_Datatype datatype;
+    switch (specific_cactus_type(vtype)) {
+#define TYPECASE(N, T)                                                         \
+  case N: {                                                                    \
+    T dummy;                                                                   \
+    datatype = dist::mpi_datatype(dummy);                                      \
+    break;                                                                     \
+  }
+#include "typecase.hh"
+#undef TYPECASE
+    default:
+      CCTK_ERROR("invalid datatype");
+    }
+    if (datatype == MPI_DATATYPE_NULL)
+      CCTK_VError(__LINE__, __FILE__, CCTK_THORNSTRING,
+                  "MPI datatype for Cactus datatype %d is not defined", vtype);
+    MPI_Datatype vdatatype;
+    MPI_Type_vector(1, N_output_arrays, 0, datatype, &vdatatype);
+    MPI_Type_commit(&vdatatype);
+
+    static Timer *timer = NULL;
+    if (not timer) {
+      timer = new Timer("CarpetInterp::recv_points");
+    }
+    timer->start();
+    // distribute the results the same way as the coordinates were gathered
+    // simply by interchanging the send/recv counts/displacements
+    MPI_Alltoallv(&outputs_buffer[0], &recvcnt[0], &recvdispl[0], vdatatype,
+                  &tmp[0], &sendcnt[0], &senddispl[0], vdatatype, dist::comm());
+    timer->stop(N_interp_points * N_output_arrays * vtypesize);
+
+    MPI_Type_free(&vdatatype);
+
+    outputs_buffer.swap(tmp);
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // Communicate interpolation status codes and return values
+  //////////////////////////////////////////////////////////////////////
+  {
+    // A processor's overall status and return code
+    // is defined as the minimum over all local interpolator status and
+    // return codes across all processors for that processor
+    vector<CCTK_INT> tmp(status_and_retval_buffer.size());
+    { assert(status_and_retval_buffer.size() == tmp.size()); }
+    MPI_Allreduce(&status_and_retval_buffer[0], &tmp[0], tmp.size(),
+                  dist::mpi_datatype(tmp[0]), MPI_MIN, dist::comm());
+    status_and_retval_buffer.swap(tmp);
+    per_proc_statuses = &status_and_retval_buffer.front();
+    per_proc_retvals = per_proc_statuses + dist::size();
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // Finally, sort the received outputs back into the caller's arrays
+  //////////////////////////////////////////////////////////////////////
+
+  for (int d = 0; d < N_output_arrays; d++) {
+    char *output_array = static_cast<char *>(output_arrays[d]);
+    int offset = 0;
+    for (int c = 0, i = 0; c < (int)allhomecnts.size(); c++) {
+      assert((int)(allhomecnts.AT(c) * (d + 1) + offset) <=
+             N_output_arrays * N_interp_points);
+      assert(d >= 0);
+#pragma omp parallel for
+      for (int n = 0; n < allhomecnts.AT(c); n++) {
+        {
+          assert(reverse_indices.AT(i + n) >= 0 and
+                 reverse_indices.AT(i + n) < N_interp_points);
+          assert(allhomecnts.AT(c) >= 0);
+          assert(allhomecnts.AT(c) * d + offset + n <
+                 (int)outputs_buffer.size() / vtypesize);
+        }
+        memcpy(output_array + reverse_indices.AT(i + n) * vtypesize,
+               &outputs_buffer.front() +
+                   (allhomecnts.AT(c) * d + offset + n) * vtypesize,
+               vtypesize);
+      }
+      i += allhomecnts.AT(c);
+      offset += N_output_arrays * allhomecnts.AT(c);
+    }
+    assert(offset == N_output_arrays * N_interp_points);
+  }
+
+  // set this processor's overall local interpolator status code
+  int ierr =
+      Util_TableSetInt(param_table_handle, per_proc_statuses[dist::rank()],
+                       "local_interpolator_status");
+  assert(ierr >= 0);
+
+  // Done.
+  {
+    timer_CDI->stop(0);
+    int const iret = per_proc_retvals[dist::rank()];
+    return iret;
+  }
+}
+
+static void make_interp_plan(
+    cGH const *const cctkGH, int const coord_system_handle,
+    int const coord_group, int const ml, int const minrl, int const maxrl,
+    int const maxncomps, int const N_dims, int const N_interp_points,
+    bool const have_source_map, vector<CCTK_INT> &source_map,
+    void const *const coords_list[], interp_plan_t &plan) {
+  DECLARE_CCTK_PARAMETERS;
+
   //////////////////////////////////////////////////////////////////////
   // Map interpolation points to processors
   //////////////////////////////////////////////////////////////////////
@@ -560,153 +890,24 @@ extern "C" CCTK_INT Carpet_DriverInterpolate(
   }
 
   //////////////////////////////////////////////////////////////////////
-  // Do the local interpolation on individual components
-  //////////////////////////////////////////////////////////////////////
-  const int vtype = output_array_type_codes[0];
-  const int vtypesize = CCTK_VarTypeSize(vtype);
-  assert(vtypesize > 0);
-  vector<char> outputs_buffer(N_points_local * N_output_arrays * vtypesize);
-  vector<char *> outputs(homecnts.size(), &outputs_buffer.front());
-  vector<CCTK_REAL *> coords(homecnts.size(), &coords_buffer.front());
-  vector<CCTK_INT> status_and_retval_buffer(2 * dist::size(), 0);
-  CCTK_INT *per_proc_statuses = &status_and_retval_buffer.front();
-  CCTK_INT *per_proc_retvals = per_proc_statuses + dist::size();
-
-  // Set up the per-component coordinates and output arrays as offsets
-  // into the single communication buffers
-  {
-    int offset = 0;
-    for (size_t c = 0; c < homecnts.size(); c++) {
-      coords[c] += N_dims * offset;
-      outputs[c] += N_output_arrays * offset * vtypesize;
-      offset += homecnts[c];
-    }
-    assert(offset == N_points_local);
-  }
-
-  interpolate_components(
-      cctkGH, coord_system_handle, coord_group, minrl, maxrl, maxncomps,
-      want_global_mode, prolongation_order_time, N_dims, homecnts, homecntsmap,
-      recvcnt, coords, outputs, per_proc_statuses, per_proc_retvals,
-      operand_indices, time_deriv_order, num_time_derivs, local_interp_handle,
-      param_table_handle, current_time, delta_time, N_input_arrays,
-      N_output_arrays, output_array_type_codes, input_array_variable_indices);
-
-  // Free some memory
-  coords_buffer.clear();
-  coords.clear();
-  homecnts.clear();
-  home.clear();
-  rlev.clear();
-
-  //////////////////////////////////////////////////////////////////////
-  // Communicate interpolation results
-  //////////////////////////////////////////////////////////////////////
-
-  {
-    vector<char> tmp(N_interp_points * N_output_arrays * vtypesize);
-
-    MPI_Datatype datatype;
-    switch (specific_cactus_type(vtype)) {
-#define TYPECASE(N, T)                                                         \
-  case N: {                                                                    \
-    T dummy;                                                                   \
-    datatype = dist::mpi_datatype(dummy);                                      \
-    break;                                                                     \
-  }
-#include "typecase.hh"
-#undef TYPECASE
-    default:
-      CCTK_ERROR("invalid datatype");
-    }
-    if (datatype == MPI_DATATYPE_NULL)
-      CCTK_VError(__LINE__, __FILE__, CCTK_THORNSTRING,
-                  "MPI datatype for Cactus datatype %d is not defined", vtype);
-    MPI_Datatype vdatatype;
-    MPI_Type_vector(1, N_output_arrays, 0, datatype, &vdatatype);
-    MPI_Type_commit(&vdatatype);
-
-    static Timer *timer = NULL;
-    if (not timer) {
-      timer = new Timer("CarpetInterp::recv_points");
-    }
-    timer->start();
-    // distribute the results the same way as the coordinates were gathered
-    // simply by interchanging the send/recv counts/displacements
-    MPI_Alltoallv(&outputs_buffer[0], &recvcnt[0], &recvdispl[0], vdatatype,
-                  &tmp[0], &sendcnt[0], &senddispl[0], vdatatype, dist::comm());
-    timer->stop(N_interp_points * N_output_arrays * vtypesize);
-
-    MPI_Type_free(&vdatatype);
-
-    outputs_buffer.swap(tmp);
-  }
-
-  //////////////////////////////////////////////////////////////////////
-  // Communicate interpolation status codes and return values
-  //////////////////////////////////////////////////////////////////////
-  {
-    // A processor's overall status and return code
-    // is defined as the minimum over all local interpolator status and
-    // return codes across all processors for that processor
-    vector<CCTK_INT> tmp(status_and_retval_buffer.size());
-    { assert(status_and_retval_buffer.size() == tmp.size()); }
-    MPI_Allreduce(&status_and_retval_buffer[0], &tmp[0], tmp.size(),
-                  dist::mpi_datatype(tmp[0]), MPI_MIN, dist::comm());
-    status_and_retval_buffer.swap(tmp);
-    per_proc_statuses = &status_and_retval_buffer.front();
-    per_proc_retvals = per_proc_statuses + dist::size();
-  }
-
-  //////////////////////////////////////////////////////////////////////
-  // Finally, sort the received outputs back into the caller's arrays
+  // Store the plan
   //////////////////////////////////////////////////////////////////////
-
-  // Sorting is done with the help of the inverse indices vector
-  vector<int> reverse_indices(indices.size());
+  plan.sendcnt.swap(sendcnt);
+  plan.recvcnt.swap(recvcnt);
+  plan.senddispl.swap(senddispl);
+  plan.recvdispl.swap(recvdispl);
+  plan.N_points_local = N_points_local;
+  plan.allhomecnts.swap(allhomecnts);
+  plan.homecnts.swap(homecnts);
+  plan.homecntsmap.swap(homecntsmap);
+  plan.coords_buffer.swap(coords_buffer);
+
+  // Sorting the outputs back is done with the help of the inverse
+  // indices vector
+  plan.reverse_indices.resize(indices.size());
 #pragma omp parallel for
   for (int i = 0; i < (int)indices.size(); i++) {
-    reverse_indices[indices[i]] = i;
-  }
-
-  for (int d = 0; d < N_output_arrays; d++) {
-    char *output_array = static_cast<char *>(output_arrays[d]);
-    int offset = 0;
-    for (int c = 0, i = 0; c < (int)allhomecnts.size(); c++) {
-      assert((int)(allhomecnts.AT(c) * (d + 1) + offset) <=
-             N_output_arrays * N_interp_points);
-      assert(d >= 0);
-#pragma omp parallel for
-      for (int n = 0; n < allhomecnts.AT(c); n++) {
-        {
-          assert(reverse_indices.AT(i + n) >= 0 and
-                 reverse_indices.AT(i + n) < N_interp_points);
-          assert(allhomecnts.AT(c) >= 0);
-          assert(allhomecnts.AT(c) * d + offset + n <
-                 (int)outputs_buffer.size() / vtypesize);
-        }
-        memcpy(output_array + reverse_indices.AT(i + n) * vtypesize,
-               &outputs_buffer.front() +
-                   (allhomecnts.AT(c) * d + offset + n) * vtypesize,
-               vtypesize);
-      }
-      i += allhomecnts.AT(c);
-      offset += N_output_arrays * allhomecnts.AT(c);
-    }
-    assert(offset == N_output_arrays * N_interp_points);
-  }
-
-  // set this processor's overall local interpolator status code
-  int ierr =
-      Util_TableSetInt(param_table_handle, per_proc_statuses[dist::rank()],
-                       "local_interpolator_status");
-  assert(ierr >= 0);
-
-  // Done.
-  {
-    timer_CDI->stop(0);
-    int const iret = per_proc_retvals[dist::rank()];
-    return iret;
+    plan.reverse_indices[indices[i]] = i;
   }
 }
 
@@ -714,7 +915,8 @@ static int extract_parameter_table_options(
     cGH const *const cctkGH, int const param_table_handle,
     int const N_interp_points, int const N_input_arrays,
     int const N_output_arrays, bool &want_global_mode, bool &have_source_map,
-    vector<int> &num_time_derivs, int &prolongation_order_time,
+    bool &want_persistent_plan, vector<int> &num_time_derivs,
+    int &prolongation_order_time,
     CCTK_REAL &current_time, CCTK_REAL &delta_time,
     vector<CCTK_INT> &source_map, vector<CCTK_INT> &operand_indices,
     vector<CCTK_INT> &time_deriv_order) {
@@ -780,6 +982,19 @@ static int extract_parameter_table_options(
 #endif
   }
 
+  // Do we want to cache the interpolation plan?
+  CCTK_INT want_persistent_plan1;
+  iret = Util_TableGetInt(param_table_handle, &want_persistent_plan1,
+                          "persistent_plan");
+  if (iret == UTIL_ERROR_TABLE_NO_SUCH_KEY) {
+    want_persistent_plan = persistent_plans;
+  } else if (iret != 1) {
+    CCTK_WARN(CCTK_WARN_ALERT, "internal error");
+    return -1;
+  } else {
+    want_persistent_plan = want_persistent_plan1;
+  }
+
   // Find the time interpolation order
   int partype;
   void const *const parptr =
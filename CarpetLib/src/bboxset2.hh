@@ -101,6 +101,77 @@ using namespace std;
 
 namespace bboxset2 {
 
+// Storage for small sets: up to max_size disjoint boxes with a common
+// stride. The boxes are stored inline, so that small sets do not
+// allocate memory on the heap.
+template <typename T, int D, bool enabled> class small_bboxes {
+public:
+  static const int max_size = 16;
+
+private:
+  bool active_;
+  int size_;
+  vect<T, D> lower_[max_size], upper_[max_size];
+
+public:
+  small_bboxes() : active_(false), size_(0) {}
+  small_bboxes(const small_bboxes &other)
+      : active_(other.active_), size_(other.size_) {
+    for (int i = 0; i < size_; ++i) {
+      lower_[i] = other.lower_[i];
+      upper_[i] = other.upper_[i];
+    }
+  }
+  small_bboxes &operator=(const small_bboxes &other) {
+    active_ = other.active_;
+    size_ = other.size_;
+    for (int i = 0; i < size_; ++i) {
+      lower_[i] = other.lower_[i];
+      upper_[i] = other.upper_[i];
+    }
+    return *this;
+  }
+
+  bool active() const { return active_; }
+  void activate() {
+    active_ = true;
+    size_ = 0;
+  }
+  void deactivate() {
+    active_ = false;
+    size_ = 0;
+  }
+  int size() const { return size_; }
+  bool full() const { return size_ == max_size; }
+  bbox<T, D> box(const int i, const vect<T, D> &stride) const {
+    assert(i >= 0 and i < size_);
+    return bbox<T, D>(lower_[i], upper_[i], stride);
+  }
+  void push_back(const bbox<T, D> &b) {
+    assert(active_ and size_ < max_size);
+    lower_[size_] = b.lower();
+    upper_[size_] = b.upper();
+    ++size_;
+  }
+  size_t memory() const { return sizeof *this; }
+};
+
+template <typename T, int D> class small_bboxes<T, D, false> {
+public:
+  static const int max_size = 0;
+  bool active() const { return false; }
+  void activate() { assert(0); }
+  void deactivate() {}
+  int size() const { return 0; }
+  bool full() const { return true; }
+  bbox<T, D> box(const int i, const vect<T, D> &stride) const {
+    assert(0);
+    return bbox<T, D>();
+  }
+  void push_back(const bbox<T, D> &b) { assert(0); }
+  size_t memory() const { return sizeof *this; }
+};
+
 template <typename T, int D> class bboxset {
   template <typename, int> friend class bboxset;
   typedef CarpetLib::vect<T, D> vect;
@@ -131,6 +202,54 @@ template <typename T, int D> class bboxset {
 
   bool is_poison_;
 
+  // Small sets are stored as a list of disjoint boxes instead of as a
+  // tree, which avoids heap allocations for the sets with few boxes
+  // that are common in dh::regrid. Only sets with the full dimension
+  // use this representation; the lower-dimensional sets inside a tree
+  // are always trees. Operations fall back to the tree representation
+  // when a result has too many boxes, or when an operation has no
+  // small set implementation.
+  static const bool small_enabled = D == dim;
+  typedef small_bboxes<T, D, small_enabled> small_t;
+  small_t small;
+
+  bool is_small() const { return small.active(); }
+  // Whether the set can be treated as a small set
+  bool fits_small() const {
+    return small_enabled and
+           (small.active() or (subsets.empty() and not is_poison_));
+  }
+  bbox small_box(const int i) const { return small.box(i, stride); }
+
+  static bboxset tree_from_bbox(const bbox &b);
+  bboxset as_tree() const;
+  const bboxset &tree_ref(bboxset &tmp) const {
+    if (not is_small())
+      return *this;
+    tmp = as_tree();
+    return tmp;
+  }
+
+  // Serialise into some disjoint decomposition, which for small sets
+  // is not canonical
+  template <typename C> void any_serialise(C &out) const {
+    if (not is_small())
+      return serialise(out);
+    for (int i = 0; i < small.size(); ++i)
+      out.insert(out.end(), small_box(i));
+  }
+
+  void init_small_result(const bboxset &other, bboxset &res) const;
+  static bool small_subtract(const bbox &b0, const bbox &b1, small_t &res);
+  bool small_difference(const bboxset &other, bboxset &res) const;
+  bool small_intersection(const bboxset &other, bboxset &res) const;
+  bool small_concatenation(const bboxset &other, bboxset &res) const;
+
+  bboxset tree_xor(const bboxset &other) const;
+  bboxset tree_and(const bboxset &other) const;
+  bboxset tree_or(const bboxset &other) const;
+  bboxset tree_minus(const bboxset &other) const;
+
   template <typename F>
   void traverse_subsets(const F &f) const
   // void traverse_subsets(function<void(int, const bboxset1&)>& f) const
@@ -343,6 +462,25 @@ public:
   bool invariant() const {
     if (is_poison() and not empty())
       return false;
+    if (is_small()) {
+      if (not subsets.empty())
+        return false;
+      if (any(stride <= vect(0)))
+        return false;
+      if (any(offset < vect(0) or offset >= stride))
+        return false;
+      for (int i = 0; i < small.size(); ++i) {
+        const bbox b = small_box(i);
+        if (b.empty())
+          return false;
+        if (any(imod(b.lower(), stride) != offset))
+          return false;
+        for (int j = 0; j < i; ++j)
+          if (b.intersects(small_box(j)))
+            return false;
+      }
+      return true;
+    }
     if (any(stride <= vect(0)))
       return false;
     if (any(offset < vect(0) or offset >= stride))
@@ -400,6 +538,8 @@ public:
   /** Test for emptiness */
   bool empty() const {
     assert(not is_poison());
+    if (is_small())
+      return small.size() == 0;
     return subsets.empty();
   }
 
@@ -834,7 +974,8 @@ inline ostream &operator<<(ostream &os, const bboxset<T, D> &bs) {
 /** Copy constructor */
 template <typename T, int D>
 bboxset<T, D>::bboxset(const bboxset &other)
-    : stride(other.stride), offset(other.offset), is_poison_(other.is_poison_) {
+    : stride(other.stride), offset(other.offset), is_poison_(other.is_poison_),
+      small(other.small) {
   forall(const auto &pos_subset, other.subsets) {
     const T &pos = pos_subset.first;
     const auto new_subsetp = make_shared<bboxset1>(*pos_subset.second.get());
@@ -862,6 +1003,7 @@ bboxset<T, D> &bboxset<T, D>::operator=(const bboxset &other) {
   stride = other.stride;
   offset = other.offset;
   is_poison_ = other.is_poison_;
+  small = other.small;
   return *this;
 }
 
@@ -883,6 +1025,22 @@ bboxset<T, D>::bboxset(const bbox &b)
   assert(not b.is_poison());
   if (b.empty())
     return;
+  if (small_enabled) {
+    small.activate();
+    small.push_back(b);
+    return;
+  }
+  *this = tree_from_bbox(b);
+}
+
+/** Create tree from bbox */
+template <typename T, int D>
+bboxset<T, D> bboxset<T, D>::tree_from_bbox(const bbox &b) {
+  bboxset res;
+  res.stride = b.stride();
+  res.offset = imod(b.lower(), b.stride());
+  if (b.empty())
+    return res;
   const T lo = last(b.lower());
   const T hi = last(b.upper()) + last(b.stride());
   const bbox1 b1(init(b.lower()), init(b.upper()), init(b.stride()));
@@ -890,8 +1048,140 @@ bboxset<T, D>::bboxset(const bbox &b)
   const auto hi_subsetp = make_shared<bboxset1>(b1);
   // subsets.emplace_hint(subsets.end(), lo, lo_subsetp);
   // subsets.emplace_hint(subsets.end(), hi, hi_subsetp);
-  subsets.insert(subsets.end(), make_pair(lo, lo_subsetp));
-  subsets.insert(subsets.end(), make_pair(hi, hi_subsetp));
+  res.subsets.insert(res.subsets.end(), make_pair(lo, lo_subsetp));
+  res.subsets.insert(res.subsets.end(), make_pair(hi, hi_subsetp));
+  return res;
+}
+
+/** Convert a small set to a tree */
+template <typename T, int D> bboxset<T, D> bboxset<T, D>::as_tree() const {
+  if (not is_small())
+    return *this;
+  bboxset res;
+  res.stride = stride;
+  res.offset = offset;
+  for (int i = 0; i < small.size(); ++i) {
+    // The boxes are disjoint
+    res = res.tree_xor(tree_from_bbox(small_box(i)));
+  }
+  return res;
+}
+
+/** Stride and offset of the result of a binary operation */
+template <typename T, int D>
+void bboxset<T, D>::init_small_result(const bboxset &other,
+                                      bboxset &res) const {
+  assert(not is_poison() and not other.is_poison());
+  if (not empty() and not other.empty()) {
+    assert(all(stride == other.stride));
+    assert(all(offset == other.offset));
+  }
+  if (empty()) {
+    res.stride = other.stride;
+    res.offset = other.offset;
+  } else {
+    res.stride = stride;
+    res.offset = offset;
+  }
+  res.subsets.clear();
+  res.small.activate();
+}
+
+/** Append the difference of two boxes to a small set; returns false
+    if the result does not fit */
+template <typename T, int D>
+bool bboxset<T, D>::small_subtract(const bbox &b0, const bbox &b1,
+                                   small_t &res) {
+  if (not b0.intersects(b1)) {
+    if (res.full())
+      return false;
+    res.push_back(b0);
+    return true;
+  }
+  // Cut off slabs on both sides in each direction; what remains is
+  // the intersection
+  const vect str = b0.stride();
+  vect lo = b0.lower(), up = b0.upper();
+  for (int d = 0; d < D; ++d) {
+    if (lo[d] < b1.lower()[d]) {
+      vect slab_up = up;
+      slab_up[d] = b1.lower()[d] - str[d];
+      if (res.full())
+        return false;
+      res.push_back(bbox(lo, slab_up, str));
+      lo[d] = b1.lower()[d];
+    }
+    if (up[d] > b1.upper()[d]) {
+      vect slab_lo = lo;
+      slab_lo[d] = b1.upper()[d] + str[d];
+      if (res.full())
+        return false;
+      res.push_back(bbox(slab_lo, up, str));
+      up[d] = b1.upper()[d];
+    }
+  }
+  return true;
+}
+
+/** Set difference of small sets; returns false if the result does not
+    fit */
+template <typename T, int D>
+bool bboxset<T, D>::small_difference(const bboxset &other,
+                                     bboxset &res) const {
+  assert(fits_small() and other.fits_small());
+  init_small_result(other, res);
+  if (empty())
+    return true;
+  for (int i = 0; i < small.size(); ++i)
+    res.small.push_back(small_box(i));
+  for (int j = 0; j < other.small.size(); ++j) {
+    const bbox b1 = other.small_box(j);
+    small_t remainder;
+    remainder.activate();
+    for (int i = 0; i < res.small.size(); ++i) {
+      if (not small_subtract(res.small_box(i), b1, remainder))
+        return false;
+    }
+    res.small = remainder;
+  }
+  return true;
+}
+
+/** Set intersection of small sets; returns false if the result does
+    not fit */
+template <typename T, int D>
+bool bboxset<T, D>::small_intersection(const bboxset &other,
+                                       bboxset &res) const {
+  assert(fits_small() and other.fits_small());
+  init_small_result(other, res);
+  for (int i = 0; i < small.size(); ++i) {
+    const bbox b0 = small_box(i);
+    for (int j = 0; j < other.small.size(); ++j) {
+      const bbox b = b0 & other.small_box(j);
+      if (not b.empty()) {
+        if (res.small.full())
+          return false;
+        res.small.push_back(b);
+      }
+    }
+  }
+  return true;
+}
+
+/** Union of disjoint small sets; returns false if the result does not
+    fit */
+template <typename T, int D>
+bool bboxset<T, D>::small_concatenation(const bboxset &other,
+                                        bboxset &res) const {
+  assert(fits_small() and other.fits_small());
+  if (small.size() + other.small.size() > small_t::max_size)
+    return false;
+  init_small_result(other, res);
+  for (int i = 0; i < small.size(); ++i)
+    res.small.push_back(small_box(i));
+  for (int j = 0; j < other.small.size(); ++j)
+    res.small.push_back(other.small_box(j));
+  return true;
 }
 
 /** Create set from container of bboxes, bboxsets, or container
@@ -916,6 +1206,8 @@ bboxset<T, D>::bboxset(const C &elts, const B S::*const mptr) {
 template <typename T, int D> vect<T, D> bboxset<T, D>::front() const {
   assert(not is_poison());
   assert(not empty());
+  if (is_small())
+    return small_box(0).lower();
   const auto &pos_subset = *subsets.begin();
   const auto &pos = pos_subset.first;
   const auto &subset = *pos_subset.second.get();
@@ -926,6 +1218,8 @@ template <typename T, int D> vect<T, D> bboxset<T, D>::front() const {
 /** Number of characteristic points */
 template <typename T, int D> T bboxset<T, D>::chi_size() const {
   assert(not is_poison());
+  if (is_small())
+    return as_tree().chi_size();
   T sum = 0;
   forall(const auto &pos_subset, subsets) {
     sum += pos_subset.second->chi_size();
@@ -936,6 +1230,12 @@ template <typename T, int D> T bboxset<T, D>::chi_size() const {
 /** Number of elements */
 template <typename T, int D> size_type bboxset<T, D>::size() const {
   assert(not is_poison());
+  if (is_small()) {
+    size_type total_size = 0;
+    for (int i = 0; i < small.size(); ++i)
+      total_size += small_box(i).size();
+    return total_size;
+  }
   size_type total_size = 0;             // accumulated total number of points
   T old_pos = numeric_limits<T>::min(); // location of last subset
   size_t old_subset_size = 0;           // number of points in the last subset
@@ -969,6 +1269,12 @@ template <typename T, int D> bbox<T, D> bboxset<T, D>::container() const {
   assert(not is_poison());
   if (empty())
     return bbox();
+  if (is_small()) {
+    bbox res = small_box(0);
+    for (int i = 1; i < small.size(); ++i)
+      res = res.expanded_containing(small_box(i));
+    return res;
+  }
   const T lo = subsets.begin()->first;
   const T hi = subsets.rbegin()->first;
   bbox1 container1;
@@ -989,12 +1295,24 @@ template <typename T, int D> bbox<T, D> bboxset<T, D>::container() const {
 /** Test for equality */
 template <typename T, int D>
 bool bboxset<T, D>::operator==(const bboxset &other) const {
+  if (fits_small() and other.fits_small()) {
+    if (size() != other.size())
+      return false;
+    bboxset res;
+    if (small_difference(other, res))
+      return res.empty();
+  }
   return (*this ^ other).empty();
 }
 
 /** Test for is-subset-of */
 template <typename T, int D>
 bool bboxset<T, D>::operator<=(const bboxset &other) const {
+  if (fits_small() and other.fits_small()) {
+    bboxset res;
+    if (small_difference(other, res))
+      return res.empty();
+  }
   return (*this | other) == other;
 }
 
@@ -1006,7 +1324,7 @@ bool bboxset<T, D>::operator<(const bboxset &other) const {
 
 /** Symmetric set difference */
 template <typename T, int D>
-bboxset<T, D> bboxset<T, D>::operator^(const bboxset &other) const {
+bboxset<T, D> bboxset<T, D>::tree_xor(const bboxset &other) const {
 // TODO: If other is much smaller than this, direct insertion may
 // be faster
 #ifndef CARPET_AVOID_LAMBDA
@@ -1022,6 +1340,20 @@ bboxset<T, D> bboxset<T, D>::operator^(const bboxset &other) const {
 #endif
 }
 
+/** Symmetric set difference */
+template <typename T, int D>
+bboxset<T, D> bboxset<T, D>::operator^(const bboxset &other) const {
+  if (fits_small() and other.fits_small()) {
+    bboxset diff0, diff1, res;
+    if (small_difference(other, diff0) and
+        other.small_difference(*this, diff1) and
+        diff0.small_concatenation(diff1, res))
+      return res;
+  }
+  bboxset tmp0, tmp1;
+  return tree_ref(tmp0).tree_xor(other.tree_ref(tmp1));
+}
+
 /** Symmetric set difference */
 template <typename T, int D>
 bboxset<T, D> &bboxset<T, D>::operator^=(const bboxset &other) {
@@ -1031,7 +1363,7 @@ bboxset<T, D> &bboxset<T, D>::operator^=(const bboxset &other) {
 
 /** Set intersection */
 template <typename T, int D>
-bboxset<T, D> bboxset<T, D>::operator&(const bboxset &other) const {
+bboxset<T, D> bboxset<T, D>::tree_and(const bboxset &other) const {
 #ifndef CARPET_AVOID_LAMBDA
   return binary_operator(
       [](const bboxset1 &set0, const bboxset1 &set1) { return set0 & set1; },
@@ -1045,6 +1377,18 @@ bboxset<T, D> bboxset<T, D>::operator&(const bboxset &other) const {
 #endif
 }
 
+/** Set intersection */
+template <typename T, int D>
+bboxset<T, D> bboxset<T, D>::operator&(const bboxset &other) const {
+  if (fits_small() and other.fits_small()) {
+    bboxset res;
+    if (small_intersection(other, res))
+      return res;
+  }
+  bboxset tmp0, tmp1;
+  return tree_ref(tmp0).tree_and(other.tree_ref(tmp1));
+}
+
 /** Set intersection */
 template <typename T, int D>
 bboxset<T, D> &bboxset<T, D>::operator&=(const bboxset &other) {
@@ -1053,7 +1397,7 @@ bboxset<T, D> &bboxset<T, D>::operator&=(const bboxset &other) {
 
 /** Set Union */
 template <typename T, int D>
-bboxset<T, D> bboxset<T, D>::operator|(const bboxset &other) const {
+bboxset<T, D> bboxset<T, D>::tree_or(const bboxset &other) const {
 #ifndef CARPET_AVOID_LAMBDA
   return binary_operator(
       [](const bboxset1 &set0, const bboxset1 &set1) { return set0 | set1; },
@@ -1067,6 +1411,20 @@ bboxset<T, D> bboxset<T, D>::operator|(const bboxset &other) const {
 #endif
 }
 
+/** Set union */
+template <typename T, int D>
+bboxset<T, D> bboxset<T, D>::operator|(const bboxset &other) const {
+  if (fits_small() and other.fits_small()) {
+    // A | B = A + (B - A)
+    bboxset diff, res;
+    if (other.small_difference(*this, diff) and
+        small_concatenation(diff, res))
+      return res;
+  }
+  bboxset tmp0, tmp1;
+  return tree_ref(tmp0).tree_or(other.tree_ref(tmp1));
+}
+
 /** Set union */
 template <typename T, int D>
 bboxset<T, D> &bboxset<T, D>::operator|=(const bboxset &other) {
@@ -1082,6 +1440,11 @@ bboxset<T, D> bboxset<T, D>::operator+(const bboxset &other) const {
 #ifdef CARPET_DEBUG
   assert((*this & other).empty());
 #endif
+  if (fits_small() and other.fits_small()) {
+    bboxset res;
+    if (small_concatenation(other, res))
+      return res;
+  }
   // Since the sets are disjoint, their symmetric set union is
   // identical to their symmetric difference.
   return *this ^ other;
@@ -1095,7 +1458,7 @@ bboxset<T, D> &bboxset<T, D>::operator+=(const bboxset &other) {
 
 /** Set difference */
 template <typename T, int D>
-bboxset<T, D> bboxset<T, D>::operator-(const bboxset &other) const {
+bboxset<T, D> bboxset<T, D>::tree_minus(const bboxset &other) const {
 #ifndef CARPET_AVOID_LAMBDA
   return binary_operator(
       [](const bboxset1 &set0, const bboxset1 &set1) { return set0 - set1; },
@@ -1109,6 +1472,18 @@ bboxset<T, D> bboxset<T, D>::operator-(const bboxset &other) const {
 #endif
 }
 
+/** Set difference */
+template <typename T, int D>
+bboxset<T, D> bboxset<T, D>::operator-(const bboxset &other) const {
+  if (fits_small() and other.fits_small()) {
+    bboxset res;
+    if (small_difference(other, res))
+      return res;
+  }
+  bboxset tmp0, tmp1;
+  return tree_ref(tmp0).tree_minus(other.tree_ref(tmp1));
+}
+
 /** Set difference */
 template <typename T, int D>
 bboxset<T, D> &bboxset<T, D>::operator-=(const bboxset &other) {
@@ -1126,6 +1501,12 @@ bboxset<T, D> bboxset<T, D>::shift(const vect &dist,
   bboxset res;
   res.stride = stride;
   res.offset = imod(offset + dist * stride / dist_denom, res.stride);
+  if (is_small()) {
+    res.small.activate();
+    for (int i = 0; i < small.size(); ++i)
+      res.small.push_back(small_box(i).shift(dist, dist_denom));
+    return res;
+  }
   forall(const auto &pos_subset, subsets) {
     const T &pos = pos_subset.first;
     const bboxset1 &subset = *pos_subset.second.get();
@@ -1142,6 +1523,25 @@ template <typename T, int D>
 bboxset<T, D> bboxset<T, D>::expand(const vect &lo, const vect &hi) const {
   assert(not is_poison());
   assert(all(lo >= 0 and hi >= 0));
+  if (is_small()) {
+    // Expanding is distributive over the union
+    bboxset res;
+    res.stride = stride;
+    res.offset = offset;
+    res.small.activate();
+    bool fits = true;
+    for (int i = 0; i < small.size() and fits; ++i) {
+      const bboxset expanded(small_box(i).expand(lo, hi));
+      bboxset diff, sum;
+      fits = expanded.small_difference(res, diff) and
+             res.small_concatenation(diff, sum);
+      if (fits)
+        res = sum;
+    }
+    if (fits)
+      return res;
+    return as_tree().expand(lo, hi);
+  }
   bboxset res = shift(-lo);
   for (int d = 0; d < D; ++d) {
     T to_expand = (hi + lo)[d];
@@ -1176,7 +1576,7 @@ bboxset<T, D> bboxset<T, D>::expanded_for(const bbox &target) const {
   assert(not target.empty());
   assert(strides_are_compatible(stride, target.stride()));
   vector<bbox> bs;
-  serialise(bs);
+  any_serialise(bs);
   bboxset res;
   forall(const auto &b, bs) { res |= b.expanded_for(target); }
   return res;
@@ -1207,7 +1607,7 @@ bboxset<T, D> bboxset<T, D>::anti_contracted_for(const bbox &target) const {
   assert(not target.empty());
   assert(strides_are_compatible(stride, target.stride()));
   vector<bbox> bs;
-  serialise(bs);
+  any_serialise(bs);
   bboxset res;
   forall(const auto &b, bs) { res |= b.anti_contracted_for(target); }
   return res;
@@ -1218,6 +1618,18 @@ template <typename T, int D>
 template <typename C>
 void bboxset<T, D>::serialise(C &out) const {
   assert(not is_poison());
+  if (is_small()) {
+    // The boxes of a small set depend on the order of the operations
+    // that built it; serialise via the tree, which yields the canonical
+    // decomposition. A single box is already canonical.
+    if (small.size() <= 1) {
+      for (int i = 0; i < small.size(); ++i)
+        out.insert(out.end(), small_box(i));
+    } else {
+      as_tree().serialise(out);
+    }
+    return;
+  }
   typedef map<bbox1, T> subboxes_t;
   typedef set<bbox1> subboxes1_t;
   // TODO: Instead of copying from old_subboxes to subboxes,
@@ -1343,7 +1755,10 @@ void bboxset<T, D>::serialise(C &out) const {
 
 /** Memory usage */
 template <typename T, int D> size_t bboxset<T, D>::memory() const {
-  size_t s = sizeof *this;
+  // The inline buffer for small sets (about 400 bytes for D=3) is
+  // part of every set with the full dimension, whether it is in use
+  // or not
+  size_t s = sizeof *this - sizeof small + small.memory();
   forall(const auto &pos_subset, subsets) {
     s += sizeof pos_subset;
     const auto *const subsetp = pos_subset.second.get();
@@ -1395,6 +1810,8 @@ template <typename T, int D> istream &bboxset<T, D>::input(istream &is) {
 /** Output */
 template <typename T, int D>
 ostream &bboxset<T, D>::debug_output(ostream &os) const {
+  if (is_small())
+    return as_tree().debug_output(os);
   T Tdummy;
   os << "bboxset[debug]<" << typestring(Tdummy) << "," << D << ">("
      << "subsets:{";
@@ -1414,6 +1831,10 @@ ostream &bboxset<T, D>::debug_output(ostream &os) const {
 }
 
 template <typename T, int D> ostream &bboxset<T, D>::output(ostream &os) const {
+  if (is_small()) {
+    // Output the canonical decomposition of the tree
+    return as_tree().output(os);
+  }
   T Tdummy;
   os << "bboxset<" << typestring(Tdummy) << "," << D << ">";
   if (is_poison())
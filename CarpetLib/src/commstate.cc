@@ -15,6 +15,7 @@
 
 #include "commstate.hh"
 #include "timestat.hh"
+#include "tracing.hh"
 
 namespace CarpetLib {
 using namespace std;
@@ -39,7 +40,8 @@ char const *tostring(astate const &thestate) {
 
 comm_state::procbufdesc::procbufdesc()
     : sendbufsize(0), recvbufsize(0), sendbuf(NULL), recvbuf(NULL),
-      did_post_send(false), did_post_recv(false) {}
+      sendbufbegin(NULL), recvbufbegin(NULL), did_post_send(false),
+      did_post_recv(false) {}
 
 void comm_state::procbufdesc::reinitialize() {
   // Note: calling resize(0) instead of clear() ensures that the
@@ -51,6 +53,8 @@ void comm_state::procbufdesc::reinitialize() {
   recvbufsize = 0;
   sendbuf = NULL;
   recvbuf = NULL;
+  sendbufbegin = NULL;
+  recvbufbegin = NULL;
   did_post_send = false;
   did_post_recv = false;
 }
@@ -68,9 +72,12 @@ vector<MPI_Request> comm_state::rrequests;
 comm_state::comm_state() {
   DECLARE_CCTK_PARAMETERS;
 
+  tracing::begin("comm_state", tracing::cat_comm);
+
   static Timer timer("commstate::create");
   timer.start();
   thestate = state_get_buffer_sizes;
+  hierarchical = use_hierarchical();
 
   assert(not typebufs_busy);
   typebufs_busy = true;
@@ -99,6 +106,7 @@ void comm_state::step() {
   DECLARE_CCTK_PARAMETERS;
   static Timer total("commstate::step");
   total.start();
+  tracing::region const trace(tostring(thestate), tracing::cat_comm);
 
   if (barrier_between_stages) {
     // Add a barrier, ensuring e.g. that all Irecvs are posted before
@@ -160,8 +168,11 @@ void comm_state::step() {
     // The receive operations are also posted here already (a clever
     // MPI layer may take advantage of such early posting).
 
+    if (hierarchical)
+      hierarchical_setup();
+
     for (unsigned type = 0; type < dist::c_ndatatypes(); ++type) {
-      if (typebufs.AT(type).in_use) {
+      if (typebufs.AT(type).in_use and not hierarchical) {
 
         for (int proc1 = 0; proc1 < dist::size(); ++proc1) {
           int const proc = interleave_communications
@@ -187,8 +198,10 @@ void comm_state::step() {
                    procbuf.recvbufsize * datatypesize *
                        message_size_multiplier);
           }
-          procbuf.sendbuf = &procbuf.sendbufbase.front();
-          procbuf.recvbuf = &procbuf.recvbufbase.front();
+          procbuf.sendbufbegin = &procbuf.sendbufbase.front();
+          procbuf.recvbufbegin = &procbuf.recvbufbase.front();
+          procbuf.sendbuf = procbuf.sendbufbegin;
+          procbuf.recvbuf = procbuf.recvbufbegin;
 
           if (procbuf.recvbufsize > 0) {
             static Timer timer("commstate::sizes_irecv");
@@ -238,7 +251,9 @@ void comm_state::step() {
   }
 
   case state_fill_send_buffers: {
-    if (combine_sends) {
+    if (hierarchical) {
+      hierarchical_send();
+    } else if (combine_sends) {
       for (unsigned type = 0; type < dist::c_ndatatypes(); ++type) {
         if (typebufs.AT(type).in_use) {
 
@@ -254,7 +269,7 @@ void comm_state::step() {
               int const datatypesize = typebufs.AT(type).datatypesize;
 
               ptrdiff_t const fillstate =
-                  procbuf.sendbuf - &procbuf.sendbufbase.front();
+                  procbuf.sendbuf - procbuf.sendbufbegin;
               assert(fillstate == procbuf.sendbufsize * datatypesize);
 
               // Enlarge messages for performance testing
@@ -363,6 +378,9 @@ void comm_state::step() {
     }
     timer.stop(0);
 
+    if (hierarchical)
+      hierarchical_sync_recv();
+
     thestate = state_empty_recv_buffers;
     break;
   }
@@ -379,6 +397,9 @@ void comm_state::step() {
     }
     timer.stop(0);
 
+    if (hierarchical)
+      hierarchical_finish();
+
     // Transfer messages again for performance testing
     for (int n = 1; n < message_count_multiplier; ++n) {
 
@@ -541,6 +562,8 @@ comm_state::~comm_state() {
   typebufs_busy = false;
 
   assert(thestate == state_done or thestate == state_get_buffer_sizes);
+
+  tracing::end("comm_state", tracing::cat_comm);
 }
 
 void comm_state::reserve_send_space(unsigned const type, int const proc,
@@ -580,8 +603,7 @@ void *comm_state::send_buffer(unsigned const type, int const proc,
   procbufdesc const &procbuf = typebuf.procbufs.AT(proc);
 
   assert(procbuf.sendbuf + npoints * typebuf.datatypesize <=
-         &procbuf.sendbufbase.front() +
-             procbuf.sendbufsize * typebuf.datatypesize);
+         procbuf.sendbufbegin + procbuf.sendbufsize * typebuf.datatypesize);
 
   return procbuf.sendbuf;
 }
@@ -595,8 +617,7 @@ void *comm_state::recv_buffer(unsigned const type, int const proc,
   procbufdesc const &procbuf = typebuf.procbufs.AT(proc);
 
   assert(procbuf.recvbuf + npoints * typebuf.datatypesize <=
-         &procbuf.recvbufbase.front() +
-             procbuf.recvbufsize * typebuf.datatypesize);
+         procbuf.recvbufbegin + procbuf.recvbufsize * typebuf.datatypesize);
 
   return procbuf.recvbuf;
 }
@@ -612,14 +633,13 @@ void comm_state::commit_send_space(unsigned const type, int const proc,
   typebufdesc &typebuf = typebufs.AT(type);
   procbufdesc &procbuf = typebuf.procbufs.AT(proc);
   procbuf.sendbuf += npoints * typebuf.datatypesize;
-  assert(procbuf.sendbuf <= &procbuf.sendbufbase.front() +
-                                procbuf.sendbufsize * typebuf.datatypesize);
+  assert(procbuf.sendbuf <=
+         procbuf.sendbufbegin + procbuf.sendbufsize * typebuf.datatypesize);
 
   if (not combine_sends) {
     // post the send if the buffer is full
     if (procbuf.sendbuf ==
-        &procbuf.sendbufbase.front() +
-            procbuf.sendbufsize * typebuf.datatypesize) {
+        procbuf.sendbufbegin + procbuf.sendbufsize * typebuf.datatypesize) {
       if (message_size_multiplier > 1) {
         ptrdiff_t const nbytes = procbuf.sendbufsize * typebuf.datatypesize *
                                  (message_size_multiplier - 1);
@@ -666,8 +686,8 @@ void comm_state::commit_recv_space(unsigned const type, int const proc,
   typebufdesc &typebuf = typebufs.AT(type);
   procbufdesc &procbuf = typebuf.procbufs.AT(proc);
   procbuf.recvbuf += npoints * typebuf.datatypesize;
-  assert(procbuf.recvbuf <= &procbuf.recvbufbase.front() +
-                                procbuf.recvbufsize * typebuf.datatypesize);
+  assert(procbuf.recvbuf <=
+         procbuf.recvbufbegin + procbuf.recvbufsize * typebuf.datatypesize);
 }
 
 void comm_state::free_buffers() {
@@ -675,5 +695,7 @@ void comm_state::free_buffers() {
 
   // destroy all procbufs thereby freeing their memory
   typebufs.clear();
+
+  hierarchical_free();
 }
 }
@@ -15,6 +15,7 @@
 #endif
 
 #include "dist.hh"
+#include "mem.hh"
 #include "timestat.hh"
 
 namespace CarpetLib {
@@ -41,6 +42,10 @@ inline ostream &operator<<(ostream &os, astate const &thestate) {
 struct comm_state {
   astate thestate;
 
+  // Whether this comm state aggregates messages per node (see
+  // commstate_hierarchical.cc)
+  bool hierarchical;
+
   comm_state();
   void step();
   bool done() const;
@@ -54,8 +59,10 @@ private:
   // structure describing a per-process buffer
   struct procbufdesc {
     // allocated communication buffers
-    vector<char> sendbufbase;
-    vector<char> recvbufbase;
+    vector<char, counting_allocator<char, gmem::sub_commbuffers> >
+        sendbufbase;
+    vector<char, counting_allocator<char, gmem::sub_commbuffers> >
+        recvbufbase;
 
     // sizes of the communication buffers (in elements of type <datatype>)
     ptrdiff_t sendbufsize;
@@ -66,6 +73,11 @@ private:
     char *sendbuf;
     char *recvbuf;
 
+    // beginning of the communication buffers (these point into
+    // sendbufbase and recvbufbase, or into node-shared memory)
+    char *sendbufbegin;
+    char *recvbufbegin;
+
     bool did_post_send;
     bool did_post_recv;
 
@@ -106,6 +118,14 @@ private:
     return reqs.back();
   }
 
+  // hierarchical (node-aware) communication
+  static bool use_hierarchical();
+  void hierarchical_setup();
+  void hierarchical_send();
+  void hierarchical_sync_recv();
+  void hierarchical_finish();
+  static void hierarchical_free();
+
 public:
   void reserve_send_space(unsigned type, int proc, ptrdiff_t npoints);
 
@@ -0,0 +1,476 @@
+#include <cctk.h>
+#include <cctk_Parameters.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "defs.hh"
+#include "dist.hh"
+
+#include "commstate.hh"
+#include "timestat.hh"
+
+// Hierarchical (node-aware) communication
+//
+// Processes on the same node exchange data via MPI-3 shared memory.
+// Each process packs its send buffers directly into its segment of a
+// node-wide shared memory window, and the receiving process unpacks
+// directly from there, so that no MPI message is sent within a node.
+//
+// Data which are sent to another node are aggregated: the node's
+// leader (its lowest-ranked process) collects the data of all
+// processes on its node into a single message per destination node.
+// The destination node's leader receives this message into its
+// segment, from where the receiving processes unpack their data
+// directly. This reduces the number of inter-node messages from the
+// number of process pairs to the number of node pairs.
+//
+// Within a process's segment, the data for each peer process form a
+// contiguous chunk, which contains the data for all types in
+// ascending order, each aligned to a cache line. The leader's segment
+// begins with one receive area per source node, in which the chunks
+// are ordered by destination and then by source process. Aggregated
+// messages use the same order.
+
+namespace CarpetLib {
+using namespace std;
+
+#if defined CCTK_MPI && MPI_VERSION >= 3
+#define CARPETLIB_HIERARCHICAL_COMMUNICATION
+#endif
+
+#ifdef CARPETLIB_HIERARCHICAL_COMMUNICATION
+
+namespace {
+
+ptrdiff_t const alignment = 64;
+
+inline ptrdiff_t align(ptrdiff_t const nbytes) {
+  return (nbytes + alignment - 1) / alignment * alignment;
+}
+
+// The node-wide shared memory window
+MPI_Win win = MPI_WIN_NULL;
+// Size of this process's segment
+ptrdiff_t win_size = 0;
+// Segments of all processes on this node [node rank]
+vector<char *> node_bases;
+
+// A chunk of data sent to a process on another node; the offset is
+// relative to the sending process's segment
+struct chunk_t {
+  long long src, dst, offset, nbytes;
+};
+
+inline bool operator<(chunk_t const &a, chunk_t const &b) {
+  int const anode = dist::node_of(a.dst);
+  int const bnode = dist::node_of(b.dst);
+  if (anode != bnode)
+    return anode < bnode;
+  if (a.dst != b.dst)
+    return a.dst < b.dst;
+  return a.src < b.src;
+}
+
+// Chunks sent from this node (only on the leader)
+vector<chunk_t> node_chunks;
+// Buffers for aggregated messages (only on the leader) [node]
+typedef vector<char, counting_allocator<char, gmem::sub_commbuffers> >
+    stagebuf_t;
+vector<stagebuf_t> stagebufs;
+
+// Send or receive a byte buffer which may be larger than INT_MAX
+template <typename F>
+void chunked(char *const buf, ptrdiff_t const nbytes, F const &f) {
+  ptrdiff_t offset = 0;
+  while (offset < nbytes) {
+    ptrdiff_t const count =
+        std::min(ptrdiff_t(numeric_limits<int>::max()), nbytes - offset);
+    f(buf + offset, int(count));
+    offset += count;
+  }
+}
+
+} // namespace
+
+#endif
+
+bool comm_state::use_hierarchical() {
+  DECLARE_CCTK_PARAMETERS;
+
+  if (not hierarchical_communication)
+    return false;
+
+#ifdef CARPETLIB_HIERARCHICAL_COMMUNICATION
+  if (combine_sends and message_size_multiplier == 1 and
+      message_count_multiplier == 1)
+    return true;
+  static bool did_warn = false;
+  if (not did_warn) {
+    CCTK_WARN(CCTK_WARN_ALERT, "Hierarchical communication requires "
+                               "combine_sends, and cannot be used with "
+                               "message_size_multiplier or "
+                               "message_count_multiplier; using regular "
+                               "communication instead");
+    did_warn = true;
+  }
+#else
+  static bool did_warn = false;
+  if (not did_warn) {
+    CCTK_WARN(CCTK_WARN_ALERT, "Hierarchical communication requires MPI-3; "
+                               "using regular communication instead");
+    did_warn = true;
+  }
+#endif
+  return false;
+}
+
+// Allocate the buffers in node-shared memory, exchange their layout,
+// and post the receives for aggregated messages
+void comm_state::hierarchical_setup() {
+#ifdef CARPETLIB_HIERARCHICAL_COMMUNICATION
+  DECLARE_CCTK_PARAMETERS;
+
+  static Timer timer("commstate::hierarchical_setup");
+  timer.start();
+
+  int const nprocs = dist::size();
+  int const myproc = dist::rank();
+  int const nnodes = dist::num_nodes();
+  int const mynode = dist::node();
+  int const node_size = dist::node_size();
+  bool const is_leader = dist::node_rank() == 0;
+  MPI_Comm const node_comm = dist::node_comm();
+  vector<int> const &node_procs = dist::node_procs(mynode);
+
+  // Size of the chunk sent to or received from a process
+  auto const chunk_nbytes = [&](int const proc, bool const send) {
+    ptrdiff_t nbytes = 0;
+    for (unsigned type = 0; type < dist::c_ndatatypes(); ++type) {
+      typebufdesc const &typebuf = typebufs.AT(type);
+      if (typebuf.in_use) {
+        procbufdesc const &procbuf = typebuf.procbufs.AT(proc);
+        nbytes += align((send ? procbuf.sendbufsize : procbuf.recvbufsize) *
+                        typebuf.datatypesize);
+      }
+    }
+    return nbytes;
+  };
+
+  // Point the send or receive buffers for a process into a chunk
+  auto const set_buffers = [&](int const proc, bool const send,
+                               char *ptr) {
+    for (unsigned type = 0; type < dist::c_ndatatypes(); ++type) {
+      typebufdesc &typebuf = typebufs.AT(type);
+      if (typebuf.in_use) {
+        procbufdesc &procbuf = typebuf.procbufs.AT(proc);
+        if (send) {
+          procbuf.sendbufbegin = procbuf.sendbuf = ptr;
+          ptr += align(procbuf.sendbufsize * typebuf.datatypesize);
+        } else {
+          procbuf.recvbufbegin = procbuf.recvbuf = ptr;
+          ptr += align(procbuf.recvbufsize * typebuf.datatypesize);
+          procbuf.did_post_recv = procbuf.recvbufsize > 0;
+        }
+      }
+    }
+  };
+
+  // Layout of the send area: one chunk per receiving process
+  vector<ptrdiff_t> send_offsets(nprocs, -1);
+  vector<ptrdiff_t> send_nbytes(nprocs, 0);
+  ptrdiff_t send_area_size = 0;
+  for (int proc = 0; proc < nprocs; ++proc) {
+    if (proc != myproc) {
+      send_nbytes.AT(proc) = chunk_nbytes(proc, true);
+      if (send_nbytes.AT(proc) > 0) {
+        send_offsets.AT(proc) = send_area_size;
+        send_area_size += send_nbytes.AT(proc);
+      }
+    }
+  }
+
+  // Layout of the leader's receive areas: determine the offset of
+  // this process's data in the receive area for each source node
+  vector<long long> in_nbytes(nnodes, 0);
+  for (int proc = 0; proc < nprocs; ++proc) {
+    if (dist::node_of(proc) != mynode) {
+      in_nbytes.AT(dist::node_of(proc)) += chunk_nbytes(proc, false);
+    }
+  }
+  vector<long long> in_prefix(nnodes, 0), in_total(nnodes);
+  MPI_Exscan(&in_nbytes.front(), &in_prefix.front(), nnodes, MPI_LONG_LONG,
+             MPI_SUM, node_comm);
+  // The result of MPI_Exscan is undefined on the first process
+  if (is_leader)
+    fill(in_prefix.begin(), in_prefix.end(), 0);
+  MPI_Allreduce(&in_nbytes.front(), &in_total.front(), nnodes, MPI_LONG_LONG,
+                MPI_SUM, node_comm);
+  vector<ptrdiff_t> area_offsets(nnodes);
+  ptrdiff_t recv_area_size = 0;
+  for (int node = 0; node < nnodes; ++node) {
+    area_offsets.AT(node) = recv_area_size;
+    recv_area_size += in_total.AT(node);
+  }
+
+  ptrdiff_t const send_area_offset = is_leader ? recv_area_size : 0;
+  ptrdiff_t const segment_size = send_area_offset + send_area_size;
+
+  // Enlarge the window if necessary (this is collective on the node)
+  {
+    int const need_grow = win == MPI_WIN_NULL or segment_size > win_size;
+    int any_grow;
+    MPI_Allreduce(&need_grow, &any_grow, 1, MPI_INT, MPI_LOR, node_comm);
+    if (any_grow) {
+      static Timer timer("commstate::hierarchical_setup::allocate");
+      timer.start();
+      if (win != MPI_WIN_NULL) {
+        MPI_Win_unlock_all(win);
+        MPI_Win_free(&win);
+        gmem::account(gmem::sub_commbuffers, -double(win_size));
+      }
+      // Over-allocate a bit to avoid frequent re-allocations
+      if (need_grow)
+        win_size = align(segment_size + segment_size / 4);
+      MPI_Info info;
+      MPI_Info_create(&info);
+      MPI_Info_set(info, "alloc_shared_noncontig", "true");
+      char *base;
+      MPI_Win_allocate_shared(win_size, 1, info, node_comm, &base, &win);
+      gmem::account(gmem::sub_commbuffers, double(win_size));
+      MPI_Info_free(&info);
+      MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+      node_bases.resize(node_size);
+      for (int r = 0; r < node_size; ++r) {
+        MPI_Aint size;
+        int disp_unit;
+        MPI_Win_shared_query(win, r, &size, &disp_unit, &node_bases.AT(r));
+      }
+      assert(node_bases.AT(dist::node_rank()) == base);
+      timer.stop(win_size);
+    }
+  }
+  char *const mybase = node_bases.AT(dist::node_rank());
+
+  if (poison_new_memory) {
+    memset(mybase + send_area_offset, poison_value, send_area_size);
+  }
+
+  // Exchange the locations of the chunks sent within the node
+  vector<long long> offsets_to(node_size, -1), offsets_from(node_size);
+  for (int r = 0; r < node_size; ++r) {
+    int const proc = node_procs.AT(r);
+    if (send_offsets.AT(proc) >= 0) {
+      offsets_to.AT(r) = send_area_offset + send_offsets.AT(proc);
+    }
+  }
+  MPI_Alltoall(&offsets_to.front(), 1, MPI_LONG_LONG, &offsets_from.front(), 1,
+               MPI_LONG_LONG, node_comm);
+
+  // Collect the chunks sent to other nodes on the leader
+  {
+    vector<chunk_t> my_chunks;
+    for (int proc = 0; proc < nprocs; ++proc) {
+      if (dist::node_of(proc) != mynode and send_offsets.AT(proc) >= 0) {
+        chunk_t const chunk = {myproc, proc,
+                               send_area_offset + send_offsets.AT(proc),
+                               send_nbytes.AT(proc)};
+        my_chunks.push_back(chunk);
+      }
+    }
+    int const nvalues = 4 * my_chunks.size();
+    vector<int> counts(is_leader ? node_size : 0);
+    MPI_Gather(&nvalues, 1, MPI_INT, is_leader ? &counts.front() : NULL, 1,
+               MPI_INT, 0, node_comm);
+    vector<int> displs(counts.size());
+    int total = 0;
+    for (size_t r = 0; r < counts.size(); ++r) {
+      displs.AT(r) = total;
+      total += counts.AT(r);
+    }
+    node_chunks.resize(total / 4);
+    MPI_Gatherv(my_chunks.empty() ? NULL : &my_chunks.front(), nvalues,
+                MPI_LONG_LONG, node_chunks.empty() ? NULL : &node_chunks.front(),
+                is_leader ? &counts.front() : NULL,
+                is_leader ? &displs.front() : NULL, MPI_LONG_LONG, 0,
+                node_comm);
+    sort(node_chunks.begin(), node_chunks.end());
+  }
+
+  // Point the send buffers into this process's segment
+  for (int proc = 0; proc < nprocs; ++proc) {
+    if (send_offsets.AT(proc) >= 0) {
+      set_buffers(proc, true,
+                  mybase + send_area_offset + send_offsets.AT(proc));
+    }
+  }
+
+  // Point the receive buffers into the sending process's segment (on
+  // this node) or into the leader's receive areas (on other nodes)
+  vector<ptrdiff_t> area_fill(nnodes, 0);
+  for (int proc = 0; proc < nprocs; ++proc) {
+    if (proc == myproc)
+      continue;
+    ptrdiff_t const nbytes = chunk_nbytes(proc, false);
+    if (nbytes == 0)
+      continue;
+    int const node = dist::node_of(proc);
+    if (node == mynode) {
+      int const r = dist::node_rank_of(proc);
+      assert(offsets_from.AT(r) >= 0);
+      set_buffers(proc, false, node_bases.AT(r) + offsets_from.AT(r));
+    } else {
+      set_buffers(proc, false, node_bases.AT(0) + area_offsets.AT(node) +
+                                   in_prefix.AT(node) + area_fill.AT(node));
+      area_fill.AT(node) += nbytes;
+    }
+  }
+
+  // Post the receives for the aggregated messages
+  if (is_leader) {
+    int const tag = dist::c_ndatatypes();
+    for (int node = 0; node < nnodes; ++node) {
+      if (node != mynode and in_total.AT(node) > 0) {
+        int const leader = dist::node_procs(node).AT(0);
+        if (commstate_verbose) {
+          CCTK_VInfo(CCTK_THORNSTRING,
+                     "About to MPI_Irecv from node %d (process %d)", node,
+                     leader);
+        }
+        chunked(mybase + area_offsets.AT(node), in_total.AT(node),
+                [&](char *const buf, int const count) {
+                  MPI_Irecv(buf, count, MPI_BYTE, leader, tag, dist::comm(),
+                            &push_back(rrequests));
+                });
+      }
+    }
+  }
+
+  timer.stop(segment_size);
+#else
+  assert(0);
+#endif
+}
+
+// Make the send buffers visible on the node, and send the aggregated
+// messages to the other nodes
+void comm_state::hierarchical_send() {
+#ifdef CARPETLIB_HIERARCHICAL_COMMUNICATION
+  DECLARE_CCTK_PARAMETERS;
+
+  static Timer timer("commstate::hierarchical_send");
+  timer.start();
+
+  for (unsigned type = 0; type < dist::c_ndatatypes(); ++type) {
+    typebufdesc &typebuf = typebufs.AT(type);
+    if (typebuf.in_use) {
+      for (int proc = 0; proc < dist::size(); ++proc) {
+        procbufdesc &procbuf = typebuf.procbufs.AT(proc);
+        if (procbuf.sendbufsize > 0) {
+          ptrdiff_t const fillstate = procbuf.sendbuf - procbuf.sendbufbegin;
+          assert(fillstate == procbuf.sendbufsize * typebuf.datatypesize);
+          assert(not procbuf.did_post_send);
+          procbuf.did_post_send = true;
+        }
+      }
+    }
+  }
+
+  MPI_Win_sync(win);
+  MPI_Barrier(dist::node_comm());
+  MPI_Win_sync(win);
+
+  if (dist::node_rank() == 0) {
+    int const tag = dist::c_ndatatypes();
+    stagebufs.resize(dist::num_nodes());
+    ptrdiff_t total_nbytes = 0;
+    for (size_t c0 = 0; c0 < node_chunks.size();) {
+      int const node = dist::node_of(node_chunks.AT(c0).dst);
+      size_t c1 = c0;
+      ptrdiff_t nbytes = 0;
+      for (; c1 < node_chunks.size() and
+             dist::node_of(node_chunks.AT(c1).dst) == node;
+           ++c1) {
+        nbytes += node_chunks.AT(c1).nbytes;
+      }
+      // Note: calling resize(0) ensures that the vector capacity does
+      // not change
+      stagebuf_t &stagebuf = stagebufs.AT(node);
+      stagebuf.resize(0);
+      stagebuf.resize(nbytes);
+      ptrdiff_t offset = 0;
+      for (size_t c = c0; c < c1; ++c) {
+        chunk_t const &chunk = node_chunks.AT(c);
+        memcpy(&stagebuf.AT(offset),
+               node_bases.AT(dist::node_rank_of(chunk.src)) + chunk.offset,
+               chunk.nbytes);
+        offset += chunk.nbytes;
+      }
+      assert(offset == nbytes);
+      int const leader = dist::node_procs(node).AT(0);
+      if (commstate_verbose) {
+        CCTK_VInfo(CCTK_THORNSTRING,
+                   "About to MPI_Isend to node %d (process %d)", node, leader);
+      }
+      chunked(&stagebuf.front(), nbytes,
+              [&](char *const buf, int const count) {
+                MPI_Isend(buf, count, MPI_BYTE, leader, tag, dist::comm(),
+                          &push_back(srequests));
+              });
+      total_nbytes += nbytes;
+      c0 = c1;
+    }
+    timer.stop(total_nbytes);
+  } else {
+    timer.stop(0);
+  }
+#else
+  assert(0);
+#endif
+}
+
+// Make the aggregated messages visible on the node
+void comm_state::hierarchical_sync_recv() {
+#ifdef CARPETLIB_HIERARCHICAL_COMMUNICATION
+  static Timer timer("commstate::hierarchical_sync_recv");
+  timer.start();
+  MPI_Win_sync(win);
+  MPI_Barrier(dist::node_comm());
+  MPI_Win_sync(win);
+  timer.stop(0);
+#else
+  assert(0);
+#endif
+}
+
+// Wait until all processes on the node have emptied their receive
+// buffers, so that the segments can be re-used
+void comm_state::hierarchical_finish() {
+#ifdef CARPETLIB_HIERARCHICAL_COMMUNICATION
+  static Timer timer("commstate::hierarchical_finish");
+  timer.start();
+  MPI_Barrier(dist::node_comm());
+  node_chunks.clear();
+  timer.stop(0);
+#else
+  assert(0);
+#endif
+}
+
+void comm_state::hierarchical_free() {
+#ifdef CARPETLIB_HIERARCHICAL_COMMUNICATION
+  if (win != MPI_WIN_NULL) {
+    MPI_Win_unlock_all(win);
+    MPI_Win_free(&win);
+    gmem::account(gmem::sub_commbuffers, -double(win_size));
+    win_size = 0;
+    node_bases.clear();
+  }
+  stagebufs.clear();
+#endif
+}
+}
@@ -342,7 +342,7 @@ template size_t memoryof(set<th *> const &l);
 template size_t memoryof(stack<void *> const &s);
 template size_t memoryof(vector<bool> const &v);
 template size_t memoryof(vector<int> const &v);
-// template size_t memoryof (vector<CCTK_REAL> const & v);
+template size_t memoryof(vector<CCTK_REAL> const &v);
 template size_t memoryof(vector<dh *> const &v);
 template size_t memoryof(vector<gh *> const &v);
 template size_t memoryof(vector<bbox<int, 1> > const &v);
@@ -1,6 +1,7 @@
 #include <cctk.h>
 #include <cctk_Parameters.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <sstream>
@@ -121,6 +122,30 @@ int dh::prolongation_stencil_size(int const rl) const {
   return prolongation_orders_space.AT(rl) / 2;
 }
 
+dh::level_dboxes const &dh::global_level_boxes(int const ml,
+                                                int const rl) const {
+  DECLARE_CCTK_PARAMETERS;
+
+  if (not distributed_grid_metadata)
+    return level_boxes.AT(ml).AT(rl);
+  return global_level_boxes_.AT(ml).AT(rl);
+}
+
+// Calculate the level description of the whole level from the light
+// boxes, which contain the owned regions of all components (see
+// dh::regrid)
+void dh::calc_global_level_boxes(int const ml, int const rl) {
+  i2vect const &buffer_width = buffer_widths.AT(rl);
+  i2vect const &overlap_width = overlap_widths.AT(rl);
+  ibbox const domain_active = h.baseextent(ml, rl).expand(-h.boundary_width);
+  ibset const allowned(light_boxes.AT(ml).AT(rl), &light_dboxes::owned);
+  ibset const notowned = domain_active - allowned;
+  ibset const notactive = notowned.expand(buffer_width + overlap_width);
+  level_dboxes &level = global_level_boxes_.AT(ml).AT(rl);
+  level.buffers = allowned & notowned.expand(buffer_width);
+  level.active = allowned - notactive;
+}
+
 // Modifiers
 
 // Calculate this quantity on this process? It does not need to be
@@ -208,6 +233,121 @@ static void assert_error(char const *restrict const checkstring,
 
 #endif
 
+// Number of additional fine points that refinement restriction
+// requires on each side
+static int restriction_shrink_width(centering const refcent) {
+  DECLARE_CCTK_PARAMETERS;
+  if (use_higher_order_restriction and refcent == cell_centered)
+    return restriction_order_space / 2;
+  else if (support_staggered_operators)
+    return 2; // RH: not sure why 2 is required
+  else
+    return 0;
+}
+
+// Find the components of refinement level rl whose full grid
+// structure is required on this process. These are the local
+// components, and all components which are close enough to a local
+// component (on this or a neighbouring refinement level) to exchange
+// data with it. Without distributed grid metadata, these are all
+// components.
+void dh::find_neighbour_components(int const ml, int const rl,
+                                   vector<int> &neighbours) const {
+  DECLARE_CCTK_PARAMETERS;
+
+  neighbours.clear();
+
+  if (not distributed_grid_metadata) {
+    neighbours.resize(h.components(rl));
+    for (int c = 0; c < h.components(rl); ++c) {
+      neighbours.AT(c) = c;
+    }
+    return;
+  }
+
+  ibbox const &domain = h.baseextent(ml, rl);
+  // The neighbouring refinement levels
+  int const minrl = std::max(0, rl - 1);
+  int const maxrl = std::min(h.reflevels(), rl + 2);
+
+  // The distance (in grid points of this level) over which
+  // components interact: ghost, buffer, and overlap zones,
+  // prolongation stencils, and restriction. This distance is doubled,
+  // since the buffer zones and the active region of a neighbour
+  // depend on the neighbour's own neighbours.
+  int width = 0;
+  for (int orl = minrl; orl < maxrl; ++orl) {
+    int const owidth =
+        maxval(maxval(ghost_widths.AT(orl) + buffer_widths.AT(orl) +
+                      overlap_widths.AT(orl))) +
+        prolongation_stencil_size(orl) + restriction_shrink_width(h.refcent) +
+        1;
+    int const scale =
+        orl < rl ? maxval(h.reffacts.AT(rl) / h.reffacts.AT(orl)) : 1;
+    width = std::max(width, owidth * scale);
+  }
+  ivect const margin(2 * width);
+
+  // The regions of interest on this level: the local components on
+  // this and on the neighbouring levels
+  vector<ibbox> interest;
+  for (int orl = minrl; orl < maxrl; ++orl) {
+    for (int lc = 0; lc < h.local_components(orl); ++lc) {
+      ibbox const &ext = h.extent(ml, orl, h.get_component(orl, lc));
+      if (ext.empty())
+        continue;
+      ibbox const box = orl < rl ? ext.expanded_for(domain)
+                                 : orl > rl ? ext.contracted_for(domain) : ext;
+      interest.push_back(box.expand(margin, margin));
+    }
+  }
+
+  // Query the process decomposition trees of the superregions. The
+  // trees live in the index space of multigrid level 0.
+  bool have_trees = not h.superregions.AT(rl).empty();
+  for (size_t r = 0; r < h.superregions.AT(rl).size(); ++r) {
+    have_trees = have_trees and h.superregions.AT(rl).AT(r).processors;
+  }
+  ibbox const &domain0 = h.baseextent(0, rl);
+  for (size_t i = 0; i < interest.size(); ++i) {
+    ibbox const &box = interest.AT(i);
+    if (have_trees) {
+      ibbox const box0 = ml == 0 ? box : box.expanded_for(domain0);
+      vector<pseudoregion_t const *> pregs;
+      for (size_t r = 0; r < h.superregions.AT(rl).size(); ++r) {
+        region_t const &reg = h.superregions.AT(rl).AT(r);
+        if (reg.extent.intersects(box0)) {
+          reg.processors->search(box0.lower(), box0.upper(), pregs);
+        }
+      }
+      for (size_t p = 0; p < pregs.size(); ++p) {
+        int const c = pregs.AT(p)->component;
+        if (h.extent(ml, rl, c).intersects(box)) {
+          neighbours.push_back(c);
+        }
+      }
+    } else {
+      // There are no trees; search all components
+      for (int c = 0; c < h.components(rl); ++c) {
+        if (h.extent(ml, rl, c).intersects(box)) {
+          neighbours.push_back(c);
+        }
+      }
+    }
+  }
+
+  // The local components are always needed, even if they are empty
+  for (int lc = 0; lc < h.local_components(rl); ++lc) {
+    neighbours.push_back(h.get_component(rl, lc));
+  }
+
+  // Keep the components in order, so that the communication schedule
+  // is the same as without distributed grid metadata
+  sort(neighbours.begin(), neighbours.end());
+  neighbours.erase(unique(neighbours.begin(), neighbours.end()),
+                   neighbours.end());
+}
+
 void dh::regrid(bool const do_init) {
   DECLARE_CCTK_PARAMETERS;
 
@@ -232,16 +372,24 @@ void dh::regrid(bool const do_init) {
   level_boxes.resize(h.mglevels());
   full_boxes.resize(h.mglevels());
   fast_boxes.resize(h.mglevels());
+  global_level_boxes_.clear();
+  global_level_boxes_.resize(h.mglevels());
   for (int ml = 0; ml < h.mglevels(); ++ml) {
     light_boxes.AT(ml).resize(h.reflevels());
     local_boxes.AT(ml).resize(h.reflevels());
     level_boxes.AT(ml).resize(h.reflevels());
     full_boxes.AT(ml).resize(h.reflevels());
     fast_boxes.AT(ml).resize(h.reflevels());
+    global_level_boxes_.AT(ml).resize(h.reflevels());
+
+    // Components for which the full boxes are calculated [rl][i]
+    vector<vector<int> > neighbours(h.reflevels());
+
     for (int rl = 0; rl < h.reflevels(); ++rl) {
       light_boxes.AT(ml).AT(rl).resize(h.components(rl));
       local_boxes.AT(ml).AT(rl).resize(h.local_components(rl));
-      full_boxes.AT(ml).AT(rl).resize(h.components(rl));
+      find_neighbour_components(ml, rl, neighbours.AT(rl));
+      full_boxes.AT(ml).AT(rl).init(neighbours.AT(rl));
 
       light_cboxes &light_level = light_boxes.AT(ml).AT(rl);
       local_cboxes &local_level = local_boxes.AT(ml).AT(rl);
@@ -288,7 +436,7 @@ void dh::regrid(bool const do_init) {
       static Timers::Timer timer_region("region");
       timer_region.start();
 
-      for (int c = 0; c < h.components(rl); ++c) {
+      for (int const c : neighbours.AT(rl)) {
 
         full_dboxes &box = full_level.AT(c);
 
@@ -447,7 +595,9 @@ void dh::regrid(bool const do_init) {
 
 // All owned regions must be disjunct
 #ifdef CARPET_DEBUG
-        for (int cc = 0; cc < c; ++cc) {
+        for (int const cc : neighbours.AT(rl)) {
+          if (cc >= c)
+            break;
           ASSERT_cc(not owned.intersects(full_level.AT(cc).owned),
                     "All owned regions must be disjunct");
         }
@@ -490,7 +640,7 @@ void dh::regrid(bool const do_init) {
       ibbox const domain_enlarged = domain_active.expand(safedist);
 
       // All owned regions
-      ibset const allowned(full_level, &full_dboxes::owned);
+      ibset const allowned(full_level.boxes(), &full_dboxes::owned);
       ASSERT_rl(allowned <= domain_active, "The owned regions must be "
                                            "contained in the active part of "
                                            "the domain");
@@ -575,7 +725,7 @@ void dh::regrid(bool const do_init) {
                 "The active points, the overlap points, and buffer points "
                 "together must be exactly the owned region");
 
-      for (int c = 0; c < h.components(rl); ++c) {
+      for (int const c : neighbours.AT(rl)) {
         full_dboxes &box = full_level.AT(c);
 
         if (boundaries_are_trivial) {
@@ -627,7 +777,7 @@ void dh::regrid(bool const do_init) {
       } // for lc
 
       // The conjunction of all buffer zones must equal allbuffers
-      ibset const allbuffers1(full_level, &full_dboxes::buffers);
+      ibset const allbuffers1(full_level.boxes(), &full_dboxes::buffers);
       ASSERT_rl(allbuffers1 == allbuffers, "Buffer zone consistency check");
 
       timer_buffers.stop();
@@ -637,7 +787,7 @@ void dh::regrid(bool const do_init) {
       static Timers::Timer timer_test("test");
       timer_test.start();
 
-      for (int c = 0; c < h.components(rl); ++c) {
+      for (int const c : neighbours.AT(rl)) {
         full_dboxes const &box = full_level.AT(c);
 
         ASSERT_c((box.active & box.buffers).empty(), "Consistency check");
@@ -782,7 +932,7 @@ void dh::regrid(bool const do_init) {
               "Refinement factors must be integer multiples of each other");
           i2vect const reffact = i2vect(h.reffacts.at(rl) / h.reffacts.at(orl));
 
-          for (int cc = 0; cc < h.components(orl); ++cc) {
+          for (int const cc : neighbours.AT(orl)) {
             if (needrecv.empty())
               break;
 
@@ -856,7 +1006,7 @@ void dh::regrid(bool const do_init) {
 
           ibset &sync = box.sync;
 
-          for (int cc = 0; cc < h.components(rl); ++cc) {
+          for (int const cc : neighbours.AT(rl)) {
             if (needrecv.empty())
               break;
 
@@ -932,7 +1082,7 @@ void dh::regrid(bool const do_init) {
               "Refinement factors must be integer multiples of each other");
           i2vect const reffact = i2vect(h.reffacts.at(rl) / h.reffacts.at(orl));
 
-          for (int cc = 0; cc < h.components(orl); ++cc) {
+          for (int const cc : neighbours.AT(orl)) {
             if (needrecv.empty())
               break;
 
@@ -1035,7 +1185,7 @@ void dh::regrid(bool const do_init) {
           // Cannot restrict into buffer zones
           assert((allrestricted & obox.buffers).empty());
 
-          for (int c = 0; c < h.components(rl); ++c) {
+          for (int const c : neighbours.AT(rl)) {
             if (needrecv.empty())
               break;
 
@@ -1044,13 +1194,7 @@ void dh::regrid(bool const do_init) {
             // If we make a mistake expanding the domain of dependence here, it
             // _should_ be caught be by the expand()ed is_contained_in(srcbbox)
             // test in the actual operator.
-            int shrink_by;
-            if (use_higher_order_restriction and h.refcent == cell_centered)
-              shrink_by = restriction_order_space / 2;
-            else if (support_staggered_operators)
-              shrink_by = 2; // RH: not sure why 2 is required
-            else
-              shrink_by = 0;
+            int const shrink_by = restriction_shrink_width(h.refcent);
             ibbox const contracted_exterior =
                 box.exterior.expand(-shrink_by, -shrink_by)
                     .contracted_for(odomext);
@@ -1205,7 +1349,7 @@ void dh::regrid(bool const do_init) {
             ivect const idir = ivect::dir(dir); // Unit vector
             for (int face = 0; face < 2; ++face) {
               ibset all_fine_boundary_combined;
-              for (int c = 0; c < h.components(rl); ++c) {
+              for (int const c : neighbours.AT(rl)) {
                 full_dboxes const &box = full_level.AT(c);
                 all_fine_boundary_combined |=
                     box.exterior.shift(-idir, 2) & all_fine_boundary[dir][face];
@@ -1310,7 +1454,7 @@ void dh::regrid(bool const do_init) {
 
                 ibset needrecv(local_obox.coarse_boundary[dir][face]);
 
-                for (int c = 0; c < h.components(rl); ++c) {
+                for (int const c : neighbours.AT(rl)) {
                   if (needrecv.empty())
                     break;
 
@@ -1588,7 +1732,7 @@ void dh::regrid(bool const do_init) {
         ibbox const &obase = h.baseextent(ml, orl);
 
         // Calculate the union of all coarse regions
-        ibset const allointr(full_olevel, &full_dboxes::interior);
+        ibset const allointr(full_olevel.boxes(), &full_dboxes::interior);
 
         // Project to current level
         ivect const rf(reffact);
@@ -1674,6 +1818,7 @@ void dh::regrid(bool const do_init) {
 
         // This works only when the refinement factor is 2
         ivect const reffact = h.reffacts.AT(rl) / h.reffacts.AT(orl);
+        ibset unused_region;
         if (all(reffact == 2)) {
           // use the already computed 'all_refined' to get region from where
           // no information will be used later (overwritten)
@@ -1690,7 +1835,7 @@ void dh::regrid(bool const do_init) {
           i2vect to_shrink = buffer_widths[orl] + ghost_widths[orl];
           ibbox enclosing =
               restricted_region.container().expand(ivect(1) + to_shrink);
-          ibset unused_region =
+          unused_region =
               enclosing - (enclosing - restricted_region).expand(to_shrink);
           // Now we have the interesting region in 'unused_region' and need to
           // store
@@ -1705,6 +1850,33 @@ void dh::regrid(bool const do_init) {
             local_obox.unused_region = unused_region & obox.owned;
           } // for lc
         }   // if reffact != 2
+
+        if (not restrict_unused_points) {
+          // Restrict only into points that are not unused (the unused
+          // region is empty unless the refinement factor is 2)
+          fast_dboxes &fast_olevel = fast_boxes.AT(ml).AT(orl);
+          int const shrink_by = restriction_shrink_width(h.refcent);
+          for (sendrecv_pseudoregion_t const &preg :
+               fast_olevel.fast_ref_rest_sendrecv) {
+            int const c = preg.send.component;
+            int const oc = preg.recv.component;
+            full_dboxes const &box = full_level.AT(c);
+            ibset const needed = ibset(preg.recv.extent) - unused_region;
+            for (ibbox const &recv : needed.iterator()) {
+              ibbox const send = recv.expanded_for(box.exterior)
+                                     .expand(shrink_by, shrink_by);
+              assert(send <= preg.send.extent);
+              sendrecv_pseudoregion_t const npreg(send, c, recv, oc);
+              fast_olevel.fast_ref_rest_needed_sendrecv.push_back(npreg);
+              if (not on_this_proc(rl, c)) {
+                fast_dboxes &fast_level_otherproc =
+                    fast_level_otherprocs.AT(this_proc(rl, c));
+                fast_level_otherproc.fast_ref_rest_needed_sendrecv.push_back(
+                    npreg);
+              }
+            }
+          }
+        }
       }     // if not coarsest level
 
       timer_overwrittenmask.stop();
@@ -1740,11 +1912,14 @@ void dh::regrid(bool const do_init) {
             // grid structure.  It should fill as many active points
             // as possible.
 
+            ibbox const needrecv_container = needrecv.container();
             for (int cc = 0; cc < oldcomponents; ++cc) {
               if (needrecv.empty())
                 break;
 
               light_dboxes const &obox = old_light_boxes.AT(ml).AT(rl).AT(cc);
+              if (not needrecv_container.intersects(obox.owned))
+                continue;
 
               ibset const ovlp = needrecv & obox.owned;
 
@@ -1788,7 +1963,7 @@ void dh::regrid(bool const do_init) {
             i2vect const reffact =
                 i2vect(h.reffacts.at(rl) / h.reffacts.at(orl));
 
-            for (int cc = 0; cc < h.components(orl); ++cc) {
+            for (int const cc : neighbours.AT(orl)) {
               if (needrecv.empty())
                 break;
 
@@ -1890,6 +2065,10 @@ void dh::regrid(bool const do_init) {
         timer_bcast_boxes.stop();
       }
 
+      if (distributed_grid_metadata) {
+        calc_global_level_boxes(ml, rl);
+      }
+
       {
 
         static Timers::Timer timer_bcast_comm("bcast_comm");
@@ -1920,6 +2099,8 @@ void dh::regrid(bool const do_init) {
           timer_bcast_comm_ref_rest.start();
           broadcast_schedule(fast_level_otherprocs, fast_olevel,
                              &fast_dboxes::fast_ref_rest_sendrecv);
+          broadcast_schedule(fast_level_otherprocs, fast_olevel,
+                             &fast_dboxes::fast_ref_rest_needed_sendrecv);
           timer_bcast_comm_ref_rest.stop();
         }
 
@@ -1984,7 +2165,7 @@ void dh::regrid(bool const do_init) {
           cout << "processor=" << h.processor(rl, c) << eol;
         } // for c
 
-        for (int c = 0; c < h.components(rl); ++c) {
+        for (int const c : neighbours.AT(rl)) {
           full_dboxes const &box = full_boxes.AT(ml).AT(rl).AT(c);
           cout << eol;
           cout << "ml=" << ml << " rl=" << rl << " c=" << c << eol;
@@ -2168,27 +2349,64 @@ void dh::recompose(int const rl, bool const do_prolongate) {
   if (combine_recompose) {
     // Recompose all grid functions of this refinement levels at once.
     // This may be faster, but requires more memory. This is the default.
+    vector<ggf *> fs;
     for (map<int, ggf *>::iterator f = gfs.begin(); f != gfs.end(); ++f) {
-      f->second->recompose_allocate(rl);
+      fs.push_back(f->second);
     }
+
+    // Split the grid functions into batches that allocate a limited
+    // amount of memory. All processes need to use the same batches,
+    // since recomposing requires communication. The elements of a
+    // vector group share their leader's memory and need to be in the
+    // same batch; they follow their leader, since gfs is ordered by
+    // variable index.
+    vector<size_t> batch_begins(1, 0);
+    if (recompose_batch_memory > 0 and not fs.empty()) {
+      vector<long long> allocsizes(fs.size()), max_allocsizes(fs.size());
+      for (size_t i = 0; i < fs.size(); ++i) {
+        allocsizes.AT(i) = fs.AT(i)->recompose_allocsize(rl);
+      }
+      MPI_Allreduce(&allocsizes.front(), &max_allocsizes.front(), fs.size(),
+                    MPI_LONG_LONG, MPI_MAX, dist::comm());
+      long long const max_batchsize =
+          (long long)recompose_batch_memory * 1024 * 1024;
+      long long batchsize = 0;
+      for (size_t i = 0; i < fs.size(); ++i) {
+        if (fs.AT(i)->vectorindex == 0 and batchsize > 0 and
+            batchsize + max_allocsizes.AT(i) > max_batchsize) {
+          batch_begins.push_back(i);
+          batchsize = 0;
+        }
+        batchsize += max_allocsizes.AT(i);
+      }
+    }
+    batch_begins.push_back(fs.size());
+
+    for (size_t b = 0; b + 1 < batch_begins.size(); ++b) {
+      size_t const ibegin = batch_begins.AT(b);
+      size_t const iend = batch_begins.AT(b + 1);
+      for (size_t i = ibegin; i < iend; ++i) {
+        fs.AT(i)->recompose_allocate(rl);
+      }
 // TODO: If this works, rename do_prolongate to do_init here, and
 // remove the do_prolongate parameter from ggf::recompose_fill
 #if 0
-    for (comm_state state; not state.done(); state.step()) {
-      for (map<int,ggf*>::iterator f=gfs.begin(); f!=gfs.end(); ++f) {
-        f->second->recompose_fill (state, rl, do_prolongate);
+      for (comm_state state; not state.done(); state.step()) {
+        for (size_t i = ibegin; i < iend; ++i) {
+          fs.AT(i)->recompose_fill (state, rl, do_prolongate);
+        }
       }
-    }
 #endif
-    if (do_prolongate) {
-      for (comm_state state; not state.done(); state.step()) {
-        for (map<int, ggf *>::iterator f = gfs.begin(); f != gfs.end(); ++f) {
-          f->second->recompose_fill(state, rl, true);
+      if (do_prolongate) {
+        for (comm_state state; not state.done(); state.step()) {
+          for (size_t i = ibegin; i < iend; ++i) {
+            fs.AT(i)->recompose_fill(state, rl, true);
+          }
         }
       }
-    }
-    for (map<int, ggf *>::iterator f = gfs.begin(); f != gfs.end(); ++f) {
-      f->second->recompose_free_old(rl);
+      for (size_t i = ibegin; i < iend; ++i) {
+        fs.AT(i)->recompose_free_old(rl);
+      }
     }
   } else {
     // Recompose the grid functions sequentially.  This may be slower,
@@ -2298,6 +2516,7 @@ MPI_Datatype mpi_datatype(dh::fast_dboxes const &) {
         ENTRY(dh::srpvect, fast_mg_prol_sendrecv),
         ENTRY(dh::srpvect, fast_ref_prol_sendrecv),
         ENTRY(dh::srpvect, fast_ref_rest_sendrecv),
+        ENTRY(dh::srpvect, fast_ref_rest_needed_sendrecv),
         ENTRY(dh::srpvect, fast_sync_sendrecv),
         ENTRY(dh::srpvect, fast_ref_bnd_prol_sendrecv),
         ENTRY(dh::srpvect, fast_old2new_sync_sendrecv),
@@ -2329,7 +2548,7 @@ size_t dh::memory() const {
   return memoryof(ghost_widths) + memoryof(buffer_widths) +
          memoryof(overlap_widths) + memoryof(prolongation_orders_space) +
          memoryof(light_boxes) + memoryof(local_boxes) + memoryof(level_boxes) +
-         memoryof(fast_boxes) + memoryof(gfs);
+         memoryof(global_level_boxes_) + memoryof(fast_boxes) + memoryof(gfs);
 }
 
 size_t dh::allmemory() {
@@ -2378,6 +2597,7 @@ size_t dh::full_dboxes::memory() const {
 size_t dh::fast_dboxes::memory() const {
   return memoryof(fast_mg_rest_sendrecv) + memoryof(fast_mg_prol_sendrecv) +
          memoryof(fast_ref_prol_sendrecv) + memoryof(fast_ref_rest_sendrecv) +
+         memoryof(fast_ref_rest_needed_sendrecv) +
          memoryof(fast_sync_sendrecv) + memoryof(fast_ref_bnd_prol_sendrecv) +
          memoryof(fast_ref_refl_sendrecv_0_0) +
          memoryof(fast_ref_refl_sendrecv_0_1) +
@@ -2565,6 +2785,9 @@ istream &dh::fast_dboxes::input(istream &is) {
     consume(is, "fast_ref_rest_sendrecv:");
     is >> fast_ref_rest_sendrecv;
     skipws(is);
+    consume(is, "fast_ref_rest_needed_sendrecv:");
+    is >> fast_ref_rest_needed_sendrecv;
+    skipws(is);
     consume(is, "fast_sync_sendrecv:");
     is >> fast_sync_sendrecv;
     skipws(is);
@@ -2673,6 +2896,8 @@ ostream &dh::fast_dboxes::output(ostream &os) const {
      << "   fast_mg_prol_sendrecv: " << fast_mg_prol_sendrecv << eol
      << "   fast_ref_prol_sendrecv: " << fast_ref_prol_sendrecv << eol
      << "   fast_ref_rest_sendrecv: " << fast_ref_rest_sendrecv << eol
+     << "   fast_ref_rest_needed_sendrecv: " << fast_ref_rest_needed_sendrecv
+     << eol
      << "   fast_sync_sendrecv: " << fast_sync_sendrecv << eol
      << "   fast_ref_bnd_prol_sendrecv: " << fast_ref_bnd_prol_sendrecv << eol
      << "   fast_ref_refl_sendrecv_0_0: " << fast_ref_refl_sendrecv_0_0 << eol
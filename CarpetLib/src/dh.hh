@@ -1,6 +1,7 @@
 #ifndef DH_HH
 #define DH_HH
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <iostream>
@@ -148,6 +149,8 @@ public:
     srpvect fast_mg_prol_sendrecv;
     srpvect fast_ref_prol_sendrecv;
     srpvect fast_ref_rest_sendrecv;
+    // restriction without the unused region (see restrict_unused_points)
+    srpvect fast_ref_rest_needed_sendrecv;
     srpvect fast_sync_sendrecv;
     srpvect fast_ref_bnd_prol_sendrecv;
 
@@ -203,7 +206,40 @@ public:
   typedef vector<level_dboxes> level_rboxes; // ... for each refinement level
   typedef vector<level_rboxes> level_mboxes; // ... for each multigrid level
 
-  typedef vector<full_dboxes> full_cboxes; // ... for each component
+  // The full boxes are calculated only for some components (see
+  // find_neighbour_components). They are stored only for these
+  // components, and are looked up by component number.
+  class full_cboxes {
+    vector<int> components_;    // sorted component numbers
+    vector<full_dboxes> boxes_; // [i]
+
+    int index(int const c) const {
+      vector<int>::const_iterator const it =
+          lower_bound(components_.begin(), components_.end(), c);
+      assert(it != components_.end() and *it == c);
+      return it - components_.begin();
+    }
+
+  public:
+    void init(vector<int> const &components) {
+      components_ = components;
+      boxes_.clear();
+      boxes_.resize(components_.size());
+    }
+    void clear() {
+      components_.clear();
+      boxes_.clear();
+    }
+    vector<int> const &components() const { return components_; }
+    // The boxes of the stored components
+    vector<full_dboxes> const &boxes() const { return boxes_; }
+    full_dboxes &at(int const c) { return boxes_.at(index(c)); }
+    full_dboxes const &at(int const c) const { return boxes_.at(index(c)); }
+    full_dboxes &operator[](int const c) { return boxes_[index(c)]; }
+    full_dboxes const &operator[](int const c) const {
+      return boxes_[index(c)];
+    }
+  };
   typedef vector<full_cboxes> full_rboxes; // ... for each refinement level
   typedef vector<full_rboxes> full_mboxes; // ... for each multigrid level
 
@@ -234,6 +270,11 @@ public: // should be readonly
   fast_mboxes fast_boxes;   // grid hierarchy [ml][rl][p]
 
 private:
+  // With distributed grid metadata, level_boxes describe only the
+  // neighbourhood of the local components; the level description of
+  // the whole level is calculated from the light boxes in regrid
+  level_mboxes global_level_boxes_; // [ml][rl]
+
   // this needs to be sorted by varindex so that when iterating through the
   // container in order with a forward iterator, vector leaders are processed
   // first
@@ -251,6 +292,10 @@ public:
   // Helpers
   int prolongation_stencil_size(int rl) const CCTK_MEMBER_ATTRIBUTE_PURE;
 
+  // Level description of the whole level (this is level_boxes unless
+  // distributed grid metadata are used)
+  level_dboxes const &global_level_boxes(int ml, int rl) const;
+
   // Modifiers
   void regrid(bool do_init);
   void regrid_free(bool do_init);
@@ -263,6 +308,10 @@ private:
   int this_oldproc(int rl, int c) const CCTK_MEMBER_ATTRIBUTE_PURE;
   bool on_this_oldproc(int rl, int c) const CCTK_MEMBER_ATTRIBUTE_PURE;
 
+  void find_neighbour_components(int ml, int rl,
+                                 vector<int> &neighbours) const;
+  void calc_global_level_boxes(int ml, int rl);
+
   static void broadcast_schedule(vector<fast_dboxes> &fast_level_otherprocs,
                                  fast_dboxes &fast_level,
                                  srpvect fast_dboxes::*const schedule_item);
@@ -29,6 +29,11 @@ namespace dist {
 
 MPI_Comm comm_ = MPI_COMM_NULL;
 
+MPI_Comm node_comm_ = MPI_COMM_NULL;
+vector<int> node_of_proc_;
+vector<int> node_rank_of_proc_;
+vector<vector<int> > node_procs_;
+
 MPI_Datatype mpi_complex8 = MPI_DATATYPE_NULL;
 MPI_Datatype mpi_complex16 = MPI_DATATYPE_NULL;
 MPI_Datatype mpi_complex32 = MPI_DATATYPE_NULL;
@@ -154,6 +159,8 @@ void init(int &argc, char **&argv) {
   pseudoinit(MPI_COMM_WORLD);
 }
 
+static void setup_nodes();
+
 void pseudoinit(MPI_Comm const c) {
   comm_ = c;
 
@@ -198,6 +205,49 @@ void pseudoinit(MPI_Comm const c) {
   CarpetLib::request_backtraces();
 
   collect_total_num_threads();
+
+  setup_nodes();
+}
+
+// Determine which processes share a node
+void setup_nodes() {
+  int leader = rank();
+#ifdef CCTK_MPI
+  // pseudoinit may be called more than once
+  if (node_comm_ != MPI_COMM_NULL)
+    MPI_Comm_free(&node_comm_);
+#if MPI_VERSION >= 3
+  MPI_Comm_split_type(comm(), MPI_COMM_TYPE_SHARED, rank(), MPI_INFO_NULL,
+                      &node_comm_);
+  // The process with the lowest rank leads the node
+  MPI_Bcast(&leader, 1, MPI_INT, 0, node_comm_);
+#else
+  // Without MPI-3 we cannot find out which processes share a node;
+  // every process forms its own node
+  MPI_Comm_split(comm(), rank(), 0, &node_comm_);
+#endif
+  vector<int> leaders(size());
+  MPI_Allgather(&leader, 1, MPI_INT, &leaders.front(), 1, MPI_INT, comm());
+#else
+  node_comm_ = comm();
+  vector<int> leaders(1, leader);
+#endif
+
+  node_of_proc_.resize(size());
+  node_rank_of_proc_.resize(size());
+  node_procs_.clear();
+  vector<int> node_of_leader(size(), -1);
+  for (int p = 0; p < size(); ++p) {
+    int const l = leaders.AT(p);
+    if (node_of_leader.AT(l) < 0) {
+      node_of_leader.AT(l) = node_procs_.size();
+      node_procs_.push_back(vector<int>());
+    }
+    int const n = node_of_leader.AT(l);
+    node_of_proc_.AT(p) = n;
+    node_rank_of_proc_.AT(p) = node_procs_.AT(n).size();
+    node_procs_.AT(n).push_back(p);
+  }
 }
 
 void finalize() { MPI_Finalize(); }
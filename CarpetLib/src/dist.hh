@@ -7,6 +7,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <vector>
 
 #ifdef CCTK_MPI
 #include <mpi.h>
@@ -30,6 +31,11 @@ namespace dist {
 
 extern MPI_Comm comm_;
 
+extern MPI_Comm node_comm_;
+extern vector<int> node_of_proc_;
+extern vector<int> node_rank_of_proc_;
+extern vector<vector<int> > node_procs_;
+
 extern MPI_Datatype mpi_complex8;
 extern MPI_Datatype mpi_complex16;
 extern MPI_Datatype mpi_complex32;
@@ -164,6 +170,32 @@ inline int size() {
   return size_;
 }
 
+// Information about the nodes (shared-memory domains); processes on
+// the same node can access each other's memory
+
+// Return the communicator for the processes on this node
+inline MPI_Comm node_comm() { return node_comm_; }
+
+// Number of nodes
+inline int num_nodes() { return node_procs_.size(); }
+
+// Node to which a process belongs
+inline int node_of(int const proc) { return node_of_proc_.AT(proc); }
+
+// Rank of a process in its node's communicator
+inline int node_rank_of(int const proc) { return node_rank_of_proc_.AT(proc); }
+
+// Processes on a node, in ascending order (the first process is the
+// node's leader)
+inline vector<int> const &node_procs(int const node) {
+  return node_procs_.AT(node);
+}
+
+// This process's node, rank on the node, and the node's size
+inline int node() { return node_of(rank()); }
+inline int node_rank() { return node_rank_of(rank()); }
+inline int node_size() { return node_procs(node()).size(); }
+
 // Set number of threads
 void set_num_threads(int num_threads);
 
@@ -159,6 +159,24 @@ P *fulltree<T, D, P>::search(tvect const &ipos) {
   return subtrees.AT(i)->search(ipos);
 }
 
+// Find all leaf payloads whose region may intersect a box
+template <typename T, int D, typename P>
+void fulltree<T, D, P>::search(tvect const &lower, tvect const &upper,
+                               vector<P const *> &ps) const {
+  if (empty())
+    return;
+  if (is_leaf()) {
+    ps.push_back(&p);
+    return;
+  }
+  int const imin = std::max(0, CarpetLib::asearch(lower[dir], bounds));
+  for (int i = imin; i < int(subtrees.size()); ++i) {
+    if (bounds.AT(i) > upper[dir])
+      break;
+    subtrees.AT(i)->search(lower, upper, ps);
+  }
+}
+
 // Const iterator
 template <typename T, int D, typename P>
 fulltree<T, D, P>::const_iterator::const_iterator(fulltree const &f_)
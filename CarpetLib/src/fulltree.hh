@@ -99,6 +99,11 @@ public:
   P const *search(tvect const &ipos) const CCTK_MEMBER_ATTRIBUTE_PURE;
   P *search(tvect const &ipos) CCTK_MEMBER_ATTRIBUTE_PURE;
 
+  // Find all leaf payloads whose region may intersect the box
+  // [lower, upper] (the payloads need to be checked by the caller)
+  void search(tvect const &lower, tvect const &upper,
+              vector<P const *> &ps) const;
+
   class const_iterator {
     fulltree const &f;
     size_t i;
@@ -1,4 +1,5 @@
 #include <cctk.h>
+#include <cctk_Parameters.h>
 
 #include <cassert>
 #include <cmath>
@@ -21,6 +22,7 @@ namespace CarpetLib {
 using namespace std;
 
 set<ggf *> ggf::allggf;
+size_t ggf::storage_generation = 0;
 
 // Constructors
 ggf::ggf(const int varindex_, const operator_type transport_operator_, th &t_,
@@ -79,6 +81,7 @@ bool ggf::operator==(const ggf &f) const { return this == &f; }
 
 // Modifiers
 void ggf::set_timelevels(const int ml, const int rl, const int new_timelevels) {
+  ++storage_generation;
   assert(ml >= 0 and ml < (int)storage.size());
   assert(rl >= 0 and rl < (int)storage.AT(ml).size());
 
@@ -116,6 +119,7 @@ void ggf::set_timelevels(const int ml, const int rl, const int new_timelevels) {
 }
 
 void ggf::recompose_crop() {
+  ++storage_generation;
   // Free storage that will not be needed
   static Timers::Timer timer("CarpetLib::ggf::recompose_crop");
   timer.start();
@@ -133,6 +137,9 @@ void ggf::recompose_crop() {
 }
 
 void ggf::recompose_allocate(const int rl) {
+  DECLARE_CCTK_PARAMETERS;
+
+  ++storage_generation;
   // Retain storage that might be needed
   static Timers::Timer timer("CarpetLib::ggf::recompose_allocate");
   timer.start();
@@ -152,9 +159,30 @@ void ggf::recompose_allocate(const int rl) {
   for (int ml = 0; ml < h.mglevels(); ++ml) {
     storage.AT(ml).resize(h.reflevels());
     storage.AT(ml).AT(rl).resize(h.local_components(rl));
+    cdata const &olddata = oldstorage.AT(ml).AT(rl);
+    vector<bool> taken(olddata.size(), false);
     for (int lc = 0; lc < h.local_components(rl); ++lc) {
       int const c = h.get_component(rl, lc);
       storage.AT(ml).AT(rl).AT(lc).resize(timelevels(ml, rl));
+
+      // Adopt the old storage if this component did not change
+      if (recompose_adopt_storage) {
+        const auto &comp = d.light_boxes.AT(ml).AT(rl).AT(c);
+        int const olc =
+            find_adoptable_storage(olddata, taken, comp.exterior,
+                                   pad_shape(comp.exterior, comp.owned),
+                                   timelevels(ml, rl));
+        if (olc >= 0) {
+          taken.AT(olc) = true;
+          for (int tl = 0; tl < timelevels(ml, rl); ++tl) {
+            gdata *const data = olddata.AT(olc).AT(tl);
+            storage.AT(ml).AT(rl).AT(lc).AT(tl) = data;
+            adopted_storage.insert(data);
+          }
+          continue;
+        }
+      }
+
       for (int tl = 0; tl < timelevels(ml, rl); ++tl) {
         storage.AT(ml).AT(rl).AT(lc).AT(tl) = typed_data(tl, rl, lc, ml);
         const auto &comp = d.light_boxes.AT(ml).AT(rl).AT(c);
@@ -172,6 +200,70 @@ void ggf::recompose_allocate(const int rl) {
   timer.stop();
 }
 
+// Find an old local component whose storage can be adopted by a new
+// component, i.e. which has the same extent and memory layout;
+// return -1 if there is none
+int ggf::find_adoptable_storage(cdata const &olddata,
+                                vector<bool> const &taken,
+                                ibbox const &exterior,
+                                padding_t<int, dim> const &shp,
+                                int const ntl) const {
+  for (int olc = 0; olc < int(olddata.size()); ++olc) {
+    if (taken.AT(olc) or int(olddata.AT(olc).size()) != ntl)
+      continue;
+    bool can_adopt = ntl > 0;
+    for (int tl = 0; tl < ntl; ++tl) {
+      gdata const *const data = olddata.AT(olc).AT(tl);
+      can_adopt = can_adopt and data and data->has_storage() and
+                  data->proc() == dist::rank() and
+                  data->extent() == exterior and
+                  all(data->padded_shape() == shp.padded_shape) and
+                  all(data->padding_offset() == shp.padding_offset);
+    }
+    if (can_adopt)
+      return olc;
+  }
+  return -1;
+}
+
+// Estimate the amount of memory which recompose_allocate will
+// allocate; this needs to be called before recompose_allocate. The
+// elements of a vector group share their leader's memory, which is
+// accounted for by the leader.
+size_t ggf::recompose_allocsize(int const rl) const {
+  DECLARE_CCTK_PARAMETERS;
+
+  if (vectorindex != 0)
+    return 0;
+
+  size_t const elementsize = CCTK_VarTypeSize(CCTK_VarTypeI(varindex));
+  size_t allocsize = 0;
+  for (int ml = 0; ml < h.mglevels(); ++ml) {
+    cdata const empty;
+    cdata const &olddata =
+        ml < int(storage.size()) and rl < int(storage.AT(ml).size())
+            ? storage.AT(ml).AT(rl)
+            : empty;
+    vector<bool> taken(olddata.size(), false);
+    for (int lc = 0; lc < h.local_components(rl); ++lc) {
+      int const c = h.get_component(rl, lc);
+      const auto &comp = d.light_boxes.AT(ml).AT(rl).AT(c);
+      auto shp = pad_shape(comp.exterior, comp.owned);
+      if (recompose_adopt_storage) {
+        int const olc = find_adoptable_storage(olddata, taken, comp.exterior,
+                                               shp, timelevels(ml, rl));
+        if (olc >= 0) {
+          taken.AT(olc) = true;
+          continue;
+        }
+      }
+      allocsize += timelevels(ml, rl) * vectorlength *
+                   prod(shp.padded_shape) * elementsize;
+    }
+  }
+  return allocsize;
+}
+
 void ggf::recompose_fill(comm_state &state, int const rl,
                          bool const do_prolongate) {
   // Initialise the new storage
@@ -221,8 +313,14 @@ void ggf::recompose_free_old(const int rl) {
 
   for (int ml = 0; ml < (int)oldstorage.size(); ++ml) {
     for (int lc = 0; lc < (int)oldstorage.AT(ml).AT(rl).size(); ++lc)
-      for (int tl = 0; tl < (int)oldstorage.AT(ml).AT(rl).AT(lc).size(); ++tl)
-        delete oldstorage.AT(ml).AT(rl).AT(lc).AT(tl);
+      for (int tl = 0; tl < (int)oldstorage.AT(ml).AT(rl).AT(lc).size();
+           ++tl) {
+        gdata *const data = oldstorage.AT(ml).AT(rl).AT(lc).AT(tl);
+        // Adopted storage is now owned by the new storage
+        if (adopted_storage.erase(data))
+          continue;
+        delete data;
+      }
     oldstorage.AT(ml).AT(rl).clear();
   } // for ml
 
@@ -230,6 +328,7 @@ void ggf::recompose_free_old(const int rl) {
 }
 
 void ggf::recompose_free(const int rl) {
+  ++storage_generation;
   // Delete old storage
   static Timers::Timer timer("dh::recompose_free");
   timer.start();
@@ -246,6 +345,7 @@ void ggf::recompose_free(const int rl) {
 
 // Cycle the time levels by rotating the data sets
 void ggf::cycle_all(int const rl, int const ml) {
+  ++storage_generation;
   assert(rl >= 0 and rl < h.reflevels());
   assert(ml >= 0 and ml < h.mglevels());
   int const ntl = timelevels(ml, rl);
@@ -268,6 +368,7 @@ void ggf::cycle_all(int const rl, int const ml) {
 
 // Uncycle the time levels by rotating the data sets
 void ggf::uncycle_all(int const rl, int const ml) {
+  ++storage_generation;
   assert(rl >= 0 and rl < h.reflevels());
   assert(ml >= 0 and ml < h.mglevels());
   int const ntl = timelevels(ml, rl);
@@ -290,6 +391,7 @@ void ggf::uncycle_all(int const rl, int const ml) {
 
 // Flip the time levels by exchanging the data sets
 void ggf::flip_all(int const rl, int const ml) {
+  ++storage_generation;
   assert(rl >= 0 and rl < h.reflevels());
   assert(ml >= 0 and ml < h.mglevels());
   int const ntl = timelevels(ml, rl);
@@ -421,6 +523,7 @@ void ggf::mg_prolongate_all(comm_state &state, int const tl, int const rl,
 // Restrict a refinement level
 void ggf::ref_restrict_all(comm_state &state, int const tl, int const rl,
                            int const ml) {
+  DECLARE_CCTK_PARAMETERS;
   if (transport_operator == op_none or transport_operator == op_sync)
     return;
   static Timer timer("ref_restrict_all");
@@ -428,7 +531,10 @@ void ggf::ref_restrict_all(comm_state &state, int const tl, int const rl,
   // Require same times
   assert(std::fabs(t.get_time(ml, rl, tl) - t.get_time(ml, rl + 1, tl)) <=
          1.0e-8 * (1.0 + std::fabs(t.get_time(ml, rl, tl))));
-  transfer_from_all(state, tl, rl, ml, &dh::fast_dboxes::fast_ref_rest_sendrecv,
+  transfer_from_all(state, tl, rl, ml,
+                    restrict_unused_points
+                        ? &dh::fast_dboxes::fast_ref_rest_sendrecv
+                        : &dh::fast_dboxes::fast_ref_rest_needed_sendrecv,
                     tl, rl + 1, ml);
   timer.stop(0);
 
@@ -583,6 +689,10 @@ void ggf::transfer_from_all(comm_state &state, int const tl1, int const rl1,
     for (int i = 0; i < (int)gsrcs.size(); ++i)
       gsrcs.AT(i) = lc2 >= 0 ? srcs.AT(lc2).AT(tl2s.AT(i)) : NULL;
 
+    // Skip copying adopted storage onto itself
+    if (use_old_storage and dst and gsrcs.size() == 1 and gsrcs.AT(0) == dst)
+      continue;
+
     gdata::transfer_data(dst, state, gsrcs, times, recv, send, slabinfo, p1, p2, time,
                        pos, pot);
   }
@@ -9,6 +9,7 @@
 #include <string>
 #include <vector>
 
+#include "cacheinfo.hh"
 #include "defs.hh"
 #include "dh.hh"
 #include "gdata.hh"
@@ -29,6 +30,14 @@ class ggf {
 
   static set<ggf *> allggf;
 
+public:
+  // Incremented whenever the storage of any grid function is
+  // allocated, freed, or rearranged, so that pointers to storage can
+  // be cached
+  static size_t storage_generation;
+
+private:
+
   // Types
   typedef vector<pseudoregion_t> pvect;
   typedef vector<sendrecv_pseudoregion_t> srpvect;
@@ -64,6 +73,14 @@ public:
 private:
   mdata oldstorage; // temporary storage
 
+  // old storage that has been adopted by the new storage, and must
+  // not be freed
+  set<gdata const *> adopted_storage;
+
+  int find_adoptable_storage(cdata const &olddata, vector<bool> const &taken,
+                             ibbox const &exterior,
+                             padding_t<int, dim> const &shp, int ntl) const;
+
 public:
   // Constructors
   ggf(const int varindex, const operator_type transport_operator, th &t, dh &d,
@@ -95,6 +112,7 @@ public:
   void recompose_fill(comm_state &state, int rl, bool do_prolongate);
   void recompose_free_old(int rl);
   void recompose_free(int rl);
+  size_t recompose_allocsize(int rl) const;
 
   // Cycle the time levels by rotating the data sets
   void cycle_all(int rl, int ml);
@@ -403,7 +403,7 @@ void gh::locate_position(rvect const &rpos, int const ml, int const minrl,
     // Ignore this level if this point is not in the active region
     // (i.e. if it is a buffer point or similar)
     if (not interpolate_from_buffer_zones and
-        dd.level_boxes.AT(ml).AT(rl).buffers.contains(aligned_ipos)) {
+        dd.global_level_boxes(ml, rl).buffers.contains(aligned_ipos)) {
       continue;
     }
 
@@ -458,7 +458,7 @@ void gh::locate_position(ivect const &ipos, int const ml, int const minrl,
     // Ignore this level if this point is not in the active region
     // (i.e. if it is a buffer point or similar)
     if (not interpolate_from_buffer_zones and
-        dd.level_boxes.AT(ml).AT(rl).buffers.contains(aligned_ipos)) {
+        dd.global_level_boxes(ml, rl).buffers.contains(aligned_ipos)) {
       continue;
     }
 
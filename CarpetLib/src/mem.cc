@@ -34,6 +34,46 @@ double gmem::total_allocated_objects = 0;
 double gmem::max_allocated_bytes = 0;
 double gmem::max_allocated_objects = 0;
 
+char const *const gmem::subsystem_names[gmem::num_subsystems] = {
+    "gridfunctions", "commbuffers", "metadata", "interp", "io"};
+
+double gmem::subsystem_bytes[gmem::num_subsystems] = {0};
+double gmem::max_subsystem_bytes[gmem::num_subsystems] = {0};
+double gmem::accounted_bytes = 0;
+
+char const *const gmem::phase_names[gmem::num_phases] = {
+    "other", "regrid", "checkpoint", "output"};
+gmem::phase_t gmem::current_phase = gmem::phase_other;
+double gmem::max_phase_bytes[gmem::num_phases] = {0};
+
+void gmem::account(subsystem_t const sub, double const bytes) {
+  assert(sub >= 0 and sub < num_subsystems);
+  // Grid function storage may be allocated by several threads
+#pragma omp critical(CarpetLib_gmem_account)
+  {
+    subsystem_bytes[sub] += bytes;
+    max_subsystem_bytes[sub] =
+        max(max_subsystem_bytes[sub], subsystem_bytes[sub]);
+    accounted_bytes += bytes;
+    max_phase_bytes[current_phase] =
+        max(max_phase_bytes[current_phase], accounted_bytes);
+  }
+}
+
+memphase::memphase(gmem::phase_t const phase)
+    : old_phase(gmem::current_phase) {
+  assert(phase >= 0 and phase < gmem::num_phases);
+  gmem::sample_metadata();
+  gmem::current_phase = phase;
+  gmem::max_phase_bytes[phase] =
+      max(gmem::max_phase_bytes[phase], gmem::accounted_bytes);
+}
+
+memphase::~memphase() {
+  gmem::sample_metadata();
+  gmem::current_phase = old_phase;
+}
+
 namespace {
 size_t get_max_cache_linesize() {
   static size_t max_cache_linesize = 0;
@@ -151,6 +191,7 @@ mem<T>::mem(size_t const vectorlength, size_t const nelems, size_t const offset,
 
   total_allocated_bytes += nbytes_;
   max_allocated_bytes = max(max_allocated_bytes, total_allocated_bytes);
+  account(sub_gridfunctions, nbytes_);
 
   ++total_allocated_objects;
   max_allocated_objects = max(max_allocated_objects, total_allocated_objects);
@@ -167,6 +208,7 @@ template <typename T> mem<T>::~mem() {
     free(storage_base_);
   }
   total_allocated_bytes -= nbytes_;
+  account(sub_gridfunctions, -double(nbytes_));
   --total_allocated_objects;
 }
 
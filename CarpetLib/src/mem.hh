@@ -5,6 +5,7 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <memory>
 #include <stack>
 #include <vector>
 
@@ -30,6 +31,89 @@ public:
   // Maximum of the above (over time)
   static double max_allocated_bytes;
   static double max_allocated_objects;
+
+  // Memory accounting by subsystem. Grid function storage is
+  // accounted automatically, the other subsystems report their
+  // allocations via account(), and the administrative data structures
+  // (grid hierarchies, bboxsets, etc.) are sampled via
+  // sample_metadata(). account() may be called from several threads;
+  // sample_metadata() and memphase are for the main thread only.
+  enum subsystem_t {
+    sub_gridfunctions,
+    sub_commbuffers,
+    sub_metadata,
+    sub_interp,
+    sub_io,
+    num_subsystems
+  };
+  static char const *const subsystem_names[num_subsystems];
+
+  // Currently accounted bytes and their maximum (over time), per
+  // subsystem and in total
+  static double subsystem_bytes[num_subsystems];
+  static double max_subsystem_bytes[num_subsystems];
+  static double accounted_bytes;
+
+  // Phases for which high-water marks are tracked separately
+  enum phase_t {
+    phase_other,
+    phase_regrid,
+    phase_checkpoint,
+    phase_output,
+    num_phases
+  };
+  static char const *const phase_names[num_phases];
+  static phase_t current_phase;
+
+  // Maximum total accounted bytes during each phase
+  static double max_phase_bytes[num_phases];
+
+  // Account an allocation (positive) or deallocation (negative)
+  static void account(subsystem_t sub, double bytes);
+
+  // Update the accounted size of the administrative data structures
+  // (defined in memstat.cc)
+  static void sample_metadata();
+};
+
+// Attribute the memory usage to a phase while this object exists
+class memphase {
+  gmem::phase_t const old_phase;
+
+  // Forbid copying
+  memphase(memphase const &);
+  memphase &operator=(memphase const &);
+
+public:
+  memphase(gmem::phase_t phase);
+  ~memphase();
+};
+
+// An allocator for standard containers that accounts the allocated
+// memory to a subsystem
+template <typename T, gmem::subsystem_t SUB>
+class counting_allocator : public std::allocator<T> {
+public:
+  template <typename U> struct rebind {
+    typedef counting_allocator<U, SUB> other;
+  };
+
+  counting_allocator() {}
+  counting_allocator(counting_allocator const &a) : std::allocator<T>(a) {}
+  template <typename U>
+  counting_allocator(counting_allocator<U, SUB> const &a)
+      : std::allocator<T>(a) {}
+
+  T *allocate(size_t const n) {
+    T *const ptr = std::allocator<T>::allocate(n);
+    gmem::account(SUB, double(n * sizeof(T)));
+    return ptr;
+  }
+
+  void deallocate(T *const ptr, size_t const n) {
+    gmem::account(SUB, -double(n * sizeof(T)));
+    std::allocator<T>::deallocate(ptr, n);
+  }
 };
 
 template <typename T> class mem : public gmem {
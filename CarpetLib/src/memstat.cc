@@ -40,9 +40,26 @@ struct mstat {
   // malloc statistics
   double malloc_used_bytes;
   double malloc_free_bytes;
+  // Accounting by subsystem and phase
+  double subsystem_bytes[gmem::num_subsystems];
+  double max_subsystem_bytes[gmem::num_subsystems];
+  double max_phase_bytes[gmem::num_phases];
 };
 int const mstat_entries = sizeof(mstat) / sizeof(double);
 
+void gmem::sample_metadata() {
+  DECLARE_CCTK_PARAMETERS;
+
+  // Traversing all administrative data structures is not cheap; do
+  // this only if memory statistics are reported
+  if (print_memstats_every < 0)
+    return;
+
+  double const bytes = gh::allmemory() + dh::allmemory() + th::allmemory() +
+                       ggf::allmemory() + gdata::allmemory();
+  account(sub_metadata, bytes - subsystem_bytes[sub_metadata]);
+}
+
 extern "C" void CarpetLib_printmemstats(CCTK_ARGUMENTS);
 
 void CarpetLib_printmemstats(CCTK_ARGUMENTS) {
@@ -74,6 +91,14 @@ void CarpetLib_printmemstats(CCTK_ARGUMENTS) {
     mybuf.malloc_used_bytes = 0;
     mybuf.malloc_free_bytes = 0;
 #endif
+    gmem::sample_metadata();
+    for (int sub = 0; sub < gmem::num_subsystems; ++sub) {
+      mybuf.subsystem_bytes[sub] = gmem::subsystem_bytes[sub];
+      mybuf.max_subsystem_bytes[sub] = gmem::max_subsystem_bytes[sub];
+    }
+    for (int phase = 0; phase < gmem::num_phases; ++phase) {
+      mybuf.max_phase_bytes[phase] = gmem::max_phase_bytes[phase];
+    }
 
     cout << "Memory statistics from CarpetLib:" << eol
          << "   Current number of objects: "
@@ -98,6 +123,19 @@ void CarpetLib_printmemstats(CCTK_ARGUMENTS) {
          << "   ggf::allmemory:   " << ggf::allmemory() << eol
          << "   gdata::allmemory: " << gdata::allmemory() << endl;
 
+    cout << "   Memory by subsystem (current / maximum):" << eol;
+    for (int sub = 0; sub < gmem::num_subsystems; ++sub) {
+      cout << "      " << gmem::subsystem_names[sub] << ": " << setprecision(3)
+           << mybuf.subsystem_bytes[sub] / gmem::MEGA << " MB / "
+           << mybuf.max_subsystem_bytes[sub] / gmem::MEGA << " MB" << eol;
+    }
+    cout << "   Maximum memory by phase:" << eol;
+    for (int phase = 0; phase < gmem::num_phases; ++phase) {
+      cout << "      " << gmem::phase_names[phase] << ": " << setprecision(3)
+           << mybuf.max_phase_bytes[phase] / gmem::MEGA << " MB" << eol;
+    }
+    cout.flush();
+
     if (strcmp(memstat_file, "") != 0) {
       vector<mstat> allbuf(dist::size());
       MPI_Gather(&mybuf, mstat_entries, MPI_DOUBLE, &allbuf.front(),
@@ -182,6 +220,42 @@ void CarpetLib_printmemstats(CCTK_ARGUMENTS) {
 
         file.close();
 
+        // Per-process memory accounting by subsystem and phase
+        string const subfilename = filename + "-subsystems";
+        ofstream subfile;
+        static bool did_truncate_sub = false;
+        if (not did_truncate_sub) {
+          did_truncate_sub = true;
+          subfile.open(subfilename.c_str(), ios::out | ios::trunc);
+          subfile << "# Memory accounting by subsystem and phase (in bytes)"
+                  << eol << "# 1:iteration 2:process";
+          int col = 3;
+          for (int sub = 0; sub < gmem::num_subsystems; ++sub)
+            subfile << " " << col++ << ":" << gmem::subsystem_names[sub];
+          for (int sub = 0; sub < gmem::num_subsystems; ++sub)
+            subfile << " " << col++ << ":max_" << gmem::subsystem_names[sub];
+          for (int phase = 0; phase < gmem::num_phases; ++phase)
+            subfile << " " << col++ << ":max_" << gmem::phase_names[phase];
+          subfile << eol;
+        } else {
+          subfile.open(subfilename.c_str(), ios::out | ios::app);
+        }
+
+        for (size_t n = 0; n < allbuf.size(); ++n) {
+          subfile << cctk_iteration << "\t" << n << "\t";
+          for (int sub = 0; sub < gmem::num_subsystems; ++sub)
+            subfile << " " << allbuf[n].subsystem_bytes[sub];
+          subfile << "\t";
+          for (int sub = 0; sub < gmem::num_subsystems; ++sub)
+            subfile << " " << allbuf[n].max_subsystem_bytes[sub];
+          subfile << "\t";
+          for (int phase = 0; phase < gmem::num_phases; ++phase)
+            subfile << " " << allbuf[n].max_phase_bytes[phase];
+          subfile << eol;
+        }
+
+        subfile.close();
+
       } // if on root process
     }   // if output to file
   }
@@ -7,6 +7,7 @@
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
+#include <vector>
 
 #include "operator_prototypes_3d.hh"
 #include "typeprops.hh"
@@ -1071,7 +1072,101 @@ void prolongate_3d_cc_eno_rf2(
   size_t const srcdj = srcjext > 1 ? SRCIND3(0, 1, 0) - SRCIND3(0, 0, 0) : 0;
   size_t const srcdk = srckext > 1 ? SRCIND3(0, 0, 1) - SRCIND3(0, 0, 0) : 0;
 
-  if (not use_loopcontrol_in_operators) {
+  if (eno_prolongation_sweeps) {
+
+    // Apply the 1D ENO reconstruction one direction at a time. interp3
+    // applies interp1 along x, then the same 1D ENO along y to these
+    // results, and then along z. The partial results along x and y
+    // (and their stencil selections) are shared between many fine grid
+    // points; here they are computed only once. The x sweep writes into
+    // a scratch array that is fine in x and coarse in y and z, the y
+    // sweep into one that is fine in x and y and coarse in z, and the z
+    // sweep into the destination. The result is identical to calling
+    // interp3 for each fine grid point.
+    //
+    // This operator is called via call_operator, which already splits
+    // the region among the threads; the sweeps are therefore not
+    // parallelised here.
+
+    ptrdiff_t const ni = regiext;
+    ptrdiff_t const nj = regjext;
+    ptrdiff_t const nk = regkext;
+
+    // Coarse index ranges in y and z that are needed by the stencils
+    // (see offsetlo and offsethi above)
+    ptrdiff_t const jmin = ptrdiff_t(j0) - offsetlo[1];
+    ptrdiff_t const jmax = ptrdiff_t((srcjoff + nj - 1) / 2) + offsethi[1];
+    ptrdiff_t const kmin = ptrdiff_t(k0) - offsetlo[2];
+    ptrdiff_t const kmax = ptrdiff_t((srckoff + nk - 1) / 2) + offsethi[2];
+    assert(jmin >= 0 and jmax < ptrdiff_t(srcjext));
+    assert(kmin >= 0 and kmax < ptrdiff_t(srckext));
+    ptrdiff_t const njs = jmax - jmin + 1;
+    ptrdiff_t const nks = kmax - kmin + 1;
+
+    // The first fine grid points in x with parity 0 and 1
+    ptrdiff_t const i0even = fi;
+    ptrdiff_t const i0odd = 1 - fi;
+
+    vector<T> xbuf(ni * njs * nks);
+    vector<T> ybuf(ni * nj * nks);
+
+    // Sweep along x
+    for (ptrdiff_t k = 0; k < nks; ++k) {
+      for (ptrdiff_t j = 0; j < njs; ++j) {
+        T *restrict const xrow = &xbuf[ni * (j + njs * k)];
+        for (ptrdiff_t i = i0even; i < ni; i += 2) {
+          ptrdiff_t const is = (srcioff + i) / 2;
+          check_indices1<T, ORDER, 0>(is, srciext);
+          xrow[i] = interp1<T, ORDER, 0>(
+              &src[SRCIND3(is, jmin + j, kmin + k)], srcdi);
+        }
+        for (ptrdiff_t i = i0odd; i < ni; i += 2) {
+          ptrdiff_t const is = (srcioff + i) / 2;
+          check_indices1<T, ORDER, 1>(is, srciext);
+          xrow[i] = interp1<T, ORDER, 1>(
+              &src[SRCIND3(is, jmin + j, kmin + k)], srcdi);
+        }
+      }
+    }
+
+    // Sweep along y
+    for (ptrdiff_t k = 0; k < nks; ++k) {
+      for (ptrdiff_t j = 0; j < nj; ++j) {
+        ptrdiff_t const js = (srcjoff + j) / 2 - jmin;
+        T const *restrict const xcol = &xbuf[ni * (js + njs * k)];
+        T *restrict const yrow = &ybuf[ni * (j + nj * k)];
+        if ((srcjoff + j) % 2 == 0) {
+          for (ptrdiff_t i = 0; i < ni; ++i) {
+            yrow[i] = interp1<T, ORDER, 0>(&xcol[i], ni);
+          }
+        } else {
+          for (ptrdiff_t i = 0; i < ni; ++i) {
+            yrow[i] = interp1<T, ORDER, 1>(&xcol[i], ni);
+          }
+        }
+      }
+    }
+
+    // Sweep along z
+    for (ptrdiff_t k = 0; k < nk; ++k) {
+      for (ptrdiff_t j = 0; j < nj; ++j) {
+        ptrdiff_t const ks = (srckoff + k) / 2 - kmin;
+        T const *restrict const ycol = &ybuf[ni * (j + nj * ks)];
+        if ((srckoff + k) % 2 == 0) {
+          for (ptrdiff_t i = 0; i < ni; ++i) {
+            dst[DSTIND3(dstioff + i, dstjoff + j, dstkoff + k)] =
+                interp1<T, ORDER, 0>(&ycol[i], ni * nj);
+          }
+        } else {
+          for (ptrdiff_t i = 0; i < ni; ++i) {
+            dst[DSTIND3(dstioff + i, dstjoff + j, dstkoff + k)] =
+                interp1<T, ORDER, 1>(&ycol[i], ni * nj);
+          }
+        }
+      }
+    }
+
+  } else if (not use_loopcontrol_in_operators) {
 
     // Loop over fine region
     // Label scheme: l 8 fk fj fi
@@ -0,0 +1,187 @@
+#include <cctk.h>
+#include <util_Table.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "quantize.hh"
+
+namespace CarpetLib {
+using namespace std;
+
+namespace {
+
+// The tolerances of all variables, or negative values for variables
+// which are not listed
+typedef vector<pair<double, double> > tolerances_t;
+
+void set_tolerances(int const vindex, char const *const optstring,
+                    void *const arg) {
+  tolerances_t &tolerances = *static_cast<tolerances_t *>(arg);
+  double abs_tol = 0.0, rel_tol = 0.0;
+  if (optstring) {
+    int const table = Util_TableCreateFromString(optstring);
+    if (table < 0) {
+      char *const fullname = CCTK_FullName(vindex);
+      CCTK_VWARN(CCTK_WARN_ALERT,
+                 "Cannot parse compression tolerances \"%s\" of variable "
+                 "\"%s\"",
+                 optstring, fullname);
+      free(fullname);
+    } else {
+      CCTK_REAL value;
+      if (Util_TableGetReal(table, &value, "absolute_tolerance") == 1)
+        abs_tol = value;
+      if (Util_TableGetReal(table, &value, "relative_tolerance") == 1)
+        rel_tol = value;
+      Util_TableDestroy(table);
+    }
+  }
+  if (abs_tol < 0.0 or rel_tol < 0.0) {
+    char *const fullname = CCTK_FullName(vindex);
+    CCTK_VWARN(CCTK_WARN_ALERT,
+               "Ignoring negative compression tolerances of variable \"%s\"",
+               fullname);
+    free(fullname);
+    abs_tol = max(abs_tol, 0.0);
+    rel_tol = max(rel_tol, 0.0);
+  }
+  tolerances.at(vindex) = make_pair(abs_tol, rel_tol);
+}
+
+// Round a value to a multiple of a power of two, keeping the error
+// within max(abs_tol, rel_tol * |x|). abs_exp is the exponent of the
+// largest power of two that is at most twice abs_tol (or a very
+// small number), and rel_exp is floor(log2(rel_tol)) (or a very small
+// number).
+template <typename T>
+inline T round_value(T const x, int const abs_exp, int const rel_exp) {
+  if (x == T(0) or not isfinite(x))
+    return x;
+  // x = m * 2^e with 0.5 <= |m| < 1, hence |x| >= 2^(e-1), and a
+  // step of 2^(e + rel_exp) has an error of at most 2^(e - 1 +
+  // rel_exp) <= rel_tol * |x|
+  int e;
+  frexp(x, &e);
+  int const step_exp = max(abs_exp, e + rel_exp);
+  T const r = ldexp(rint(ldexp(x, -step_exp)), step_exp);
+  return isfinite(r) ? r : x;
+}
+
+template <typename T>
+void quantize_values(T *const data, size_t const n, double const abs_tol,
+                     double const rel_tol) {
+  int const no_exp = numeric_limits<int>::min() / 2;
+  int abs_exp = no_exp, rel_exp = no_exp;
+  if (abs_tol > 0.0) {
+    frexp(2.0 * abs_tol, &abs_exp);
+    --abs_exp; // 2^abs_exp <= 2 * abs_tol
+  }
+  if (rel_tol > 0.0) {
+    frexp(rel_tol, &rel_exp);
+    --rel_exp; // 2^rel_exp <= rel_tol
+  }
+  if (abs_exp == no_exp and rel_exp == no_exp)
+    return;
+#pragma omp parallel for if (not omp_in_parallel())
+  for (ptrdiff_t i = 0; i < ptrdiff_t(n); ++i) {
+    data[i] = round_value(data[i], abs_exp, rel_exp);
+  }
+}
+
+} // namespace
+
+bool lookup_tolerances(char const *const spec, int const vindex,
+                       double &abs_tol, double &rel_tol) {
+  static map<string, tolerances_t> cache;
+  map<string, tolerances_t>::iterator it = cache.find(spec);
+  if (it == cache.end()) {
+    tolerances_t tolerances(CCTK_NumVars(), make_pair(-1.0, -1.0));
+    if (CCTK_TraverseString(spec, set_tolerances, &tolerances,
+                            CCTK_GROUP_OR_VAR) < 0) {
+      CCTK_VWARN(CCTK_WARN_ALERT,
+                 "Cannot parse compression tolerance specification \"%s\"",
+                 spec);
+    }
+    it = cache.insert(make_pair(string(spec), tolerances)).first;
+  }
+  pair<double, double> const &tolerance = it->second.at(vindex);
+  if (tolerance.first < 0.0)
+    return false;
+  abs_tol = tolerance.first;
+  rel_tol = tolerance.second;
+  return abs_tol > 0.0 or rel_tol > 0.0;
+}
+
+bool can_quantize(int const vartype) {
+  switch (vartype) {
+#ifdef HAVE_CCTK_REAL4
+  case CCTK_VARIABLE_REAL4:
+#ifdef HAVE_CCTK_COMPLEX8
+  case CCTK_VARIABLE_COMPLEX8:
+#endif
+#endif
+#ifdef HAVE_CCTK_REAL8
+  case CCTK_VARIABLE_REAL8:
+#ifdef HAVE_CCTK_COMPLEX16
+  case CCTK_VARIABLE_COMPLEX16:
+#endif
+#endif
+  case CCTK_VARIABLE_REAL:
+  case CCTK_VARIABLE_COMPLEX:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool quantize(int const vartype, void *const data, size_t const npoints,
+              double const abs_tol, double const rel_tol) {
+  switch (vartype) {
+#ifdef HAVE_CCTK_REAL4
+  case CCTK_VARIABLE_REAL4:
+    quantize_values(static_cast<CCTK_REAL4 *>(data), npoints, abs_tol,
+                    rel_tol);
+    return true;
+#ifdef HAVE_CCTK_COMPLEX8
+  case CCTK_VARIABLE_COMPLEX8:
+    quantize_values(static_cast<CCTK_REAL4 *>(data), 2 * npoints, abs_tol,
+                    rel_tol);
+    return true;
+#endif
+#endif
+#ifdef HAVE_CCTK_REAL8
+  case CCTK_VARIABLE_REAL8:
+    quantize_values(static_cast<CCTK_REAL8 *>(data), npoints, abs_tol,
+                    rel_tol);
+    return true;
+#ifdef HAVE_CCTK_COMPLEX16
+  case CCTK_VARIABLE_COMPLEX16:
+    quantize_values(static_cast<CCTK_REAL8 *>(data), 2 * npoints, abs_tol,
+                    rel_tol);
+    return true;
+#endif
+#endif
+  case CCTK_VARIABLE_REAL:
+    quantize_values(static_cast<CCTK_REAL *>(data), npoints, abs_tol, rel_tol);
+    return true;
+  case CCTK_VARIABLE_COMPLEX:
+    quantize_values(static_cast<CCTK_REAL *>(data), 2 * npoints, abs_tol,
+                    rel_tol);
+    return true;
+  default:
+    return false;
+  }
+}
+
+} // namespace CarpetLib
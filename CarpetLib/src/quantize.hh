@@ -0,0 +1,49 @@
+#ifndef QUANTIZE_HH
+#define QUANTIZE_HH
+
+#include <cctk.h>
+
+#include <cstddef>
+
+namespace CarpetLib {
+
+// Error-bounded lossy compression for output
+//
+// Floating-point data are rounded to multiples of a power of two, so
+// that their trailing mantissa bits become zero. The shuffle and
+// deflate filters then compress them much better, while the files
+// remain ordinary HDF5 files that any reader understands.
+//
+// With an absolute tolerance, the rounding error of each value is at
+// most the tolerance; with a relative tolerance, it is at most the
+// tolerance times the magnitude of the value. If both are given, the
+// larger of the two bounds holds for each value. A tolerance of zero
+// is ignored.
+//
+// Complex values are rounded component by component: the real and
+// imaginary parts are rounded independently, and a relative tolerance
+// applies to the magnitude of each part, not to the modulus of the
+// complex number. A part that is much smaller than the other is thus
+// kept more accurately than the modulus would require.
+
+// Look up the tolerances of a variable in a specification such as
+// "ADMBase::metric{absolute_tolerance=1.0e-10}
+// HydroBase::rho{relative_tolerance=1.0e-6}". Returns false if the
+// variable is not listed.
+bool lookup_tolerances(char const *spec, int vindex, double &abs_tol,
+                       double &rel_tol);
+
+// Whether values of the given Cactus type can be rounded, i.e.
+// whether the type is a real or complex type
+bool can_quantize(int vartype);
+
+// Round npoints values of a variable of the given Cactus type in place.
+// Returns false (and leaves the data unchanged) if the type is not a
+// real or complex type. The values are rounded in parallel, unless
+// this is called from within an OpenMP parallel region.
+bool quantize(int vartype, void *data, size_t npoints, double abs_tol,
+              double rel_tol);
+
+} // namespace CarpetLib
+
+#endif // #ifndef QUANTIZE_HH
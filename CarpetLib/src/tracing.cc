@@ -0,0 +1,274 @@
+#include <cctk.h>
+#include <cctk_Arguments.h>
+#include <cctk_Parameters.h>
+
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <time.h>
+
+#ifdef CCTK_MPI
+#include <mpi.h>
+#else
+#include "nompi.h"
+#endif
+
+#include "defs.hh"
+#include "dist.hh"
+#include "tracing.hh"
+
+namespace CarpetLib {
+namespace tracing {
+using namespace std;
+
+bool enabled_ = false;
+
+namespace {
+
+struct event_t {
+  double time;
+  char const *name;
+  int arg;
+  unsigned char cat;
+  char phase;
+};
+
+// A ring buffer holding the events of one thread
+struct thread_buffer_t {
+  vector<event_t> events;
+  size_t next;    // where the next event will be stored
+  size_t count;   // number of stored events
+  size_t dropped; // number of overwritten events
+  size_t open;    // number of written begin events without end event
+  char padding[64]; // avoid false sharing between threads
+};
+
+char const *const category_names[num_categories] = {"timer", "function",
+                                                    "comm", "io"};
+
+vector<thread_buffer_t> buffers;
+
+// Local time at which tracing started, and local time that
+// corresponds to the (globally synchronised) trace time zero
+double start_time;
+double epoch;
+bool synced = false;
+
+ofstream file;
+
+double now() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+}
+
+void write_string(ostream &os, char const *str) {
+  os << '"';
+  for (; *str; ++str) {
+    if (*str == '"' or *str == '\\')
+      os << '\\';
+    if (static_cast<unsigned char>(*str) >= ' ')
+      os << *str;
+  }
+  os << '"';
+}
+
+void write_event(ostream &os, event_t const &event, int const thread) {
+  os << "{\"name\":";
+  write_string(os, event.name);
+  os << ",\"cat\":\"" << category_names[event.cat] << "\",\"ph\":\""
+     << event.phase << "\",\"ts\":" << fixed << setprecision(3)
+     << 1.0e+6 * (event.time - epoch) << ",\"pid\":" << dist::rank()
+     << ",\"tid\":" << thread;
+  if (event.arg >= 0)
+    os << ",\"args\":{\"level\":" << event.arg << "}";
+  os << "},\n";
+}
+
+// Write and empty the buffer of a thread
+void flush(int const thread) {
+  assert(synced);
+  thread_buffer_t &buffer = buffers.AT(thread);
+  size_t const size = buffer.events.size();
+  ostringstream buf;
+  for (size_t n = 0; n < buffer.count; ++n) {
+    size_t const i = (buffer.next + size - buffer.count + n) % size;
+    event_t const &event = buffer.events[i];
+    // The events of a thread are properly nested. If the buffer
+    // wrapped before the trace file was opened, the begin events of
+    // some end events were overwritten; skip these end events.
+    if (event.phase == 'B') {
+      ++buffer.open;
+    } else if (event.phase == 'E') {
+      if (buffer.open == 0)
+        continue;
+      --buffer.open;
+    }
+    write_event(buf, event, thread);
+  }
+  buffer.count = 0;
+#pragma omp critical(CarpetLib_tracing_file)
+  file << buf.str();
+}
+
+} // namespace
+
+void init() {
+  DECLARE_CCTK_PARAMETERS;
+
+  if (not trace_timeline)
+    return;
+
+  int const num_threads = omp_get_max_threads();
+  buffers.resize(num_threads);
+  for (int thread = 0; thread < num_threads; ++thread) {
+    thread_buffer_t &buffer = buffers.AT(thread);
+    buffer.events.resize(trace_buffer_events);
+    buffer.next = 0;
+    buffer.count = 0;
+    buffer.dropped = 0;
+    buffer.open = 0;
+  }
+  start_time = now();
+  enabled_ = true;
+}
+
+void sync_clocks() {
+  DECLARE_CCTK_PARAMETERS;
+
+  if (not enabled_)
+    return;
+  assert(not synced);
+
+  // All processes leave the barrier at approximately the same time.
+  // Choose the trace time zero so that no event recorded so far has
+  // a negative time stamp.
+  MPI_Barrier(dist::comm());
+  double const sync_time = now();
+  double local_elapsed = sync_time - start_time;
+  double elapsed;
+  MPI_Allreduce(&local_elapsed, &elapsed, 1, MPI_DOUBLE, MPI_MAX,
+                dist::comm());
+  epoch = sync_time - elapsed;
+
+  ostringstream filenamebuf;
+  filenamebuf << out_dir << "/" << trace_file << "." << setw(4) << setfill('0')
+              << dist::rank() << ".json";
+  string const filename = filenamebuf.str();
+  file.open(filename.c_str(), ios::out | ios::trunc);
+  if (not file.good()) {
+    CCTK_VWARN(CCTK_WARN_ALERT,
+               "Could not open trace file \"%s\"; disabling tracing",
+               filename.c_str());
+    enabled_ = false;
+    return;
+  }
+
+  // Name the process and its threads
+  file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << dist::rank()
+       << ",\"args\":{\"name\":\"process " << dist::rank() << "\"}},\n"
+       << "{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":"
+       << dist::rank() << ",\"args\":{\"sort_index\":" << dist::rank()
+       << "}},\n";
+  for (size_t thread = 0; thread < buffers.size(); ++thread) {
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << dist::rank()
+         << ",\"tid\":" << thread << ",\"args\":{\"name\":\"thread "
+         << thread << "\"}},\n";
+  }
+
+  synced = true;
+}
+
+void finalize() {
+  if (not enabled_)
+    return;
+  enabled_ = false;
+
+  if (not synced)
+    return;
+
+  size_t dropped = 0;
+  for (size_t thread = 0; thread < buffers.size(); ++thread) {
+    flush(thread);
+    dropped += buffers.AT(thread).dropped;
+  }
+  file.close();
+  buffers.clear();
+
+  if (dropped > 0) {
+    CCTK_VINFO("%lu trace events were dropped before the trace file was "
+               "opened; increase CarpetLib::trace_buffer_events to keep them",
+               (unsigned long)dropped);
+  }
+}
+
+char const *intern(string const &name) {
+  static set<string> names;
+  char const *res;
+#pragma omp critical(CarpetLib_tracing_intern)
+  res = names.insert(name).first->c_str();
+  return res;
+}
+
+void record(char const phase, char const *const name, category_t const cat,
+            int const arg) {
+#ifdef _OPENMP
+  // Events in nested parallel regions are not recorded, since thread
+  // numbers are not unique there
+  if (omp_get_level() > 1)
+    return;
+#endif
+  int const thread = omp_get_thread_num();
+  if (thread >= int(buffers.size()))
+    return;
+  thread_buffer_t &buffer = buffers[thread];
+  size_t const size = buffer.events.size();
+
+  if (buffer.count == size) {
+    // The buffer is full. Write it to the trace file if that is
+    // already open, otherwise overwrite the oldest event.
+    if (synced) {
+      flush(thread);
+    } else {
+      --buffer.count;
+      ++buffer.dropped;
+    }
+  }
+
+  event_t &event = buffer.events[buffer.next];
+  event.time = now();
+  event.name = name;
+  event.arg = arg;
+  event.cat = cat;
+  event.phase = phase;
+  buffer.next = (buffer.next + 1) % size;
+  ++buffer.count;
+}
+
+} // namespace tracing
+
+extern "C" int CarpetLib_trace_startup();
+extern "C" void CarpetLib_trace_sync(CCTK_ARGUMENTS);
+extern "C" int CarpetLib_trace_shutdown();
+
+int CarpetLib_trace_startup() {
+  tracing::init();
+  return 0;
+}
+
+void CarpetLib_trace_sync(CCTK_ARGUMENTS) {
+  tracing::sync_clocks();
+}
+
+int CarpetLib_trace_shutdown() {
+  tracing::finalize();
+  return 0;
+}
+
+} // namespace CarpetLib
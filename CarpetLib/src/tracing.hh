@@ -0,0 +1,86 @@
+#ifndef TRACING_HH
+#define TRACING_HH
+
+#include <cctk.h>
+
+#include <string>
+
+namespace CarpetLib {
+
+// A per-process event timeline. Begin and end events of timers,
+// scheduled functions, communication steps, and I/O operations are
+// recorded into preallocated per-thread ring buffers, and are written
+// to one file per process in the Chrome trace event format. Each
+// file contains one event per line, and the files of all processes
+// can be merged into a single trace with
+//
+//    (echo '['; cat carpetlib-trace.*.json) > trace.json
+//
+// which can be loaded into a trace viewer such as chrome://tracing or
+// Perfetto. (The closing bracket is optional in this format.)
+//
+// Event names are stored as pointers; they must remain valid until
+// the trace is written. Use intern() for names that are constructed
+// at run time.
+namespace tracing {
+
+enum category_t {
+  cat_timer,    // Timers::Timer
+  cat_function, // scheduled function
+  cat_comm,     // comm_state step
+  cat_io,       // I/O
+  num_categories
+};
+
+// Whether events are currently recorded
+extern bool enabled_;
+inline bool enabled() { return enabled_; }
+
+// Set up the trace buffers (called at startup)
+void init();
+
+// Synchronise the clocks of all processes, and open the trace file
+// (collective)
+void sync_clocks();
+
+// Write the remaining events and close the trace file
+void finalize();
+
+// Return a pointer to a copy of the name that remains valid forever
+char const *intern(std::string const &name);
+
+// Record an event; arg is an optional integer argument (e.g. the
+// refinement level), or -1
+void record(char phase, char const *name, category_t cat, int arg);
+
+inline void begin(char const *const name, category_t const cat,
+                  int const arg = -1) {
+  if (enabled_)
+    record('B', name, cat, arg);
+}
+
+inline void end(char const *const name, category_t const cat,
+                int const arg = -1) {
+  if (enabled_)
+    record('E', name, cat, arg);
+}
+
+// Record a region that lasts for the lifetime of this object
+class region {
+  char const *name;
+  category_t cat;
+  int arg;
+
+public:
+  region(char const *const name_, category_t const cat_, int const arg_ = -1)
+      : name(name_), cat(cat_), arg(arg_) {
+    begin(name, cat, arg);
+  }
+  ~region() { end(name, cat, arg); }
+};
+
+} // namespace tracing
+
+} // namespace CarpetLib
+
+#endif // #ifndef TRACING_HH
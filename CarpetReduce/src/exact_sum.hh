@@ -0,0 +1,169 @@
+#ifndef EXACT_SUM_HH
+#define EXACT_SUM_HH
+
+// This header must not depend on Cactus, so that it can also be used
+// by the benchmark utility
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace CarpetReduce {
+
+// Exact summation of double precision values ("superaccumulator").
+// All values are added exactly into a long fixed-point integer that
+// covers the whole range of double precision numbers, so that the
+// result does not depend on the order in which values are added or
+// partial sums are combined. The integer is stored in 32-bit limbs
+// held in 64-bit words, which leaves room to add many values (or
+// partial sums from many processes) before carries need to be
+// propagated. Partial sums can thus be combined across processes
+// with MPI_SUM on the words.
+struct exact_sum {
+  // Bit 0 of limb 0 corresponds to 2^-1074, the smallest denormal
+  // number; the limbs cover all finite doubles plus room for carries
+  static const int limb_bits = 32;
+  static const int nlimbs = 70;
+  // Special values (nans and infinities) are counted separately
+  static const int inan = nlimbs, iposinf = nlimbs + 1, ineginf = nlimbs + 2;
+  // Number of values added since carries were last propagated
+  static const int ipending = nlimbs + 3;
+  static const int nwords = nlimbs + 4;
+  // Propagate carries after this many additions
+  static const long long max_pending = 1LL << 30;
+
+  long long words[nwords];
+
+  exact_sum() { clear(); }
+
+  void clear() { memset(words, 0, sizeof words); }
+
+  void add(const double x) {
+    unsigned long long bits;
+    memcpy(&bits, &x, sizeof bits);
+    const bool negative = bits >> 63;
+    const int biased_exponent = (bits >> 52) & 0x7ff;
+    unsigned long long mantissa = bits & ((1ULL << 52) - 1);
+    if (biased_exponent == 0x7ff) {
+      if (mantissa != 0) {
+        ++words[inan];
+      } else {
+        ++words[negative ? ineginf : iposinf];
+      }
+      return;
+    }
+    if (mantissa == 0 and biased_exponent == 0)
+      return;
+    // x = mantissa * 2^(pos - 1074)
+    int pos;
+    if (biased_exponent == 0) {
+      pos = 0;
+    } else {
+      mantissa |= 1ULL << 52;
+      pos = biased_exponent - 1;
+    }
+    const int i = pos / limb_bits;
+    const int s = pos % limb_bits;
+    const unsigned long long mask = 0xffffffffULL;
+    const long long lo = (mantissa & (mask >> s)) << s;
+    const unsigned long long rest = mantissa >> (limb_bits - s);
+    const long long mid = rest & mask;
+    const long long hi = rest >> limb_bits;
+    assert(i + 2 < nlimbs);
+    if (negative) {
+      words[i] -= lo;
+      words[i + 1] -= mid;
+      words[i + 2] -= hi;
+    } else {
+      words[i] += lo;
+      words[i + 1] += mid;
+      words[i + 2] += hi;
+    }
+    if (++words[ipending] >= max_pending)
+      normalise();
+  }
+
+  void add(const exact_sum &other) {
+    for (int i = 0; i < nwords; ++i) {
+      words[i] += other.words[i];
+    }
+    normalise();
+  }
+
+  // Propagate carries, so that all limbs except the topmost are in
+  // the range [0, 2^32); the topmost limb carries the sign
+  void normalise() {
+    long long carry = 0;
+    for (int i = 0; i < nlimbs - 1; ++i) {
+      const long long v = words[i] + carry;
+      words[i] = v & 0xffffffffLL;
+      carry = (v - words[i]) / (1LL << limb_bits);
+    }
+    words[nlimbs - 1] += carry;
+    words[ipending] = 0;
+  }
+
+  // Round the exact sum to the nearest double (ties to even). The
+  // result is correctly rounded, and it is deterministic, since the
+  // normalised representation of the sum is unique.
+  double value() const {
+    if (words[inan] or (words[iposinf] and words[ineginf]))
+      return std::numeric_limits<double>::quiet_NaN();
+    if (words[iposinf])
+      return std::numeric_limits<double>::infinity();
+    if (words[ineginf])
+      return -std::numeric_limits<double>::infinity();
+
+    exact_sum tmp(*this);
+    tmp.normalise();
+    const bool negative = tmp.words[nlimbs - 1] < 0;
+    if (negative) {
+      for (int i = 0; i < nlimbs; ++i) {
+        tmp.words[i] = -tmp.words[i];
+      }
+      tmp.normalise();
+    }
+    // Split the topmost limb, which may hold more than 32 bits
+    unsigned long long digits[nlimbs + 1];
+    for (int i = 0; i < nlimbs - 1; ++i)
+      digits[i] = tmp.words[i];
+    digits[nlimbs - 1] = tmp.words[nlimbs - 1] & 0xffffffffLL;
+    digits[nlimbs] = tmp.words[nlimbs - 1] >> limb_bits;
+    // Find the most significant bit
+    int top = nlimbs;
+    while (top >= 0 and digits[top] == 0)
+      --top;
+    if (top < 0)
+      return 0.0;
+    int msb = top * limb_bits;
+    for (unsigned long long d = digits[top] >> 1; d; d >>= 1)
+      ++msb;
+    // Keep the 53 most significant bits, and round with the bits
+    // below them
+    const int lsb = std::max(0, msb - 52);
+    unsigned long long mantissa = 0;
+    for (int k = msb; k >= lsb; --k)
+      mantissa = mantissa << 1 | bit(digits, k);
+    if (lsb > 0 and bit(digits, lsb - 1)) {
+      bool sticky = false;
+      for (int k = lsb - 2; k >= 0 and not sticky; --k)
+        sticky = bit(digits, k);
+      if (sticky or (mantissa & 1))
+        ++mantissa;
+    }
+    const double result = std::ldexp(double(mantissa), lsb - 1074);
+    return negative ? -result : result;
+  }
+
+private:
+  static unsigned long long bit(const unsigned long long *const digits,
+                                const int k) {
+    return digits[k / limb_bits] >> (k % limb_bits) & 1;
+  }
+};
+
+} // namespace CarpetReduce
+
+#endif // #ifndef EXACT_SUM_HH
@@ -30,6 +30,7 @@
 
 #include <carpet.hh>
 
+#include "exact_sum.hh"
 #include "reduce.hh"
 
 namespace CarpetReduce {
@@ -818,6 +819,307 @@ void finalise(void *const outval, const void *const cnt) {
   OP::finalise(*(T *)outval, *(const T *)cnt);
 }
 
+// Apply a reduction operator that is only known at run time; these
+// are used when several reductions are evaluated in a single sweep
+#define REDUCTION_CASES(CASE)                                                  \
+  CASE(count);                                                                 \
+  CASE(minimum);                                                               \
+  CASE(maximum);                                                               \
+  CASE(product);                                                               \
+  CASE(sum);                                                                   \
+  CASE(sum_abs);                                                               \
+  CASE(sum_squared);                                                           \
+  CASE(sum_abs_squared);                                                       \
+  CASE(average);                                                               \
+  CASE(norm1);                                                                 \
+  CASE(norm2);                                                                 \
+  CASE(norm_inf)
+
+template <class T>
+static inline void initialise_any(const ared thered, T &accum, T &cnt) {
+  switch (thered) {
+#define CASE(OP)                                                               \
+  case do_##OP:                                                                \
+    OP::op<T>::initialise(accum, cnt);                                         \
+    break
+    REDUCTION_CASES(CASE);
+#undef CASE
+  default:
+    assert(0);
+  }
+}
+
+// Apply one reduction to a row of n values; the weights (if any) are
+// multiplied by levfac, as in reduce
+template <class T, class OP>
+static void reduce_row(const T *const vals, const CCTK_REAL *const weight,
+                       const int n, const CCTK_REAL levfac, T &accum, T &cnt) {
+  for (int i = 0; i < n; ++i) {
+    CCTK_REAL const w = weight ? weight[i] * levfac : levfac;
+    OP::reduce(accum, cnt, vals[i], w);
+  }
+}
+
+template <class T>
+static void reduce_row_any(const ared thered, const T *const vals,
+                           const CCTK_REAL *const weight, const int n,
+                           const CCTK_REAL levfac, T &accum, T &cnt) {
+  switch (thered) {
+#define CASE(OP)                                                               \
+  case do_##OP:                                                                \
+    reduce_row<T, OP::op<T> >(vals, weight, n, levfac, accum, cnt);           \
+    break
+    REDUCTION_CASES(CASE);
+#undef CASE
+  default:
+    assert(0);
+  }
+}
+
+template <class T>
+static inline void combine_any(const ared thered, T &accum, T &cnt,
+                               const T &accum2, const T &cnt2) {
+  switch (thered) {
+#define CASE(OP)                                                               \
+  case do_##OP:                                                                \
+    OP::op<T>::combine(accum, cnt, accum2, cnt2);                              \
+    break
+    REDUCTION_CASES(CASE);
+#undef CASE
+  default:
+    assert(0);
+  }
+}
+
+template <class T>
+static inline void finalise_any(const ared thered, T &accum, const T &cnt) {
+  switch (thered) {
+#define CASE(OP)                                                               \
+  case do_##OP:                                                                \
+    OP::op<T>::finalise(accum, cnt);                                           \
+    break
+    REDUCTION_CASES(CASE);
+#undef CASE
+  default:
+    assert(0);
+  }
+}
+
+// Apply several reductions to one row of grid points of a variable.
+// The time-interpolated values of the row are computed once, so that
+// each grid point is read only once, and each reduction is then
+// applied to the whole row.
+template <class T>
+static inline void reduce_row_multi(const int index, const int n,
+                                    vector<const void *> const &inarrays,
+                                    vector<CCTK_REAL> const &tfacs,
+                                    vector<ared> const &thereds,
+                                    vector<CCTK_REAL> const &levfacs,
+                                    vector<T> &accums, vector<T> &cnts,
+                                    const CCTK_REAL *const weight,
+                                    vector<T> &vals) {
+  for (int i = 0; i < n; ++i) {
+    T myinval = T(0);
+    for (size_t tl = 0; tl < inarrays.size(); ++tl) {
+      myinval +=
+          static_cast<const T *>(inarrays.AT(tl))[index + i] * tfacs.AT(tl);
+    }
+    vals[i] = myinval;
+  }
+  for (size_t r = 0; r < thereds.size(); ++r) {
+    reduce_row_any(thereds[r], &vals[0], weight ? &weight[index] : NULL, n,
+                   levfacs[r], accums[r], cnts[r]);
+  }
+}
+
+template <class T>
+void reduce_multi(const int *const lsh, const int *const ash,
+                  const int *const bbox, const int *const nghostzones,
+                  vector<const void *> const &inarrays,
+                  vector<CCTK_REAL> const &tfacs, vector<ared> const &thereds,
+                  vector<CCTK_REAL> const &levfacs,
+                  vector<void *> const &outvals, vector<void *> const &cnts,
+                  const CCTK_REAL *const weight) {
+  for (size_t tl = 0; tl < inarrays.size(); ++tl) {
+    assert(inarrays.AT(tl));
+  }
+  assert(tfacs.size() == inarrays.size());
+  const size_t nreds = thereds.size();
+  assert(levfacs.size() == nreds);
+  assert(outvals.size() == nreds);
+  assert(cnts.size() == nreds);
+  vect<int, dim> imin, imax;
+  for (int d = 0; d < dim; ++d) {
+    imin[d] = (bbox[2 * d] ? 0 : nghostzones[d]);
+    imax[d] = lsh[d] - (bbox[2 * d + 1] ? 0 : nghostzones[d]);
+  }
+
+  vector<T> accums(nreds), mycnts(nreds);
+  for (size_t r = 0; r < nreds; ++r) {
+    initialise_any(thereds[r], accums[r], mycnts[r]);
+  }
+  const int n = max(0, imax[0] - imin[0]);
+  vector<T> vals(n);
+  if (n > 0) {
+#if CARPET_DIM == 3
+    for (int k = imin[2]; k < imax[2]; ++k) {
+      for (int j = imin[1]; j < imax[1]; ++j) {
+        const int index = imin[0] + ash[0] * (j + ash[1] * k);
+        reduce_row_multi(index, n, inarrays, tfacs, thereds, levfacs, accums,
+                         mycnts, weight, vals);
+      }
+    }
+#elif CARPET_DIM == 4
+    for (int l = imin[3]; l < imax[3]; ++l) {
+      for (int k = imin[2]; k < imax[2]; ++k) {
+        for (int j = imin[1]; j < imax[1]; ++j) {
+          const int index = imin[0] + ash[0] * (j + ash[1] * (k + ash[2] * l));
+          reduce_row_multi(index, n, inarrays, tfacs, thereds, levfacs, accums,
+                           mycnts, weight, vals);
+        }
+      }
+    }
+#else
+#error "Value of CARPET_DIM is not supported"
+#endif
+  }
+  for (size_t r = 0; r < nreds; ++r) {
+    combine_any(thereds[r], *static_cast<T *>(outvals[r]),
+                *static_cast<T *>(cnts[r]), accums[r], mycnts[r]);
+  }
+}
+
+// Reproducible sums: sum-type reductions of real variables can be
+// evaluated exactly (see exact_sum.hh). The result is then
+// independent of the order in which grid points are visited, of the
+// domain decomposition, and of the number of processes and threads.
+static bool is_exact_type(const int outtype) {
+  switch (specific_cactus_type(outtype)) {
+#ifdef HAVE_CCTK_REAL4
+  case CCTK_VARIABLE_REAL4:
+#endif
+#ifdef HAVE_CCTK_REAL8
+  case CCTK_VARIABLE_REAL8:
+#endif
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool is_exact_reduction(const ared thered) {
+  switch (thered) {
+  case do_count:
+  case do_sum:
+  case do_sum_abs:
+  case do_sum_squared:
+  case do_sum_abs_squared:
+  case do_average:
+  case do_norm1:
+  case do_norm2:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// The term that a grid point contributes to a sum-type reduction
+template <class T>
+static inline double exact_term(const ared thered, const CCTK_REAL weight,
+                                const T val) {
+  switch (thered) {
+  case do_count:
+    return weight;
+  case do_sum:
+  case do_average:
+    return weight * val;
+  case do_sum_abs:
+  case do_norm1:
+    return weight * abs(val);
+  case do_sum_squared:
+    return weight * CarpetReduce::mysqr(val);
+  case do_sum_abs_squared:
+  case do_norm2:
+    return weight * CarpetReduce::mysqrabs(val);
+  default:
+    assert(0);
+  }
+  return 0;
+}
+
+template <class T>
+static inline void reduce_point_exact(const int index,
+                                      vector<const void *> const &inarrays,
+                                      vector<CCTK_REAL> const &tfacs,
+                                      vector<ared> const &thereds,
+                                      vector<CCTK_REAL> const &levfacs,
+                                      vector<exact_sum *> const &accums,
+                                      vector<exact_sum *> const &cnts,
+                                      const CCTK_REAL *const weight) {
+  CCTK_REAL const w = weight ? weight[index] : 1.0;
+  if (w == 0)
+    return;
+  T myinval = T(0);
+  for (size_t tl = 0; tl < inarrays.size(); ++tl) {
+    myinval += static_cast<const T *>(inarrays.AT(tl))[index] * tfacs.AT(tl);
+  }
+  for (size_t r = 0; r < thereds.size(); ++r) {
+    CCTK_REAL const wr = w * levfacs[r];
+    accums[r]->add(exact_term(thereds[r], wr, myinval));
+    cnts[r]->add(wr);
+  }
+}
+
+template <class T>
+void reduce_exact(const int *const lsh, const int *const ash,
+                  const int *const bbox, const int *const nghostzones,
+                  vector<const void *> const &inarrays,
+                  vector<CCTK_REAL> const &tfacs, vector<ared> const &thereds,
+                  vector<CCTK_REAL> const &levfacs,
+                  vector<exact_sum *> const &accums,
+                  vector<exact_sum *> const &cnts,
+                  const CCTK_REAL *const weight) {
+  for (size_t tl = 0; tl < inarrays.size(); ++tl) {
+    assert(inarrays.AT(tl));
+  }
+  assert(tfacs.size() == inarrays.size());
+  const size_t nreds = thereds.size();
+  assert(levfacs.size() == nreds);
+  assert(accums.size() == nreds);
+  assert(cnts.size() == nreds);
+  vect<int, dim> imin, imax;
+  for (int d = 0; d < dim; ++d) {
+    imin[d] = (bbox[2 * d] ? 0 : nghostzones[d]);
+    imax[d] = lsh[d] - (bbox[2 * d + 1] ? 0 : nghostzones[d]);
+  }
+
+#if CARPET_DIM == 3
+  for (int k = imin[2]; k < imax[2]; ++k) {
+    for (int j = imin[1]; j < imax[1]; ++j) {
+      for (int i = imin[0]; i < imax[0]; ++i) {
+        const int index = i + ash[0] * (j + ash[1] * k);
+        reduce_point_exact<T>(index, inarrays, tfacs, thereds, levfacs, accums,
+                              cnts, weight);
+      }
+    }
+  }
+#elif CARPET_DIM == 4
+  for (int l = imin[3]; l < imax[3]; ++l) {
+    for (int k = imin[2]; k < imax[2]; ++k) {
+      for (int j = imin[1]; j < imax[1]; ++j) {
+        for (int i = imin[0]; i < imax[0]; ++i) {
+          const int index = i + ash[0] * (j + ash[1] * (k + ash[2] * l));
+          reduce_point_exact<T>(index, inarrays, tfacs, thereds, levfacs,
+                                accums, cnts, weight);
+        }
+      }
+    }
+  }
+#else
+#error "Value of CARPET_DIM is not supported"
+#endif
+}
+
 void Initialise(const cGH *const cgh, const int proc, const int num_outvals,
                 void *const myoutvals, const int outtype, void *const mycounts,
                 const reduction *const red) {
@@ -1006,6 +1308,203 @@ void Reduce(const cGH *const cgh, const int proc, const int *const mylsh,
   } // for n
 }
 
+// Apply several reductions to several variables. The accumulators
+// for reduction r and variable n are stored at
+// myoutvals[r][n] and mycounts[r][n]; only the reductions listed in
+// "which" are applied.
+void ReduceMulti(const cGH *const cgh, const int proc, const int *const mylsh,
+                 const int *const myash, const int *const mybbox,
+                 const int *const mynghostzones, const int num_inarrays,
+                 vector<const void *const *> const &inarrays,
+                 vector<CCTK_REAL> const &tfacs, const int intype,
+                 vector<char *> const &myoutvals, const int outtype,
+                 vector<char *> const &mycounts, vector<int> const &which,
+                 vector<const reduction *> const &reds,
+                 CCTK_REAL const *const weight,
+                 vector<CCTK_REAL> const &levfacs) {
+  assert(proc == -1 or (proc >= 0 and proc < CCTK_nProcs(cgh)));
+
+  assert(num_inarrays >= 0);
+  for (size_t tl = 0; tl < inarrays.size(); ++tl) {
+    assert(inarrays.AT(tl));
+    for (int n = 0; n < num_inarrays; ++n) {
+      assert(inarrays.AT(tl)[n]);
+    }
+  }
+  assert(tfacs.size() == inarrays.size());
+  assert(myoutvals.size() == reds.size());
+  assert(mycounts.size() == reds.size());
+  assert(levfacs.size() == reds.size());
+
+  assert(outtype == intype);
+
+  const int vartypesize = CCTK_VarTypeSize(outtype);
+  assert(vartypesize >= 0);
+
+  const size_t nwhich = which.size();
+  vector<ared> thereds(nwhich);
+  vector<CCTK_REAL> mylevfacs(nwhich);
+  for (size_t i = 0; i < nwhich; ++i) {
+    thereds.AT(i) = reds.AT(which.AT(i))->thered();
+    mylevfacs.AT(i) = levfacs.AT(which.AT(i));
+  }
+
+  vector<const void *> myinarrays(inarrays.size());
+  vector<void *> outvals(nwhich), cnts(nwhich);
+
+  for (int n = 0; n < num_inarrays; ++n) {
+
+    for (size_t tl = 0; tl < inarrays.size(); ++tl) {
+      myinarrays.AT(tl) = inarrays.AT(tl)[n];
+    }
+    for (size_t i = 0; i < nwhich; ++i) {
+      outvals.AT(i) = &myoutvals.AT(which.AT(i))[vartypesize * n];
+      cnts.AT(i) = &mycounts.AT(which.AT(i))[vartypesize * n];
+    }
+
+    switch (specific_cactus_type(outtype)) {
+#define TYPECASE(N, S)                                                         \
+  case N: {                                                                    \
+    typedef typeconv<S>::goodtype T;                                           \
+    reduce_multi<T>(mylsh, myash, mybbox, mynghostzones, myinarrays, tfacs,    \
+                    thereds, mylevfacs, outvals, cnts, weight);                \
+    break;                                                                     \
+  }
+#include "typecase.hh"
+#undef TYPECASE
+    default:
+      assert(0);
+    }
+
+  } // for n
+}
+
+// Apply the sum-type reductions listed in "which" to several
+// variables, accumulating exactly. The accumulators for reduction r
+// and variable n are stored at accums[r * num_inarrays + n] and
+// cnts[r * num_inarrays + n].
+void ReduceExact(const cGH *const cgh, const int proc, const int *const mylsh,
+                 const int *const myash, const int *const mybbox,
+                 const int *const mynghostzones, const int num_inarrays,
+                 vector<const void *const *> const &inarrays,
+                 vector<CCTK_REAL> const &tfacs, const int intype,
+                 const int outtype, vector<exact_sum> &accums,
+                 vector<exact_sum> &cnts, vector<int> const &which,
+                 vector<const reduction *> const &reds,
+                 CCTK_REAL const *const weight,
+                 vector<CCTK_REAL> const &levfacs) {
+  assert(proc == -1 or (proc >= 0 and proc < CCTK_nProcs(cgh)));
+
+  assert(num_inarrays >= 0);
+  for (size_t tl = 0; tl < inarrays.size(); ++tl) {
+    assert(inarrays.AT(tl));
+    for (int n = 0; n < num_inarrays; ++n) {
+      assert(inarrays.AT(tl)[n]);
+    }
+  }
+  assert(tfacs.size() == inarrays.size());
+  assert(accums.size() == reds.size() * num_inarrays);
+  assert(cnts.size() == reds.size() * num_inarrays);
+  assert(levfacs.size() == reds.size());
+
+  assert(outtype == intype);
+  assert(is_exact_type(outtype));
+
+  const size_t nwhich = which.size();
+  vector<ared> thereds(nwhich);
+  vector<CCTK_REAL> mylevfacs(nwhich);
+  for (size_t i = 0; i < nwhich; ++i) {
+    thereds.AT(i) = reds.AT(which.AT(i))->thered();
+    assert(is_exact_reduction(thereds.AT(i)));
+    mylevfacs.AT(i) = levfacs.AT(which.AT(i));
+  }
+
+  vector<const void *> myinarrays(inarrays.size());
+  vector<exact_sum *> myaccums(nwhich), mycnts(nwhich);
+
+  for (int n = 0; n < num_inarrays; ++n) {
+
+    for (size_t tl = 0; tl < inarrays.size(); ++tl) {
+      myinarrays.AT(tl) = inarrays.AT(tl)[n];
+    }
+    for (size_t i = 0; i < nwhich; ++i) {
+      myaccums.AT(i) = &accums.AT(which.AT(i) * num_inarrays + n);
+      mycnts.AT(i) = &cnts.AT(which.AT(i) * num_inarrays + n);
+    }
+
+    switch (specific_cactus_type(outtype)) {
+#ifdef HAVE_CCTK_REAL4
+    case CCTK_VARIABLE_REAL4:
+      reduce_exact<CCTK_REAL4>(mylsh, myash, mybbox, mynghostzones, myinarrays,
+                               tfacs, thereds, mylevfacs, myaccums, mycnts,
+                               weight);
+      break;
+#endif
+#ifdef HAVE_CCTK_REAL8
+    case CCTK_VARIABLE_REAL8:
+      reduce_exact<CCTK_REAL8>(mylsh, myash, mybbox, mynghostzones, myinarrays,
+                               tfacs, thereds, mylevfacs, myaccums, mycnts,
+                               weight);
+      break;
+#endif
+    default:
+      assert(0);
+    }
+
+  } // for n
+}
+
+// Finalise reduced values after they have been combined across all
+// processes
+static void FinaliseValues(const int num_outvals, void *const outvals,
+                           const int outtype, char *const counts,
+                           const reduction *const red) {
+  const int vartypesize = CCTK_VarTypeSize(outtype);
+  assert(vartypesize >= 0);
+
+  for (int n = 0; n < num_outvals; ++n) {
+
+    switch (specific_cactus_type(outtype)) {
+#define FINALISE(OP, S)                                                        \
+  case do_##OP: {                                                              \
+    typedef typeconv<S>::goodtype T;                                           \
+    void *const outval = &((char *)outvals)[vartypesize * n];                  \
+    T dummy;                                                                   \
+    void *const cnt =                                                          \
+        red->uses_cnt() ? (void *)&counts[vartypesize * n] : (void *)&dummy;   \
+    finalise<T, OP::op<T> >(outval, cnt);                                      \
+    break;                                                                     \
+  }
+#define TYPECASE(N, T)                                                         \
+  case N: {                                                                    \
+    switch (red->thered()) {                                                   \
+      FINALISE(count, T);                                                      \
+      FINALISE(minimum, T);                                                    \
+      FINALISE(maximum, T);                                                    \
+      FINALISE(product, T);                                                    \
+      FINALISE(sum, T);                                                        \
+      FINALISE(sum_abs, T);                                                    \
+      FINALISE(sum_squared, T);                                                \
+      FINALISE(sum_abs_squared, T);                                            \
+      FINALISE(average, T);                                                    \
+      FINALISE(norm1, T);                                                      \
+      FINALISE(norm2, T);                                                      \
+      FINALISE(norm_inf, T);                                                   \
+    default:                                                                   \
+      assert(0);                                                               \
+    }                                                                          \
+    break;                                                                     \
+  }
+#include "typecase.hh"
+#undef TYPECASE
+#undef FINALISE
+    default:
+      assert(0);
+    }
+
+  } // for n
+}
+
 void Finalise(const cGH *const cgh, const int proc, const int num_outvals,
               void *const outvals, const int outtype,
               const void *const myoutvals, const void *const mycounts,
@@ -1065,49 +1564,182 @@ void Finalise(const cGH *const cgh, const int proc, const int num_outvals,
       counts = recvbuf + bufsize;
     }
 
+    FinaliseValues(num_outvals, outvals, outtype, counts, red);
+
+  } // if
+}
+
+// Combine the results of several reductions across all processes.
+// Reductions using the same MPI operation are combined in a single
+// collective call. The results are stored as outvals[r][n]; only the
+// reductions listed in "which" are combined.
+void FinaliseMulti(const cGH *const cgh, const int proc, const int num_outvals,
+                   void *const outvals, const int outtype,
+                   vector<char *> const &myoutvals,
+                   vector<char *> const &mycounts, vector<int> const &which,
+                   vector<const reduction *> const &reds) {
+  assert(proc == -1 or (proc >= 0 and proc < CCTK_nProcs(cgh)));
+
+  assert(num_outvals >= 0);
+  assert(outvals or (proc != -1 and proc != CCTK_MyProc(cgh)));
+
+  const int nreds = reds.size();
+  assert((int)myoutvals.size() == nreds);
+  assert((int)mycounts.size() == nreds);
+
+  const int vartypesize = CCTK_VarTypeSize(outtype);
+  assert(vartypesize >= 0);
+  const int bufsize = num_outvals * vartypesize;
+
+  const MPI_Datatype mpitype = CarpetMPIDatatype(outtype);
+  bool const is_root = proc == -1 or proc == CCTK_MyProc(cgh);
+
+  const int nwhich = which.size();
+  vector<bool> done(nwhich, false);
+  for (int i0 = 0; i0 < nwhich; ++i0) {
+    if (done.AT(i0))
+      continue;
+    MPI_Op const op = reds.AT(which.AT(i0))->mpi_op();
+
+    // Collect all reductions using this operation
+    vector<int> group;
+    for (int i = i0; i < nwhich; ++i) {
+      int const r = which.AT(i);
+      if (not done.AT(i) and reds.AT(r)->mpi_op() == op) {
+        group.push_back(r);
+        done.AT(i) = true;
+      }
+    }
+
+    vector<char> sendbuf, recvbuf;
+    for (size_t i = 0; i < group.size(); ++i) {
+      int const r = group.AT(i);
+      sendbuf.insert(sendbuf.end(), myoutvals.AT(r), myoutvals.AT(r) + bufsize);
+      if (reds.AT(r)->uses_cnt()) {
+        assert(op == dist::mpi_sum);
+        sendbuf.insert(sendbuf.end(), mycounts.AT(r), mycounts.AT(r) + bufsize);
+      }
+    }
+    if (sendbuf.empty())
+      continue;
+    recvbuf.resize(sendbuf.size());
+    const int mpicount = sendbuf.size() / vartypesize;
+
+    if (proc == -1) {
+      MPI_Allreduce(&sendbuf[0], &recvbuf[0], mpicount, mpitype, op,
+                    CarpetMPIComm());
+    } else {
+      MPI_Reduce(&sendbuf[0], &recvbuf[0], mpicount, mpitype, op, proc,
+                 CarpetMPIComm());
+    }
+
+    if (is_root) {
+      char *pos = &recvbuf[0];
+      for (size_t i = 0; i < group.size(); ++i) {
+        int const r = group.AT(i);
+        char *const myresult = &static_cast<char *>(outvals)[r * bufsize];
+        memcpy(myresult, pos, bufsize);
+        pos += bufsize;
+        char *counts = NULL;
+        if (reds.AT(r)->uses_cnt()) {
+          counts = pos;
+          pos += bufsize;
+        }
+        FinaliseValues(num_outvals, myresult, outtype, counts, reds.AT(r));
+      }
+      assert(pos == &recvbuf[0] + recvbuf.size());
+    }
+  }
+}
+
+// Combine the exact sums of several reductions across all processes
+// in a single collective call, and round the results. Since the
+// partial sums are integers, combining them is exact as well. The
+// results are stored as outvals[r][n].
+void FinaliseExact(const cGH *const cgh, const int proc, const int num_outvals,
+                   void *const outvals, const int outtype,
+                   vector<exact_sum> const &accums,
+                   vector<exact_sum> const &cnts, vector<int> const &which,
+                   vector<const reduction *> const &reds) {
+  assert(proc == -1 or (proc >= 0 and proc < CCTK_nProcs(cgh)));
+
+  assert(num_outvals >= 0);
+  assert(outvals or (proc != -1 and proc != CCTK_MyProc(cgh)));
+
+  assert(accums.size() == reds.size() * num_outvals);
+  assert(cnts.size() == reds.size() * num_outvals);
+
+  const int vartypesize = CCTK_VarTypeSize(outtype);
+  assert(vartypesize >= 0);
+  const int bufsize = num_outvals * vartypesize;
+
+  const int nwords = exact_sum::nwords;
+  const int nwhich = which.size();
+  vector<long long> sendbuf(2 * nwords * nwhich * num_outvals);
+  vector<long long> recvbuf(sendbuf.size());
+  long long *pos = &sendbuf[0];
+  for (int i = 0; i < nwhich; ++i) {
     for (int n = 0; n < num_outvals; ++n) {
+      int const j = which.AT(i) * num_outvals + n;
+      // Propagate carries first, so that the sum of the words cannot
+      // overflow
+      exact_sum accum(accums.AT(j)), cnt(cnts.AT(j));
+      accum.normalise();
+      cnt.normalise();
+      pos = copy(accum.words, accum.words + nwords, pos);
+      pos = copy(cnt.words, cnt.words + nwords, pos);
+    }
+  }
+  assert(pos == &sendbuf[0] + sendbuf.size());
 
-      switch (specific_cactus_type(outtype)) {
-#define FINALISE(OP, S)                                                        \
-  case do_##OP: {                                                              \
-    typedef typeconv<S>::goodtype T;                                           \
-    void *const outval = &((char *)outvals)[vartypesize * n];                  \
-    T dummy;                                                                   \
-    void *const cnt =                                                          \
-        red->uses_cnt() ? (void *)&counts[vartypesize * n] : (void *)&dummy;   \
-    finalise<T, OP::op<T> >(outval, cnt);                                      \
-    break;                                                                     \
+  const MPI_Datatype mpitype = dist::mpi_datatype<long long>();
+  if (proc == -1) {
+    MPI_Allreduce(&sendbuf[0], &recvbuf[0], recvbuf.size(), mpitype, MPI_SUM,
+                  CarpetMPIComm());
+  } else {
+    MPI_Reduce(&sendbuf[0], &recvbuf[0], recvbuf.size(), mpitype, MPI_SUM,
+               proc, CarpetMPIComm());
   }
-#define TYPECASE(N, T)                                                         \
-  case N: {                                                                    \
-    switch (red->thered()) {                                                   \
-      FINALISE(count, T);                                                      \
-      FINALISE(minimum, T);                                                    \
-      FINALISE(maximum, T);                                                    \
-      FINALISE(product, T);                                                    \
-      FINALISE(sum, T);                                                        \
-      FINALISE(sum_abs, T);                                                    \
-      FINALISE(sum_squared, T);                                                \
-      FINALISE(sum_abs_squared, T);                                            \
-      FINALISE(average, T);                                                    \
-      FINALISE(norm1, T);                                                      \
-      FINALISE(norm2, T);                                                      \
-      FINALISE(norm_inf, T);                                                   \
-    default:                                                                   \
-      assert(0);                                                               \
-    }                                                                          \
-    break;                                                                     \
+
+  if (proc == -1 or proc == CCTK_MyProc(cgh)) {
+    long long const *pos = &recvbuf[0];
+    for (int i = 0; i < nwhich; ++i) {
+      int const r = which.AT(i);
+      ared const thered = reds.AT(r)->thered();
+      char *const myresult = &static_cast<char *>(outvals)[r * bufsize];
+      for (int n = 0; n < num_outvals; ++n) {
+        exact_sum accum, cnt;
+        copy(pos, pos + nwords, accum.words);
+        pos += nwords;
+        copy(pos, pos + nwords, cnt.words);
+        pos += nwords;
+        void *const outval = &myresult[vartypesize * n];
+        switch (specific_cactus_type(outtype)) {
+#define FINALISE(S)                                                            \
+  {                                                                            \
+    S myaccum = S(accum.value());                                              \
+    S const mycnt = S(cnt.value());                                            \
+    finalise_any(thered, myaccum, mycnt);                                      \
+    *static_cast<S *>(outval) = myaccum;                                       \
   }
-#include "typecase.hh"
-#undef TYPECASE
+#ifdef HAVE_CCTK_REAL4
+        case CCTK_VARIABLE_REAL4:
+          FINALISE(CCTK_REAL4);
+          break;
+#endif
+#ifdef HAVE_CCTK_REAL8
+        case CCTK_VARIABLE_REAL8:
+          FINALISE(CCTK_REAL8);
+          break;
+#endif
 #undef FINALISE
-      default:
-        assert(0);
+        default:
+          assert(0);
+        }
       }
-
-    } // for n
-
-  } // if
+    }
+    assert(pos == &recvbuf[0] + recvbuf.size());
+  }
 }
 
 int ReduceArrays(const cGH *const cgh, const int proc, const int num_dims,
@@ -1269,10 +1901,13 @@ int ReduceArrays(const cGH *const cgh, const int proc, const int num_dims,
   return 0;
 }
 
+// Apply one or several reductions to grid variables. With several
+// reductions, each grid point is read only once, and the results are
+// stored as outvals[r][n].
 int ReduceGVs(const cGH *const cgh, const int proc, const int num_outvals,
               const int outtype, void *const outvals, const int num_invars,
-              const int *const invars, const reduction *const red,
-              const int igrid) {
+              const int *const invars, vector<const reduction *> const &reds,
+              vector<int> const &igrids) {
   DECLARE_CCTK_PARAMETERS;
 
   assert(cgh);
@@ -1291,6 +1926,10 @@ int ReduceGVs(const cGH *const cgh, const int proc, const int num_outvals,
     assert(invars[n] >= 0 and invars[n] < CCTK_NumVars());
   }
 
+  const int nreds = reds.size();
+  assert(nreds > 0);
+  assert((int)igrids.size() == nreds);
+
   if (num_invars == 0)
     return 0;
 
@@ -1423,14 +2062,42 @@ int ReduceGVs(const cGH *const cgh, const int proc, const int num_outvals,
 
   CCTK_REAL const current_time = cgh->cctk_time;
 
+  // Minimum and maximum are by default not interpolated in time
+  vector<bool> want_time_interp(nreds);
+  bool any_want_time_interp = false;
+  for (int r = 0; r < nreds; ++r) {
+    ared const thered = reds.AT(r)->thered();
+    want_time_interp.AT(r) = min_max_time_interpolation or
+                             (thered != do_minimum and thered != do_maximum);
+    any_want_time_interp = any_want_time_interp or want_time_interp.AT(r);
+  }
+
+  // Sum-type reductions of real variables can be evaluated exactly
+  vector<int> exact_reds, regular_reds;
+  for (int r = 0; r < nreds; ++r) {
+    if (reproducible_reductions and is_exact_type(outtype) and
+        is_exact_reduction(reds.AT(r)->thered())) {
+      assert(want_time_interp.AT(r));
+      exact_reds.push_back(r);
+    } else {
+      regular_reds.push_back(r);
+    }
+  }
+  int const num_exact = exact_reds.empty() ? 0 : num_invars * num_outvals;
+  vector<exact_sum> exact_accums(nreds * num_exact);
+  vector<exact_sum> exact_cnts(nreds * num_exact);
+
   // keep local outvals and counts in a single buffer
   // to save a copy operation in the Finalise() step
-  vector<char> buffer(2 * vartypesize * num_invars * num_outvals);
-  char *const myoutvals = &buffer[0];
-  char *const mycounts = &buffer[vartypesize * num_invars * num_outvals];
-
-  Initialise(cgh, proc, num_invars * num_outvals, myoutvals, outtype, mycounts,
-             red);
+  int const bufsize = vartypesize * num_invars * num_outvals;
+  vector<char> buffer(2 * bufsize * nreds);
+  vector<char *> myoutvals(nreds), mycounts(nreds);
+  for (int r = 0; r < nreds; ++r) {
+    myoutvals.AT(r) = &buffer[2 * bufsize * r];
+    mycounts.AT(r) = &buffer[2 * bufsize * r + bufsize];
+    Initialise(cgh, proc, num_invars * num_outvals, myoutvals.AT(r), outtype,
+               mycounts.AT(r), reds.AT(r));
+  }
 
   BEGIN_GLOBAL_MODE(cgh) {
     for (int rl = minrl; rl < maxrl; ++rl) {
@@ -1439,9 +2106,7 @@ int ReduceGVs(const cGH *const cgh, const int proc, const int num_outvals,
         // Number of necessary time levels
         CCTK_REAL const level_time = cgh->cctk_time;
         bool need_time_interp =
-            ((min_max_time_interpolation or
-              (red->thered() != do_minimum and red->thered() != do_maximum)) and
-             not reduce_arrays and
+            (any_want_time_interp and not reduce_arrays and
              (fabs(current_time - level_time) >
               1e-12 * (fabs(level_time) + fabs(current_time) +
                        fabs(cgh->cctk_delta_time))));
@@ -1616,7 +2281,7 @@ int ReduceGVs(const cGH *const cgh, const int proc, const int num_outvals,
                 }
 
                 CCTK_REAL const *weight;
-                CCTK_REAL levfac;
+                vector<CCTK_REAL> levfacs(nreds);
                 if (want_global_mode or want_level_mode) {
                   static int iweight = -1;
                   if (iweight == -1) {
@@ -1628,10 +2293,15 @@ int ReduceGVs(const cGH *const cgh, const int proc, const int num_outvals,
                   assert(weight);
                   CCTK_REAL const levfac1 =
                       1.0 / prod(rvect(spacereflevelfact));
-                  levfac = want_level_mode or igrid ? 1.0 : levfac1;
+                  for (int r = 0; r < nreds; ++r) {
+                    levfacs.AT(r) =
+                        want_level_mode or igrids.AT(r) ? 1.0 : levfac1;
+                  }
                 } else {
                   weight = NULL;
-                  levfac = 1.0;
+                  for (int r = 0; r < nreds; ++r) {
+                    levfacs.AT(r) = 1.0;
+                  }
                 }
 
                 vector<vector<const void *> > myinarrays(num_tl);
@@ -1653,10 +2323,50 @@ int ReduceGVs(const cGH *const cgh, const int proc, const int num_outvals,
                   inarrays.AT(tl) = &myinarrays.AT(tl).AT(0);
                 }
 
-                Reduce(cgh, proc, &mylsh[0], &myash[0], &mybbox[0][0],
-                       &mynghostzones[0], num_invars, inarrays, tfacs, intype,
-                       num_invars * num_outvals, myoutvals, outtype, mycounts,
-                       red, weight, levfac);
+                if (not exact_reds.empty()) {
+                  ReduceExact(cgh, proc, &mylsh[0], &myash[0], &mybbox[0][0],
+                              &mynghostzones[0], num_invars, inarrays, tfacs,
+                              intype, outtype, exact_accums, exact_cnts,
+                              exact_reds, reds, weight, levfacs);
+                }
+                if (regular_reds.empty()) {
+                  // nothing to do
+                } else if (nreds == 1) {
+                  Reduce(cgh, proc, &mylsh[0], &myash[0], &mybbox[0][0],
+                         &mynghostzones[0], num_invars, inarrays, tfacs,
+                         intype, num_invars * num_outvals, myoutvals.AT(0),
+                         outtype, mycounts.AT(0), reds.AT(0), weight,
+                         levfacs.AT(0));
+                } else {
+                  // Reductions that are not interpolated in time use
+                  // only the current time level, and need a separate
+                  // sweep if other reductions are interpolated
+                  vector<int> interp_reds, current_reds;
+                  for (size_t i = 0; i < regular_reds.size(); ++i) {
+                    int const r = regular_reds.AT(i);
+                    if (need_time_interp and not want_time_interp.AT(r)) {
+                      current_reds.push_back(r);
+                    } else {
+                      interp_reds.push_back(r);
+                    }
+                  }
+                  if (not interp_reds.empty()) {
+                    ReduceMulti(cgh, proc, &mylsh[0], &myash[0], &mybbox[0][0],
+                                &mynghostzones[0], num_invars, inarrays, tfacs,
+                                intype, myoutvals, outtype, mycounts,
+                                interp_reds, reds, weight, levfacs);
+                  }
+                  if (not current_reds.empty()) {
+                    vector<const void *const *> const current_inarrays(
+                        1, inarrays.AT(0));
+                    vector<CCTK_REAL> const current_tfacs(1, 1.0);
+                    ReduceMulti(cgh, proc, &mylsh[0], &myash[0], &mybbox[0][0],
+                                &mynghostzones[0], num_invars,
+                                current_inarrays, current_tfacs, intype,
+                                myoutvals, outtype, mycounts, current_reds,
+                                reds, weight, levfacs);
+                  }
+                }
               }
               END_LOCAL_COMPONENT_LOOP;
             }
@@ -1669,8 +2379,19 @@ int ReduceGVs(const cGH *const cgh, const int proc, const int num_outvals,
   }
   END_GLOBAL_MODE;
 
-  Finalise(cgh, proc, num_invars * num_outvals, outvals, outtype, myoutvals,
-           mycounts, red);
+  if (not exact_reds.empty()) {
+    FinaliseExact(cgh, proc, num_invars * num_outvals, outvals, outtype,
+                  exact_accums, exact_cnts, exact_reds, reds);
+  }
+  if (regular_reds.empty()) {
+    // nothing to do
+  } else if (nreds == 1) {
+    Finalise(cgh, proc, num_invars * num_outvals, outvals, outtype,
+             myoutvals.AT(0), mycounts.AT(0), reds.AT(0));
+  } else {
+    FinaliseMulti(cgh, proc, num_invars * num_outvals, outvals, outtype,
+                  myoutvals, mycounts, regular_reds, reds);
+  }
 
   return 0;
 }
@@ -1694,7 +2415,8 @@ int ReduceGVs(const cGH *const cgh, const int proc, const int num_outvals,
                    const int *const invars) {                                  \
     const OP red;                                                              \
     return ReduceGVs(cgh, proc, num_outvals, outtype, outvals, num_invars,     \
-                     invars, &red, IGRID);                                     \
+                     invars, vector<const reduction *>(1, &red),               \
+                     vector<int>(1, IGRID));                                   \
   }
 
 REDUCTION(count, count, 0);
@@ -1725,32 +2447,50 @@ REDUCTION(inorm_inf, norm_inf, 1);
 
 #undef REDUCTION
 
+// The grid variable reduction operators registered with the flesh
+struct registered_reduction {
+  int handle;
+  const reduction *red;
+  int igrid;
+};
+static vector<registered_reduction> registered_reductions;
+
 int CarpetReduceStartup() {
-  CCTK_RegisterReductionOperator(count_GVs, "count");
-  CCTK_RegisterReductionOperator(minimum_GVs, "minimum");
-  CCTK_RegisterReductionOperator(maximum_GVs, "maximum");
-  CCTK_RegisterReductionOperator(product_GVs, "product");
-  CCTK_RegisterReductionOperator(sum_GVs, "sum");
-  CCTK_RegisterReductionOperator(sum_abs_GVs, "sum_abs");
-  CCTK_RegisterReductionOperator(sum_squared_GVs, "sum_squared");
-  CCTK_RegisterReductionOperator(sum_abs_squared_GVs, "sum_abs_squared");
-  CCTK_RegisterReductionOperator(average_GVs, "average");
-  CCTK_RegisterReductionOperator(norm1_GVs, "norm1");
-  CCTK_RegisterReductionOperator(norm2_GVs, "norm2");
-  CCTK_RegisterReductionOperator(norm_inf_GVs, "norm_inf");
-
-  CCTK_RegisterReductionOperator(icount_GVs, "icount");
-  CCTK_RegisterReductionOperator(iminimum_GVs, "iminimum");
-  CCTK_RegisterReductionOperator(imaximum_GVs, "imaximum");
-  CCTK_RegisterReductionOperator(iproduct_GVs, "iproduct");
-  CCTK_RegisterReductionOperator(isum_GVs, "isum");
-  CCTK_RegisterReductionOperator(isum_abs_GVs, "isum_abs");
-  CCTK_RegisterReductionOperator(isum_squared_GVs, "isum_squared");
-  CCTK_RegisterReductionOperator(isum_abs_squared_GVs, "isum_abs_squared");
-  CCTK_RegisterReductionOperator(iaverage_GVs, "iaverage");
-  CCTK_RegisterReductionOperator(inorm1_GVs, "inorm1");
-  CCTK_RegisterReductionOperator(inorm2_GVs, "inorm2");
-  CCTK_RegisterReductionOperator(inorm_inf_GVs, "inorm_inf");
+#define REGISTER(OPNAME, OP, IGRID)                                            \
+  do {                                                                         \
+    static const OP red;                                                       \
+    registered_reduction rr;                                                   \
+    rr.handle = CCTK_RegisterReductionOperator(OPNAME##_GVs, #OPNAME);         \
+    rr.red = &red;                                                             \
+    rr.igrid = IGRID;                                                          \
+    registered_reductions.push_back(rr);                                       \
+  } while (0)
+  REGISTER(count, count, 0);
+  REGISTER(minimum, minimum, 0);
+  REGISTER(maximum, maximum, 0);
+  REGISTER(product, product, 0);
+  REGISTER(sum, sum, 0);
+  REGISTER(sum_abs, sum_abs, 0);
+  REGISTER(sum_squared, sum_squared, 0);
+  REGISTER(sum_abs_squared, sum_abs_squared, 0);
+  REGISTER(average, average, 0);
+  REGISTER(norm1, norm1, 0);
+  REGISTER(norm2, norm2, 0);
+  REGISTER(norm_inf, norm_inf, 0);
+
+  REGISTER(icount, count, 1);
+  REGISTER(iminimum, minimum, 1);
+  REGISTER(imaximum, maximum, 1);
+  REGISTER(iproduct, product, 1);
+  REGISTER(isum, sum, 1);
+  REGISTER(isum_abs, sum_abs, 1);
+  REGISTER(isum_squared, sum_squared, 1);
+  REGISTER(isum_abs_squared, sum_abs_squared, 1);
+  REGISTER(iaverage, average, 1);
+  REGISTER(inorm1, norm1, 1);
+  REGISTER(inorm2, norm2, 1);
+  REGISTER(inorm_inf, norm_inf, 1);
+#undef REGISTER
 
   CCTK_RegisterReductionArrayOperator(count_arrays, "count");
   CCTK_RegisterReductionArrayOperator(minimum_arrays, "minimum");
@@ -1783,4 +2523,50 @@ int CarpetReduceStartup() {
   return 0;
 }
 
+// Apply several reductions to several grid variables at once. All
+// variables must have the same type and dimension. The results are
+// stored as outvals[reduction][variable]. Returns -1 if one of the
+// reduction handles was not registered by this thorn.
+extern "C" CCTK_INT CarpetReduce_ReduceGVsMultiple(
+    CCTK_POINTER_TO_CONST const cctkGH_, CCTK_INT const proc,
+    CCTK_INT const num_reductions, CCTK_INT const *const reduction_handles,
+    CCTK_INT const outtype, CCTK_POINTER const outvals,
+    CCTK_INT const num_invars, CCTK_INT const *const invars_) {
+  cGH const *const cctkGH = static_cast<cGH const *>(cctkGH_);
+  assert(cctkGH);
+
+  assert(num_reductions >= 0);
+  if (num_reductions == 0)
+    return 0;
+  assert(reduction_handles);
+
+  vector<const reduction *> reds(num_reductions);
+  vector<int> igrids(num_reductions);
+  for (int r = 0; r < num_reductions; ++r) {
+    size_t i;
+    for (i = 0; i < registered_reductions.size(); ++i) {
+      if (registered_reductions.AT(i).handle == reduction_handles[r])
+        break;
+    }
+    if (i == registered_reductions.size()) {
+      CCTK_VWarn(CCTK_WARN_COMPLAIN, __LINE__, __FILE__, CCTK_THORNSTRING,
+                 "Reduction handle %d does not refer to a grid variable "
+                 "reduction operator provided by CarpetReduce",
+                 int(reduction_handles[r]));
+      return -1;
+    }
+    reds.AT(r) = registered_reductions.AT(i).red;
+    igrids.AT(r) = registered_reductions.AT(i).igrid;
+  }
+
+  assert(num_invars >= 0);
+  vector<int> invars(num_invars);
+  for (int n = 0; n < num_invars; ++n) {
+    invars.AT(n) = invars_[n];
+  }
+
+  return ReduceGVs(cctkGH, proc, 1, outtype, outvals, num_invars,
+                   num_invars > 0 ? &invars[0] : NULL, reds, igrids);
+}
+
 } // namespace CarpetReduce
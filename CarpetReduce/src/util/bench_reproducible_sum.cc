@@ -0,0 +1,126 @@
+// Benchmark for reproducible sums
+//
+// Sums a set of values in several different ways, mimicking
+// different numbers of processes and threads (i.e. different
+// decompositions of the data into partial sums), both with ordinary
+// floating point addition and with the exact accumulation used by
+// CarpetReduce when reproducible_reductions is set. Reports the
+// spread of the results and the time per value for each method.
+//
+// Usage: bench_reproducible_sum [number of values] [number of repetitions]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/time.h>
+#include <vector>
+
+#include "../exact_sum.hh"
+
+using namespace std;
+using CarpetReduce::exact_sum;
+
+static double get_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1.0e-6 * tv.tv_usec;
+}
+
+// A simple deterministic pseudo-random number generator, so that all
+// runs use the same values
+static unsigned long long rng_state = 1;
+static double random_value() {
+  rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+  double const x = (rng_state >> 11) * (1.0 / 9007199254740992.0);
+  // Values of varying sign and magnitude, to provoke cancellation
+  return (2.0 * x - 1.0) * pow(10.0, floor(16.0 * x) - 8.0);
+}
+
+// Sum values in nparts contiguous chunks, then combine the partial
+// sums in order
+static double naive_sum(vector<double> const &values, int const nparts) {
+  size_t const n = values.size();
+  double total = 0.0;
+  for (int p = 0; p < nparts; ++p) {
+    size_t const imin = n * p / nparts, imax = n * (p + 1) / nparts;
+    double partial = 0.0;
+    for (size_t i = imin; i < imax; ++i)
+      partial += values[i];
+    total += partial;
+  }
+  return total;
+}
+
+static double exact_sum_parts(vector<double> const &values, int const nparts) {
+  size_t const n = values.size();
+  exact_sum total;
+  for (int p = 0; p < nparts; ++p) {
+    size_t const imin = n * p / nparts, imax = n * (p + 1) / nparts;
+    exact_sum partial;
+    for (size_t i = imin; i < imax; ++i)
+      partial.add(values[i]);
+    total.add(partial);
+  }
+  return total.value();
+}
+
+int main(int argc, char **argv) {
+  size_t const nvalues = argc > 1 ? atol(argv[1]) : 1000000;
+  int const nreps = argc > 2 ? atoi(argv[2]) : 5;
+  if (argc > 3 or nvalues == 0 or nreps <= 0) {
+    fprintf(stderr, "Usage: %s [number of values] [number of repetitions]\n",
+            argv[0]);
+    return 1;
+  }
+
+  vector<double> values(nvalues);
+  for (size_t i = 0; i < nvalues; ++i)
+    values[i] = random_value();
+
+  // Numbers of partial sums, corresponding to different numbers of
+  // processes and threads
+  int const nparts_list[] = {1, 2, 3, 4, 7, 16, 48, 128, 1000};
+  int const num_nparts = sizeof nparts_list / sizeof *nparts_list;
+
+  printf("Summing %zu values, %d repetitions\n", nvalues, nreps);
+  printf("%8s  %-24s %-24s\n", "parts", "naive", "exact");
+
+  double naive_min = HUGE_VAL, naive_max = -HUGE_VAL;
+  double exact_first = 0.0;
+  bool exact_identical = true;
+  double naive_time = 0.0, exact_time = 0.0;
+  for (int np = 0; np < num_nparts; ++np) {
+    int const nparts = nparts_list[np];
+    double naive = 0.0, exact = 0.0;
+
+    double t0 = get_time();
+    for (int rep = 0; rep < nreps; ++rep)
+      naive = naive_sum(values, nparts);
+    naive_time += get_time() - t0;
+
+    t0 = get_time();
+    for (int rep = 0; rep < nreps; ++rep)
+      exact = exact_sum_parts(values, nparts);
+    exact_time += get_time() - t0;
+
+    printf("%8d  %-24.17g %-24.17g\n", nparts, naive, exact);
+    naive_min = min(naive_min, naive);
+    naive_max = max(naive_max, naive);
+    if (np == 0)
+      exact_first = exact;
+    else if (memcmp(&exact, &exact_first, sizeof exact) != 0)
+      exact_identical = false;
+  }
+
+  double const nsums = double(nvalues) * nreps * num_nparts;
+  printf("\n");
+  printf("naive: spread of results %g, %.3f ns per value\n",
+         naive_max - naive_min, 1.0e9 * naive_time / nsums);
+  printf("exact: results are %s, %.3f ns per value\n",
+         exact_identical ? "bitwise identical" : "NOT IDENTICAL",
+         1.0e9 * exact_time / nsums);
+
+  return exact_identical ? 0 : 1;
+}
@@ -10,4 +10,18 @@ extern "C" void PeriodicCarpet_ParamCheck(CCTK_ARGUMENTS) {
     CCTK_PARAMWARN("When PeriodicCarpet::periodic is set, all boundaries are "
                    "periodic. It does not make sense to also set any of "
                    "PeriodicCarpet::periodic_[xyz]");
+
+  if (fuse_with_sync and
+      not(periodic or (periodic_x and periodic_y and periodic_z)))
+    CCTK_PARAMWARN("PeriodicCarpet::fuse_with_sync requires that all "
+                   "boundaries are periodic, since periodic boundaries may "
+                   "otherwise need to be applied after the physical boundary "
+                   "conditions");
+
+  if (fuse_with_sync and (CCTK_EQUALS(presync_mode, "off") or
+                          CCTK_EQUALS(presync_mode, "warn-only")))
+    CCTK_PARAMWARN("PeriodicCarpet::fuse_with_sync requires that Carpet "
+                   "applies the boundary conditions after synchronising, i.e. "
+                   "Cactus::presync_mode must be neither \"off\" nor "
+                   "\"warn-only\"");
 }
@@ -84,11 +84,12 @@ MPI_Datatype mpi_datatype(xferinfo_t const &) {
 
 struct levelinfo_t {
   int regridding_epoch;
+  ivect periodic; // periodic directions for which this schedule was set up
   vector<xferinfo_t> xferinfos;
-  levelinfo_t() : regridding_epoch(-1) {}
+  levelinfo_t() : regridding_epoch(-1), periodic(-1) {}
   friend ostream &operator<<(ostream &os, const levelinfo_t &li) {
     os << "levelinfo_t{regridding_epoch=" << li.regridding_epoch
-       << ",xferinfos=vector<xferinfo_t>[";
+       << ",periodic=" << li.periodic << ",xferinfos=vector<xferinfo_t>[";
     for (const auto &xi : li.xferinfos)
       os << xi << ",";
     os << "]}";
@@ -103,7 +104,265 @@ ostream &operator<<(ostream &os, const vector<levelinfo_t> &lis) {
   return os;
 }
 
-static vector<levelinfo_t> levelinfos;
+// The cached data structures, containing the communication schedule
+// for each multigrid and refinement level, either for all maps (level
+// mode) or for a single map (local mode)
+static vector<vector<levelinfo_t> > levelinfos;                 // [ml][rl]
+static vector<vector<vector<levelinfo_t> > > local_levelinfos; // [ml][rl][m]
+
+// The schedule and the variables whose periodic boundaries are being
+// filled while they are synchronised. These are only set between the
+// preparation and the end of a synchronisation.
+static vector<xferinfo_t> const *sync_xferinfos = NULL;
+static vector<bool> fused_vars; // [vi]
+
+// Determine the source regions for the periodic boundaries of all
+// local components on the given level, or only of the local
+// component on the given map if only_map is not negative. This is a
+// collective operation if the schedule needs to be (re-)generated.
+static vector<xferinfo_t> const &get_xferinfos(int const ml, int const rl,
+                                               CCTK_INT const do_periodic[3],
+                                               int const only_map) {
+  DECLARE_CCTK_PARAMETERS;
+
+  ivect const periodic_dirs(do_periodic[0], do_periodic[1], do_periodic[2]);
+
+  if (mglevels > (int)levelinfos.size())
+    levelinfos.resize(mglevels);
+  if (reflevels > (int)levelinfos.AT(ml).size())
+    levelinfos.AT(ml).resize(reflevels);
+  if (mglevels > (int)local_levelinfos.size())
+    local_levelinfos.resize(mglevels);
+  if (reflevels > (int)local_levelinfos.AT(ml).size())
+    local_levelinfos.AT(ml).resize(reflevels);
+  if (maps > (int)local_levelinfos.AT(ml).AT(rl).size())
+    local_levelinfos.AT(ml).AT(rl).resize(maps);
+  levelinfo_t &levelinfo = only_map >= 0
+                               ? local_levelinfos.AT(ml).AT(rl).AT(only_map)
+                               : levelinfos.AT(ml).AT(rl);
+  vector<xferinfo_t> &xferinfos = levelinfo.xferinfos;
+
+  // Do we need a new levelinfo? (We need a new levelinfo after each
+  // regridding.)
+  if (levelinfo.regridding_epoch == level_regridding_epochs.AT(rl) and
+      all(levelinfo.periodic == periodic_dirs))
+    return xferinfos;
+
+  if (verbose)
+    CCTK_INFO("New regridding epoch -- (re-)generating levelinfos");
+
+  levelinfo.regridding_epoch = level_regridding_epochs.AT(rl);
+  levelinfo.periodic = periodic_dirs;
+  xferinfos.clear();
+
+  int const mmin = only_map >= 0 ? only_map : 0;
+  int const mmax = only_map >= 0 ? only_map + 1 : maps;
+  for (int m = mmin; m < mmax; ++m) {
+
+    // Loop over all local components and find out how to fill their
+    // periodic boundaries
+
+    gh const &hh = *vhh.AT(m);
+    if (only_map >= 0 and hh.local_components(rl) != 1)
+      CCTK_ERROR("Cannot handle more than one local component in local mode");
+    ibbox const &domain_exterior = hh.baseextent(ml, rl);
+    i2vect const &boundary_width = hh.boundary_width;
+    ibbox const domain_active = domain_exterior.expand(-boundary_width);
+    dh const &dd = *vdd.AT(m);
+    dh::light_cboxes const &light_level = dd.light_boxes.AT(ml).AT(rl);
+
+    // Interior of the domain with respect to periodic boundaries,
+    // i.e. periodic boundaries cut off, but all other boundaries
+    // still included
+    ibbox domain_perint;
+    {
+      ivect lo, hi, str;
+      for (int d = 0; d < dim; ++d) {
+        ibbox const &dom = do_periodic[d] ? domain_active : domain_exterior;
+        lo[d] = dom.lower()[d];
+        hi[d] = dom.upper()[d];
+        str[d] = dom.stride()[d];
+      }
+      domain_perint = ibbox(lo, hi, str);
+    }
+
+    for (int lc = 0; lc < hh.local_components(rl); ++lc) {
+      int const c = hh.get_component(rl, lc);
+
+      // Exterior and outer boundaries of this component
+      ibbox const &ext = light_level.AT(c).exterior;
+      b2vect const &obnds = hh.outer_boundaries(rl, c);
+
+      // Collect all periodic boundaries for this component
+      ibset dst_bset;
+      for (int d = 0; d < dim; ++d) {
+        for (int f = 0; f < 2; ++f) {
+          if (obnds[f][d] and do_periodic[d]) {
+            // This is a periodic boundary
+            ivect lo = ext.lower();
+            ivect up = ext.upper();
+            ivect const str = ext.stride();
+            int const bnd = boundary_width[f][d];
+            if (f == 0)
+              up[d] = lo[d] + (bnd - 1) * str[d];
+            else
+              lo[d] = up[d] - (bnd - 1) * str[d];
+            ibbox const dst_bbox(lo, up, str);
+            assert(dst_bbox.shape()[d] / dst_bbox.stride()[d] == bnd);
+            dst_bset |= dst_bbox;
+          }
+        }
+      }
+
+      // Determine the source bboxes
+      while (not dst_bset.empty()) {
+
+        // Pick one (arbitrary) dst_bbox
+        ibbox const dst_bbox1 = *dst_bset.iterator().begin();
+
+        // Find the slabbing offset (a multiple of the domain size)
+        // that moves dst_bbox1 into the domain
+        islab slab;
+        for (int d = 0; d < dim; ++d) {
+          if (not do_periodic[d]) {
+            slab.offset[d] = 0;
+          } else {
+            assert((dst_bbox1.lower()[d] - domain_perint.lower()[d]) %
+                       domain_perint.stride()[d] ==
+                   0);
+            slab.offset[d] =
+                -rounddn(dst_bbox1.lower()[d] - domain_perint.lower()[d],
+                         domain_perint.shape()[d]) /
+                domain_perint.stride()[d];
+          }
+        }
+        assert(not all(slab.offset == 0)); // this would be trivial
+
+        // Determine corresponding source bbox
+        ibbox const src_bbox1 = dst_bbox1.shift(slab.offset);
+
+        // Ensure we copy from within the domain, not from boundary
+        // points
+        ibbox const src_bbox = src_bbox1 & domain_perint;
+        assert(not src_bbox.empty());
+        ibbox const dst_bbox = src_bbox.shift(-slab.offset);
+        assert(dst_bbox.is_contained_in(dst_bbox1));
+        dst_bset -= dst_bbox;
+
+        // Find source components for all points. We first look at
+        // the interior of all components, and only then at their
+        // exteriors. We cannot copy only from the interior (the
+        // "good" points), because this excludes the ghost zones, and
+        // we may need to copy from prolongation boundaries. (This
+        // assumes that prolongation occurs before periodic boundaries
+        // are applied!) Preferring the interior ensures that we never
+        // copy from ghost zones that are filled by synchronisation,
+        // so that these transfers can be executed while the level is
+        // being synchronised.
+        ibset src_bset(src_bbox);
+        for (int pass = 0; pass < 2; ++pass) {
+          for (int oc = 0; oc < hh.components(rl); ++oc) {
+            ibbox const &src_region = pass == 0
+                                          ? light_level.AT(oc).interior
+                                          : light_level.AT(oc).exterior;
+            ibset const intersection = src_bset & src_region;
+            if (not intersection.empty()) {
+              src_bset -= intersection;
+
+              // Loop over the intersection and insert respective
+              // xferinfos
+              for (ibbox const src_reg : intersection.iterator()) {
+                ibbox const dst_reg = src_reg.shift(-slab.offset);
+                xferinfo_t xferinfo;
+                xferinfo.m = m;
+                xferinfo.sendrecv.send.extent = src_reg;
+                xferinfo.sendrecv.send.component = oc;
+                xferinfo.sendrecv.recv.extent = dst_reg;
+                xferinfo.sendrecv.recv.component = c;
+                xferinfo.slab = slab;
+                xferinfos.push_back(xferinfo);
+              }
+            }
+          } // for oc
+        }   // for pass
+        // Ensure we know how to handle all points
+        assert(src_bset.empty());
+
+      } // while dst_bset
+
+    } // for lc
+
+  } // for m
+
+  // Tell the source processes what they have to send
+  {
+    int const p = dist::rank();
+    vector<vector<xferinfo_t> > sends(dist::size());
+    for (xferinfo_t const &xferinfo : xferinfos) {
+      gh const &hh = *vhh.AT(xferinfo.m);
+      int const oc = xferinfo.sendrecv.send.component;
+      int const op = hh.processor(rl, oc);
+      if (op != p)
+        sends.AT(op).push_back(xferinfo);
+    }
+
+    vector<xferinfo_t> const recv = alltoallv1(dist::comm(), sends);
+
+    xferinfos.insert(xferinfos.end(), recv.begin(), recv.end());
+  }
+
+  if (verbose) {
+    ostringstream buf;
+    buf << "levelinfo[ml=" << ml << ",rl=" << rl;
+    if (only_map >= 0)
+      buf << ",m=" << only_map;
+    buf << "]=" << levelinfo;
+    CCTK_INFO(buf.str().c_str());
+  }
+
+  return xferinfos;
+}
+
+// Execute one communication state of the transfers for the given
+// variables
+static void periodic_transfer(comm_state &state,
+                              vector<xferinfo_t> const &xferinfos,
+                              CCTK_INT const *restrict const vars,
+                              int const nvars, int const tl, int const rl,
+                              int const ml) {
+  for (xferinfo_t const &xferinfo : xferinfos) {
+
+    gh const &hh = *vhh.AT(xferinfo.m);
+
+    // Determine components, local components, processes
+    int const oc = xferinfo.sendrecv.send.component;
+    int const c = xferinfo.sendrecv.recv.component;
+    int const olc = hh.get_local_component(rl, oc);
+    int const lc = hh.get_local_component(rl, c);
+    int const op = hh.processor(rl, oc);
+    int const p = hh.processor(rl, c);
+
+    for (int n = 0; n < nvars; ++n) {
+      int const vi = vars[n];
+      int const gi = CCTK_GroupIndexFromVarI(vi);
+      int const v0 = CCTK_FirstVarIndexI(gi);
+
+      ggf &ff = *arrdata.AT(gi).AT(xferinfo.m).data.AT(vi - v0);
+
+      // Get pointers to the variable's data
+      gdata *const src =
+          hh.is_local(rl, oc) ? ff.data_pointer(tl, rl, olc, ml) : NULL;
+      gdata *const dst =
+          hh.is_local(rl, c) ? ff.data_pointer(tl, rl, lc, ml) : NULL;
+
+      // Copy
+      ibbox const &dstbox = xferinfo.sendrecv.recv.extent;
+      ibbox const &srcbox = xferinfo.sendrecv.send.extent;
+      islab const &slab = xferinfo.slab;
+      gdata::copy_data(dst, state, src, dstbox, srcbox, &slab, p, op);
+    }
+  }
+}
 
 static void periodic_carpet(cGH const *restrict const cctkGH, int const size,
                             CCTK_INT const *restrict const stencil,
@@ -143,255 +402,105 @@ static void periodic_carpet(cGH const *restrict const cctkGH, int const size,
                   CCTK_GroupNameFromVarI(vi), group.dim, size);
   }
 
-  // Ensure we are in level mode (and not global mode)
+  // Ensure we are in level or local mode (and not global mode). In
+  // local mode, only the current component is handled.
   assert(reflevel >= 0);
+  int const only_map = component >= 0 ? Carpet::map : -1;
 
-  // The cached data structures, containing the communication schedule
-  // for each refinement level
   int const ml = mglevel;
   int const rl = reflevel;
   int const tl = 0;
 
-  if (reflevels >= (int)levelinfos.size())
-    levelinfos.resize(reflevels);
-  levelinfo_t &levelinfo = levelinfos.at(reflevel);
-  vector<xferinfo_t> &xferinfos = levelinfo.xferinfos;
+  vector<xferinfo_t> const &xferinfos =
+      get_xferinfos(ml, rl, do_periodic, only_map);
 
-  // Do we need a new levelinfo? (We need a new levelinfo after each
-  // regridding.)
-  if (levelinfo.regridding_epoch != level_regridding_epochs.at(reflevel)) {
-    if (verbose)
-      CCTK_INFO("New regridding epoch -- (re-)generating levelinfos");
-
-    levelinfo.regridding_epoch = level_regridding_epochs.at(reflevel);
-    xferinfos.clear();
-
-    // Loop over all components and find out how to fill their
-    // periodic boundaries
+  // Transfer: Loop over all communication phases, all variables, and
+  // all regions
+  for (comm_state state; not state.done(); state.step())
+    periodic_transfer(state, xferinfos, vars, nvars, tl, rl, ml);
+}
 
-    gh const &hh = *vhh.at(Carpet::map);
-    ibbox const &domain_exterior = hh.baseextent(mglevel, reflevel);
-    i2vect const &boundary_width = hh.boundary_width;
-    ibbox const domain_active = domain_exterior.expand(-boundary_width);
-    dh const &dd = *vdd.at(Carpet::map);
-    dh::light_cboxes const &light_level =
-        dd.light_boxes.AT(mglevel).AT(reflevel);
+// Apply periodic boundaries while groups are being synchronised, so
+// that they do not require a separate communication round. Only
+// variables that are selected for boundary conditions are handled.
+static void periodic_sync_prepare(cGH const *const cctkGH,
+                                  vector<int> const &groups) {
+  DECLARE_CCTK_PARAMETERS;
 
-    if (hh.local_components(reflevel) != 1)
-      CCTK_ERROR("Cannot handle more than one local component");
+  sync_xferinfos = NULL;
+  fused_vars.clear();
 
-    // Interior of the domain with respect to periodic boundaries,
-    // i.e. periodic boundaries cut off, but all other boundaries
-    // still included
-    ibbox domain_perint;
-    {
-      ivect lo, hi, str;
-      for (int d = 0; d < dim; ++d) {
-        ibbox const &dom = do_periodic[d] ? domain_active : domain_exterior;
-        lo[d] = dom.lower()[d];
-        hi[d] = dom.upper()[d];
-        str[d] = dom.stride()[d];
-      }
-      domain_perint = ibbox(lo, hi, str);
-    }
+  // Only grid arrays can be synchronised in global mode
+  if (reflevel < 0)
+    return;
 
-    // CCTK_INT width[2*dim];
-    // CCTK_INT is_internal[2*dim];
-    // CCTK_INT is_staggered[2*dim];
-    // CCTK_INT shiftout[2*dim];
-    // int ierr = GetBoundarySpecification
-    //   (2*dim, width, is_internal, is_staggered, shiftout);
-    // assert(not ierr);
-
-    // // Domain size
-    // CCTK_REAL physical_min[dim];
-    // CCTK_REAL physical_max[dim];
-    // CCTK_REAL interior_min[dim];
-    // CCTK_REAL interior_max[dim];
-    // CCTK_REAL exterior_min[dim];
-    // CCTK_REAL exterior_max[dim];
-    // CCTK_REAL spacing[dim];
-    // ierr = GetDomainSpecification(dim,
-    //                               physical_min, physical_max,
-    //                               interior_min, interior_max,
-    //                               exterior_min, exterior_max,
-    //                               spacing);
-    // assert(not ierr);
-
-    // Domain size on this level, in terms of grid points
-    // ivect npoints;
-    // for (int d=0; d<dim; ++d) {
-    //   CCTK_REAL const rnpoints =
-    //     (exterior_max[d] - exterior_min[d]) / spacing[d]
-    //     + 1 - (width[2*d] + width[2*d+1]);
-    //   npoints[d] = floor(rnpoints + 0.01);
-    //   // Ensure the domain size is integer
-    //   assert(fabs(npoints[d] - rnpoints) < 0.01);
-    // }
-
-    DECLARE_CCTK_ARGUMENTS;
-
-    // Exterior of this component
-    ibbox const &ext = light_level.at(component).exterior;
-
-    // Collect all periodic boundaries for this component
-    ibset dst_bset;
-    for (int d = 0; d < dim; ++d) {
-      for (int f = 0; f < 2; ++f) {
-        if (cctk_bbox[2 * d + f] and do_periodic[d]) {
-          // This is a periodic boundary
-          ivect lo = ext.lower();
-          ivect up = ext.upper();
-          ivect const str = ext.stride();
-          int const bnd = boundary_width[f][d];
-          if (f == 0)
-            up[d] = lo[d] + (bnd - 1) * str[d];
-          else
-            lo[d] = up[d] - (bnd - 1) * str[d];
-          ibbox const dst_bbox(lo, up, str);
-          assert(dst_bbox.shape()[d] / dst_bbox.stride()[d] == bnd);
-          dst_bset |= dst_bbox;
-        }
+  fused_vars.resize(CCTK_NumVars(), false);
+  bool any_vars = false;
+  for (int const gi : groups) {
+    if (CCTK_GroupTypeI(gi) != CCTK_GF or CCTK_GroupDimI(gi) != dim)
+      continue;
+    int const v0 = CCTK_FirstVarIndexI(gi);
+    int const nvars = CCTK_NumVarsInGroupI(gi);
+    for (int vi = v0; vi < v0 + nvars; ++vi) {
+      if (QueryDriverBCForVarI(cctkGH, vi)) {
+        fused_vars.AT(vi) = true;
+        any_vars = true;
       }
     }
+  }
+  // The boundary condition selections are the same on all processes
+  if (not any_vars)
+    return;
 
-    // Determine the source bboxes
-    while (not dst_bset.empty()) {
-
-      // Pick one (arbitrary) dst_bbox
-      ibbox const dst_bbox1 = *dst_bset.iterator().begin();
-
-      // Find the slabbing offset (a multiple of the domain size)
-      // that moves dst_bbox1 into the domain
-      islab slab;
-      for (int d = 0; d < dim; ++d) {
-        if (not do_periodic[d]) {
-          slab.offset[d] = 0;
-        } else {
-          assert((dst_bbox1.lower()[d] - domain_perint.lower()[d]) %
-                     domain_perint.stride()[d] ==
-                 0);
-          slab.offset[d] =
-              -rounddn(dst_bbox1.lower()[d] - domain_perint.lower()[d],
-                       domain_perint.shape()[d]) /
-              domain_perint.stride()[d];
-        }
-      }
-      assert(not all(slab.offset == 0)); // this would be trivial
-
-      // Determine corresponding source bbox
-      ibbox const src_bbox1 = dst_bbox1.shift(slab.offset);
-
-      // Ensure we copy from within the domain, not from boundary
-      // points
-      ibbox const src_bbox = src_bbox1 & domain_perint;
-      assert(not src_bbox.empty());
-      ibbox const dst_bbox = src_bbox.shift(-slab.offset);
-      assert(dst_bbox.is_contained_in(dst_bbox1));
-      dst_bset -= dst_bbox;
-
-      // Find source components for all points
-      ibset src_bset(src_bbox);
-      for (int oc = 0; oc < hh.components(reflevel); ++oc) {
-        // We cannot copy only from the interior (the "good"
-        // points), because this excludes the ghost zones, and we
-        // may need to copy from prolongation boundaries. (This
-        // assumes that synchronisation and prolongation occurs
-        // before periodic boundaries are applied!)
-        ibset const intersection = src_bset & light_level.at(oc).exterior;
-        if (not intersection.empty()) {
-          src_bset -= intersection;
-
-          // Loop over the intersection and insert respective
-          // xferinfos
-          for (ibbox const src_reg : intersection.iterator()) {
-            ibbox const dst_reg = src_reg.shift(-slab.offset);
-            xferinfo_t xferinfo;
-            xferinfo.m = Carpet::map;
-            xferinfo.sendrecv.send.extent = src_reg;
-            xferinfo.sendrecv.send.component = oc;
-            xferinfo.sendrecv.recv.extent = dst_reg;
-            xferinfo.sendrecv.recv.component = component;
-            xferinfo.slab = slab;
-            xferinfos.push_back(xferinfo);
-          }
-        }
-      } // for oc
-      // Ensure we know how to handle all points
-      assert(src_bset.empty());
-
-    } // while dst_bset
-
-    // Tell the source processes what they have to send
-    {
-      int const p = dist::rank();
-      vector<vector<xferinfo_t> > sends(dist::size());
-      vector<xferinfo_t>::const_iterator const ib = xferinfos.begin();
-      vector<xferinfo_t>::const_iterator const ie = xferinfos.end();
-      for (vector<xferinfo_t>::const_iterator ixferinfo = ib; ixferinfo != ie;
-           ++ixferinfo) {
-        xferinfo_t const &xferinfo = *ixferinfo;
-        gh const &hh = *vhh.at(xferinfo.m);
-        int const oc = xferinfo.sendrecv.send.component;
-        int const op = hh.processor(rl, oc);
-        if (op != p)
-          sends.at(op).push_back(xferinfo);
-      }
+  CCTK_INT do_periodic[dim];
+  do_periodic[0] = periodic or periodic_x;
+  do_periodic[1] = periodic or periodic_y;
+  do_periodic[2] = periodic or periodic_z;
 
-      vector<xferinfo_t> const recv = alltoallv1(dist::comm(), sends);
+  // This may communicate, and thus cannot happen while the
+  // communication states are being processed
+  sync_xferinfos = &get_xferinfos(mglevel, reflevel, do_periodic, -1);
+}
 
-      xferinfos.insert(xferinfos.end(), recv.begin(), recv.end());
-    }
+static void periodic_sync_transfer(cGH const *const cctkGH,
+                                   comm_state &state, int const gi,
+                                   int const tl, int const rl, int const ml) {
+  if (not sync_xferinfos)
+    return;
+  if (CCTK_GroupTypeI(gi) != CCTK_GF or CCTK_GroupDimI(gi) != dim)
+    return;
 
-    if (verbose) {
-      ostringstream buf;
-      buf << "levelinfos=" << levelinfos;
-      CCTK_INFO(buf.str().c_str());
+  vector<CCTK_INT> vars;
+  int const v0 = CCTK_FirstVarIndexI(gi);
+  int const nvars = CCTK_NumVarsInGroupI(gi);
+  for (int vi = v0; vi < v0 + nvars; ++vi) {
+    if (not fused_vars.AT(vi))
+      continue;
+    // The boundary condition is applied to the current time level
+    // only
+    if (tl != 0) {
+      fused_vars.AT(vi) = false;
+      continue;
     }
+    vars.push_back(vi);
+  }
+  if (vars.empty())
+    return;
 
-  } // if need new levelinfo
-
-  // Transfer: Loop over all communication phases, all variables, and
-  // all regions
-  for (comm_state state; not state.done(); state.step()) {
-
-    vector<xferinfo_t>::const_iterator const ib = xferinfos.begin();
-    vector<xferinfo_t>::const_iterator const ie = xferinfos.end();
-    for (vector<xferinfo_t>::const_iterator ixferinfo = ib; ixferinfo != ie;
-         ++ixferinfo) {
-      xferinfo_t const &xferinfo = *ixferinfo;
+  periodic_transfer(state, *sync_xferinfos, &vars.front(), vars.size(), tl, rl,
+                    ml);
+}
 
-      gh const &hh = *vhh.at(xferinfo.m);
+static void periodic_sync_finish(cGH const *const cctkGH,
+                                 vector<int> const &groups) {
+  sync_xferinfos = NULL;
+  fused_vars.clear();
+}
 
-      // Determine components, local components, processes
-      int const oc = xferinfo.sendrecv.send.component;
-      int const c = xferinfo.sendrecv.recv.component;
-      int const olc = hh.get_local_component(rl, oc);
-      int const lc = hh.get_local_component(rl, c);
-      int const op = hh.processor(rl, oc);
-      int const p = hh.processor(rl, c);
-
-      for (int n = 0; n < nvars; ++n) {
-        int const vi = vars[n];
-        int const gi = CCTK_GroupIndexFromVarI(vi);
-        int const v0 = CCTK_FirstVarIndexI(gi);
-
-        ggf &ff = *arrdata.at(gi).at(xferinfo.m).data.at(vi - v0);
-
-        // Get pointers to the variable's data
-        gdata *const src =
-            hh.is_local(rl, oc) ? ff.data_pointer(tl, rl, olc, ml) : NULL;
-        gdata *const dst =
-            hh.is_local(rl, c) ? ff.data_pointer(tl, rl, lc, ml) : NULL;
-
-        // Copy
-        ibbox const &dstbox = xferinfo.sendrecv.recv.extent;
-        ibbox const &srcbox = xferinfo.sendrecv.send.extent;
-        islab const &slab = xferinfo.slab;
-        gdata::copy_data(dst, state, src, dstbox, srcbox, &slab, p, op);
-      }
-    }
-  }
+// Check whether the periodic boundaries of a variable have been
+// filled by the synchronisation that is currently being finished
+static bool is_fused(int const vi) {
+  return vi < (int)fused_vars.size() and fused_vars.AT(vi);
 }
 
 extern "C" CCTK_INT BndPeriodicCarpetVI(CCTK_POINTER_TO_CONST const cctkGH_,
@@ -474,6 +583,14 @@ extern "C" void PeriodicCarpet_RegisterBC(CCTK_ARGUMENTS) {
                                           PeriodicCarpet_Interpolate);
   if (ierr < 0)
     CCTK_ERROR("Could not register the symmetry interpolator");
+
+  if (fuse_with_sync) {
+    sync_extension_t extension;
+    extension.prepare = periodic_sync_prepare;
+    extension.transfer = periodic_sync_transfer;
+    extension.finish = periodic_sync_finish;
+    RegisterSyncExtension(extension);
+  }
 }
 
 extern "C" void PeriodicCarpet_ApplyBC(CCTK_ARGUMENTS) {
@@ -521,10 +638,18 @@ extern "C" void PeriodicCarpet_ApplyBC(CCTK_ARGUMENTS) {
     }
   }
 
+  // Skip variables whose periodic boundaries were already filled
+  // while they were synchronised just now
+  vector<CCTK_INT> vars;
+  vars.reserve(nvars);
   for (int n = 0; n < nvars; ++n) {
     int const vi = indices.at(n);
     assert(vi >= 0 and vi < CCTK_NumVars());
 
+    if (fuse_with_sync and is_fused(vi))
+      continue;
+    vars.push_back(vi);
+
     if (verbose) {
       char *const fullname = CCTK_FullName(vi);
       assert(fullname);
@@ -534,7 +659,10 @@ extern "C" void PeriodicCarpet_ApplyBC(CCTK_ARGUMENTS) {
     }
   } // for n
 
-  periodic_carpet(cctkGH, dim, stencil, do_periodic, &indices.front(), nvars);
+  if (vars.empty())
+    return;
+  periodic_carpet(cctkGH, dim, stencil, do_periodic, &vars.front(),
+                  vars.size());
 }
 
 namespace CarpetLib {
@@ -0,0 +1,254 @@
+#include <cctk.h>
+#include <cctk_Arguments.h>
+#include <cctk_Parameters.h>
+
+#include <cycleclock.h>
+
+#include <bboxset.hh>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Benchmark the bboxset algebra
+//
+// The old (bboxset1) and the new (bboxset2) bboxset classes are timed
+// for box distributions that resemble those occurring in an AMR
+// simulation, for an increasing number of boxes. The operations are
+// those that dominate regridding: building a set from boxes, union,
+// intersection, difference, expanding by ghost zones, and testing for
+// containment.
+
+namespace {
+
+typedef ::vect<int, dim> ivect;
+typedef ::bbox<int, dim> ibbox;
+typedef bboxset1::bboxset<int, dim> ibset1;
+typedef bboxset2::bboxset<int, dim> ibset2;
+
+const int ghost_width = 3;
+
+// A simple deterministic random number generator, so that the
+// benchmark results are reproducible
+struct random_t {
+  unsigned long long state;
+  random_t(unsigned long long seed) : state(seed) {}
+  int operator()(int n) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return int((state >> 33) % (unsigned long long)n);
+  }
+};
+
+// Create a set of boxes with (approximately) nboxes elements
+
+// The domain, split into components, each extended by ghost zones, as
+// for a load-balanced refinement level
+vector<ibbox> tiled_boxes(int const nboxes, random_t &random) {
+  ivect ncomps(1);
+  for (int n = nboxes; n > 1; n /= 2)
+    ncomps[minloc(ncomps)] *= 2;
+  ivect const npoints(64);
+  ivect const offset(random(8), random(8), random(8));
+  vector<ibbox> boxes;
+  for (int k = 0; k < ncomps[2]; ++k) {
+    for (int j = 0; j < ncomps[1]; ++j) {
+      for (int i = 0; i < ncomps[0]; ++i) {
+        ivect const n(i, j, k);
+        ivect const lo = offset + n * npoints / ncomps;
+        ivect const hi = offset + (n + 1) * npoints / ncomps - 1;
+        boxes.push_back(ibbox(lo - ghost_width, hi + ghost_width, ivect(1)));
+      }
+    }
+  }
+  return boxes;
+}
+
+// Refined regions clustered around a few centres, as for nested
+// refinement levels tracking several objects
+vector<ibbox> nested_boxes(int const nboxes, random_t &random) {
+  int const ncentres = 3;
+  ivect centres[ncentres];
+  for (int c = 0; c < ncentres; ++c) {
+    centres[c] = ivect(16 + random(96), 16 + random(96), 16 + random(96));
+  }
+  vector<ibbox> boxes;
+  for (int b = 0; b < nboxes; ++b) {
+    ivect const &centre = centres[b % ncentres];
+    ivect const radius(4 + random(12), 4 + random(12), 4 + random(12));
+    ivect const shift(random(9) - 4, random(9) - 4, random(9) - 4);
+    boxes.push_back(
+        ibbox(centre + shift - radius, centre + shift + radius, ivect(1)));
+  }
+  return boxes;
+}
+
+// Small boxes scattered through a large domain, as for refinement
+// flagged by an error estimator
+vector<ibbox> scattered_boxes(int const nboxes, random_t &random) {
+  vector<ibbox> boxes;
+  for (int b = 0; b < nboxes; ++b) {
+    ivect const lo(random(256), random(256), random(256));
+    ivect const size(1 + random(16), 1 + random(16), 1 + random(16));
+    boxes.push_back(ibbox(lo, lo + size - 1, ivect(1)));
+  }
+  return boxes;
+}
+
+vector<ibbox> make_boxes(const string &distribution, int const nboxes,
+                         random_t &random) {
+  if (distribution == "tiled")
+    return tiled_boxes(nboxes, random);
+  if (distribution == "nested")
+    return nested_boxes(nboxes, random);
+  if (distribution == "scattered")
+    return scattered_boxes(nboxes, random);
+  assert(0);
+  return vector<ibbox>();
+}
+
+template <typename S> S make_set(const vector<ibbox> &boxes) {
+  S res;
+  for (size_t b = 0; b < boxes.size(); ++b)
+    res |= boxes[b];
+  return res;
+}
+
+// Run a function repeatedly, and return the time per call
+template <typename F> double time_call(int const repetitions, const F &f) {
+  const ticks tb = getticks();
+  for (int r = 0; r < repetitions; ++r)
+    f();
+  const ticks te = getticks();
+  return seconds_per_tick() * elapsed(te, tb) / repetitions;
+}
+
+// Prevent the compiler from optimising away a computed result
+volatile size_t sink;
+
+struct timing_t {
+  double build, union_, intersection, difference, expand, contains;
+  size_t nboxes;
+};
+
+template <typename S>
+timing_t benchmark_set(const vector<ibbox> &boxes1,
+                       const vector<ibbox> &boxes2,
+                       const vector<ivect> &points, int const repetitions) {
+  timing_t timing;
+  S const set1 = make_set<S>(boxes1);
+  S const set2 = make_set<S>(boxes2);
+  timing.nboxes = set1.setsize();
+
+  timing.build = time_call(
+      repetitions, [&]() { sink = make_set<S>(boxes1).setsize(); });
+  timing.union_ =
+      time_call(repetitions, [&]() { sink = (set1 | set2).setsize(); });
+  timing.intersection =
+      time_call(repetitions, [&]() { sink = (set1 & set2).setsize(); });
+  timing.difference =
+      time_call(repetitions, [&]() { sink = (set1 - set2).setsize(); });
+  timing.expand = time_call(repetitions, [&]() {
+    sink = set1.expand(ivect(ghost_width), ivect(ghost_width)).setsize();
+  });
+  timing.contains = time_call(repetitions, [&]() {
+    size_t count = 0;
+    for (size_t b = 0; b < boxes2.size(); ++b)
+      count += boxes2[b] <= set1;
+    for (size_t p = 0; p < points.size(); ++p)
+      count += set1.contains(points[p]);
+    sink = count;
+  });
+  return timing;
+}
+
+void output_timing(ostream &os, const string &distribution, int const nboxes,
+                   const char *const name, const timing_t &timing) {
+  os << setw(10) << distribution << setw(8) << nboxes << setw(10) << name
+     << setw(8) << timing.nboxes;
+  double const times[] = {timing.build,      timing.union_,
+                          timing.intersection, timing.difference,
+                          timing.expand,     timing.contains};
+  for (size_t i = 0; i < sizeof times / sizeof *times; ++i)
+    os << setw(13) << setprecision(4) << times[i] * 1.0e+6;
+  os << "\n";
+}
+
+} // namespace
+
+extern "C" void TestBBoxSet2_benchmark(CCTK_ARGUMENTS) {
+  DECLARE_CCTK_PARAMETERS;
+
+  CCTK_INFO("Benchmarking bboxset algebra...");
+
+  vector<int> box_counts;
+  {
+    istringstream buf(benchmark_box_counts);
+    int n;
+    while (buf >> n) {
+      if (n <= 0)
+        CCTK_VERROR("Illegal box count %d in parameter "
+                    "TestBBoxSet2::benchmark_box_counts",
+                    n);
+      box_counts.push_back(n);
+    }
+    if (not buf.eof())
+      CCTK_VERROR("Cannot parse parameter TestBBoxSet2::benchmark_box_counts "
+                  "\"%s\"",
+                  benchmark_box_counts);
+  }
+
+  const char *const distributions[] = {"tiled", "nested", "scattered"};
+
+  ostringstream table;
+  table << "# Times in microseconds per operation\n"
+        << "#" << setw(9) << "distrib" << setw(8) << "nboxes" << setw(10)
+        << "class" << setw(8) << "setsize" << setw(13) << "build"
+        << setw(13) << "union" << setw(13) << "intersect" << setw(13)
+        << "difference" << setw(13) << "expand" << setw(13) << "contains"
+        << "\n";
+
+  for (size_t d = 0; d < sizeof distributions / sizeof *distributions; ++d) {
+    for (size_t n = 0; n < box_counts.size(); ++n) {
+      random_t random(12345 + 1000 * d + n);
+      vector<ibbox> const boxes1 =
+          make_boxes(distributions[d], box_counts[n], random);
+      vector<ibbox> const boxes2 =
+          make_boxes(distributions[d], box_counts[n], random);
+      vector<ivect> points(64);
+      for (size_t p = 0; p < points.size(); ++p)
+        points[p] = ivect(random(256), random(256), random(256));
+
+      // Use fewer repetitions for large sets, so that the benchmark
+      // finishes in reasonable time
+      int const repetitions =
+          max(1, benchmark_repetitions / max(1, box_counts[n] / 16));
+
+      timing_t const timing1 =
+          benchmark_set<ibset1>(boxes1, boxes2, points, repetitions);
+      timing_t const timing2 =
+          benchmark_set<ibset2>(boxes1, boxes2, points, repetitions);
+
+      output_timing(table, distributions[d], box_counts[n], "bboxset1",
+                    timing1);
+      output_timing(table, distributions[d], box_counts[n], "bboxset2",
+                    timing2);
+      if (verbose) {
+        CCTK_VInfo(CCTK_THORNSTRING, "  %s, %d boxes: union %g us / %g us",
+                   distributions[d], box_counts[n], timing1.union_ * 1.0e+6,
+                   timing2.union_ * 1.0e+6);
+      }
+    }
+  }
+
+  cout << table.str();
+  cout.flush();
+
+  CCTK_INFO("Done.");
+}
@@ -243,6 +243,31 @@ template <int D> void test() {
   xtime(time_check,
         [&]() { check_equal("non-trivial difference", bs1d, bs2d); });
 
+  // The serialised form must not depend on the order of the
+  // operations that built a set
+  {
+    const ibbox b1(ivect(0 * str), ivect(4 * str), ivect(str));
+    const ibbox b2(ivect(2 * str), ivect(6 * str), ivect(str));
+    const ibbox b3(ivect(5 * str), ivect(9 * str), ivect(str));
+    const ibset2 bs2e = (ibset2(b1) | b2) | b3;
+    const ibset2 bs2f = (ibset2(b3) | b2) | b1;
+    const ibset2 bs2g = (ibset2(b1) | b2 | b3 | b3.expand(1)) -
+                        (ibset2(b3.expand(1)) - b3 - b2 - b1);
+    assert(bs2e == bs2f and bs2e == bs2g);
+    const vector<ibbox> v2e = bs2e.iterator();
+    const vector<ibbox> v2f = bs2f.iterator();
+    const vector<ibbox> v2g = bs2g.iterator();
+    if (not(v2e == v2f and v2e == v2g and
+            bs2e.setsize() == bs2f.setsize() and
+            bs2e.setsize() == bs2g.setsize())) {
+      CCTK_VParamWarn(CCTK_THORNSTRING,
+                      "Serialisation depends on the order of operations");
+      cout << "v2e=" << v2e << "\n"
+           << "v2f=" << v2f << "\n"
+           << "v2g=" << v2g << "\n";
+    }
+  }
+
   // Many tests with random sets
 
   bs1 = ibset1();
@@ -0,0 +1,27 @@
+#ifndef COMMPATTERNS_HH
+#define COMMPATTERNS_HH
+
+#include <dh.hh>
+
+namespace TestCommPatterns {
+
+// A communication schedule of the grid hierarchy
+struct schedule_desc_t {
+  const char *name;
+  CarpetLib::dh::srpvect CarpetLib::dh::fast_dboxes::*sendrecvs;
+  int send_rl_offset;   // refinement level of the sending components
+  bool is_prolongation; // may send several time levels
+};
+
+// The schedules which are dumped and replayed, in the order in which
+// they appear in the schedule files
+extern const schedule_desc_t schedules[];
+extern const int num_schedules;
+
+// Look up a schedule by name; returns NULL if there is no such
+// schedule
+const schedule_desc_t *find_schedule(const char *name);
+
+} // namespace TestCommPatterns
+
+#endif // #ifndef COMMPATTERNS_HH
@@ -0,0 +1,124 @@
+#include <cctk.h>
+#include <cctk_Arguments.h>
+#include <cctk_Parameters.h>
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <carpet.hh>
+#include <dh.hh>
+#include <dist.hh>
+#include <gh.hh>
+
+#include "commpatterns.hh"
+
+namespace TestCommPatterns {
+
+using namespace std;
+using namespace Carpet;
+using namespace CarpetLib;
+
+const schedule_desc_t schedules[] = {
+    {"sync", &dh::fast_dboxes::fast_sync_sendrecv, 0, false},
+    {"ref_bnd_prol", &dh::fast_dboxes::fast_ref_bnd_prol_sendrecv, -1, true},
+    {"ref_prol", &dh::fast_dboxes::fast_ref_prol_sendrecv, -1, true},
+    {"ref_rest", &dh::fast_dboxes::fast_ref_rest_sendrecv, +1, false},
+    {"mg_rest", &dh::fast_dboxes::fast_mg_rest_sendrecv, 0, false},
+    {"mg_prol", &dh::fast_dboxes::fast_mg_prol_sendrecv, 0, true},
+};
+const int num_schedules = sizeof schedules / sizeof *schedules;
+
+const schedule_desc_t *find_schedule(const char *const name) {
+  for (int i = 0; i < num_schedules; ++i) {
+    if (strcmp(schedules[i].name, name) == 0)
+      return &schedules[i];
+  }
+  return NULL;
+}
+
+// Write the communication schedules of this process. Every process
+// writes the schedules for all levels in the same order, including
+// empty ones, so that the replay can step through them collectively.
+//
+// File format:
+//   nprocs <nprocs> rank <rank>
+//   schedule <name> ml <ml> rl <rl> count <count>
+//   <map> <send proc> <send component> <send bbox>
+//         <recv proc> <recv component> <recv bbox>
+//   ...
+extern "C" void TestCommPatterns_Dump(CCTK_ARGUMENTS) {
+  DECLARE_CCTK_ARGUMENTS;
+  DECLARE_CCTK_PARAMETERS;
+
+  if (cctk_iteration != dump_iteration)
+    return;
+
+  CCTK_CreateDirectory(0755, out_dir);
+  ostringstream filenamebuf;
+  filenamebuf << out_dir << "/" << dump_filename << "." << dist::rank()
+              << ".txt";
+  string const filename = filenamebuf.str();
+  ofstream file(filename.c_str());
+  if (not file.good()) {
+    CCTK_VWarn(CCTK_WARN_ALERT, __LINE__, __FILE__, CCTK_THORNSTRING,
+               "Could not open schedule file \"%s\"", filename.c_str());
+    return;
+  }
+
+  file << "# TestCommPatterns communication schedule, iteration "
+       << cctk_iteration << "\n"
+       << "nprocs " << dist::size() << " rank " << dist::rank() << "\n";
+
+  int total_count = 0;
+  int const mglevels = vhh.AT(0)->mglevels();
+  int const reflevels = vhh.AT(0)->reflevels();
+  for (int ml = 0; ml < mglevels; ++ml) {
+    for (int rl = 0; rl < reflevels; ++rl) {
+      for (int s = 0; s < num_schedules; ++s) {
+        schedule_desc_t const &sched = schedules[s];
+        int const send_rl = rl + sched.send_rl_offset;
+
+        int count = 0;
+        for (int m = 0; m < maps; ++m) {
+          dh::fast_dboxes const &fast_boxes =
+              vdd.AT(m)->fast_boxes.AT(ml).AT(rl);
+          count += (fast_boxes.*sched.sendrecvs).size();
+        }
+        file << "schedule " << sched.name << " ml " << ml << " rl " << rl
+             << " count " << count << "\n";
+
+        for (int m = 0; m < maps; ++m) {
+          gh const &hh = *vhh.AT(m);
+          dh::srpvect const &sendrecvs =
+              vdd.AT(m)->fast_boxes.AT(ml).AT(rl).*sched.sendrecvs;
+          for (dh::srpvect::const_iterator isr = sendrecvs.begin();
+               isr != sendrecvs.end(); ++isr) {
+            assert(send_rl >= 0 and send_rl < reflevels);
+            file << m << " " << hh.processor(send_rl, isr->send.component)
+                 << " " << isr->send.component << " " << isr->send.extent
+                 << " " << hh.processor(rl, isr->recv.component) << " "
+                 << isr->recv.component << " " << isr->recv.extent << "\n";
+          }
+        }
+        total_count += count;
+      }
+    }
+  }
+
+  file.close();
+  if (not file.good()) {
+    CCTK_VWarn(CCTK_WARN_ALERT, __LINE__, __FILE__, CCTK_THORNSTRING,
+               "Could not write schedule file \"%s\"", filename.c_str());
+  }
+
+  if (verbose) {
+    CCTK_VInfo(CCTK_THORNSTRING,
+               "Wrote %d communication schedule entries to \"%s\"",
+               total_count, filename.c_str());
+  }
+}
+
+} // namespace TestCommPatterns
@@ -0,0 +1,422 @@
+#include <cctk.h>
+#include <cctk_Arguments.h>
+#include <cctk_Parameters.h>
+
+#include <cycleclock.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+#include <bbox.hh>
+#include <commstate.hh>
+#include <dist.hh>
+
+#include "commpatterns.hh"
+
+namespace TestCommPatterns {
+
+using namespace std;
+using namespace CarpetLib;
+
+namespace {
+
+// One communication, as seen from this process
+struct entry_t {
+  int sendproc, recvproc;
+  ptrdiff_t npoints; // points per variable
+};
+
+// All communications of one schedule on one level
+struct group_t {
+  string name;
+  int ml, rl;
+  vector<entry_t> entries;
+};
+
+// The communication phases, corresponding to the comm_state states
+enum phase_t {
+  phase_setup,    // determine buffer sizes, post receives
+  phase_send,     // fill send buffers, post sends
+  phase_local,    // process-local copies
+  phase_receive,  // wait for and empty receive buffers
+  num_phases
+};
+
+const char *const phase_names[num_phases] = {"setup", "send", "local",
+                                             "receive"};
+
+// A communication strategy, i.e. a setting of the comm_state
+// parameters of CarpetLib
+struct strategy_t {
+  const char *name;
+  bool combine_sends, interleave_communications, use_mpi_send, use_mpi_ssend;
+};
+
+const strategy_t strategy_list[] = {
+    {"isend", false, false, false, false},
+    {"combine_sends", true, false, false, false},
+    {"interleave", false, true, false, false},
+    {"mpi_send", true, false, true, false},
+    {"mpi_ssend", true, false, false, true},
+};
+
+const char *const strategy_parameters[] = {
+    "combine_sends", "interleave_communications", "use_mpi_send",
+    "use_mpi_ssend"};
+const int num_strategy_parameters =
+    sizeof strategy_parameters / sizeof *strategy_parameters;
+
+void set_parameter(const char *const name, bool const value) {
+  int const ierr = CCTK_ParameterSet(name, "CarpetLib", value ? "yes" : "no");
+  if (ierr) {
+    CCTK_VWarn(CCTK_WARN_ABORT, __LINE__, __FILE__, CCTK_THORNSTRING,
+               "Could not set parameter CarpetLib::%s", name);
+  }
+}
+
+void set_strategy(strategy_t const &strategy) {
+  set_parameter("combine_sends", strategy.combine_sends);
+  set_parameter("interleave_communications",
+                strategy.interleave_communications);
+  set_parameter("use_mpi_send", strategy.use_mpi_send);
+  set_parameter("use_mpi_ssend", strategy.use_mpi_ssend);
+}
+
+// Read the schedule file of this process
+vector<group_t> read_schedules(string const &filename,
+                               int const ntimelevels) {
+  ifstream file(filename.c_str());
+  if (not file.good()) {
+    CCTK_VERROR("Could not open schedule file \"%s\"", filename.c_str());
+  }
+
+  vector<group_t> groups;
+  int nprocs = -1, rank = -1;
+  string line;
+  while (getline(file, line)) {
+    if (line.empty() or line[0] == '#')
+      continue;
+    istringstream buf(line);
+    string keyword;
+    buf >> keyword;
+    if (keyword == "nprocs") {
+      string dummy;
+      buf >> nprocs >> dummy >> rank;
+      if (nprocs != dist::size() or rank != dist::rank()) {
+        CCTK_VERROR("The schedule file \"%s\" was written by process %d of "
+                    "%d, but is read by process %d of %d",
+                    filename.c_str(), rank, nprocs, dist::rank(),
+                    dist::size());
+      }
+    } else if (keyword == "schedule") {
+      group_t group;
+      string dummy;
+      int count;
+      buf >> group.name >> dummy >> group.ml >> dummy >> group.rl >> dummy >>
+          count;
+      assert(buf.good() or buf.eof());
+      const schedule_desc_t *const sched = find_schedule(group.name.c_str());
+      if (not sched) {
+        CCTK_VERROR("Unknown schedule \"%s\" in schedule file \"%s\"",
+                    group.name.c_str(), filename.c_str());
+      }
+      int const ntl = sched->is_prolongation ? ntimelevels : 1;
+      group.entries.reserve(count);
+      for (int n = 0; n < count; ++n) {
+        int m, sendcomp, recvcomp;
+        ibbox sendbox, recvbox;
+        entry_t entry;
+        file >> m >> entry.sendproc >> sendcomp >> sendbox >> entry.recvproc >>
+            recvcomp >> recvbox;
+        if (not file.good()) {
+          CCTK_VERROR("Error reading schedule file \"%s\"", filename.c_str());
+        }
+        assert(entry.sendproc == dist::rank() or
+               entry.recvproc == dist::rank());
+        // Interpolate either on the sending or on the receiving
+        // process, depending on which requires less data (see
+        // gdata::transfer_data)
+        entry.npoints = min(ptrdiff_t(recvbox.size()),
+                            ptrdiff_t(sendbox.size()) * ntl);
+        group.entries.push_back(entry);
+      }
+      groups.push_back(group);
+    } else {
+      CCTK_VERROR("Unexpected line \"%s\" in schedule file \"%s\"",
+                  line.c_str(), filename.c_str());
+    }
+  }
+  if (nprocs < 0) {
+    CCTK_VERROR("The schedule file \"%s\" has no header", filename.c_str());
+  }
+  return groups;
+}
+
+// Replay the communication of a group once, recording the time spent
+// in each phase
+void replay(group_t const &group, int const nvars, vector<CCTK_REAL> &local,
+            double times[num_phases]) {
+  int const me = dist::rank();
+  CCTK_REAL dummy;
+  unsigned const type = dist::c_datatype(dummy);
+
+  ticks t0 = getticks();
+  comm_state state;
+  assert(state.thestate == state_get_buffer_sizes);
+  for (size_t i = 0; i < group.entries.size(); ++i) {
+    entry_t const &entry = group.entries[i];
+    if (entry.sendproc == entry.recvproc)
+      continue;
+    for (int var = 0; var < nvars; ++var) {
+      if (entry.recvproc == me)
+        state.reserve_recv_space(type, entry.sendproc, entry.npoints);
+      if (entry.sendproc == me)
+        state.reserve_send_space(type, entry.recvproc, entry.npoints);
+    }
+  }
+  state.step();
+  ticks t1 = getticks();
+  times[phase_setup] += seconds_per_tick() * elapsed(t1, t0);
+
+  t0 = getticks();
+  assert(state.thestate == state_fill_send_buffers);
+  for (size_t i = 0; i < group.entries.size(); ++i) {
+    entry_t const &entry = group.entries[i];
+    if (entry.sendproc == entry.recvproc or entry.sendproc != me)
+      continue;
+    for (int var = 0; var < nvars; ++var) {
+      CCTK_REAL *const buf = static_cast<CCTK_REAL *>(
+          state.send_buffer(type, entry.recvproc, entry.npoints));
+      fill(buf, buf + entry.npoints, CCTK_REAL(var));
+      state.commit_send_space(type, entry.recvproc, entry.npoints);
+    }
+  }
+  state.step();
+  t1 = getticks();
+  times[phase_send] += seconds_per_tick() * elapsed(t1, t0);
+
+  t0 = getticks();
+  assert(state.thestate == state_do_some_work);
+  for (size_t i = 0; i < group.entries.size(); ++i) {
+    entry_t const &entry = group.entries[i];
+    if (entry.sendproc != entry.recvproc)
+      continue;
+    if (ptrdiff_t(local.size()) < 2 * entry.npoints)
+      local.resize(2 * entry.npoints);
+    // local may still be empty if npoints is zero
+    CCTK_REAL *const data = local.data();
+    for (int var = 0; var < nvars; ++var) {
+      copy(data, data + entry.npoints, data + entry.npoints);
+    }
+  }
+  state.step();
+  t1 = getticks();
+  times[phase_local] += seconds_per_tick() * elapsed(t1, t0);
+
+  t0 = getticks();
+  assert(state.thestate == state_empty_recv_buffers);
+  for (size_t i = 0; i < group.entries.size(); ++i) {
+    entry_t const &entry = group.entries[i];
+    if (entry.sendproc == entry.recvproc or entry.recvproc != me)
+      continue;
+    if (ptrdiff_t(local.size()) < entry.npoints)
+      local.resize(entry.npoints);
+    for (int var = 0; var < nvars; ++var) {
+      CCTK_REAL const *const buf = static_cast<CCTK_REAL const *>(
+          state.recv_buffer(type, entry.sendproc, entry.npoints));
+      copy(buf, buf + entry.npoints, local.data());
+      state.commit_recv_space(type, entry.sendproc, entry.npoints);
+    }
+  }
+  state.step();
+  t1 = getticks();
+  times[phase_receive] += seconds_per_tick() * elapsed(t1, t0);
+  assert(state.done());
+}
+
+} // namespace
+
+extern "C" void TestCommPatterns_Replay(CCTK_ARGUMENTS) {
+  DECLARE_CCTK_ARGUMENTS;
+  DECLARE_CCTK_PARAMETERS;
+
+  int const me = dist::rank();
+  MPI_Comm const comm = dist::comm();
+
+  ostringstream filenamebuf;
+  filenamebuf << replay_filename << "." << me << ".txt";
+  vector<group_t> const groups =
+      read_schedules(filenamebuf.str(), replay_timelevels);
+
+  // All processes need to step through the same schedules
+  {
+    int const ngroups = groups.size();
+    int min_ngroups, max_ngroups;
+    MPI_Allreduce(const_cast<int *>(&ngroups), &min_ngroups, 1, MPI_INT,
+                  MPI_MIN, comm);
+    MPI_Allreduce(const_cast<int *>(&ngroups), &max_ngroups, 1, MPI_INT,
+                  MPI_MAX, comm);
+    if (min_ngroups != max_ngroups) {
+      CCTK_VERROR("The schedule files contain different numbers of "
+                  "schedules (between %d and %d)",
+                  min_ngroups, max_ngroups);
+    }
+  }
+
+  // Select the strategies
+  vector<strategy_t> selected_strategies;
+  {
+    istringstream buf(strategies);
+    string name;
+    while (buf >> name) {
+      int const nstrategies = sizeof strategy_list / sizeof *strategy_list;
+      int s;
+      for (s = 0; s < nstrategies; ++s)
+        if (name == strategy_list[s].name)
+          break;
+      if (s == nstrategies) {
+        CCTK_VParamWarn(CCTK_THORNSTRING, "Unknown strategy \"%s\"",
+                        name.c_str());
+        continue;
+      }
+      int type;
+      CCTK_INT const *const message_count_multiplier =
+          static_cast<CCTK_INT const *>(
+              CCTK_ParameterGet("message_count_multiplier", "CarpetLib",
+                                &type));
+      assert(message_count_multiplier);
+      if (*message_count_multiplier > 1 and
+          (strategy_list[s].use_mpi_send or strategy_list[s].use_mpi_ssend)) {
+        CCTK_VWarn(CCTK_WARN_ALERT, __LINE__, __FILE__, CCTK_THORNSTRING,
+                   "Skipping strategy \"%s\", which is incompatible with "
+                   "CarpetLib::message_count_multiplier > 1",
+                   name.c_str());
+        continue;
+      }
+      selected_strategies.push_back(strategy_list[s]);
+    }
+  }
+
+  // Save the current settings
+  vector<char *> saved_values(num_strategy_parameters);
+  for (int i = 0; i < num_strategy_parameters; ++i) {
+    saved_values[i] = CCTK_ParameterValString(strategy_parameters[i],
+                                              "CarpetLib");
+    assert(saved_values[i]);
+  }
+
+  FILE *outfile = NULL;
+  if (me == 0 and *out_filename) {
+    CCTK_CreateDirectory(0755, out_dir);
+    string const filename = string(out_dir) + "/" + out_filename;
+    outfile = fopen(filename.c_str(), "w");
+    if (not outfile) {
+      CCTK_VWarn(CCTK_WARN_ALERT, __LINE__, __FILE__, CCTK_THORNSTRING,
+                 "Could not open output file \"%s\"", filename.c_str());
+    } else {
+      fprintf(outfile, "# TestCommPatterns replay results for \"%s\" on %d "
+                       "processes, %d variables\n",
+              replay_filename, dist::size(), int(replay_variables));
+      fprintf(outfile, "# strategy\tschedule\tml\trl\tmessages\tbytes");
+      for (int p = 0; p < num_phases; ++p)
+        fprintf(outfile, "\t%s [s]", phase_names[p]);
+      fprintf(outfile, "\ttotal [s]\tbandwidth [GB/s]\n");
+    }
+  }
+
+  vector<CCTK_REAL> local;
+  for (size_t s = 0; s < selected_strategies.size(); ++s) {
+    strategy_t const &strategy = selected_strategies[s];
+    set_strategy(strategy);
+
+    for (size_t g = 0; g < groups.size(); ++g) {
+      group_t const &group = groups[g];
+
+      // Count the messages and bytes sent by this process
+      double counts[2] = {0.0, 0.0};
+      {
+        set<int> peers;
+        for (size_t i = 0; i < group.entries.size(); ++i) {
+          entry_t const &entry = group.entries[i];
+          if (entry.sendproc == me and entry.recvproc != me) {
+            peers.insert(entry.recvproc);
+            counts[1] += double(entry.npoints) * replay_variables *
+                         sizeof(CCTK_REAL);
+          }
+        }
+        counts[0] = peers.size();
+      }
+      double total_counts[2];
+      MPI_Allreduce(counts, total_counts, 2, MPI_DOUBLE, MPI_SUM, comm);
+      int const ngroup_entries = group.entries.size();
+      int max_entries;
+      MPI_Allreduce(const_cast<int *>(&ngroup_entries), &max_entries, 1,
+                    MPI_INT, MPI_MAX, comm);
+      if (max_entries == 0)
+        continue;
+
+      // Warm up
+      double times[num_phases + 1];
+      fill(times, times + num_phases + 1, 0.0);
+      replay(group, replay_variables, local, times);
+
+      // Measure
+      fill(times, times + num_phases + 1, 0.0);
+      for (int rep = 0; rep < replay_repetitions; ++rep) {
+        MPI_Barrier(comm);
+        ticks const t0 = getticks();
+        replay(group, replay_variables, local, times);
+        ticks const t1 = getticks();
+        times[num_phases] += seconds_per_tick() * elapsed(t1, t0);
+      }
+      for (int p = 0; p <= num_phases; ++p)
+        times[p] /= replay_repetitions;
+      // The slowest process determines the time
+      double max_times[num_phases + 1];
+      MPI_Reduce(times, max_times, num_phases + 1, MPI_DOUBLE, MPI_MAX, 0,
+                 comm);
+
+      if (me == 0) {
+        double const bandwidth = total_counts[1] / max_times[num_phases];
+        if (verbose) {
+          CCTK_VInfo(CCTK_THORNSTRING,
+                     "%-13s %-12s ml %d rl %2d: %6.0f messages, %10.4g "
+                     "bytes, %10.4g s, %8.4g GB/s",
+                     strategy.name, group.name.c_str(), group.ml, group.rl,
+                     total_counts[0], total_counts[1], max_times[num_phases],
+                     1.0e-9 * bandwidth);
+        }
+        if (outfile) {
+          fprintf(outfile, "%s\t%s\t%d\t%d\t%.0f\t%.0f", strategy.name,
+                  group.name.c_str(), group.ml, group.rl, total_counts[0],
+                  total_counts[1]);
+          for (int p = 0; p <= num_phases; ++p)
+            fprintf(outfile, "\t%.6g", max_times[p]);
+          fprintf(outfile, "\t%.6g\n", 1.0e-9 * bandwidth);
+        }
+      }
+    }
+  }
+
+  if (outfile)
+    fclose(outfile);
+
+  // Restore the settings
+  for (int i = 0; i < num_strategy_parameters; ++i) {
+    CCTK_ParameterSet(strategy_parameters[i], "CarpetLib", saved_values[i]);
+    free(saved_values[i]);
+  }
+  comm_state::free_buffers();
+}
+
+} // namespace TestCommPatterns
@@ -0,0 +1,558 @@
+#include <cctk.h>
+#include <cctk_Arguments.h>
+#include <cctk_Parameters.h>
+
+#include <cycleclock.h>
+
+#include <operator_prototypes_3d.hh>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+using namespace CarpetLib;
+
+// The Fortran operators exist only for CCTK_REAL8; see CarpetLib's
+// data.cc
+extern "C" {
+void CCTK_FCALL CCTK_FNAME(prolongate_3d_real8_eno)(
+    const CCTK_REAL8 *src, const int &srcipadext, const int &srcjpadext,
+    const int &srckpadext, const int &srciext, const int &srcjext,
+    const int &srckext, CCTK_REAL8 *dst, const int &dstipadext,
+    const int &dstjpadext, const int &dstkpadext, const int &dstiext,
+    const int &dstjext, const int &dstkext, const int srcbbox[3][3],
+    const int dstbbox[3][3], const int regbbox[3][3]);
+void CCTK_FCALL CCTK_FNAME(prolongate_3d_real8_weno)(
+    const CCTK_REAL8 *src, const int &srcipadext, const int &srcjpadext,
+    const int &srckpadext, const int &srciext, const int &srcjext,
+    const int &srckext, CCTK_REAL8 *dst, const int &dstipadext,
+    const int &dstjpadext, const int &dstkpadext, const int &dstiext,
+    const int &dstjext, const int &dstkext, const int srcbbox[3][3],
+    const int dstbbox[3][3], const int regbbox[3][3]);
+#ifndef OMIT_F90
+void CCTK_FCALL CCTK_FNAME(prolongate_3d_real8_tvd)(
+    const CCTK_REAL8 *src, const int &srcipadext, const int &srcjpadext,
+    const int &srckpadext, const int &srciext, const int &srcjext,
+    const int &srckext, CCTK_REAL8 *dst, const int &dstipadext,
+    const int &dstjpadext, const int &dstkpadext, const int &dstiext,
+    const int &dstjext, const int &dstkext, const int srcbbox[3][3],
+    const int dstbbox[3][3], const int regbbox[3][3]);
+#endif
+}
+
+namespace {
+
+// Ghost zones (in coarse grid points) around the prolongation source
+// region, sufficient for all operators
+const int ghosts = 8;
+
+// Split a space separated list
+vector<string> split(const char *const str) {
+  vector<string> words;
+  istringstream buf(str);
+  string word;
+  while (buf >> word)
+    words.push_back(word);
+  return words;
+}
+
+vector<int> split_ints(const char *const str, const char *const name) {
+  vector<int> values;
+  const vector<string> words = split(str);
+  for (size_t i = 0; i < words.size(); ++i) {
+    char *end;
+    const long value = strtol(words[i].c_str(), &end, 10);
+    if (*end or value <= 0)
+      CCTK_VParamWarn(CCTK_THORNSTRING,
+                      "Parameter %s contains an invalid entry \"%s\"", name,
+                      words[i].c_str());
+    else
+      values.push_back(value);
+  }
+  return values;
+}
+
+// Time a function call, repeating it until the minimum time and the
+// minimum number of repetitions are reached; returns the time per call
+double time_call(const function<void()> &f) {
+  DECLARE_CCTK_PARAMETERS;
+
+  f(); // warm up
+  int reps = 0;
+  double time = 0.0;
+  while (reps < min_repetitions or time < min_time) {
+    const ticks tb = getticks();
+    f();
+    const ticks te = getticks();
+    time += seconds_per_tick() * elapsed(te, tb);
+    ++reps;
+  }
+  return time / reps;
+}
+
+// Measure the memory bandwidth with the STREAM triad a = b + s c
+// (in bytes per second)
+double stream_triad_bandwidth() {
+  DECLARE_CCTK_PARAMETERS;
+
+  const ptrdiff_t n = stream_array_size;
+  double *restrict const a = new double[n];
+  double *restrict const b = new double[n];
+  double *restrict const c = new double[n];
+#pragma omp parallel for
+  for (ptrdiff_t i = 0; i < n; ++i) {
+    a[i] = 0.0;
+    b[i] = 1.0;
+    c[i] = 2.0;
+  }
+  const double s = 3.0;
+  const double time = time_call([&]() {
+#pragma omp parallel for
+    for (ptrdiff_t i = 0; i < n; ++i)
+      a[i] = b[i] + s * c[i];
+  });
+  delete[] a;
+  delete[] b;
+  delete[] c;
+  return 3 * sizeof(double) * n / time;
+}
+
+// Fill an array with smooth, non-trivial data
+template <typename T> void fill(vector<T> &array, const int seed) {
+  const ptrdiff_t n = array.size();
+#pragma omp parallel for
+  for (ptrdiff_t i = 0; i < n; ++i)
+    array[i] = T(1 + seed + sin(0.001 * i) + 0.1 * cos(0.017 * i));
+}
+
+// One benchmark: a transfer operator applied to a particular geometry
+struct benchmark_t {
+  string name;
+  int order; // 0 if the operator has no order
+  // apply the operator once to a destination region
+  function<void(const ibbox3 &)> run;
+  ibbox3 region;      // destination region
+  bool split_region;  // whether the region is split among the threads
+  double points;      // number of destination points per call
+  double bytes;       // minimum number of bytes moved per call
+};
+
+// Apply a benchmarked operator once. Operators which CarpetLib calls
+// via call_operator (see data.cc) do not parallelise themselves; for
+// these, split the destination region among the threads exactly as
+// call_operator does. The other operators are called directly.
+void apply(const benchmark_t &bench) {
+  if (not bench.split_region) {
+    bench.run(bench.region);
+    return;
+  }
+  const ibbox3 &region = bench.region;
+#pragma omp parallel
+  {
+#ifdef _OPENMP
+    const int num_threads = omp_get_num_threads();
+    const int thread_num = omp_get_thread_num();
+#else
+    const int num_threads = 1;
+    const int thread_num = 0;
+#endif
+    // Parallelise along longest extent
+    const int dir = maxloc(region.shape());
+    const int stride = region.stride()[dir];
+    const int first_point = region.lower()[dir];
+    const int last_point = region.upper()[dir] + stride;
+    const int num_points = last_point - first_point;
+    assert(num_points >= 0);
+    assert(num_points % stride == 0);
+    const int my_num_points =
+        (num_points / stride + num_threads - 1) / num_threads * stride;
+    const int my_first_point =
+        std::min(last_point, first_point + thread_num * my_num_points);
+    const int my_last_point =
+        std::min(last_point, my_first_point + my_num_points);
+    assert(my_last_point >= my_first_point);
+    const ibbox3 myregion(region.lower().replace(dir, my_first_point),
+                          region.upper().replace(dir, my_last_point - stride),
+                          region.stride());
+    if (not myregion.empty())
+      bench.run(myregion);
+  }
+}
+
+// Describe an array by its bbox
+struct array_t {
+  ibbox3 box;
+  ivect3 ext() const { return box.shape() / box.stride(); }
+  size_t size() const { return box.size(); }
+};
+
+// Geometries
+array_t fine_array(const int n) {
+  array_t a;
+  a.box = ibbox3(ivect3(0), ivect3(n - 1), ivect3(1));
+  return a;
+}
+
+array_t coarse_source(const int n) {
+  // covers the fine array, plus ghost zones
+  array_t a;
+  a.box = ibbox3(ivect3(-2 * ghosts), ivect3(2 * ((n + 1) / 2 + ghosts)),
+                 ivect3(2));
+  return a;
+}
+
+array_t restriction_destination(const int n) {
+  array_t a;
+  a.box = ibbox3(ivect3(0), ivect3(2 * (n - 1)), ivect3(2));
+  return a;
+}
+
+array_t restriction_source(const int n) {
+  array_t a;
+  a.box = ibbox3(ivect3(-2 * ghosts), ivect3(2 * (n - 1 + ghosts)), ivect3(1));
+  return a;
+}
+
+typedef void (*fortran_prolongate_t)(
+    const CCTK_REAL8 *src, const int &srcipadext, const int &srcjpadext,
+    const int &srckpadext, const int &srciext, const int &srcjext,
+    const int &srckext, CCTK_REAL8 *dst, const int &dstipadext,
+    const int &dstjpadext, const int &dstkpadext, const int &dstiext,
+    const int &dstjext, const int &dstkext, const int srcbbox[3][3],
+    const int dstbbox[3][3], const int regbbox[3][3]);
+
+// Operators which exist only for some types
+template <typename T>
+void add_fortran_benchmarks(vector<benchmark_t> &benchmarks,
+                            const set<string> &selected, const int n,
+                            vector<T> &src, vector<T> &dst) {}
+
+template <>
+void add_fortran_benchmarks(vector<benchmark_t> &benchmarks,
+                            const set<string> &selected, const int n,
+                            vector<CCTK_REAL8> &src, vector<CCTK_REAL8> &dst) {
+  const array_t s = coarse_source(n), d = fine_array(n);
+  const double points = d.size();
+  const double bytes = (d.size() + d.size() / 8) * sizeof(CCTK_REAL8);
+  struct fortran_op_t {
+    const char *name;
+    int order;
+    fortran_prolongate_t op;
+  };
+  const fortran_op_t ops[] = {
+      {"prolongate_3d_eno", 3, CCTK_FNAME(prolongate_3d_real8_eno)},
+      {"prolongate_3d_weno", 3, CCTK_FNAME(prolongate_3d_real8_weno)},
+#ifndef OMIT_F90
+      {"prolongate_3d_tvd", 2, CCTK_FNAME(prolongate_3d_real8_tvd)},
+#endif
+  };
+  for (size_t i = 0; i < sizeof ops / sizeof *ops; ++i) {
+    if (not selected.empty() and not selected.count(ops[i].name))
+      continue;
+    const fortran_prolongate_t op = ops[i].op;
+    const CCTK_REAL8 *const srcp = &src[0];
+    CCTK_REAL8 *const dstp = &dst[0];
+    benchmarks.push_back(benchmark_t{
+        ops[i].name, ops[i].order,
+        [=](const ibbox3 &region) {
+          const ivect3 sext = s.ext(), dext = d.ext();
+          op(srcp, sext[0], sext[1], sext[2], sext[0], sext[1], sext[2], dstp,
+             dext[0], dext[1], dext[2], dext[0], dext[1], dext[2],
+             reinterpret_cast<int const(*)[3]>(&s.box),
+             reinterpret_cast<int const(*)[3]>(&d.box),
+             reinterpret_cast<int const(*)[3]>(&region));
+        },
+        d.box, true, points, bytes});
+  }
+}
+
+// Run all benchmarks for one data type, box size, and thread count
+template <typename T>
+void run_benchmarks(const char *const type_name, const int n,
+                    const int nthreads, const double bandwidth,
+                    FILE *const outfile) {
+  DECLARE_CCTK_PARAMETERS;
+
+  const vector<string> operator_list = split(operators);
+  set<string> selected(operator_list.begin(), operator_list.end());
+  if (selected.count("all"))
+    selected.clear();
+  const auto is_selected = [&](const string &name) {
+    return selected.empty() or selected.count(name);
+  };
+
+  const array_t fine = fine_array(n);
+  const array_t coarse = coarse_source(n);
+  const array_t rdst = restriction_destination(n);
+  const array_t rsrc = restriction_source(n);
+
+  vector<T> coarse_data(coarse.size()), fine_data(fine.size());
+  vector<vector<T> > tl_data(5, vector<T>(fine.size()));
+  vector<T> rsrc_data(rsrc.size()), rdst_data(rdst.size());
+  fill(coarse_data, 0);
+  fill(fine_data, 0);
+  for (size_t tl = 0; tl < tl_data.size(); ++tl)
+    fill(tl_data[tl], tl);
+  fill(rsrc_data, 0);
+  fill(rdst_data, 0);
+
+  const T *const cp = &coarse_data[0];
+  T *const fp = &fine_data[0];
+  const ivect3 cext = coarse.ext(), fext = fine.ext();
+  const ivect3 rsext = rsrc.ext(), rdext = rdst.ext();
+  const double fpoints = fine.size();
+  const double prolongation_bytes = (fine.size() + fine.size() / 8) * sizeof(T);
+
+  vector<benchmark_t> benchmarks;
+
+  if (is_selected("prolongate_3d_rf2")) {
+    const vector<int> orders =
+        split_ints(prolongation_orders, "prolongation_orders");
+    for (size_t i = 0; i < orders.size(); ++i) {
+      void (*op)(T const *, ivect3 const &, ivect3 const &, T *, ivect3 const &,
+                 ivect3 const &, ibbox3 const &, ibbox3 const &,
+                 ibbox3 const &, ibbox3 const &, void *) = NULL;
+      switch (orders[i]) {
+      case 1:
+        op = prolongate_3d_rf2<T, 1>;
+        break;
+      case 3:
+        op = prolongate_3d_rf2<T, 3>;
+        break;
+      case 5:
+        op = prolongate_3d_rf2<T, 5>;
+        break;
+      case 7:
+        op = prolongate_3d_rf2<T, 7>;
+        break;
+      case 9:
+        op = prolongate_3d_rf2<T, 9>;
+        break;
+      case 11:
+        op = prolongate_3d_rf2<T, 11>;
+        break;
+      default:
+        CCTK_VParamWarn(CCTK_THORNSTRING,
+                        "Unsupported prolongation order %d", orders[i]);
+        continue;
+      }
+      benchmarks.push_back(benchmark_t{
+          "prolongate_3d_rf2", orders[i],
+          [=](const ibbox3 &region) {
+            op(cp, cext, cext, fp, fext, fext, coarse.box, fine.box, coarse.box,
+               region, NULL);
+          },
+          fine.box, true, fpoints, prolongation_bytes});
+    }
+  }
+
+  if (is_selected("prolongate_3d_o5_monotone_rf2")) {
+    benchmarks.push_back(benchmark_t{
+        "prolongate_3d_o5_monotone_rf2", 5,
+        [=](const ibbox3 &region) {
+          prolongate_3d_o5_monotone_rf2(cp, cext, cext, fp, fext, fext,
+                                        coarse.box, fine.box, coarse.box,
+                                        region, NULL);
+        },
+        fine.box, true, fpoints, prolongation_bytes});
+  }
+
+  add_fortran_benchmarks(benchmarks, selected, n, coarse_data, fine_data);
+
+  if (is_selected("restrict_3d_rf2")) {
+    const T *const rsp = &rsrc_data[0];
+    T *const rdp = &rdst_data[0];
+    benchmarks.push_back(benchmark_t{
+        "restrict_3d_rf2", 0,
+        [=](const ibbox3 &region) {
+          restrict_3d_rf2(rsp, rsext, rsext, rdp, rdext, rdext, rsrc.box,
+                          rdst.box, rsrc.box, region, NULL);
+        },
+        rdst.box, true, double(rdst.size()), 2.0 * rdst.size() * sizeof(T)});
+  }
+
+  if (is_selected("copy_3d")) {
+    const T *const sp = &tl_data[0][0];
+    benchmarks.push_back(benchmark_t{
+        "copy_3d", 0,
+        [=](const ibbox3 &region) {
+          copy_3d(sp, fext, fext, fp, fext, fext, fine.box, fine.box, region,
+                  region, NULL);
+        },
+        fine.box, false, fpoints, 2.0 * fine.size() * sizeof(T)});
+  }
+
+  const T *const s1 = &tl_data[0][0];
+  const T *const s2 = &tl_data[1][0];
+  const T *const s3 = &tl_data[2][0];
+  const T *const s4 = &tl_data[3][0];
+  const T *const s5 = &tl_data[4][0];
+  const CCTK_REAL t = 0.25;
+  if (is_selected("interpolate_3d_2tl")) {
+    benchmarks.push_back(benchmark_t{
+        "interpolate_3d_2tl", 0,
+        [=](const ibbox3 &region) {
+          interpolate_3d_2tl(s1, 0.0, s2, -1.0, fext, fext, fp, t, fext, fext,
+                             fine.box, fine.box, fine.box, region, NULL);
+        },
+        fine.box, false, fpoints, 3.0 * fine.size() * sizeof(T)});
+  }
+  if (is_selected("interpolate_3d_3tl")) {
+    benchmarks.push_back(benchmark_t{
+        "interpolate_3d_3tl", 0,
+        [=](const ibbox3 &region) {
+          interpolate_3d_3tl(s1, 0.0, s2, -1.0, s3, -2.0, fext, fext, fp, t,
+                             fext, fext, fine.box, fine.box, fine.box,
+                             region, NULL);
+        },
+        fine.box, false, fpoints, 4.0 * fine.size() * sizeof(T)});
+  }
+  if (is_selected("interpolate_3d_4tl")) {
+    benchmarks.push_back(benchmark_t{
+        "interpolate_3d_4tl", 0,
+        [=](const ibbox3 &region) {
+          interpolate_3d_4tl(s1, 0.0, s2, -1.0, s3, -2.0, s4, -3.0, fext, fext,
+                             fp, t, fext, fext, fine.box, fine.box, fine.box,
+                             region, NULL);
+        },
+        fine.box, false, fpoints, 5.0 * fine.size() * sizeof(T)});
+  }
+  if (is_selected("interpolate_3d_5tl")) {
+    benchmarks.push_back(benchmark_t{
+        "interpolate_3d_5tl", 0,
+        [=](const ibbox3 &region) {
+          interpolate_3d_5tl(s1, 0.0, s2, -1.0, s3, -2.0, s4, -3.0, s5, -4.0,
+                             fext, fext, fp, t, fext, fext, fine.box, fine.box,
+                             fine.box, region, NULL);
+        },
+        fine.box, false, fpoints, 6.0 * fine.size() * sizeof(T)});
+  }
+  if (is_selected("interpolate_eno_3d_3tl")) {
+    benchmarks.push_back(benchmark_t{
+        "interpolate_eno_3d_3tl", 0,
+        [=](const ibbox3 &region) {
+          interpolate_eno_3d_3tl(s1, 0.0, s2, -1.0, s3, -2.0, fext, fext, fp, t,
+                                 fext, fext, fine.box, fine.box, fine.box,
+                                 region, NULL);
+        },
+        fine.box, false, fpoints, 4.0 * fine.size() * sizeof(T)});
+  }
+
+  for (size_t i = 0; i < benchmarks.size(); ++i) {
+    const benchmark_t &bench = benchmarks[i];
+    const double time = time_call([&]() { apply(bench); });
+    const double points_per_second = bench.points / time;
+    const double bytes_per_second = bench.bytes / time;
+    const double fraction = bytes_per_second / bandwidth;
+    if (verbose) {
+      CCTK_VInfo(CCTK_THORNSTRING, "%-30s %-7s order %2d  n %4d  threads "
+                                   "%3d:  %10.4g points/s  %8.4g GB/s  "
+                                   "(%5.1f%% of STREAM)",
+                 bench.name.c_str(), type_name, bench.order, n, nthreads,
+                 points_per_second, 1.0e-9 * bytes_per_second,
+                 100.0 * fraction);
+    }
+    if (outfile) {
+      fprintf(outfile, "%s\t%s\t%d\t%d\t%d\t%.6g\t%.6g\t%.6g\t%.6g\t%.6g\n",
+              bench.name.c_str(), type_name, bench.order, n, nthreads, time,
+              points_per_second, 1.0e-9 * bytes_per_second,
+              1.0e-9 * bandwidth, fraction);
+      fflush(outfile);
+    }
+  }
+}
+
+} // namespace
+
+extern "C" void TestTransferOperators_Benchmark(CCTK_ARGUMENTS) {
+  DECLARE_CCTK_ARGUMENTS;
+  DECLARE_CCTK_PARAMETERS;
+
+  // Run on a single process only, so that processes do not compete
+  // for memory bandwidth
+  if (CCTK_MyProc(cctkGH) != 0)
+    return;
+
+  const vector<int> sizes = split_ints(box_sizes, "box_sizes");
+
+  // Determine the thread counts; an empty list means the default
+  // number of threads
+  vector<int> nthreads_list = split_ints(thread_counts, "thread_counts");
+#ifdef _OPENMP
+  const int default_nthreads = omp_get_max_threads();
+  if (nthreads_list.empty())
+    nthreads_list.push_back(default_nthreads);
+#else
+  nthreads_list.assign(1, 1);
+#endif
+
+  // Measure the memory bandwidth for each thread count
+  vector<double> bandwidths(nthreads_list.size());
+  for (size_t j = 0; j < nthreads_list.size(); ++j) {
+#ifdef _OPENMP
+    omp_set_num_threads(nthreads_list[j]);
+#endif
+    bandwidths[j] = stream_triad_bandwidth();
+    if (verbose) {
+      CCTK_VInfo(CCTK_THORNSTRING, "STREAM triad with %d threads: %g GB/s",
+                 nthreads_list[j], 1.0e-9 * bandwidths[j]);
+    }
+  }
+
+  FILE *outfile = NULL;
+  if (*out_filename) {
+    CCTK_CreateDirectory(0755, out_dir);
+    const string filename = string(out_dir) + "/" + out_filename;
+    outfile = fopen(filename.c_str(), "w");
+    if (not outfile) {
+      CCTK_VWarn(CCTK_WARN_ALERT, __LINE__, __FILE__, CCTK_THORNSTRING,
+                 "Could not open output file \"%s\"", filename.c_str());
+    } else {
+      fprintf(outfile, "# TestTransferOperators benchmark results\n"
+                       "# operator\ttype\torder\tn\tthreads\tseconds\t"
+                       "points/s\tGB/s\tSTREAM GB/s\tfraction of STREAM\n");
+    }
+  }
+
+  const vector<string> type_list = split(types);
+  const set<string> selected_types(type_list.begin(), type_list.end());
+
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    for (size_t j = 0; j < nthreads_list.size(); ++j) {
+#ifdef _OPENMP
+      omp_set_num_threads(nthreads_list[j]);
+#endif
+#define TYPECASE(N, T)                                                         \
+  {                                                                            \
+    /* strip the "CCTK_VARIABLE_" prefix */                                    \
+    const char *const type_name = CCTK_VarTypeName(N) + 14;                    \
+    if (selected_types.count("all") or selected_types.count(type_name))        \
+      run_benchmarks<T>(type_name, sizes[i], nthreads_list[j], bandwidths[j],  \
+                        outfile);                                              \
+  }
+#define CARPET_NO_COMPLEX
+#define CARPET_NO_INT
+#include <typecase.hh>
+#undef TYPECASE
+    }
+  }
+
+  if (outfile)
+    fclose(outfile);
+
+#ifdef _OPENMP
+  omp_set_num_threads(default_nthreads);
+#endif
+}
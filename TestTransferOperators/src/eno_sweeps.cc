@@ -0,0 +1,135 @@
+#include <cctk.h>
+#include <cctk_Arguments.h>
+#include <cctk_Parameters.h>
+
+#include <operator_prototypes_3d.hh>
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+using namespace CarpetLib;
+
+namespace {
+
+typedef void (*eno_operator_t)(
+    CCTK_REAL8 const *src, ivect3 const &srcpadext, ivect3 const &srcext,
+    CCTK_REAL8 *dst, ivect3 const &dstpadext, ivect3 const &dstext,
+    ibbox3 const &srcbbox, ibbox3 const &dstbbox, ibbox3 const &srcregbbox,
+    ibbox3 const &dstregbbox, void *extraargs);
+
+void set_sweeps(const char *const value) {
+  const int ierr =
+      CCTK_ParameterSet("eno_prolongation_sweeps", "CarpetLib", value);
+  if (ierr < 0)
+    CCTK_VERROR("Could not set CarpetLib::eno_prolongation_sweeps to \"%s\"",
+                value);
+}
+
+// Prolongate with the per-point kernel and with the sweeps (once over
+// the whole region, and once split into slabs as call_operator does),
+// and compare the results bitwise; returns the number of differing
+// points
+int check(const char *const name, const eno_operator_t op,
+          const ibbox3 &dstbox, const ibbox3 &regbox) {
+  // The source covers the destination plus ghost zones; cell centred
+  // coarse points lie at odd offsets from the fine points
+  const int ghosts = 4;
+  const ibbox3 srcbox(
+      (dstbox.lower() - ivect3(1)) / 4 * 4 - ivect3(4 * ghosts),
+      (dstbox.upper() + ivect3(1)) / 4 * 4 + ivect3(4 * ghosts), ivect3(4));
+  const ivect3 srcext = srcbox.shape() / srcbox.stride();
+  const ivect3 dstext = dstbox.shape() / dstbox.stride();
+
+  // Non-smooth data, so that the ENO stencil selection matters
+  vector<CCTK_REAL8> src(srcbox.size());
+  for (size_t i = 0; i < src.size(); ++i)
+    src[i] = sin(0.37 * i) + (i % 7 == 0 ? 1.0 : 0.0);
+
+  vector<CCTK_REAL8> dst0(dstbox.size(), 0.0), dst1(dstbox.size(), 0.0),
+      dst2(dstbox.size(), 0.0);
+
+  set_sweeps("no");
+  op(&src[0], srcext, srcext, &dst0[0], dstext, dstext, srcbox, dstbox,
+     srcbox, regbox, NULL);
+  set_sweeps("yes");
+  op(&src[0], srcext, srcext, &dst1[0], dstext, dstext, srcbox, dstbox,
+     srcbox, regbox, NULL);
+  const int stride = regbox.stride()[2];
+  const int mid = regbox.lower()[2] + regbox.shape()[2] / stride / 2 * stride;
+  const ibbox3 lo(regbox.lower(), regbox.upper().replace(2, mid - stride),
+                  regbox.stride());
+  const ibbox3 hi(regbox.lower().replace(2, mid), regbox.upper(),
+                  regbox.stride());
+  if (not lo.empty())
+    op(&src[0], srcext, srcext, &dst2[0], dstext, dstext, srcbox, dstbox,
+       srcbox, lo, NULL);
+  op(&src[0], srcext, srcext, &dst2[0], dstext, dstext, srcbox, dstbox, srcbox,
+     hi, NULL);
+
+  int ndiffs = 0;
+  for (size_t i = 0; i < dst0.size(); ++i) {
+    if (memcmp(&dst0[i], &dst1[i], sizeof dst0[i]) != 0 or
+        memcmp(&dst0[i], &dst2[i], sizeof dst0[i]) != 0)
+      ++ndiffs;
+  }
+  if (ndiffs) {
+    CCTK_VWARN(CCTK_WARN_ALERT,
+               "%s: %d points of the region [%d,%d,%d]:[%d,%d,%d] differ "
+               "between the sweeps and the per-point kernel",
+               name, ndiffs, regbox.lower()[0], regbox.lower()[1],
+               regbox.lower()[2], regbox.upper()[0], regbox.upper()[1],
+               regbox.upper()[2]);
+  }
+  return ndiffs;
+}
+
+} // namespace
+
+extern "C" void TestTransferOperators_CheckENOSweeps(CCTK_ARGUMENTS) {
+  DECLARE_CCTK_ARGUMENTS;
+  DECLARE_CCTK_PARAMETERS;
+
+  // Save the current setting
+  char *const saved_sweeps =
+      CCTK_ParameterValString("eno_prolongation_sweeps", "CarpetLib");
+  assert(saved_sweeps);
+
+  struct {
+    const char *name;
+    eno_operator_t op;
+  } const ops[] = {
+      {"prolongate_3d_cc_eno_rf2<2>", prolongate_3d_cc_eno_rf2<CCTK_REAL8, 2>},
+      {"prolongate_3d_cc_eno_rf2<3>", prolongate_3d_cc_eno_rf2<CCTK_REAL8, 3>},
+  };
+
+  // A destination box with stride 2, and regions starting and ending
+  // with all combinations of parities
+  const ibbox3 dstbox(ivect3(1), ivect3(41), ivect3(2));
+  int nfailures = 0;
+  for (size_t n = 0; n < sizeof ops / sizeof *ops; ++n) {
+    for (int lo = 0; lo < 2; ++lo) {
+      for (int hi = 0; hi < 2; ++hi) {
+        const ibbox3 regbox(ivect3(5 + 2 * lo, 9, 7 + 2 * lo),
+                            ivect3(29 + 2 * hi, 27 + 2 * hi, 33),
+                            ivect3(2));
+        if (check(ops[n].name, ops[n].op, dstbox, regbox))
+          ++nfailures;
+      }
+    }
+  }
+
+  set_sweeps(saved_sweeps);
+  free(saved_sweeps);
+
+  if (nfailures)
+    CCTK_VERROR("The sweep-based ENO prolongation differs from the "
+                "per-point kernel in %d cases",
+                nfailures);
+  if (verbose)
+    CCTK_INFO("The sweep-based ENO prolongation agrees bitwise with the "
+              "per-point kernel");
+}
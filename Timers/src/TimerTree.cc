@@ -39,6 +39,7 @@
 
 #include <dist.hh>
 #include <mpi_string.hh>
+#include <tracing.hh>
 
 #include "TimerTree.hh"
 
@@ -90,6 +91,7 @@ void TimerNode::start() {
     d_timer = new CactusTimer(pathName());
   assert(d_timer);
   d_timer->start();
+  CarpetLib::tracing::begin(d_name.c_str(), CarpetLib::tracing::cat_timer);
 }
 
 void TimerNode::stop() {
@@ -100,6 +102,7 @@ void TimerNode::stop() {
     CCTK_VERROR("Tried to stop non-current timer '%s'", getName().c_str());
 
   d_timer->stop();
+  CarpetLib::tracing::end(d_name.c_str(), CarpetLib::tracing::cat_timer);
 
   d_running = false;
   d_tree->current = d_parent;